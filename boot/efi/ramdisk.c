@@ -6,6 +6,7 @@
 #include <tilck/common/page_size.h>
 #include <tilck/common/assert.h>
 #include <tilck/common/fat32_base.h>
+#include <tilck/common/lz4.h>
 #include <tilck/common/utils.h>
 
 #include "defs.h"
@@ -22,6 +23,9 @@ struct load_ramdisk_ctx {
    UINT32 rounded_tot_used_bytes;   /* Rounded up at PAGE_SIZE */
 
    void *fat_hdr;
+
+   bool compressed;                 /* The initrd is an LZ4 frame */
+   struct lz4f_info lz4;
 };
 
 static EFI_STATUS
@@ -43,6 +47,22 @@ LoadRamdisk_GetTotFatSize(struct load_ramdisk_ctx *ctx)
    status = ReadAlignedBlock(ctx->blockio, initrd_off, PAGE_SIZE, fat_hdr);
    HANDLE_EFI_ERROR("ReadAlignedBlock");
 
+   if (lz4f_is_frame(fat_hdr)) {
+
+      ctx->compressed = true;
+
+      if (lz4f_read_header(fat_hdr, PAGE_SIZE, &ctx->lz4) ||
+          !ctx->lz4.content_size ||
+          ctx->lz4.content_size >= LINEAR_MAPPING_SIZE)
+      {
+         Print(L"Unsupported LZ4 initrd\n");
+         status = EFI_UNSUPPORTED;
+      }
+
+      BS->FreePages(paddr, 1);
+      goto end;
+   }
+
    fat_sec_sz = fat_get_sector_size(fat_hdr);
    ctx->total_fat_size = (fat_get_first_data_sector(fat_hdr) + 1) * fat_sec_sz;
    ctx->rounded_tot_fat_sz = round_up_at(ctx->total_fat_size, PAGE_SIZE);
@@ -167,6 +187,85 @@ end:
    return status;
 }
 
+/*
+ * Reads the LZ4-compressed initrd (see lz4.h) decompressing it on the fly,
+ * chunk by chunk. The chunks are read in an aligned buffer and then appended
+ * to the input buffer of the decoder, which always keeps only the incomplete
+ * block at its end.
+ */
+static EFI_STATUS
+LoadRamdisk_ReadLz4(struct load_ramdisk_ctx *ctx)
+{
+   const UINTN ChunkSize = 256 * KB;
+   const UINT32 blockSize = ctx->blockio->Media->BlockSize;
+   const UINT64 diskSize = (ctx->blockio->Media->LastBlock + 1) * blockSize;
+   const UINT32 content_size = (UINT32)ctx->lz4.content_size;
+   UINT64 offset = INITRD_SECTOR * SECTOR_SIZE;
+   EFI_PHYSICAL_ADDRESS paddr = 0;
+   EFI_STATUS status;
+   struct lz4f_stream s;
+   UINTN buf_pages, in_size, have = 0, len;
+   u32 used;
+   void *chunk, *in_buf;
+   int rc;
+
+   in_size = round_up_at(ctx->lz4.block_max_size + LZ4F_MAX_BLOCK_OVERHEAD,
+                         PAGE_SIZE) + ChunkSize;
+   buf_pages = (ChunkSize + in_size) / PAGE_SIZE;
+
+   status = BS->AllocatePages(AllocateAnyPages,
+                              EfiLoaderData,
+                              buf_pages,
+                              &paddr);
+   HANDLE_EFI_ERROR("AllocatePages");
+
+   chunk = TO_PTR(paddr);
+   in_buf = chunk + ChunkSize;
+   lz4f_stream_init(&s, ctx->fat_hdr, content_size);
+
+   do {
+
+      len = (UINTN)MIN((UINT64)ChunkSize, diskSize - offset);
+
+      if (!len || in_size - have < len) {
+         status = EFI_VOLUME_CORRUPTED;
+         break;
+      }
+
+      status = ReadAlignedBlock(ctx->blockio, offset, len, chunk);
+
+      if (EFI_ERROR(status))
+         break;
+
+      BS->CopyMem(in_buf + have, chunk, len);
+      offset += len;
+      have += len;
+
+      rc = lz4f_stream_decode(&s, in_buf, (u32)have, &used);
+
+      if (rc < 0) {
+         status = EFI_VOLUME_CORRUPTED;
+         break;
+      }
+
+      have -= used;
+      BS->CopyMem(in_buf, in_buf + used, have);
+      ShowProgress(ST->ConOut, LOADING_INITRD_STR_U, s.out_pos, content_size);
+
+   } while (!rc);
+
+   BS->FreePages(paddr, buf_pages);
+
+   if (!EFI_ERROR(status) && s.out_pos != content_size)
+      status = EFI_VOLUME_CORRUPTED;
+
+   HANDLE_EFI_ERROR("LoadRamdisk_ReadLz4");
+   ctx->tot_used_bytes = fat_calculate_used_bytes(ctx->fat_hdr);
+
+end:
+   return status;
+}
+
 static EFI_STATUS
 GetPhysBlockIODeviceHandle(EFI_LOADED_IMAGE *img, EFI_HANDLE *ref)
 {
@@ -249,19 +348,33 @@ LoadRamdisk(EFI_HANDLE image,
    status = LoadRamdisk_GetTotFatSize(&ctx);
    HANDLE_EFI_ERROR("LoadRamdisk_GetTotFatSize");
 
-   status = LoadRamdisk_GetTotUsedBytes(&ctx);
-   HANDLE_EFI_ERROR("LoadRamdisk_GetTotUsedBytes");
+   if (ctx.compressed) {
+
+      ctx.rounded_tot_used_bytes =
+         round_up_at((UINT32)ctx.lz4.content_size, PAGE_SIZE);
 
-   status = LoadRamdisk_AllocMem(&ctx);
-   HANDLE_EFI_ERROR("LoadRamdisk_AllocMem");
+      status = LoadRamdisk_AllocMem(&ctx);
+      HANDLE_EFI_ERROR("LoadRamdisk_AllocMem");
 
-   status = ReadDiskWithProgress(ST->ConOut,
-                                 LOADING_INITRD_STR_U,
-                                 ctx.blockio,
-                                 initrd_off,
-                                 ctx.rounded_tot_used_bytes,
-                                 ctx.fat_hdr);
-   HANDLE_EFI_ERROR("ReadDiskWithProgress");
+      status = LoadRamdisk_ReadLz4(&ctx);
+      HANDLE_EFI_ERROR("LoadRamdisk_ReadLz4");
+
+   } else {
+
+      status = LoadRamdisk_GetTotUsedBytes(&ctx);
+      HANDLE_EFI_ERROR("LoadRamdisk_GetTotUsedBytes");
+
+      status = LoadRamdisk_AllocMem(&ctx);
+      HANDLE_EFI_ERROR("LoadRamdisk_AllocMem");
+
+      status = ReadDiskWithProgress(ST->ConOut,
+                                    LOADING_INITRD_STR_U,
+                                    ctx.blockio,
+                                    initrd_off,
+                                    ctx.rounded_tot_used_bytes,
+                                    ctx.fat_hdr);
+      HANDLE_EFI_ERROR("ReadDiskWithProgress");
+   }
 
    /* Now we're done with the BlockIoProtocol, close it. */
    BS->CloseProtocol(bioDeviceHandle, &BlockIoProtocol, image, NULL);
@@ -4,6 +4,9 @@
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/fat32_base.h>
+#include <tilck/common/lz4.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/utils.h>
 #include <tilck/common/printk.h>
 #include <tilck/common/color_defs.h>
 
@@ -157,6 +160,97 @@ check_fat_header(struct fat_hdr *hdr)
    return true;
 }
 
+/*
+ * Loads an LZ4-compressed ramdisk (see lz4.h), decompressing it while reading
+ * the sectors, chunk by chunk, in a small staging buffer placed right after the
+ * output buffer. That way, the compressed image is never entirely in memory
+ * and we read from the disk only the compressed bytes.
+ */
+static bool
+load_lz4_ramdisk(const char *load_str,
+                 struct lz4f_info *info,
+                 u32 first_sec,
+                 ulong min_paddr,
+                 ulong *ref_rd_paddr,
+                 u32 *ref_rd_size,
+                 bool alloc_extra_page)
+{
+   const u32 chunk_sectors = 128;
+   const u32 chunk_sz = chunk_sectors * SECTOR_SIZE;
+   struct lz4f_stream s;
+   ulong out_paddr, stage_paddr;
+   u32 out_sz, stage_sz, have = 0, used;
+   u32 sec = first_sec;
+   int rc;
+
+   if (!info->content_size || info->content_size >= 1ull << 32)
+      goto corrupted;
+
+   out_sz = pow2_round_up_at((u32)info->content_size, SECTOR_SIZE);
+
+   if (alloc_extra_page)
+      out_sz += PAGE_SIZE;
+
+   out_paddr = get_usable_mem(&g_meminfo, min_paddr, out_sz);
+
+   if (!out_paddr || overlap_with_kernel_file(out_paddr, out_sz))
+      goto oom;
+
+   stage_sz = info->block_max_size + LZ4F_MAX_BLOCK_OVERHEAD + chunk_sz;
+   stage_paddr = get_usable_mem(&g_meminfo, out_paddr + out_sz, stage_sz);
+
+   if (!stage_paddr || overlap_with_kernel_file(stage_paddr, stage_sz))
+      goto oom;
+
+   lz4f_stream_init(&s, (void *)out_paddr, (u32)info->content_size);
+
+   do {
+
+      if (stage_sz - have < chunk_sz)
+         goto corrupted;   /* a block bigger than block_max_size? */
+
+      read_sectors(stage_paddr + have, sec, chunk_sectors);
+      sec += chunk_sectors;
+      have += chunk_sz;
+
+      rc = lz4f_stream_decode(&s, (void *)stage_paddr, have, &used);
+
+      if (rc < 0)
+         goto corrupted;
+
+      have -= used;
+      memmove((void *)stage_paddr, (void *)(stage_paddr + used), have);
+      dump_progress(load_str, s.out_pos, (u32)info->content_size);
+
+   } while (!rc);
+
+   if (s.out_pos != info->content_size)
+      goto corrupted;
+
+   if (!check_fat_header((void *)out_paddr))
+      goto corrupted;
+
+   bt_movecur(bt_get_curr_row(), 0);
+   printk("%s", load_str);
+   write_ok_msg();
+
+   *ref_rd_paddr = out_paddr;
+   *ref_rd_size = fat_calculate_used_bytes((void *)out_paddr);
+   return true;
+
+oom:
+   printk("No free memory for loading the ramdisk\n");
+   goto end;
+
+corrupted:
+   printk("\nLZ4 ramdisk corrupted\n");
+   goto end;
+
+end:
+   write_fail_msg();
+   return false;
+}
+
 bool
 load_fat_ramdisk(const char *load_str,
                  u32 first_sec,
@@ -171,6 +265,7 @@ load_fat_ramdisk(const char *load_str,
    ulong rd_paddr;         /* ramdisk physical address */
    ulong free_mem;
    ulong size_to_alloc;
+   struct lz4f_info lz4_info;
 
    printk("%s", load_str);
    free_mem = get_usable_mem(&g_meminfo, min_paddr, SECTOR_SIZE);
@@ -181,6 +276,15 @@ load_fat_ramdisk(const char *load_str,
    // Read FAT's header
    read_sectors(free_mem, first_sec, 1 /* read just 1 sector */);
 
+   if (lz4f_is_frame((void *)free_mem)) {
+
+      if (lz4f_read_header((void *)free_mem, SECTOR_SIZE, &lz4_info))
+         goto corrupted;
+
+      return load_lz4_ramdisk(load_str, &lz4_info, first_sec, min_paddr,
+                              ref_rd_paddr, ref_rd_size, alloc_extra_page);
+   }
+
    // Do some sanity checks against data corruption
    if (!check_fat_header((void *)free_mem))
       goto corrupted;
@@ -39,10 +39,11 @@ void get_cpu_features(void)
       goto ext_features;
 
    /* CPUID[7] supported */
-   if (f->ecx1.avx) {
-      cpuid(7, &a, &b, &c, &d);
+   cpuid(7, &a, &b, &c, &d);
+   f->erms = !!(b & (1 << 9));
+
+   if (f->ecx1.avx)
       f->avx2 = !!(b & (1 << 5)) && !!(b & (1 << 3)) && !!(b & (1 << 8));
-   }
 
 ext_features:
 
@@ -179,6 +180,9 @@ void dump_x86_features(void)
    if (x86_cpu_features.avx2)
       w += (u32)snprintk(buf + w, sizeof(buf) - w, "avx2 ");
 
+   if (x86_cpu_features.erms)
+      w += (u32)snprintk(buf + w, sizeof(buf) - w, "erms ");
+
    if (w)
       printk("%s\n", buf);
 }
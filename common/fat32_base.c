@@ -24,7 +24,7 @@
 #define FAT_ENTRY_LAST                       ((char)0)
 #define FAT_ENTRY_AVAILABLE                  ((char)0xE5)
 
-static u8 shortname_checksum(u8 *shortname)
+u8 fat_shortname_checksum(u8 *shortname)
 {
    u8 sum = 0;
 
@@ -229,7 +229,7 @@ static const char *
 finalize_long_name(struct fat_walk_long_name_ctx *ctx,
                    struct fat_entry *e)
 {
-   const s16 e_checksum = shortname_checksum((u8 *)e->DIR_Name);
+   const s16 e_checksum = fat_shortname_checksum((u8 *)e->DIR_Name);
 
    if (ctx->lname_chksum == e_checksum) {
       ctx->lname_buf[ctx->lname_sz] = 0;
@@ -269,7 +269,15 @@ fat_walk(struct fat_walk_static_params *p, u32 cluster)
           * In that case, fat_get_rootdir() returns 0 as cluster. In all the
           * other cases, we need only the cluster.
           */
-         dentries = fat_get_pointer_to_cluster_data(p->h, cluster);
+         if (p->get_cluster) {
+
+            if (!(dentries = p->get_cluster(p->get_cluster_arg, cluster)))
+               return -5; /* -EIO */
+
+         } else {
+
+            dentries = fat_get_pointer_to_cluster_data(p->h, cluster);
+         }
       }
 
       ASSERT(dentries != NULL);
@@ -369,7 +377,7 @@ enum fat_type fat_get_type(struct fat_hdr *hdr)
    }
 }
 
-static void *
+void *
 fat_get_entry_ptr(struct fat_hdr *h, enum fat_type ft, u32 fatN, u32 clu)
 {
    STATIC_ASSERT(fat16_type == 2);
@@ -0,0 +1,249 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/unaligned.h>
+#include <tilck/common/lz4.h>
+
+/*
+ * See the LZ4 block and frame format descriptions:
+ *
+ *    https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+ *    https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md
+ */
+
+#define FLG_VERSION_MASK                       0xC0
+#define FLG_VERSION_01                         0x40
+#define FLG_BLOCK_CHECKSUM                     0x10
+#define FLG_CONTENT_SIZE                       0x08
+#define FLG_CONTENT_CHECKSUM                   0x04
+#define FLG_DICT_ID                            0x01
+
+#define BLOCK_UNCOMPRESSED_FLAG          0x80000000
+#define MIN_MATCH                                 4
+
+int lz4f_read_header(const void *buf, u32 len, struct lz4f_info *info)
+{
+   const u8 *p = buf;
+   u8 flg, bd;
+   u32 size = 7;     /* magic (4) + FLG + BD + HC */
+
+   if (len < size)
+      return 1;
+
+   if (!lz4f_is_frame(p))
+      return -1;
+
+   flg = p[4];
+   bd = p[5];
+
+   if ((flg & FLG_VERSION_MASK) != FLG_VERSION_01)
+      return -1;
+
+   if (flg & FLG_DICT_ID)
+      return -1;
+
+   if (((bd >> 4) & 7) < 4)
+      return -1;
+
+   if (flg & FLG_CONTENT_SIZE)
+      size += 8;
+
+   if (len < size)
+      return 1;
+
+   info->block_max_size = 1u << (8 + 2 * ((bd >> 4) & 7));
+   info->block_checksum = !!(flg & FLG_BLOCK_CHECKSUM);
+   info->content_checksum = !!(flg & FLG_CONTENT_CHECKSUM);
+   info->content_size = (flg & FLG_CONTENT_SIZE) ? READ_U64(p + 6) : 0;
+   info->header_size = size;
+   return 0;
+}
+
+/* Reads a length encoded as a sequence of 255s terminated by a byte < 255 */
+static inline bool
+read_ext_len(const u8 **ip, const u8 *iend, u32 *len)
+{
+   u8 b;
+
+   do {
+
+      if (*ip >= iend)
+         return false;
+
+      b = *(*ip)++;
+      *len += b;
+
+   } while (b == 255);
+
+   return true;
+}
+
+int lz4_decompress_block(const void *src, u32 src_len,
+                         u8 *out, u32 out_pos, u32 out_size)
+{
+   const u8 *ip = src;
+   const u8 *const iend = ip + src_len;
+   u8 *op = out + out_pos;
+   u8 *const oend = out + out_size;
+   u32 lit_len, match_len, offset;
+   const u8 *match;
+   u8 token;
+
+   while (ip < iend) {
+
+      token = *ip++;
+      lit_len = token >> 4;
+
+      if (lit_len == 15 && !read_ext_len(&ip, iend, &lit_len))
+         return -1;
+
+      if (lit_len > (u32)(iend - ip) || lit_len > (u32)(oend - op))
+         return -1;
+
+      memcpy(op, ip, lit_len);
+      ip += lit_len;
+      op += lit_len;
+
+      if (ip == iend)
+         break;      /* The last sequence has only literals */
+
+      if (iend - ip < 2)
+         return -1;
+
+      offset = READ_U16(ip);
+      ip += 2;
+
+      if (!offset || offset > (u32)(op - out))
+         return -1;
+
+      match_len = token & 15;
+
+      if (match_len == 15 && !read_ext_len(&ip, iend, &match_len))
+         return -1;
+
+      match_len += MIN_MATCH;
+
+      if (match_len > (u32)(oend - op))
+         return -1;
+
+      match = op - offset;
+
+      if (offset >= match_len) {
+
+         memcpy(op, match, match_len);
+         op += match_len;
+
+      } else {
+
+         /* Overlapping copy: it repeats the last `offset` bytes */
+         for (u32 i = 0; i < match_len; i++)
+            *op++ = *match++;
+      }
+   }
+
+   return (int)(op - (out + out_pos));
+}
+
+void lz4f_stream_init(struct lz4f_stream *s, void *out, u32 out_size)
+{
+   memset(s, 0, sizeof(*s));
+   s->out = out;
+   s->out_size = out_size;
+}
+
+int lz4f_stream_decode(struct lz4f_stream *s,
+                       const void *in, u32 in_len, u32 *consumed)
+{
+   const u8 *p = in;
+   u32 pos = 0;
+   int rc = 0;
+
+   if (!s->header_done) {
+
+      if ((rc = lz4f_read_header(p, in_len, &s->info))) {
+         rc = rc > 0 ? 0 : -1;      /* need more bytes or invalid header */
+         goto out;
+      }
+
+      pos += s->info.header_size;
+      s->header_done = true;
+   }
+
+   while (!s->done) {
+
+      const u32 csum_sz = s->info.block_checksum ? 4 : 0;
+      u32 bsize, data_sz;
+
+      if (in_len - pos < 4)
+         break;
+
+      bsize = READ_U32(p + pos);
+      data_sz = bsize & ~BLOCK_UNCOMPRESSED_FLAG;
+
+      if (!bsize) {
+
+         /* EndMark, possibly followed by the content checksum */
+         const u32 tail = 4 + (s->info.content_checksum ? 4 : 0);
+
+         if (in_len - pos < tail)
+            break;
+
+         pos += tail;
+         s->done = true;
+         break;
+      }
+
+      if (data_sz > s->info.block_max_size) {
+         rc = -1;
+         goto out;
+      }
+
+      if (in_len - pos < 4 + data_sz + csum_sz)
+         break;      /* incomplete block: wait for more input */
+
+      if (bsize & BLOCK_UNCOMPRESSED_FLAG) {
+
+         if (data_sz > s->out_size - s->out_pos) {
+            rc = -1;
+            goto out;
+         }
+
+         memcpy(s->out + s->out_pos, p + pos + 4, data_sz);
+         s->out_pos += data_sz;
+
+      } else {
+
+         rc = lz4_decompress_block(p + pos + 4, data_sz,
+                                   s->out, s->out_pos, s->out_size);
+         if (rc < 0)
+            goto out;
+
+         s->out_pos += (u32)rc;
+         rc = 0;
+      }
+
+      pos += 4 + data_sz + csum_sz;
+   }
+
+   rc = s->done ? 1 : 0;
+
+out:
+   *consumed = pos;
+   return rc;
+}
+
+long lz4f_decompress(const void *src, u32 src_len, void *dst, u32 dst_size)
+{
+   struct lz4f_stream s;
+   u32 consumed;
+   int rc;
+
+   lz4f_stream_init(&s, dst, dst_size);
+   rc = lz4f_stream_decode(&s, src, src_len, &consumed);
+
+   if (rc != 1)
+      return -1;
+
+   return (long)s.out_pos;
+}
@@ -16,4 +16,5 @@
 /* --------- Boolean config variables --------- */
 #cmakedefine01 KERNEL_FORCE_TC_ISYSTEM
 #cmakedefine01 KERNEL_SAT
+#cmakedefine01 KERNEL_INITRD_RW
 #cmakedefine01 KERNEL_64BIT_OFFT
@@ -21,9 +21,12 @@
 #cmakedefine01 KERNEL_SELFTESTS
 #cmakedefine01 KRN_STACK_ISOLATION
 #cmakedefine01 KRN_SYMBOLS
+#cmakedefine01 KRN_SYSCALL_STATS
+#cmakedefine01 KRN_BOOT_TRACE
 
 /* opt-in debug features */
 #cmakedefine01 KRN_HANG_DETECTION
+#cmakedefine01 KRN_LOCKSTAT
 
 /*
  * --------------------------------------------------------------------------
@@ -51,3 +51,6 @@
 #define WTH_MAX_PRIO_QUEUE_SIZE                    32
 #define WTH_KB_QUEUE_SIZE                          32
 #define WTH_SERIAL_QUEUE_SIZE                      32
+#define WTH_TTY_OUT_QUEUE_SIZE                     32
+#define WTH_POOL_MAX_THREADS                        4
+#define WTH_MAX_DELAYED_JOBS                       32
@@ -16,6 +16,7 @@
 #cmakedefine01 KRN_KMALLOC_HEAVY_STATS
 #cmakedefine01 KRN_KMALLOC_SUPPORT_DEBUG_LOG
 #cmakedefine01 KRN_KMALLOC_SUPPORT_LEAK_DETECTOR
+#cmakedefine01 KRN_KMALLOC_PROFILER
 
 
 /*
@@ -32,4 +33,9 @@
  * variable.
  */
 
-/* --- NOTHING HERE at the moment --- */
+/*
+ * Average number of allocated bytes between two samples of the kmalloc
+ * profiler (KRN_KMALLOC_PROFILER). The intervals are exponentially distributed
+ * as in pprof's heap_v2 profiles, which use this value to scale the samples.
+ */
+#define KMALLOC_PROF_SAMPLE_RATE                    (4 * KB)
@@ -14,9 +14,16 @@
 /* Include the shared MM config from the root build */
 #include "@BUILD_DIR@/tilck_gen_headers/config_mm.h"
 
+/* ------ Boolean config variables -------- */
+
+#cmakedefine01 KRN_PAGE_ALLOC
+
 /* ------ Value-based config variables -------- */
 
 #define KRN_USER_STACK_PAGES       @KRN_USER_STACK_PAGES@
+#define KRN_PAGE_ALLOC_POOL_PERCENT       @KRN_PAGE_ALLOC_POOL_PERCENT@
+#define KRN_BCACHE_PAGES                  @KRN_BCACHE_PAGES@
+#define KRN_BCACHE_READAHEAD              @KRN_BCACHE_READAHEAD@
 
 
 /*
@@ -47,3 +54,7 @@
 
 #define USERMODE_STACK_MAX \
    ((USERMODE_VADDR_END - 1) & ALIGNED_MASK(USERMODE_STACK_ALIGN))
+
+#define PAGE_ALLOC_MAX_ORDER                 10 /* 4 MB blocks */
+#define PAGE_ALLOC_ZERO_CACHE_MAX            64 /* pre-zeroed pages */
+#define PAGE_ALLOC_ZERO_CACHE_LOW            16 /* refill watermark */
@@ -9,6 +9,7 @@
 
 /* ------ Value-based config variables -------- */
 #define KRN_MAX_HANDLES            @KRN_MAX_HANDLES@
+#define KRN_NOFILE_MAX             @KRN_NOFILE_MAX@
 
 /* --------- Boolean config variables --------- */
 #cmakedefine01 KRN_BIG_IO_BUF
@@ -14,11 +14,14 @@
 /* ------ Value-based config variables -------- */
 
 #define KRN_TERM_SCROLL_LINES      @KRN_TERM_SCROLL_LINES@
+#define KRN_TTY_INPUT_BS           @KRN_TTY_INPUT_BS@
 
 /* --------- Kernel-private boolean config variables --------- */
 
 #cmakedefine01    KRN_SHOW_LOGO
 #cmakedefine01    KRN_PRINTK_ON_CURR_TTY
+#cmakedefine01    KRN_TTY_ASYNC_OUTPUT
+#cmakedefine01    KRN_PRINTK_DEFERRED
 
 #ifdef KERNEL_TEST
    #define MOD_console_actual 1
@@ -32,6 +35,11 @@
  * --------------------------------------------------------------------------
  */
 
-#define TTY_INPUT_BS                                              1024
+#define TTY_INPUT_BS                                  KRN_TTY_INPUT_BS
+#define TTY_INPUT_MAX_LINES                          (TTY_INPUT_BS / 8)
+#define TTY_OUTPUT_BS                                             4096
+#define TTY_OUTPUT_FLUSH_BS                                       1024
+#define TERM_SB_CHUNK_SIZE                                        4096
+#define TERM_SB_MAX_ROWS                                   (64 * 1024)
 #define FAILSAFE_COLS                                              80u
 #define FAILSAFE_ROWS                                              25u
@@ -3,7 +3,7 @@
 /*
  * Shim for <linux/sched.h>.
  * On Linux, forward to the real header. On other platforms, provide the
- * clone flags that Tilck needs.
+ * clone flags and the scheduling policies that Tilck needs.
  */
 
 #pragma once
@@ -15,4 +15,16 @@
 #define CLONE_VM     0x00000100
 #define CLONE_VFORK  0x00004000
 
+#define SCHED_NORMAL               0
+#define SCHED_FIFO                 1
+#define SCHED_RR                   2
+#define SCHED_BATCH                3
+#define SCHED_IDLE                 5
+#define SCHED_DEADLINE             6
+#define SCHED_RESET_ON_FORK        0x40000000
+
+#define SCHED_FLAG_RESET_ON_FORK   0x01
+#define SCHED_FLAG_KEEP_POLICY     0x08
+#define SCHED_FLAG_KEEP_PARAMS     0x10
+
 #endif /* !__linux__ */
@@ -19,6 +19,8 @@ DEFINE_KOPT(selftest          ,     , wordstr, NULL)
 DEFINE_KOPT(sched_alive_thread, sat , bool,    KERNEL_SAT)
 DEFINE_KOPT(sercon            ,     , bool,    KERNEL_SERCON || !MOD_console)
 DEFINE_KOPT(noacpi            ,     , bool,    false)
+DEFINE_KOPT(initrd_rw         , irw , bool,    KERNEL_INITRD_RW)
+DEFINE_KOPT(blkdev_rw         , brw , bool,    false)
 DEFINE_KOPT(fb_no_opt         ,     , bool,    false)
 DEFINE_KOPT(fb_no_wc          ,     , bool,    false)
 DEFINE_KOPT(no_fpu_memcpy     ,     , bool,    false)
@@ -91,6 +91,10 @@ struct dp_trace_stats {
    s32  printk_lvl;          /* trace_printk verbosity threshold */
    s32  sys_traced_count;    /* number of syscalls in the filter */
    s32  tasks_traced_count;  /* number of tasks with .traced=true */
+   u32  in_buf_count;        /* events currently in the ring buffer */
+   u32  buf_capacity;        /* max events in the ring buffer */
+   u64  written_count;       /* events ever written in the ring buffer */
+   u64  dropped_count;       /* events dropped because the ring was full */
 };
 
 /*
@@ -214,6 +218,62 @@ struct dp_mem_global_stats {
    u64  kernel_used;
 };
 
+/*
+ * Page-frame allocator stats shown below the global stats in MemMap.
+ * Counters are in pages. `free_blocks[i]` is the number of free blocks
+ * of 2^i pages; orders above `max_order` are always zero.
+ */
+#define DP_PAGE_ALLOC_MAX_ORDERS          16
+
+struct dp_page_alloc_stats {
+
+   u64  tot_pages;
+   u64  free_pages;
+   u64  zero_cache_pages;
+   u64  fallback_allocs;        /* allocations served by kmalloc */
+   u32  max_order;
+   s32  largest_free_order;     /* -1 if there are no free blocks */
+   u64  free_blocks[DP_PAGE_ALLOC_MAX_ORDERS];
+};
+
+/*
+ * One row in the Syscalls panel. `hist[i]` counts the calls which took
+ * [2^i, 2^(i+1)) cycles, the last bucket everything above. In the
+ * per-process stats, only `count` and `tot_cycles` are set.
+ */
+#define DP_SYSCALL_STATS_BUCKETS          32
+
+struct dp_syscall_stats {
+
+   u32  sys_n;
+   u32  reserved;
+   u64  count;
+   u64  tot_cycles;
+   u64  max_cycles;
+   u32  hist[DP_SYSCALL_STATS_BUCKETS];
+};
+
+/*
+ * One row in the Locks panel: the stats of a lock class (see lockstat.h).
+ * Times are in cycles. `type` is 0 for kmutex, 1 for rwlock_wp and 2 for
+ * kcond; `holds` counts the acquisitions with a measured hold time.
+ */
+#define DP_LOCKSTAT_NAME_MAX              48
+
+struct dp_lockstat_class {
+
+   u32  type;
+   u32  locks;
+   u64  acquired;
+   u64  contended;
+   u64  wait_tot;
+   u64  wait_max;
+   u64  holds;
+   u64  hold_tot;
+   u64  hold_max;
+   char name[DP_LOCKSTAT_NAME_MAX];
+};
+
 /* One row in the MTRRs panel (x86 only). */
 struct dp_mtrr_entry {
 
@@ -264,6 +324,78 @@ struct dp_runtime_info {
    u32  clk_multi_second_resync_count;
 };
 
+/*
+ * Statistics page
+ * -----------------
+ *
+ * A read-only region exported as DP_STATS_PATH, which the kernel refreshes
+ * every DP_STATS_REFRESH_MS while at least one process has it mapped. The
+ * dp tool mmap()s it once and then reads the counters with no syscalls at
+ * all. The kernel makes `seq` odd while updating the region: readers must
+ * copy what they need between dp_stats_read_begin() and dp_stats_read_retry()
+ * and start over when the latter returns true (seqlock).
+ *
+ * A read() of the file works too: it refreshes the data before copying it.
+ */
+#define DP_STATS_PATH           "/syst/dp/stats"
+#define DP_STATS_SIZE           (16 * 1024)    /* multiple of the page size */
+#define DP_STATS_MAX_TASKS      128
+#define DP_STATS_REFRESH_MS     250
+
+struct dp_stats_task {
+
+   struct dp_task_info info;
+   u64  ticks;                   /* total life-time ticks */
+   u64  kernel_ticks;            /* ticks spent in kernel mode */
+};
+
+struct dp_stats {
+
+   u32  seq;                     /* odd while the kernel is writing */
+   u32  timer_hz;
+   u64  updates;                 /* count of refreshes so far */
+   u64  ticks;                   /* get_ticks() at the last refresh */
+
+   /* Scheduler */
+   u64  idle_ticks;
+   u32  runnable_count;
+   u32  tot_tasks;               /* might be > tasks_count */
+   u32  tasks_count;             /* valid elements in tasks[] */
+   u32  reserved;
+
+   /* IRQs */
+   struct dp_irq_stats irqs;
+
+   /* Memory */
+   u64  kmalloc_used;
+   u64  kmalloc_heaps_size;
+   u64  page_alloc_tot_pages;
+   u64  page_alloc_free_pages;
+
+   struct dp_stats_task tasks[DP_STATS_MAX_TASKS];
+};
+
+STATIC_ASSERT(sizeof(struct dp_stats) <= DP_STATS_SIZE);
+
+static inline u32
+dp_stats_read_begin(const volatile struct dp_stats *s)
+{
+   u32 seq;
+
+   while ((seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE)) & 1) {
+      /* The kernel is in the middle of a refresh */
+   }
+
+   return seq;
+}
+
+static inline bool
+dp_stats_read_retry(const volatile struct dp_stats *s, u32 seq)
+{
+   __atomic_thread_fence(__ATOMIC_ACQUIRE);
+   return __atomic_load_n(&s->seq, __ATOMIC_RELAXED) != seq;
+}
+
 /* ----------------- sub-command argument conventions -----------------
  *
  * sys_tilck_cmd(int cmd_n, ulong a1, ulong a2, ulong a3, ulong a4)
@@ -303,10 +435,26 @@ struct dp_runtime_info {
  *   a3 = struct dp_mtrr_info __user *info  (NULL allowed)
  *   returns: count, or -ENOTSUP on non-x86
  *
+ * GET_PAGE_ALLOC_STATS:
+ *   a1 = struct dp_page_alloc_stats __user *out
+ *   returns: 0, or -errno
+ *
  * GET_RUNTIME_INFO:
  *   a1 = struct dp_runtime_info __user *out
  *   returns: 0, or -errno
  *
+ * GET_SYSCALL_STATS:
+ *   a1 = struct dp_syscall_stats __user *buf
+ *   a2 = ulong max_count
+ *   a3 = ulong pid  (0 for the global stats)
+ *   returns: count of the syscalls called at least once, or -ENOTSUP if
+ *            KRN_SYSCALL_STATS is off, -ESRCH if there's no such process
+ *
+ * GET_LOCKSTAT:
+ *   a1 = struct dp_lockstat_class __user *buf
+ *   a2 = ulong max_count
+ *   returns: count of the lock classes, or -ENOTSUP if KRN_LOCKSTAT is off
+ *
  * TRACE_SET_FILTER:
  *   a1 = const char __user *expr   (NUL-terminated, ≤ DP_TRACE_FILTER_MAX)
  *   returns: 0, or -errno
@@ -144,6 +144,13 @@ fat_write_fat_entry(struct fat_hdr *h,
                     u32 clusterN,
                     u32 value);
 
+/* Returns a pointer to the entry for `clu` in the FAT `fatN` */
+void *
+fat_get_entry_ptr(struct fat_hdr *h, enum fat_type ft, u32 fatN, u32 clu);
+
+/* The checksum of the 11-char short name, stored in its long name entries */
+u8 fat_shortname_checksum(u8 *shortname);
+
 u32 fat_get_first_data_sector(struct fat_hdr *hdr);
 u32 fat_get_cluster_count(struct fat_hdr *hdr);
 
@@ -252,6 +259,8 @@ typedef int (*fat_dentry_cb)(struct fat_hdr *,
                              const char *,         /* long name */
                              void *);              /* user data pointer */
 
+typedef void *(*fat_get_cluster_cb)(void *, u32);   /* (arg, cluster) */
+
 struct fat_walk_static_params {
 
    struct fat_walk_long_name_ctx *ctx;
@@ -259,6 +268,16 @@ struct fat_walk_static_params {
    enum fat_type ft;
    fat_dentry_cb cb;
    void *arg;
+
+   /*
+    * Optional. When set, it's used instead of fat_get_pointer_to_cluster_data()
+    * to get the data of the dir's clusters, with `get_cluster_arg` as first
+    * argument. That's needed when `h` is not followed in memory by the whole
+    * partition (e.g. when it's mounted from a block device). Returning NULL
+    * makes fat_walk() fail with -EIO.
+    */
+   fat_get_cluster_cb get_cluster;
+   void *get_cluster_arg;
 };
 
 /*
@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Minimal LZ4 frame decoder, shared by the bootloaders, the kernel and the
+ * build apps. It's used for the compressed initrd.
+ *
+ * Supported: the standard LZ4 frame format, with linked or independent blocks
+ * of any max size. The optional checksums are skipped, not verified.
+ * Dictionary IDs and skippable frames are not supported.
+ *
+ * The output is always a single contiguous buffer. That's what makes the
+ * streaming easy: with linked blocks, the matches can refer to any of the
+ * previous 64 KB of output, which is always there. The input instead can be
+ * fed in chunks of any size: lz4f_stream_decode() consumes only the complete
+ * units (frame header, data blocks) present in the given chunk and the caller
+ * has to keep the remaining bytes for the next call. Therefore, the caller's
+ * input buffer must be able to hold at least one whole block:
+ * LZ4F_MAX_BLOCK_OVERHEAD + info.block_max_size bytes.
+ */
+
+#define LZ4F_MAGIC                              0x184D2204
+#define LZ4F_MAX_HEADER_SIZE                            19
+#define LZ4F_MAX_BLOCK_OVERHEAD                          8   /* size + csum */
+
+struct lz4f_info {
+
+   u64 content_size;          /* 0 if not stored in the frame header */
+   u32 block_max_size;
+   u32 header_size;
+   bool block_checksum;
+   bool content_checksum;
+};
+
+struct lz4f_stream {
+
+   struct lz4f_info info;
+   u8 *out;
+   u32 out_size;              /* capacity of the `out` buffer */
+   u32 out_pos;               /* bytes produced so far */
+   bool header_done;
+   bool done;
+};
+
+static inline bool lz4f_is_frame(const void *buf)
+{
+   const u8 *p = (const u8 *)buf;
+   return p[0] == 0x04 && p[1] == 0x22 && p[2] == 0x4D && p[3] == 0x18;
+}
+
+/*
+ * Parses the frame header in `buf`. Returns 0 in case of success, 1 if more
+ * bytes are needed or -1 if the header is invalid or not supported.
+ */
+int lz4f_read_header(const void *buf, u32 len, struct lz4f_info *info);
+
+/*
+ * Decompresses a single LZ4 block in out[out_pos, out_size). Returns the number
+ * of bytes produced or -1 in case of corrupted data.
+ */
+int lz4_decompress_block(const void *src, u32 src_len,
+                         u8 *out, u32 out_pos, u32 out_size);
+
+void lz4f_stream_init(struct lz4f_stream *s, void *out, u32 out_size);
+
+/*
+ * Consumes the complete units in `in` and sets *consumed accordingly. Returns
+ * 0 if the frame is not over yet, 1 when it is over or -1 in case of errors.
+ */
+int lz4f_stream_decode(struct lz4f_stream *s,
+                       const void *in, u32 in_len, u32 *consumed);
+
+/* One-shot version. Returns the size of the decompressed data or -1 */
+long lz4f_decompress(const void *src, u32 src_len, void *dst, u32 dst_size);
@@ -83,8 +83,17 @@ enum tilck_cmd {
     */
    TILCK_CMD_DP_GET_RUNTIME_INFO       = 35,
 
+   /* Page-frame allocator stats for the dp MemMap panel */
+   TILCK_CMD_DP_GET_PAGE_ALLOC_STATS   = 36,
+
+   /* Per-syscall latency stats for the dp Syscalls panel */
+   TILCK_CMD_DP_GET_SYSCALL_STATS      = 37,
+
+   /* Lock contention stats (KRN_LOCKSTAT) for the dp Locks panel */
+   TILCK_CMD_DP_GET_LOCKSTAT           = 38,
+
    /* Number of elements in the enum */
-   TILCK_CMD_COUNT               = 36,
+   TILCK_CMD_COUNT               = 39,
 };
 
 #if defined(__x86_64__)
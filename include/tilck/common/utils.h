@@ -128,25 +128,13 @@ get_first_set_bit_index64(u64 num)
 CONSTEXPR static inline u32
 get_first_zero_bit_index_l(ulong num)
 {
-   u32 i;
-   ASSERT(num != ~0U);
-
-   for (i = 0; i < NBITS; i++)
-      if ((num & (1UL << i)) == 0)
-         break;
-
-   return i;
+   ASSERT(num != ~0UL);
+   return (u32)__builtin_ctzl(~num);
 }
 
 CONSTEXPR static inline u32
 get_first_set_bit_index_l(ulong num)
 {
-   u32 i;
    ASSERT(num != 0);
-
-   for (i = 0; i < NBITS; i++)
-      if (num & (1UL << i))
-         break;
-
-   return i;
+   return (u32)__builtin_ctzl(num);
 }
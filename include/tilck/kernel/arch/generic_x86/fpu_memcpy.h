@@ -36,6 +36,10 @@ void fpu_memcpy256_nt_read_sse4_1(void *dest, const void *src, u32 n);
 void fpu_memset256_sse2(void *dest, u32 val32, u32 n);
 void fpu_memset256_avx2(void *dest, u32 val32, u32 n);
 
+/* Bzero (regular stores, unlike fpu_memset256*) */
+void fpu_bzero256_sse2(void *dest, u32 n);
+void fpu_bzero256_avx2(void *dest, u32 n);
+
 EXTERN ALWAYS_INLINE FASTCALL void
 fpu_cpy_single_512_nt_avx2(void *dest, const void *src)
 {
@@ -103,6 +107,16 @@ fpu_cpy_single_256_avx2(void *dest, const void *src)
                : "memory");
 }
 
+EXTERN ALWAYS_INLINE FASTCALL void
+fpu_zero_single_256_avx2(void *dest)
+{
+   asmVolatile("vpxor   %%ymm0, %%ymm0, %%ymm0\n\t"
+               "vmovdqa %%ymm0,   (%0)\n\t"
+               : /* no output */
+               : "r" (dest)
+               : "memory");
+}
+
 EXTERN ALWAYS_INLINE FASTCALL void
 fpu_cpy_single_512_nt_sse2(void *dest, const void *src)
 {
@@ -190,6 +204,17 @@ fpu_cpy_single_256_sse2(void *dest, const void *src)
 }
 
 
+EXTERN ALWAYS_INLINE FASTCALL void
+fpu_zero_single_256_sse2(void *dest)
+{
+   asmVolatile("pxor   %%xmm0, %%xmm0\n\t"
+               "movdqa %%xmm0,   (%0)\n\t"
+               "movdqa %%xmm0, 16(%0)\n\t"
+               : /* no output */
+               : "r" (dest)
+               : "memory");
+}
+
 EXTERN ALWAYS_INLINE FASTCALL void
 fpu_cpy_single_128_nt_sse2(void *dest, const void *src)
 {
@@ -337,5 +362,20 @@ fpu_cpy_single_256_nt_read(void *dest, const void *src)
    __asm_fpu_cpy_single_256_nt_read(dest, src);
 }
 
+/*
+ * The implementations of bulk_memcpy() and bulk_bzero(). They're exposed only
+ * for the self-tests: everybody else should use the bulk_* funcs in hal.h.
+ */
+struct bulk_mem_impl {
+
+   const char *name;
+   void (*cpy)(void *dest, const void *src, size_t n);
+   void (*zero)(void *dest, size_t n);
+   bool (*is_supported)(void);
+   bool uses_fpu;
+};
+
+extern const struct bulk_mem_impl bulk_mem_impls[];
+extern const u32 bulk_mem_impls_count;
 
 void init_fpu_memcpy(void);
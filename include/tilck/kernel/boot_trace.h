@@ -0,0 +1,71 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck_gen_headers/config_debug.h>
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Boot timeline
+ * ---------------
+ *
+ * When KRN_BOOT_TRACE is enabled, kmain(), do_async_init() and init_modules()
+ * read the cycle counter (RDTSC) before and after each init call and record
+ * the pair in a static array: that works from the very first instruction of
+ * kmain(), long before kmalloc is available. A few instant events (marks) can
+ * be recorded as well, like the moment we're about to run init.
+ *
+ * The cycles are converted to microseconds only when the timeline is read,
+ * using the cycle counter and the system time sampled once the timer is up
+ * (see boot_trace_calibrate()). The timeline is exported as
+ * /syst/boot/timeline and the devshell's `boottime` command prints it sorted.
+ */
+
+#define BOOT_TRACE_MAX_EVENTS                               96
+
+enum boot_phase_kind {
+   BOOT_PHASE_INIT,              /* kmain(): synchronous, early init */
+   BOOT_PHASE_ASYNC,             /* do_async_init(), in a kthread */
+   BOOT_PHASE_MODULE,            /* the init func of a kernel module */
+   BOOT_PHASE_MARK,              /* an instant event: start == end */
+};
+
+struct boot_trace_event {
+
+   const char *name;
+   u64 start;                    /* cycles */
+   u64 end;                      /* cycles, 0 if the phase is still running */
+   enum boot_phase_kind kind;
+};
+
+#if KRN_BOOT_TRACE
+
+   int boot_trace_begin(const char *name, enum boot_phase_kind kind);
+   void boot_trace_end(int idx);
+   void boot_trace_mark(const char *name);
+   void boot_trace_calibrate(void);
+   void register_boot_trace_sysfs(void);
+
+#else
+
+   static inline int
+   boot_trace_begin(const char *name, enum boot_phase_kind kind) {
+      return -1;
+   }
+
+   static inline void boot_trace_end(int idx) { }
+   static inline void boot_trace_mark(const char *name) { }
+   static inline void boot_trace_calibrate(void) { }
+   static inline void register_boot_trace_sysfs(void) { }
+
+#endif
+
+/*
+ * Calls func(...) recording it as a boot phase of the given kind, using the
+ * function name as phase name. Example: BOOT_TRACE(INIT, init_paging).
+ */
+#define BOOT_TRACE(kind, func, ...)                                    \
+   do {                                                                \
+      const int __bt_idx = boot_trace_begin(#func, BOOT_PHASE_##kind); \
+      func(__VA_ARGS__);                                               \
+      boot_trace_end(__bt_idx);                                        \
+   } while (0)
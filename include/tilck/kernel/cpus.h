@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+/*
+ * CPU enumeration
+ * -----------------
+ *
+ * Tilck does NOT support SMP: the kernel runs only on the boot CPU and the
+ * other CPUs are left halted, as the firmware left them. The firmware-specific
+ * code (on x86, the ACPI module parsing the MADT) just reports here the CPUs
+ * it finds, so that their number is known and logged at boot.
+ */
+
+void init_cpus(void);
+void register_cpu(u32 hw_id, bool enabled);
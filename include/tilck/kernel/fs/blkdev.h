@@ -0,0 +1,90 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck_gen_headers/config_mm.h>
+#include <tilck/common/basic_defs.h>
+#include <tilck/kernel/fs/vfs_base.h>
+#include <tilck/kernel/list.h>
+
+/*
+ * Block devices
+ * ---------------
+ *
+ * A block device driver (e.g. the ATA one) fills a struct block_dev and calls
+ * register_block_dev(), which creates the /dev/<name> file for it. After that,
+ * the device is accessed only through the buffer cache: a page-granular LRU
+ * cache shared by all the block devices, limited to KRN_BCACHE_PAGES pages.
+ *
+ * Writes only dirty the pages in the cache: a worker thread writes them back
+ * periodically, on sync() and when too many pages are dirty. The same thread
+ * does the read-ahead, when it detects sequential reads on a device.
+ *
+ * The driver's read() and write() funcs are always called with the buffer
+ * cache's mutex held, in a task context. Therefore, they can sleep but they
+ * don't need any locking of their own.
+ */
+
+#define BLKDEV_SECTOR_SIZE                         512
+#define BLKDEV_SECTORS_PER_PAGE    (PAGE_SIZE / BLKDEV_SECTOR_SIZE)
+
+struct block_dev;
+
+struct block_dev_ops {
+
+   /* Read/write `count` sectors starting from `sector`. Return 0 or -EIO */
+   int (*read)(struct block_dev *bdev, u64 sector, u32 count, void *buf);
+   int (*write)(struct block_dev *bdev, u64 sector, u32 count, const void *b);
+};
+
+struct block_dev {
+
+   /* Set by the driver */
+   const char *name;                /* name of the file in /dev */
+   const struct block_dev_ops *ops;
+   u64 sectors;                     /* device size, in sectors */
+   bool read_only;
+   void *driver_data;
+
+   /* Set by register_block_dev() */
+   struct list_node node;
+   u16 minor;
+
+   /* Read-ahead state, protected by the buffer cache's mutex */
+   u64 last_page;                   /* last page read by the users */
+   u64 ra_page;                     /* first page after the read-ahead */
+};
+
+struct bcache_stats {
+
+   u32 tot_pages;             /* pages currently allocated */
+   u32 dirty_pages;
+   u64 hits;
+   u64 misses;
+   u64 ra_pages;              /* pages read by the read-ahead */
+   u64 writebacks;            /* pages written back to the devices */
+};
+
+int register_block_dev(struct block_dev *bdev);
+struct block_dev *get_block_dev_by_name(const char *name);
+
+/*
+ * Returns the block device opened by the handle `h` or NULL if `h` is not
+ * a handle of a block device file in /dev.
+ */
+struct block_dev *get_block_dev_from_handle(fs_handle h);
+
+static inline u64 blkdev_get_size(struct block_dev *bdev) {
+   return bdev->sectors * BLKDEV_SECTOR_SIZE;
+}
+
+/* Read/write through the buffer cache. Return the number of bytes or < 0 */
+ssize_t blkdev_read(struct block_dev *bdev, u64 off, void *buf, size_t len);
+ssize_t blkdev_write(struct block_dev *bdev, u64 off, const void *b, size_t l);
+
+/* Write back the dirty pages of `bdev` (of all the devices, if NULL) */
+int blkdev_sync(struct block_dev *bdev);
+
+void bcache_get_stats(struct bcache_stats *stats);
+
+/* Internal: called by register_block_dev() */
+void init_bcache(void);
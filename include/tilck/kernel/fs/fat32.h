@@ -6,9 +6,28 @@
 #include <tilck/common/fat32_base.h>
 
 #include <tilck/kernel/sync.h>
+#include <tilck/kernel/rwlock.h>
+#include <tilck/kernel/list.h>
 #include <tilck/kernel/datetime.h>
 #include <tilck/kernel/fs/vfs_base.h>
 
+struct block_dev;
+
+/*
+ * Number of cluster numbers cached by each handle: see fat_read(). Keep the
+ * handle within MAX_FS_HANDLE_SIZE, on 32-bit too.
+ */
+#define FAT_RA_CLUSTERS                                  16
+
+/* A directory cluster read from the block device, see fat_fs_device_data */
+struct fat_dir_cluster {
+
+   struct list_node node;
+   u32 clu;
+   bool dirty;          /* modified in memory, not yet written to bdev */
+   char data[];
+};
+
 struct fat_fs_device_data {
 
    struct fat_hdr *hdr; /* vaddr of the beginning of the FAT partition */
@@ -28,6 +47,44 @@ struct fat_fs_device_data {
     * regular fat_entry.
     */
    struct fat_entry *root_dir_entries;
+
+   /*
+    * Used only when mounted from a block device. In that case, `hdr` points to
+    * an in-memory copy of just the metadata region (reserved sectors, FATs and
+    * FAT16's root dir), while the directories' clusters are read on-demand
+    * and kept in the `dir_clusters` list until umount. That's because the
+    * fat_entry pointers are used as inodes: they must never change. The data
+    * of the regular files is read through the buffer cache instead.
+    */
+   struct block_dev *bdev;
+   size_t hdr_size;
+   struct list dir_clusters;
+   struct kmutex dir_clusters_mutex;
+
+   /*
+    * Used only when mounted in r/w mode (see fat32_rw.c). The `rwlock` is the
+    * fs lock: it protects the FAT, the dir entries and the clusters' data.
+    * The free clusters are tracked by `free_bmp` (bit N set: cluster N used),
+    * built at mount time by scanning the FAT. Every change in a cluster chain
+    * or in a file size increments `gen`, telling the open handles that their
+    * `curr_cluster` might be stale.
+    *
+    * On a ramdisk, the clusters beyond the end of the loaded image (truncated
+    * by our build system) are backed by kernel memory and kept in the
+    * `extra_clusters` tree. On a block device, the modified sectors of the
+    * metadata region are tracked in `hdr_dirty` and written back, together
+    * with the dirty dir clusters, to the buffer cache.
+    */
+   bool rw;
+   struct rwlock_wp rwlock;
+   ulong *free_bmp;
+   u32 clusters_end;             /* first invalid cluster number */
+   u32 free_hint;
+   u32 free_count;
+   u32 gen;
+   u32 img_clusters_end;         /* ramdisk: first cluster not in the image */
+   void *extra_clusters;         /* ramdisk: bintree of fat_extra_cluster */
+   ulong *hdr_dirty;             /* bdev: bit N set: sector N is dirty */
 };
 
 struct fatfs_handle {
@@ -38,13 +95,39 @@ struct fatfs_handle {
    /* fs-specific members */
    struct fat_entry *e;
    u32 curr_cluster;
+
+   /*
+    * Read-ahead of the cluster chain. When the reads are sequential, the
+    * numbers of the clusters following `curr_cluster` are read from the FAT
+    * in one go and cached here: ra_clusters[ra_idx] is the next cluster after
+    * `curr_cluster` and so on, up to `ra_count`. Any seek drops the cache.
+    */
+   u8 ra_seq;                          /* consecutive reads with no seek */
+   u8 ra_idx;
+   u8 ra_count;
+   bool at_clu_end;                    /* h_fpos at the end of curr_cluster */
+   u32 ra_clusters[FAT_RA_CLUSTERS];
+
+   u32 gen;                            /* r/w mounts: see fat_fs_device_data */
 };
 
 STATIC_ASSERT(sizeof(struct fatfs_handle) <= MAX_FS_HANDLE_SIZE);
 
+/* A position in a file, used by the write path (see fat32_rw.c) */
+struct fat_cursor {
+
+   offt pos;
+   u32 clu;          /* the cluster containing `pos` (0 if there's none) */
+   bool at_end;      /* `pos` is at the end of `clu`, not in it */
+};
+
 struct mnt_fs *fat_mount_ramdisk(void *vaddr, size_t rd_size, u32 flags);
 void fat_umount_ramdisk(struct mnt_fs *fs);
 
+/* Returns NULL and sets *err in case of failure */
+struct mnt_fs *fat_mount_blkdev(struct block_dev *bdev, u32 flags, int *err);
+void fat_umount_blkdev(struct mnt_fs *fs);
+
 struct datetime
 fat_datetime_to_regular_datetime(u16 date, u16 time, u8 timetenth);
 
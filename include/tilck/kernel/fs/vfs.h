@@ -22,6 +22,12 @@ struct vfs_dent64 {
    enum vfs_entry_type type;
    u8 name_len;               /* NODE: includes the final '\0' */
    const char *name;
+
+   /*
+    * Opaque position of the next dent, to be used with seek(). When 0, the
+    * position is just the index of the dent, as for most filesystems.
+    */
+   offt next_off;
 };
 
 typedef int (*get_dents_func_cb) (struct vfs_dent64 *, void *);
@@ -234,6 +234,7 @@ void init_syscall_interfaces(void);
 void set_kernel_stack(ulong stack);
 void enable_cpu_features(void);
 void fpu_context_begin(void);
+bool fpu_context_try_begin(void);
 void fpu_context_end(void);
 void save_current_fpu_regs(bool in_kernel);
 void restore_fpu_regs(void *task, bool in_kernel);
@@ -250,5 +251,13 @@ void copy_main_tss_on_regs(regs_t *ctx);
 void arch_add_initial_mem_regions();
 bool arch_add_final_mem_regions();
 
+/*
+ * memcpy() and bzero() for page-sized and bigger buffers, using the fastest
+ * implementation selected by init_fpu_memcpy() for the current CPU.
+ */
+void bulk_memcpy(void *dest, const void *src, size_t n);
+void bulk_bzero(void *dest, size_t n);
+const char *get_bulk_mem_impl_name(void);
+
 #define get_task_arch_fields(ti) ((arch_task_members_t*)(void*)((ti)->ti_arch))
 #define get_proc_arch_fields(pi) ((arch_proc_members_t*)(void*)((pi)->pi_arch))
@@ -79,6 +79,16 @@ kmalloc_heap_dup_expanded(struct kmalloc_heap *h, size_t sz);
 void *
 per_heap_kmalloc(struct kmalloc_heap *h, size_t *size, u32 flags);
 
+/*
+ * Allocate exactly the range [ptr, ptr + size) in the heap `h`, if it's
+ * completely free. Both `ptr` and `size` must be aligned at the heap's min
+ * block size. Supported flags: KMALLOC_FL_NO_ACTUAL_ALLOC and the sub-block
+ * min size (see KMALLOC_FL_SUB_BLOCK_MIN_SIZE_MASK). The allocation is always
+ * multi-step: free it with KFREE_FL_MULTI_STEP.
+ */
+void *
+per_heap_kmalloc_at(struct kmalloc_heap *h, void *ptr, size_t size, u32 flags);
+
 void
 per_heap_kfree(struct kmalloc_heap *h, void *ptr, size_t *size, u32 flags);
 
@@ -3,6 +3,7 @@
 #pragma once
 #include <tilck/common/basic_defs.h>
 #include <tilck/kernel/bintree.h>
+#include <tilck_gen_headers/config_kmalloc.h>
 
 struct debug_kmalloc_heap_info {
 
@@ -60,3 +61,11 @@ void debug_kmalloc_stop_leak_detector(bool show_leaks);
 
 void debug_kmalloc_start_log(void);
 void debug_kmalloc_stop_log(void);
+
+/* Sampling call-site profiler (KRN_KMALLOC_PROFILER) */
+
+#if KRN_KMALLOC_PROFILER
+   void register_kmalloc_prof_sysfs(void);
+#else
+   static inline void register_kmalloc_prof_sysfs(void) { }
+#endif
@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck_gen_headers/config_kernel.h>
+#include <tilck/common/basic_defs.h>
+
+/*
+ * The kernel log: every printk() message is stored as a record in a
+ * fixed-size ring, together with its metadata. The records are read by the
+ * console flush (KRN_PRINTK_DEFERRED) and by the userspace through /dev/kmsg.
+ * See kernel/kmsg.c.
+ */
+
+#if KRN_TINY_KERNEL
+   #define KMSG_RECORDS                          16
+#else
+   #define KMSG_RECORDS                         128
+#endif
+
+#define KMSG_TEXT_MAX                           224
+
+#define KMSG_LEVEL_EMERG                          0
+#define KMSG_LEVEL_INFO                           6
+
+#define KMSG_FL_CONT                       (1 << 0)   /* continues a line */
+#define KMSG_FL_PREFIX                     (1 << 1)   /* has the ts prefix */
+#define KMSG_FL_LOWSS                      (1 << 2)   /* low stack space */
+#define KMSG_FL_IRQ                        (1 << 3)   /* stored in IRQ ctx */
+
+struct kmsg_record {
+
+   u32 seq;
+   u8 level;
+   u8 flags;
+   u16 len;                   /* bytes in text[], no NUL terminator */
+   u16 cpu;
+   u16 unused0;
+   int tid;                   /* 0 before the scheduler is initialized */
+   u64 tsc;                   /* RDTSC() */
+   u64 ts;                    /* get_sys_time() */
+   char text[KMSG_TEXT_MAX];
+};
+
+/* Stores a record: it can be called in any context, including IRQs */
+void kmsg_store(u8 level, u8 flags, const char *text, u32 len);
+
+/*
+ * Copies the record `seq` in `out`. Returns 0, -EAGAIN if the record has not
+ * been (completely) stored yet or -EPIPE if it has been overwritten.
+ */
+int kmsg_read(u32 seq, struct kmsg_record *out);
+
+u32 kmsg_get_first_seq(void);
+u32 kmsg_get_next_seq(void);
+
+/*
+ * Queues the kmsg job, which flushes the stored records on the console (see
+ * printk_flush_deferred()) and wakes up the /dev/kmsg readers. Returns false
+ * if the job cannot be queued from the current context.
+ */
+bool kmsg_kick(void);
+
+/*
+ * Defined in printk.c. printk_start_deferred() makes printk() leave the
+ * console flush to the kmsg job (KRN_PRINTK_DEFERRED), which calls
+ * printk_flush_deferred() to render the records not flushed yet.
+ */
+void printk_start_deferred(void);
+void printk_flush_deferred(void);
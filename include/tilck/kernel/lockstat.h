@@ -0,0 +1,100 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck_gen_headers/config_debug.h>
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Lock contention stats (lockstat)
+ * ----------------------------------
+ *
+ * When KRN_LOCKSTAT is enabled, kmutex, rwlock_wp and kcond account their
+ * acquisitions per lock class. A class is identified by a key: the call site
+ * of the lock's init function or, for the statically initialized locks, the
+ * address of the lock itself. Therefore, all the per-inode rwlocks initialized
+ * in the same place share a class, while e.g. the mount points mutex has its
+ * own. The class is looked up on the first acquisition of each lock.
+ *
+ * For each class we keep the number of acquisitions, how many of them had to
+ * wait (contended), the total and max time spent waiting and the total and max
+ * time the lock was held, all in cycles (RDTSC). For rwlock_wp, both shared
+ * and exclusive acquisitions are counted, but only the exclusive ones have a
+ * hold time: `holds` counts the measured hold times. For kcond, each wait is
+ * a contended acquisition, with the time until the wake-up as wait time, and
+ * there is no hold time.
+ *
+ * The counters are updated with preemption disabled. The stats are exported
+ * as /syst/lockstat/classes and shown by dp.
+ */
+
+enum lockstat_type {
+
+   LOCKSTAT_KMUTEX,
+   LOCKSTAT_RWLOCK_WP,
+   LOCKSTAT_KCOND,
+};
+
+#define LOCKSTAT_HASH_BITS                                       8
+#define LOCKSTAT_MAX_CLASSES                 (1 << LOCKSTAT_HASH_BITS)
+
+struct lockstat_class {
+
+   const void *key;
+   u32 type;                  /* enum lockstat_type */
+   u32 locks;                 /* locks of this class acquired at least once */
+   u64 acquired;
+   u64 contended;
+   u64 wait_tot;
+   u64 wait_max;
+   u64 holds;
+   u64 hold_tot;
+   u64 hold_max;
+};
+
+/* Per-lock data, embedded in each lock as `lstat` */
+struct lockstat {
+
+   const void *key;           /* NULL: the lock is not tracked */
+   struct lockstat_class *cls;
+   u64 acq_cycles;            /* RDTSC() at the last acquisition */
+};
+
+#if KRN_LOCKSTAT
+
+   #define LOCKSTAT_ONLY(x)                                   x
+   #define LOCKSTAT_STATIC_INIT(lock)   .lstat = { .key = &(lock) },
+
+   extern u32 lockstat_classes_count;
+   extern u32 lockstat_untracked;
+
+   static inline void lockstat_init(struct lockstat *ls, const void *key)
+   {
+      ls->key = key;
+      ls->cls = NULL;
+      ls->acq_cycles = 0;
+   }
+
+   void
+   lockstat_acquired(struct lockstat *ls,
+                     enum lockstat_type type,
+                     u64 wait_start);
+
+   void lockstat_released(struct lockstat *ls);
+   u32 lockstat_get_classes(struct lockstat_class *buf, u32 max_count);
+
+   void
+   lockstat_get_class_name(const struct lockstat_class *c,
+                           char *buf,
+                           size_t buf_sz);
+
+   const char *lockstat_get_type_name(u32 type);
+   void register_lockstat_sysfs(void);
+
+#else
+
+   #define LOCKSTAT_ONLY(x)
+   #define LOCKSTAT_STATIC_INIT(lock)
+
+   static inline void register_lockstat_sysfs(void) { }
+
+#endif
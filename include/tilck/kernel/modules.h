@@ -10,8 +10,26 @@ struct module {
    const char *name;
    int priority;
    void (*init)(void);
+
+   /*
+    * NULL-terminated list with the names of the modules which must be
+    * initialized before this one. Modules not compiled-in are ignored.
+    * When `deps` is NULL, the module depends on all the (non-background)
+    * modules with a lower priority: that's the safe default. Use
+    * MODULE_NO_DEPS for modules that can be initialized at any time.
+    */
+   const char *const *deps;
+
+   /*
+    * Background modules are not waited for by init_modules(): init can start
+    * while they are still probing their hardware.
+    */
+   bool background;
 };
 
+#define MODULE_DEPS(...)      ((const char *const []) { __VA_ARGS__, NULL })
+#define MODULE_NO_DEPS        ((const char *const []) { NULL })
+
 void init_modules(void);
 void register_module(struct module *m);
 
@@ -31,10 +49,12 @@ void register_module(struct module *m);
 #define MOD_kb_prio                           50
 #define MOD_tracing_prio                     100
 #define MOD_tty_prio                         200
+#define MOD_kmsg_prio                        210
 #define MOD_fbdev_prio                       300
 #define MOD_serial_prio                      400
 #define MOD_sb16_prio                        410
 #define MOD_null_prio                        420
 #define MOD_e1000_prio                       430
+#define MOD_ata_prio                         440
 #define MOD_systests_prio                    990
 #define MOD_dp_prio                         1000 /* last */
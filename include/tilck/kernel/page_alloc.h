@@ -0,0 +1,49 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck_gen_headers/config_mm.h>
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Page-frame allocator
+ * ----------------------
+ *
+ * A buddy allocator with per-order free lists managing the physical memory
+ * regions reserved for it at boot (MEM_REG_EXTRA_PAGE_ALLOC). It serves the
+ * pageframes mapped in user space, keeping them out of the kmalloc heaps. On
+ * top of the buddy lists there is a small cache of pre-zeroed pages, refilled
+ * in background by a low-priority worker thread.
+ *
+ * All the pageframes are returned as linear-mapping kernel vaddrs, exactly as
+ * kmalloc(PAGE_SIZE) does. When the pool is exhausted (or when the allocator
+ * is disabled) alloc_pageframe() falls back to kmalloc, and free_pageframe()
+ * always returns a pageframe to its owner.
+ *
+ * The allocator does not track the ref-count of the pageframes: that's still
+ * done by the paging code. A pageframe must have ref-count == 0 when it's
+ * allocated and when it's freed.
+ */
+
+#define PAGE_ALLOC_FL_ZERO                          (1 << 0)
+
+struct page_alloc_stats {
+
+   size_t tot_pages;          /* pageframes in the pool */
+   size_t free_pages;         /* free pageframes in the buddy lists */
+   size_t zero_cache_pages;   /* pre-zeroed free pageframes */
+   size_t fallback_allocs;    /* allocations served by kmalloc */
+   int largest_free_order;    /* -1 if there are no free blocks */
+   size_t free_blocks[PAGE_ALLOC_MAX_ORDER + 1];
+};
+
+void init_page_alloc(void);
+void init_page_alloc_worker(void);
+
+void *alloc_pages(u32 order);
+void free_pages(void *vaddr, u32 order);
+
+void *alloc_pageframe(u32 flags);
+void free_pageframe(void *vaddr);
+
+bool is_page_alloc_frame(ulong paddr);
+void page_alloc_get_stats(struct page_alloc_stats *stats);
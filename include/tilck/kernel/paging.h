@@ -135,8 +135,24 @@ pdir_t *pdir_deep_clone(pdir_t *pdir);
 void pdir_destroy(pdir_t *pdir);
 void invalidate_page(ulong vaddr);
 void set_page_rw(pdir_t *pdir, void *vaddr, bool rw);
+
+/*
+ * Change the protection of an already mapped user page, using PAGING_FL_US
+ * and PAGING_FL_RW in `pg_flags`. Without PAGING_FL_US, the page is still
+ * mapped but not accessible from user space. Private (non-shared) pages made
+ * writable become CoW pages when their pageframe is shared or when they map
+ * the zero page.
+ */
+void set_page_prot(pdir_t *pdir, void *vaddr, u32 pg_flags);
+
+/*
+ * Swap the page table entries of two mapped pages, preserving all of their
+ * flags. The ref-count of the pageframes does not change.
+ */
+void swap_page_mappings(pdir_t *pdir, void *vaddr1, void *vaddr2);
 void retain_pageframes_mapped_at(pdir_t *pdir, void *vaddr, size_t len);
 void release_pageframes_mapped_at(pdir_t *pdir, void *vaddr, size_t len);
+u32 get_pageframe_ref_count(ulong paddr);
 
 static ALWAYS_INLINE pdir_t *get_kernel_pdir(void)
 {
@@ -33,6 +33,8 @@ struct mappings_info {
    struct list mappings;
 };
 
+#define FD_BMP_WORDS(n)                         (((n) + NBITS - 1) / NBITS)
+
 struct process {
 
    REF_COUNTED_OBJECT;
@@ -63,9 +65,21 @@ struct process {
 
    struct vfs_path cwd;                   /* CWD as a struct vfs_path */
    char *debug_cmdline;                   /* debug field used by debugpanel */
+   struct proc_syscall_stats *sys_stats;  /* see syscall_stats.h */
 
    struct locked_file *elf;
-   fs_handle handles[KRN_MAX_HANDLES];        /* just a small fixed-size array */
+
+   /*
+    * The fd table, protected by `fslock`. It starts as the small array
+    * embedded in this struct and gets re-allocated on the heap, doubling its
+    * size, when an fd >= handles_cap is needed. The bitmap has a bit set for
+    * each used slot and it's used to find the lowest free fd. See fd_table.c.
+    */
+   fs_handle *handles;
+   ulong *handles_bmp;
+   u32 handles_cap;
+
+   struct k_rlimit64 *rlimits;            /* NULL means defaults: rlimit.c */
 
    /*
     * The purpose of having this opaque `arch_fields` member here is to avoid
@@ -91,6 +105,9 @@ struct process {
    /* large members */
    char str_cwd[MAX_PATH];                /* current working directory */
 
+   fs_handle handles_inline[KRN_MAX_HANDLES];
+   ulong handles_bmp_inline[FD_BMP_WORDS(KRN_MAX_HANDLES)];
+
    void *sa_handlers[_NSIG - 1];
 };
 
@@ -159,6 +176,17 @@ void process_set_cwd2_nolock(struct vfs_path *tp);
 void process_set_cwd2_nolock_raw(struct process *pi, struct vfs_path *tp);
 void terminate_process(int exit_code, int term_sig);
 void close_cloexec_handles(struct process *pi);
+
+void init_fd_table(struct process *pi);
+void free_fd_table(struct process *pi);
+int grow_fd_table(struct process *pi, u32 min_cap);
+int get_free_handle_num_ge(struct process *pi, int ge);
+void set_fs_handle(struct process *pi, int fd, fs_handle h);
+u32 get_fd_table_end(struct process *pi);
+u32 get_nofile_limit(struct process *pi);
+void init_default_rlimits(struct process *pi);
+int dup_proc_rlimits(struct process *pi, struct process *parent);
+void free_proc_rlimits(struct process *pi);
 int setup_sig_handler(struct task *ti,
                       regs_t *r,
                       ulong user_func,
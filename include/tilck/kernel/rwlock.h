@@ -51,9 +51,25 @@ struct rwlock_wp {
    bool w;    /* writer waiting */
    bool rec;  /* is exlock operation recursive */
    u16 rc;    /* recursive locking count */
+   struct pi_lock pi;   /* used with RWLOCK_WP_FL_PI: waiters on `c` */
+
+#if KRN_LOCKSTAT
+   struct lockstat lstat;
+#endif
 };
 
-void rwlock_wp_init(struct rwlock_wp *rw, bool recursive);
+/* The exlock operation is recursive */
+#define RWLOCK_WP_FL_REC                                   (1 << 0)
+
+/*
+ * Priority inheritance: the internal mutex has KMUTEX_FL_PI and the exclusive
+ * owner runs at the priority of the highest priority task waiting for it.
+ * NOTE: the readers holding the lock are not tracked and, therefore, they are
+ * not boosted by the writers waiting for them.
+ */
+#define RWLOCK_WP_FL_PI                                    (1 << 1)
+
+void rwlock_wp_init(struct rwlock_wp *rw, u32 flags);
 void rwlock_wp_destroy(struct rwlock_wp *rw);
 void rwlock_wp_shlock(struct rwlock_wp *rw);
 void rwlock_wp_shunlock(struct rwlock_wp *rw);
@@ -12,6 +12,7 @@
 #include <tilck/kernel/signal.h>
 
 #include <tilck_gen_headers/config_sched.h>
+#include <linux/sched.h> // system header
 
 #define IN_SYSCALL_FLAG (1u << 31)
 
@@ -44,6 +45,15 @@ struct sched_ticks {
    u64 vruntime;        /* a brutal approx. of Linux's vruntime */
 };
 
+#define SCHED_NICE_MIN                                    -20
+#define SCHED_NICE_MAX                                     19
+#define SCHED_RT_PRIO_MIN                                   1
+#define SCHED_RT_PRIO_MAX                                  99
+
+/* See sched_get_base_prio() */
+#define SCHED_PRIO_RT_BASE                                 40
+#define SCHED_PRIO_MAX          (SCHED_PRIO_RT_BASE + SCHED_RT_PRIO_MAX)
+
 STATIC_ASSERT(sizeof(enum sig_state) == 1);
 
 struct task {
@@ -86,6 +96,14 @@ struct task {
    s32 wstatus;                       /* waitpid's wstatus  */
    struct sched_ticks ticks;          /* scheduler counters */
 
+   s8 nice;                           /* SCHED_NICE_MIN ... SCHED_NICE_MAX */
+   u8 sched_policy;                   /* SCHED_NORMAL, SCHED_FIFO, etc. */
+   u8 rt_prio;                        /* 0 for the non-RT policies */
+   bool sched_reset_on_fork;          /* SCHED_FLAG_RESET_ON_FORK */
+   bool rt_yield;                     /* sched_yield() called by a RT task */
+   u8 pi_prio;                        /* priority inheritance boost, or 0 */
+   struct list pi_held_list;          /* held PI locks (struct pi_lock) */
+
    void *kernel_stack;
    void *args_copybuf;
 
@@ -142,6 +160,8 @@ extern struct process *kernel_process_pi;
 extern struct task *idle_task;
 
 extern struct list runnable_tasks_list;
+extern ATOMIC(int) runnable_tasks_count;     /* see docs/atomics.md */
+extern u64 idle_ticks;
 extern const char *const task_state_str[5];
 
 #define KTH_ALLOC_BUFS                       (1 << 0)
@@ -237,6 +257,37 @@ static ALWAYS_INLINE bool is_worker_thread(struct task *ti)
    return ti->worker_thread != NULL;
 }
 
+/* True for the real-time policies: SCHED_FIFO and SCHED_RR */
+static ALWAYS_INLINE bool sched_is_rt_policy(int policy)
+{
+   return policy == SCHED_FIFO || policy == SCHED_RR;
+}
+
+/*
+ * The priority of a task on a single scale, used to compare tasks of different
+ * classes: the higher, the more important. Fair tasks have 1 (nice 19) up to
+ * SCHED_PRIO_RT_BASE (nice -20), RT tasks SCHED_PRIO_RT_BASE + rt_prio.
+ */
+static ALWAYS_INLINE int sched_get_base_prio(struct task *ti)
+{
+   if (sched_is_rt_policy(ti->sched_policy))
+      return SCHED_PRIO_RT_BASE + ti->rt_prio;
+
+   return SCHED_PRIO_RT_BASE - (ti->nice - SCHED_NICE_MIN);
+}
+
+/* The priority the scheduler uses, including the boost by PI (see kmutex.c) */
+static ALWAYS_INLINE int sched_get_prio(struct task *ti)
+{
+   return MAX(sched_get_base_prio(ti), (int)ti->pi_prio);
+}
+
+/* True for the tasks running in the RT class, boosted ones included */
+static ALWAYS_INLINE bool is_rt_task(struct task *ti)
+{
+   return sched_get_prio(ti) > SCHED_PRIO_RT_BASE;
+}
+
 /*
  * Default yield function
  *
@@ -433,3 +484,7 @@ void task_temp_kernel_free(void *ptr);
 int register_on_task_exit_cb(void (*cb)(struct task *));
 int unregister_on_task_exit_cb(void (*cb)(struct task *));
 void yield_until_last(void);
+
+u32 sched_get_task_weight(struct task *ti);
+void sched_set_task_attr(struct task *ti, int policy, int nice, int rt_prio);
+void sched_set_task_pi_prio(struct task *ti, int prio);
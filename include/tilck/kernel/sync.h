@@ -5,6 +5,7 @@
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/atomics.h>
 #include <tilck/kernel/list.h>
+#include <tilck/kernel/lockstat.h>
 
 struct task;
 
@@ -166,6 +167,27 @@ void ksem_destroy(struct ksem *s);
 int ksem_wait(struct ksem *s, int units, int timeout_ticks);
 int ksem_signal(struct ksem *s, int units);
 
+/*
+ * Priority inheritance (PI) support for the locks having an owner. While a
+ * task holds a PI lock, the lock's pi_lock is linked in the task's
+ * pi_held_list: the task runs at least at the highest priority among the
+ * tasks in the wait lists of all the PI locks it holds. See kmutex.c.
+ *
+ * NOTE: the boost is computed when a task starts waiting and when a lock
+ * changes owner: changing the priority of a task already waiting has effect
+ * only from the next of those events.
+ */
+
+struct pi_lock {
+
+   struct list_node held_node;       /* node in owner's pi_held_list */
+   struct list *wait_list;           /* the waiters (struct wait_obj) */
+};
+
+void pi_lock_acquired(struct pi_lock *pl, struct task *owner);
+void pi_lock_released(struct pi_lock *pl, struct task *owner);
+void pi_boost_owner(struct task *owner, struct task *waiter);
+
 /*
  * The mutex implementation used for locking in kernel mode.
  */
@@ -176,6 +198,11 @@ struct kmutex {
    u32 flags;
    u32 lock_count; // Valid when the mutex is recursive
    struct list wait_list;
+   struct pi_lock pi;                // Used only with KMUTEX_FL_PI
+
+#if KRN_LOCKSTAT
+   struct lockstat lstat;
+#endif
 
 #if KMUTEX_STATS_ENABLED
    u32 num_waiters;
@@ -186,13 +213,22 @@ struct kmutex {
 #define STATIC_KMUTEX_INIT(m, fl)                 \
    {                                              \
       .owner_task = NULL,                         \
-      .flags = 0,                                 \
+      .flags = (fl),                              \
       .lock_count = 0,                            \
       .wait_list = STATIC_LIST_INIT(m.wait_list), \
+      .pi = { .wait_list = &m.wait_list },        \
+      LOCKSTAT_STATIC_INIT(m)                     \
    }
 
 #define KMUTEX_FL_RECURSIVE                                (1 << 0)
 
+/*
+ * Priority inheritance: the owner runs at the priority of the highest priority
+ * waiter and, on unlock, the mutex is handed off to the highest priority
+ * waiter instead of the first one.
+ */
+#define KMUTEX_FL_PI                                       (1 << 2)
+
 #if KERNEL_SELFTESTS
 
    /*
@@ -220,11 +256,16 @@ bool kmutex_is_curr_task_holding_lock(struct kmutex *m);
 struct kcond {
 
    struct list wait_list;
+
+#if KRN_LOCKSTAT
+   struct lockstat lstat;
+#endif
 };
 
 #define STATIC_KCOND_INIT(s)                     \
    {                                             \
       .wait_list = STATIC_LIST_INIT(s.wait_list),\
+      LOCKSTAT_STATIC_INIT(s)                    \
    }
 
 #define KCOND_WAIT_FOREVER 0
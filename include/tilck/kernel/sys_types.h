@@ -112,6 +112,51 @@ struct k_rusage {
    STATIC_ASSERT(sizeof(struct k_rusage) == 136);
 #endif
 
+/*
+ * Classic rlimit struct, with pointer-size fields. Used by getrlimit() and
+ * setrlimit(). On 32-bit systems, values >= K_RLIM_INFINITY mean "infinity".
+ */
+struct k_rlimit {
+
+   ulong rlim_cur;
+   ulong rlim_max;
+};
+
+/*
+ * Modern rlimit struct, used by prlimit64().
+ */
+struct k_rlimit64 {
+
+   u64 rlim_cur;
+   u64 rlim_max;
+};
+
+#define K_RLIM_INFINITY                                  (~0UL)
+#define K_RLIM64_INFINITY                               (~0ULL)
+
+/*
+ * The struct used by sched_setattr() and sched_getattr(). Its size is part of
+ * the ABI: user space passes the size of its own version of the struct, which
+ * might be older (VER0 has no utilization clamping) or newer than ours.
+ */
+struct k_sched_attr {
+
+   u32 size;
+   u32 sched_policy;
+   u64 sched_flags;
+   s32 sched_nice;
+   u32 sched_priority;
+   u64 sched_runtime;         /* SCHED_DEADLINE only */
+   u64 sched_deadline;        /* SCHED_DEADLINE only */
+   u64 sched_period;          /* SCHED_DEADLINE only */
+   u32 sched_util_min;
+   u32 sched_util_max;
+};
+
+#define K_SCHED_ATTR_SIZE_VER0                                   48
+
+STATIC_ASSERT(sizeof(struct k_sched_attr) == 56);
+
 /*
  * Classic (old) timespec. Suffers from the Y2038 bug on ALL systems.
  */
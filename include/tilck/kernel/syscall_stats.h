@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck_gen_headers/config_debug.h>
+#include <tilck/common/basic_defs.h>
+#include <tilck/kernel/sys_types.h>
+
+/*
+ * Syscall stats
+ * ---------------
+ *
+ * When KRN_SYSCALL_STATS is enabled, handle_syscall() reads the cycle counter
+ * before each syscall and again when it returns, before processing the pending
+ * signals (their delivery is not part of the syscall's latency), and accounts
+ * the difference here. Unlike the tracing module, this is always on and costs
+ * just a few counter updates per syscall: no events are produced.
+ *
+ * Globally, for each syscall we keep the number of calls, the total and the
+ * max number of cycles spent in it and a log2 histogram of the latencies:
+ * hist[i] counts the calls which took [2^i, 2^(i+1)) cycles, while the last
+ * bucket counts everything above. Per process, we keep just the number of
+ * calls and the total cycles for each syscall, in order to keep the per-process
+ * memory overhead small.
+ *
+ * The counters are updated with preemption disabled and must be read in the
+ * same way. The stats are exported under /syst/syscalls/.
+ */
+
+#define SYSCALL_STATS_BUCKETS                               32
+
+struct syscall_stats {
+
+   u64 count;
+   u64 tot_cycles;
+   u64 max_cycles;
+   u32 hist[SYSCALL_STATS_BUCKETS];
+};
+
+struct proc_syscall_stats {
+
+   u64 tot_cycles[MAX_SYSCALLS];
+   u32 count[MAX_SYSCALLS];
+};
+
+struct process;
+
+#if KRN_SYSCALL_STATS
+
+   extern struct syscall_stats global_syscall_stats[MAX_SYSCALLS];
+
+   void syscall_stats_account(struct process *pi, u32 sn, u64 cycles);
+   int alloc_proc_syscall_stats(struct process *pi);
+   void free_proc_syscall_stats(struct process *pi);
+   void register_syscall_stats_sysfs(void);
+
+#else
+
+   static inline void
+   syscall_stats_account(struct process *pi, u32 sn, u64 cycles) { }
+
+   static inline int alloc_proc_syscall_stats(struct process *pi) { return 0; }
+   static inline void free_proc_syscall_stats(struct process *pi) { }
+   static inline void register_syscall_stats_sysfs(void) { }
+
+#endif
@@ -81,7 +81,7 @@ int sys_pause(void);
 int sys_utime32(const char *u_path, const struct k_utimbuf *u_times);
 int sys_access(const char *u_path, mode_t mode);
 
-CREATE_STUB_SYSCALL_IMPL(sys_nice)
+int sys_nice(int inc);
 
 int sys_sync(void);
 int sys_kill(int pid, int sig);
@@ -135,8 +135,9 @@ CREATE_STUB_SYSCALL_IMPL(sys_setregid16)
 CREATE_STUB_SYSCALL_IMPL(sys_sigsuspend)
 CREATE_STUB_SYSCALL_IMPL(sys_sigpending)
 CREATE_STUB_SYSCALL_IMPL(sys_sethostname)
-CREATE_STUB_SYSCALL_IMPL(sys_setrlimit)
-CREATE_STUB_SYSCALL_IMPL(sys_old_getrlimit)
+
+int sys_setrlimit(u32 resource, const struct k_rlimit *user_rlim);
+int sys_old_getrlimit(u32 resource, struct k_rlimit *user_rlim);
 
 int sys_getrusage(int who, struct k_rusage *user_buf);
 int sys_gettimeofday(struct k_timeval *tv, struct timezone *tz);
@@ -168,8 +169,8 @@ CREATE_STUB_SYSCALL_IMPL(sys_ftruncate)
 int sys_fchmod(int fd, mode_t mode);
 
 CREATE_STUB_SYSCALL_IMPL(sys_fchown16)
-CREATE_STUB_SYSCALL_IMPL(sys_getpriority)
-CREATE_STUB_SYSCALL_IMPL(sys_setpriority)
+int sys_getpriority(int which, int who);
+int sys_setpriority(int which, int who, int niceval);
 CREATE_STUB_SYSCALL_IMPL(sys_statfs)
 CREATE_STUB_SYSCALL_IMPL(sys_fstatfs)
 CREATE_STUB_SYSCALL_IMPL(sys_ioperm)
@@ -206,7 +207,8 @@ int sys_newuname(struct utsname *buf);
 CREATE_STUB_SYSCALL_IMPL(sys_modify_ldt)
 CREATE_STUB_SYSCALL_IMPL(sys_adjtimex_time32)
 CREATE_STUB_SYSCALL_IMPL(sys_adjtimex)
-CREATE_STUB_SYSCALL_IMPL(sys_mprotect)
+
+int sys_mprotect(void *addr, size_t len, int prot);
 
 int sys_sigprocmask(ulong a1, ulong a2, ulong a3); // deprecated interface
 
@@ -243,16 +245,15 @@ CREATE_STUB_SYSCALL_IMPL(sys_mlock)
 CREATE_STUB_SYSCALL_IMPL(sys_munlock)
 CREATE_STUB_SYSCALL_IMPL(sys_mlockall)
 CREATE_STUB_SYSCALL_IMPL(sys_munlockall)
-CREATE_STUB_SYSCALL_IMPL(sys_sched_setparam)
-CREATE_STUB_SYSCALL_IMPL(sys_sched_getparam)
-CREATE_STUB_SYSCALL_IMPL(sys_sched_setscheduler)
-CREATE_STUB_SYSCALL_IMPL(sys_sched_getscheduler)
 
+int sys_sched_setparam(int tid, const int *u_param);
+int sys_sched_getparam(int tid, int *u_param);
+int sys_sched_setscheduler(int tid, int policy, const int *u_param);
+int sys_sched_getscheduler(int tid);
 int sys_sched_yield(void);
-
-CREATE_STUB_SYSCALL_IMPL(sys_sched_get_priority_max)
-CREATE_STUB_SYSCALL_IMPL(sys_sched_set_priority_min)
-CREATE_STUB_SYSCALL_IMPL(sys_sched_rr_get_interval_time32)
+int sys_sched_get_priority_max(int policy);
+int sys_sched_get_priority_min(int policy);
+int sys_sched_rr_get_interval_time32(int tid, struct k_timespec32 *u_interval);
 
 int sys_nanosleep_time32(const struct k_timespec32 *req,
                          struct k_timespec32 *rem);
@@ -260,7 +261,9 @@ int sys_nanosleep_time32(const struct k_timespec32 *req,
 long sys_nanosleep(const struct k_timespec64 *u_req,
                    struct k_timespec64 *u_rem);
 
-CREATE_STUB_SYSCALL_IMPL(sys_mremap)
+long sys_mremap(void *old_addr, size_t old_len, size_t new_len,
+                int flags, void *new_addr);
+
 CREATE_STUB_SYSCALL_IMPL(sys_setresuid16)
 CREATE_STUB_SYSCALL_IMPL(sys_getresuid16)
 CREATE_STUB_SYSCALL_IMPL(sys_vm86)
@@ -305,7 +308,7 @@ CREATE_STUB_SYSCALL_IMPL(sys_sendfile)
 
 int sys_vfork(void *u_regs);
 
-CREATE_STUB_SYSCALL_IMPL(sys_getrlimit)
+int sys_getrlimit(u32 resource, struct k_rlimit *user_rlim);
 
 long sys_mmap_pgoff(void *addr, size_t length, int prot,
                     int flags, int fd, size_t pgoffset);
@@ -513,7 +516,12 @@ CREATE_STUB_SYSCALL_IMPL(sys_recvmmsg_time32)
 
 CREATE_STUB_SYSCALL_IMPL(sys_fanotify_init)
 CREATE_STUB_SYSCALL_IMPL(sys_fanotify_mark)
-CREATE_STUB_SYSCALL_IMPL(sys_prlimit64)
+
+int sys_prlimit64(int pid,
+                  u32 resource,
+                  const struct k_rlimit64 *user_new_lim,
+                  struct k_rlimit64 *user_old_lim);
+
 CREATE_STUB_SYSCALL_IMPL(sys_name_to_handle_at)
 CREATE_STUB_SYSCALL_IMPL(sys_open_by_handle_at)
 CREATE_STUB_SYSCALL_IMPL(sys_clock_adjtime32)
@@ -526,8 +534,9 @@ CREATE_STUB_SYSCALL_IMPL(sys_process_vm_readv)
 CREATE_STUB_SYSCALL_IMPL(sys_process_vm_writev)
 CREATE_STUB_SYSCALL_IMPL(sys_kcmp)
 CREATE_STUB_SYSCALL_IMPL(sys_finit_module)
-CREATE_STUB_SYSCALL_IMPL(sys_sched_setattr)
-CREATE_STUB_SYSCALL_IMPL(sys_sched_getattr)
+
+int sys_sched_setattr(int tid, struct k_sched_attr *u_attr, u32 flags);
+int sys_sched_getattr(int tid, struct k_sched_attr *u_attr, u32 size, u32 fl);
 
 long sys_renameat2(int olddfd, const char *oldname,
                    int newdfd, const char *newname, u32 flags);
@@ -600,7 +609,9 @@ CREATE_STUB_SYSCALL_IMPL(sys_mq_timedreceive)
 CREATE_STUB_SYSCALL_IMPL(sys_semtimedop)
 CREATE_STUB_SYSCALL_IMPL(sys_rt_sigtimedwait)
 CREATE_STUB_SYSCALL_IMPL(sys_futex)
-CREATE_STUB_SYSCALL_IMPL(sys_sched_rr_get_interval)
+
+int sys_sched_rr_get_interval(int tid, struct k_timespec64 *u_interval);
+
 CREATE_STUB_SYSCALL_IMPL(sys_pidfd_send_signal)
 CREATE_STUB_SYSCALL_IMPL(sys_io_uring_setup)
 CREATE_STUB_SYSCALL_IMPL(sys_io_uring_enter)
@@ -613,7 +624,9 @@ CREATE_STUB_SYSCALL_IMPL(sys_fsmount)
 CREATE_STUB_SYSCALL_IMPL(sys_fspick)
 CREATE_STUB_SYSCALL_IMPL(sys_pidfd_open)
 CREATE_STUB_SYSCALL_IMPL(sys_clone3)
-CREATE_STUB_SYSCALL_IMPL(sys_close_range)
+
+int sys_close_range(u32 first, u32 last, u32 flags);
+
 CREATE_STUB_SYSCALL_IMPL(sys_openat2)
 CREATE_STUB_SYSCALL_IMPL(sys_pidfd_getfd)
 CREATE_STUB_SYSCALL_IMPL(sys_faccessat2)
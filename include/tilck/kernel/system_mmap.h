@@ -11,6 +11,7 @@
 #define MEM_REG_EXTRA_LOWMEM          (1 << 2)
 #define MEM_REG_EXTRA_FRAMEBUFFER     (1 << 3)
 #define MEM_REG_EXTRA_DMA             (1 << 4)
+#define MEM_REG_EXTRA_PAGE_ALLOC      (1 << 5)
 
 struct mem_region {
 
@@ -44,6 +44,16 @@ struct term_params {
    const struct video_interface *vi;
 };
 
+/* Scrollback info, see term_interface's get_sb_info() */
+struct term_sb_info {
+
+   u32 rows;                  /* rows currently in the scrollback */
+   u32 max_rows;              /* max rows kept (depth) */
+   u32 mem;                   /* bytes of memory allocated */
+   u32 data_size;             /* bytes used by the encoded rows */
+   u32 raw_size;              /* bytes the same rows would take, unencoded */
+};
+
 enum term_fret {
    TERM_FILTER_WRITE_BLANK,
    TERM_FILTER_WRITE_C,
@@ -68,6 +78,10 @@ struct term_interface {
    void (*restart_output)(term *t);
    void (*set_filter)(term *t, term_filter func, void *ctx);
 
+   /* Scrollback funcs (optional) */
+   void (*get_sb_info)(term *t, struct term_sb_info *out);
+   void (*set_sb_max_rows)(term *t, u32 rows);
+
    /*
     * The first term must be pre-allocated but _not_ pre-initialized.
     * It is expected to require init() to be called on it before use.
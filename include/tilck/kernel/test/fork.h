@@ -3,4 +3,4 @@
 #pragma once
 #include <tilck/kernel/process.h>
 
-STATIC int fork_dup_all_handles(struct process *pi);
+STATIC int fork_dup_all_handles(struct process *pi, struct process *parent);
@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/kernel/modules.h>
+#include <tilck/kernel/sync.h>
+
+#define MOD_INIT_THREADS                                 4
+#define MOD_MAX_COUNT                                   32
+
+/*
+ * The state of one run of the modules initialization. The kernel has a single
+ * one, for the registered modules, while the self-tests use their own with
+ * fake modules.
+ */
+struct mod_init_ctx {
+
+   struct module **mods;
+   int count;
+
+   u32 deps_masks[MOD_MAX_COUNT];   /* bit N set: depends on mods[N] */
+   u32 all_mask;                    /* all the modules */
+   u32 fg_mask;                     /* the non-background modules */
+   u32 started_mask;
+   u32 done_mask;
+
+   struct kmutex mutex;
+   struct kcond cond;
+};
+
+int do_init_modules(struct mod_init_ctx *ctx, int *tids);
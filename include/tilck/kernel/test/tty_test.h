@@ -14,3 +14,7 @@ extern term *__curr_term;
 extern const struct term_interface *__curr_term_intf;
 extern const struct term_interface *video_term_intf;
 extern const struct term_interface *serial_term_intf;
+
+#if KRN_TTY_ASYNC_OUTPUT
+extern struct worker_thread *tty_out_wth;
+#endif
@@ -33,14 +33,31 @@ struct tty {
    struct ringbuf input_ringbuf;
    struct kcond input_cond;     /* signal when we can read from input_rb */
    struct kcond output_cond;    /* signal when we can write to input_rb */
-   int end_line_delim_count;
+   u16 *input_lines;            /* ICANON: lengths of the lines in input_rb */
+   u16 input_lines_first;
+   u16 input_lines_count;
+   u16 edit_len;                /* ICANON: bytes in edit_buf */
+   u32 input_overruns;          /* input bytes discarded */
 
    bool mediumraw_mode;
    u8 curr_color;
    u16 serial_port_fwd;
 
    char *input_buf;
+   char *edit_buf;              /* ICANON: the line being edited */
    u32 kd_gfx_mode;
    tty_ctrl_sig_func *ctrl_handlers;
    struct termios c_term;
+
+#if KRN_TTY_ASYNC_OUTPUT
+   struct ringbuf out_ringbuf;
+   char *out_buf;               /* out_ringbuf's buffer */
+   char *out_flush_buf;         /* used only by the flush job */
+   struct kmutex out_lock;      /* serializes the writers and drain waiters */
+   struct kcond out_space_cond; /* signal when there's space in out_ringbuf */
+   struct kcond out_drain_cond; /* signal when all the output is rendered */
+   bool out_job_queued;
+   bool out_flush_delayed;      /* tty_output_delayed_flush() is pending */
+   bool out_flushing;
+#endif
 };
@@ -38,5 +38,21 @@ wth_enqueue_on(struct worker_thread *wth, void (*func)(void *), void *arg);
 NODISCARD bool
 wth_enqueue_anywhere(int lowest_prio, void (*func)(void *), void *arg);
 
+/*
+ * Enqueues the job with wth_enqueue_anywhere() after `ticks` timer ticks.
+ * Returns false if there are already WTH_MAX_DELAYED_JOBS delayed jobs.
+ */
+NODISCARD bool
+wth_enqueue_delayed(int lowest_prio,
+                    u32 ticks,
+                    void (*func)(void *),
+                    void *arg);
+
+void
+wth_run_delayed_jobs(u64 now);
+
 void
 wth_wait_for_completion(struct worker_thread *wth);
+
+void
+register_wth_sysfs(void);
@@ -248,6 +248,18 @@ set_traced_syscalls(const char *str);
 int
 tracing_get_in_buffer_events_count(void);
 
+struct tracing_ring_stats {
+
+   u32 in_buf;          /* events currently in the ring buffer */
+   u32 capacity;        /* max number of events in the ring buffer */
+   u64 written;         /* events ever written in the ring buffer */
+   u64 read;            /* events ever consumed by the reader */
+   u64 dropped;         /* events dropped because the ring was full */
+};
+
+void
+tracing_get_ring_stats(struct tracing_ring_stats *st);
+
 extern const struct syscall_info *tracing_metadata;
 extern const struct sys_param_type ptype_int;
 extern const struct sys_param_type ptype_voidp;
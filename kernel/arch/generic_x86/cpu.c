@@ -355,6 +355,30 @@ void fpu_context_begin(void)
    save_current_fpu_regs(true);
 }
 
+/*
+ * Like fpu_context_begin(), but instead of asserting on nested contexts it
+ * just returns false when the FPU cannot be used right now (nested context,
+ * no SSE, panic): the caller is expected to fall back to non-FPU code. On
+ * success, the context must be closed with fpu_context_end().
+ */
+bool fpu_context_try_begin(void)
+{
+   if (!x86_cpu_features.can_use_sse || in_panic())
+      return false;
+
+   disable_preemption();
+
+   if (in_fpu_context) {
+      enable_preemption();
+      return false;
+   }
+
+   in_fpu_context = true;
+   hw_fpu_enable();
+   save_current_fpu_regs(true);
+   return true;
+}
+
 void fpu_context_end(void)
 {
    ASSERT(in_fpu_context);
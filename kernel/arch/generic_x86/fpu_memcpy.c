@@ -26,6 +26,7 @@
 
 #include <tilck/kernel/elf_utils.h>
 #include <tilck/kernel/cmdline.h>
+#include <tilck/kernel/hal.h>
 #include <tilck/kernel/arch/generic_x86/fpu_memcpy.h>
 
 void
@@ -143,6 +144,223 @@ void fpu_memset256_avx2(void *dest, u32 val32, u32 n)
       fpu_cpy_single_256_nt_avx2(dest, val256);
 }
 
+/* 'n' is the number of 32-byte (256-bit) data packets to zero */
+void fpu_bzero256_sse2(void *dest, u32 n)
+{
+   for (register u32 i = 0; i < n; i++, dest += 32)
+      fpu_zero_single_256_sse2(dest);
+}
+
+/* 'n' is the number of 32-byte (256-bit) data packets to zero */
+void fpu_bzero256_avx2(void *dest, u32 n)
+{
+   for (register u32 i = 0; i < n; i++, dest += 32)
+      fpu_zero_single_256_avx2(dest);
+}
+
+/*
+ * -----------------------------------------------
+ *
+ * bulk_memcpy() and bulk_bzero()
+ *
+ * -----------------------------------------------
+ */
+
+static void bulk_memcpy_movs(void *dest, const void *src, size_t n)
+{
+   memcpy(dest, src, n);
+}
+
+static void bulk_bzero_stos(void *dest, size_t n)
+{
+   bzero(dest, n);
+}
+
+static void bulk_memcpy_erms(void *dest, const void *src, size_t n)
+{
+   asmVolatile("rep movsb"
+               : "+D" (dest), "+S" (src), "+c" (n)
+               : /* no input */
+               : "memory");
+}
+
+static void bulk_bzero_erms(void *dest, size_t n)
+{
+   asmVolatile("rep stosb"
+               : "+D" (dest), "+c" (n)
+               : "a" (0)
+               : "memory");
+}
+
+/*
+ * The SIMD funcs use aligned MOVs: with unaligned buffers or when we cannot
+ * open an FPU context (e.g. we're already in one), fall back to REP MOVS.
+ */
+static ALWAYS_INLINE bool bulk_fpu_begin(ulong addrs)
+{
+   return !(addrs & 31) && fpu_context_try_begin();
+}
+
+static ALWAYS_INLINE void
+bulk_memcpy_fpu(void *dest, const void *src, size_t n,
+                void (*cpy256)(void *, const void *, u32))
+{
+   const size_t rem = n % 32;
+
+   if (!bulk_fpu_begin((ulong)dest | (ulong)src)) {
+      memcpy(dest, src, n);
+      return;
+   }
+
+   cpy256(dest, src, (u32)(n / 32));
+   fpu_context_end();
+
+   if (rem)
+      memcpy(dest + n - rem, src + n - rem, rem);
+}
+
+static ALWAYS_INLINE void
+bulk_bzero_fpu(void *dest, size_t n, void (*zero256)(void *, u32))
+{
+   const size_t rem = n % 32;
+
+   if (!bulk_fpu_begin((ulong)dest)) {
+      bzero(dest, n);
+      return;
+   }
+
+   zero256(dest, (u32)(n / 32));
+   fpu_context_end();
+
+   if (rem)
+      bzero(dest + n - rem, rem);
+}
+
+static void bulk_memcpy_avx2(void *dest, const void *src, size_t n)
+{
+   bulk_memcpy_fpu(dest, src, n, &fpu_memcpy256_avx2);
+}
+
+static void bulk_bzero_avx2(void *dest, size_t n)
+{
+   bulk_bzero_fpu(dest, n, &fpu_bzero256_avx2);
+}
+
+static void bulk_memcpy_sse2(void *dest, const void *src, size_t n)
+{
+   bulk_memcpy_fpu(dest, src, n, &fpu_memcpy256_sse2);
+}
+
+static void bulk_bzero_sse2(void *dest, size_t n)
+{
+   bulk_bzero_fpu(dest, n, &fpu_bzero256_sse2);
+}
+
+static bool bulk_mem_always_supported(void)
+{
+   return true;
+}
+
+static bool bulk_mem_erms_supported(void)
+{
+   return x86_cpu_features.erms;
+}
+
+static bool bulk_mem_avx2_supported(void)
+{
+   return x86_cpu_features.can_use_avx2;
+}
+
+static bool bulk_mem_sse2_supported(void)
+{
+   return x86_cpu_features.can_use_sse2;
+}
+
+/*
+ * In order of preference. With ERMS, REP MOVSB/STOSB run at full cache
+ * bandwidth on page-sized buffers without touching the FPU: prefer them over
+ * the SIMD loops, which have to save and restore the whole FPU state on each
+ * call. The last entry must be always supported.
+ */
+const struct bulk_mem_impl bulk_mem_impls[] = {
+
+   {
+      .name = "erms",
+      .cpy = &bulk_memcpy_erms,
+      .zero = &bulk_bzero_erms,
+      .is_supported = &bulk_mem_erms_supported,
+      .uses_fpu = false,
+   },
+
+   {
+      .name = "avx2",
+      .cpy = &bulk_memcpy_avx2,
+      .zero = &bulk_bzero_avx2,
+      .is_supported = &bulk_mem_avx2_supported,
+      .uses_fpu = true,
+   },
+
+   {
+      .name = "sse2",
+      .cpy = &bulk_memcpy_sse2,
+      .zero = &bulk_bzero_sse2,
+      .is_supported = &bulk_mem_sse2_supported,
+      .uses_fpu = true,
+   },
+
+   {
+      .name = "rep movs",
+      .cpy = &bulk_memcpy_movs,
+      .zero = &bulk_bzero_stos,
+      .is_supported = &bulk_mem_always_supported,
+      .uses_fpu = false,
+   },
+};
+
+const u32 bulk_mem_impls_count = ARRAY_SIZE(bulk_mem_impls);
+
+static const struct bulk_mem_impl *bulk_mem =
+   &bulk_mem_impls[ARRAY_SIZE(bulk_mem_impls) - 1];
+
+void bulk_memcpy(void *dest, const void *src, size_t n)
+{
+   if (n < PAGE_SIZE)
+      memcpy(dest, src, n);
+   else
+      bulk_mem->cpy(dest, src, n);
+}
+
+void bulk_bzero(void *dest, size_t n)
+{
+   if (n < PAGE_SIZE)
+      bzero(dest, n);
+   else
+      bulk_mem->zero(dest, n);
+}
+
+const char *get_bulk_mem_impl_name(void)
+{
+   return bulk_mem->name;
+}
+
+static void init_bulk_mem(void)
+{
+   for (u32 i = 0; i < ARRAY_SIZE(bulk_mem_impls); i++) {
+
+      const struct bulk_mem_impl *impl = &bulk_mem_impls[i];
+
+      if (impl->uses_fpu && kopt_no_fpu_memcpy)
+         continue;
+
+      if (impl->is_supported()) {
+         bulk_mem = impl;
+         break;
+      }
+   }
+
+   printk("INFO: bulk memcpy/bzero: %s\n", bulk_mem->name);
+}
+
 static void
 init_fpu_memcpy_internal_check(void *func, const char *fname, u32 size)
 {
@@ -260,4 +478,6 @@ void init_fpu_memcpy(void)
    if ((func = get_fpu_cpy_single_256_nt_read_func())) {
       simple_hot_patch(&__asm_fpu_cpy_single_256_nt_read, func, 128);
    }
+
+   init_bulk_mem();
 }
@@ -15,6 +15,7 @@
 #include <tilck/kernel/user.h>
 #include <tilck/kernel/elf_utils.h>
 #include <tilck/kernel/signal.h>
+#include <tilck/kernel/syscall_stats.h>
 #include <tilck/mods/tracing.h>
 
 #include "idt_int.h"
@@ -235,7 +236,7 @@ static struct syscall syscalls[MAX_SYSCALLS] =
    [157] = DECL_SYS(sys_sched_getscheduler, 0),
    [158] = DECL_SYS(sys_sched_yield, 0),
    [159] = DECL_SYS(sys_sched_get_priority_max, 0),
-   [160] = DECL_SYS(sys_sched_set_priority_min, 0),
+   [160] = DECL_SYS(sys_sched_get_priority_min, 0),
    [161] = DECL_SYS(sys_sched_rr_get_interval_time32, 0),
    [162] = DECL_SYS(sys_nanosleep_time32, 0),
    [163] = DECL_SYS(sys_mremap, 0),
@@ -555,7 +556,14 @@ do_syscall_int(syscall_type fptr, regs_t *r, bool raw_regs)
    }
 }
 
-static void do_special_syscall(regs_t *r)
+/* `start` is the RDTSC() value read by handle_syscall() */
+static ALWAYS_INLINE void syscall_stats_end(u32 sn, u64 start)
+{
+   if (KRN_SYSCALL_STATS)
+      syscall_stats_account(get_curr_proc(), sn, RDTSC() - start);
+}
+
+static void do_special_syscall(regs_t *r, u64 start)
 {
    struct task *curr = get_curr_task();
    const u32 sn = r->eax;
@@ -580,11 +588,13 @@ static void do_special_syscall(regs_t *r)
    if (preemptable)
       disable_preemption();
 
+   syscall_stats_end(sn, start);
+
    if (signals)
       process_signals(curr, sig_in_syscall, r);
 }
 
-static void do_syscall(regs_t *r)
+static void do_syscall(regs_t *r, u64 start)
 {
    struct task *curr = get_curr_task();
    const u32 sn = r->eax;
@@ -597,6 +607,7 @@ static void do_syscall(regs_t *r)
       trace_sys_exit(sn,r->eax,r->ebx,r->ecx,r->edx,r->esi,r->edi,r->ebp);
    }
    disable_preemption();
+   syscall_stats_end(sn, start);
    process_signals(curr, sig_in_syscall, r);
 }
 
@@ -617,10 +628,12 @@ void handle_syscall(regs_t *r)
 
    if (LIKELY(sn < ARRAY_SIZE(syscalls))) {
 
+      const u64 start = KRN_SYSCALL_STATS ? RDTSC() : 0;
+
       if (LIKELY(syscalls[sn].flags == 0))
-         do_syscall(r);
+         do_syscall(r, start);
       else
-         do_special_syscall(r);
+         do_special_syscall(r, start);
 
    } else {
 
@@ -11,6 +11,7 @@
 #include <tilck/kernel/paging_hw.h>
 #include <tilck/kernel/irq.h>
 #include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/page_alloc.h>
 #include <tilck/kernel/debug_utils.h>
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/hal.h>
@@ -78,8 +79,15 @@ bool handle_potential_cow(void *context)
       return true;
    }
 
-   // Allocate a new page.
-   void *new_page_vaddr = kmalloc(PAGE_SIZE);
+   /*
+    * Allocate a new page. When the original page is the zero page, there's
+    * nothing to copy: just get a pre-zeroed page from the page allocator.
+    */
+   const bool from_zero_page =
+      orig_page_paddr == KERNEL_VA_TO_PA(&zero_page);
+
+   void *new_page_vaddr =
+      alloc_pageframe(from_zero_page ? PAGE_ALLOC_FL_ZERO : 0);
 
    if (!new_page_vaddr) {
 
@@ -105,7 +113,8 @@ bool handle_potential_cow(void *context)
    ASSERT(IS_PAGE_ALIGNED(new_page_vaddr));
 
    // Copy page's contents
-   memcpy32(new_page_vaddr, page_vaddr, PAGE_SIZE / 4);
+   if (!from_zero_page)
+      bulk_memcpy(new_page_vaddr, page_vaddr, PAGE_SIZE);
 
    // Get the paddr of the new page
    const ulong paddr = LIN_VA_TO_PA(new_page_vaddr);
@@ -167,9 +176,10 @@ void handle_page_fault_int(regs_t *r)
 
       /*
        * Call vfs_handle_fault() only if in first place the mapping allowed
-       * writing or if it didn't but the memory access type was a READ.
+       * writing or if it didn't but the memory access type was a READ and the
+       * mapping allowed reading (it might be a PROT_NONE guard page).
        */
-      if (!!(um->prot & PROT_WRITE) || !rw) {
+      if (!!(um->prot & PROT_WRITE) || (!rw && !!(um->prot & PROT_READ))) {
 
          if (vfs_handle_fault(um, (void *)vaddr, p, rw))
             return;
@@ -255,8 +265,69 @@ void set_page_rw(pdir_t *pdir, void *vaddrp, bool rw)
    invalidate_page_hw(vaddr);
 }
 
+static page_t *
+get_user_page_entry(pdir_t *pdir, void *vaddrp)
+{
+   page_table_t *pt;
+   const ulong vaddr = (ulong) vaddrp;
+   const u32 pt_index = (vaddr >> PAGE_SHIFT) & 1023;
+   const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
+
+   ASSERT(!pdir->entries[pd_index].psize);
+   pt = pdir_get_page_table(pdir, pd_index);
+   ASSERT(LIN_VA_TO_PA(pt) != 0);
+   ASSERT(pt->pages[pt_index].present);
+   return &pt->pages[pt_index];
+}
+
+void set_page_prot(pdir_t *pdir, void *vaddrp, u32 pg_flags)
+{
+   page_t *p = get_user_page_entry(pdir, vaddrp);
+   const ulong paddr = (ulong)p->pageAddr << PAGE_SHIFT;
+
+   p->us = !!(pg_flags & PAGING_FL_US);
+
+   if (!(pg_flags & PAGING_FL_RW)) {
+
+      p->rw = false;
+      p->avail &= ~PAGE_COW_ORIG_RW;
+
+   } else if (p->avail & PAGE_SHARED) {
+
+      p->rw = true;
+
+   } else if (paddr != KERNEL_VA_TO_PA(&zero_page) &&
+              pf_ref_count_get(paddr) == 1)
+   {
+      /* Private page, not shared with anybody: just make it writable */
+      p->rw = true;
+      p->avail &= ~PAGE_COW_ORIG_RW;
+
+   } else {
+
+      /* Zero page or pageframe shared after fork(): make it a CoW page */
+      p->rw = false;
+      p->avail |= PAGE_COW_ORIG_RW;
+   }
+
+   invalidate_page_hw((ulong)vaddrp);
+}
+
+void swap_page_mappings(pdir_t *pdir, void *vaddr1, void *vaddr2)
+{
+   page_t *p1 = get_user_page_entry(pdir, vaddr1);
+   page_t *p2 = get_user_page_entry(pdir, vaddr2);
+   const u32 raw1 = p1->raw;
+
+   p1->raw = p2->raw;
+   p2->raw = raw1;
+
+   invalidate_page_hw((ulong)vaddr1);
+   invalidate_page_hw((ulong)vaddr2);
+}
+
 static inline int
-__unmap_page(pdir_t *pdir, void *vaddrp, bool free_pageframe, bool permissive)
+__unmap_page(pdir_t *pdir, void *vaddrp, bool free_pf, bool permissive)
 {
    page_table_t *pt;
    const ulong vaddr = (ulong) vaddrp;
@@ -284,9 +355,9 @@ __unmap_page(pdir_t *pdir, void *vaddrp, bool free_pageframe, bool permissive)
    pt->pages[pt_index].raw = 0;
    invalidate_page_hw(vaddr);
 
-   if (!pf_ref_count_dec(paddr) && free_pageframe) {
+   if (!pf_ref_count_dec(paddr) && free_pf) {
       ASSERT(paddr != KERNEL_VA_TO_PA(zero_page));
-      kfree2(PA_TO_LIN_VA(paddr), PAGE_SIZE);
+      free_pageframe(PA_TO_LIN_VA(paddr));
    }
 
    return 0;
@@ -525,11 +596,10 @@ map_page(pdir_t *pdir, void *vaddrp, ulong paddr, u32 pg_flags)
       void *va;
       ASSERT(paddr == 0);
 
-      if (!(va = kmalloc(PAGE_SIZE)))
-         return -ENOMEM;
+      const u32 fl = (pg_flags & PAGING_FL_ZERO_PG) ? PAGE_ALLOC_FL_ZERO : 0;
 
-      if (pg_flags & PAGING_FL_ZERO_PG)
-         bzero(va, PAGE_SIZE);
+      if (!(va = alloc_pageframe(fl)))
+         return -ENOMEM;
 
       paddr = LIN_VA_TO_PA(va);
 
@@ -551,7 +621,7 @@ map_page(pdir_t *pdir, void *vaddrp, ulong paddr, u32 pg_flags)
                    /* Kernel pages are global */
 
    if (UNLIKELY(rc != 0) && (pg_flags & PAGING_FL_DO_ALLOC)) {
-      kfree2(PA_TO_LIN_VA(paddr), PAGE_SIZE);
+      free_pageframe(PA_TO_LIN_VA(paddr));
    }
 
    return rc;
@@ -740,7 +810,7 @@ pdir_deep_clone(pdir_t *pdir)
          ASSERT(pf_ref_count_get(new_page_paddr) == 0);
          pf_ref_count_inc(new_page_paddr);
 
-         memcpy32(new_page, orig_page, PAGE_SIZE / 4);
+         bulk_memcpy(new_page, orig_page, PAGE_SIZE);
          new_pt->pages[j].pageAddr = SHR_BITS(new_page_paddr, PAGE_SHIFT, u32);
       }
 
@@ -785,7 +855,7 @@ void pdir_destroy(pdir_t *pdir)
          const ulong paddr = (ulong)pt->pages[j].pageAddr << PAGE_SHIFT;
 
          if (pf_ref_count_dec(paddr) == 0)
-            kfree2(PA_TO_LIN_VA(paddr), PAGE_SIZE);
+            free_pageframe(PA_TO_LIN_VA(paddr));
       }
 
       // We freed all the pages, now free the whole page-table.
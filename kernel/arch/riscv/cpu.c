@@ -148,6 +148,24 @@ void fpu_context_begin(void)
    save_current_fpu_regs(true);
 }
 
+bool fpu_context_try_begin(void)
+{
+   if (in_panic())
+      return false;
+
+   disable_preemption();
+
+   if (in_fpu_context) {
+      enable_preemption();
+      return false;
+   }
+
+   in_fpu_context = true;
+   hw_fpu_enable();
+   save_current_fpu_regs(true);
+   return true;
+}
+
 void fpu_context_end(void)
 {
    ASSERT(in_fpu_context);
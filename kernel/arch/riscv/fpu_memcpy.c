@@ -26,6 +26,7 @@
 
 #include <tilck/kernel/elf_utils.h>
 #include <tilck/kernel/cmdline.h>
+#include <tilck/kernel/hal.h>
 #include <tilck/kernel/arch/riscv/fpu_memcpy.h>
 
 void
@@ -40,3 +41,18 @@ memcpy_single_256_failsafe(void *dest, const void *src)
    memcpy32(dest, src, 8);
 }
 
+
+void bulk_memcpy(void *dest, const void *src, size_t n)
+{
+   memcpy(dest, src, n);
+}
+
+void bulk_bzero(void *dest, size_t n)
+{
+   bzero(dest, n);
+}
+
+const char *get_bulk_mem_impl_name(void)
+{
+   return "generic";
+}
@@ -111,6 +111,11 @@ void release_pageframes_mapped_at(pdir_t *pdir, void *vaddrp, size_t len)
    }
 }
 
+u32 get_pageframe_ref_count(ulong paddr)
+{
+   return pf_ref_count_get((u32)paddr);
+}
+
 void invalidate_page(ulong vaddr)
 {
    invalidate_page_hw(vaddr);
@@ -17,6 +17,7 @@
 #include <tilck/kernel/user.h>
 #include <tilck/kernel/elf_utils.h>
 #include <tilck/kernel/signal.h>
+#include <tilck/kernel/syscall_stats.h>
 #include <tilck/mods/tracing.h>
 
 typedef long (*syscall_type)(
@@ -197,7 +198,7 @@ static struct syscall syscalls[MAX_SYSCALLS] =
    [123] = DECL_SYS(sys_sched_getaffinity, 0),
    [124] = DECL_SYS(sys_sched_yield, 0),
    [125] = DECL_SYS(sys_sched_get_priority_max, 0),
-   [126] = DECL_SYS(sys_sched_set_priority_min, 0),
+   [126] = DECL_SYS(sys_sched_get_priority_min, 0),
    [127] = DECL_SYS(sys_sched_rr_get_interval, 0),
    [128] = DECL_SYS(sys_restart_syscall, 0),
    [129] = DECL_SYS(sys_kill, 0),
@@ -421,7 +422,14 @@ do_syscall_int(syscall_type fptr, regs_t *r, bool raw_regs)
    }
 }
 
-static void do_special_syscall(regs_t *r)
+/* `start` is the RDTSC() value read by handle_syscall() */
+static ALWAYS_INLINE void syscall_stats_end(u32 sn, u64 start)
+{
+   if (KRN_SYSCALL_STATS)
+      syscall_stats_account(get_curr_proc(), sn, RDTSC() - start);
+}
+
+static void do_special_syscall(regs_t *r, u64 start)
 {
    struct task *curr = get_curr_task();
    const u32 sn = r->a7;
@@ -446,11 +454,13 @@ static void do_special_syscall(regs_t *r)
    if (preemptable)
       disable_preemption();
 
+   syscall_stats_end(sn, start);
+
    if (signals)
       process_signals(curr, sig_in_syscall, r);
 }
 
-static void do_syscall(regs_t *r)
+static void do_syscall(regs_t *r, u64 start)
 {
    struct task *curr = get_curr_task();
    const u32 sn = r->a7;
@@ -463,6 +473,7 @@ static void do_syscall(regs_t *r)
       trace_sys_exit(sn,r->a0,r->a1,r->a2,r->a3,r->a4,r->a5, r->a7);
    }
    disable_preemption();
+   syscall_stats_end(sn, start);
    process_signals(curr, sig_in_syscall, r);
 }
 
@@ -481,10 +492,12 @@ void handle_syscall(regs_t *r)
 
    if (LIKELY(sn < ARRAY_SIZE(syscalls))) {
 
+      const u64 start = KRN_SYSCALL_STATS ? RDTSC() : 0;
+
       if (LIKELY(syscalls[sn].flags == 0))
-         do_syscall(r);
+         do_syscall(r, start);
       else
-         do_special_syscall(r);
+         do_special_syscall(r, start);
 
    } else {
 
@@ -72,6 +72,16 @@ void set_page_rw(pdir_t *pdir, void *vaddrp, bool rw)
    NOT_IMPLEMENTED();
 }
 
+void set_page_prot(pdir_t *pdir, void *vaddrp, u32 pg_flags)
+{
+   NOT_IMPLEMENTED();
+}
+
+void swap_page_mappings(pdir_t *pdir, void *vaddr1, void *vaddr2)
+{
+   NOT_IMPLEMENTED();
+}
+
 NODISCARD int
 map_page(pdir_t *pdir, void *vaddrp, ulong paddr, u32 pg_flags)
 {
@@ -0,0 +1,190 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_debug.h>
+#include <tilck_gen_headers/mod_sysfs.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/boot_trace.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/hal.h>
+
+#if MOD_sysfs
+   #include <tilck/mods/sysfs.h>
+   #include <tilck/mods/sysfs_utils.h>
+#endif
+
+#if KRN_BOOT_TRACE
+
+static struct boot_trace_event boot_events[BOOT_TRACE_MAX_EVENTS];
+static u32 boot_events_count;
+static u32 boot_events_dropped;
+
+/* Cycle counter and system time, sampled together once the timer is up */
+static u64 calib_cycles;
+static u64 calib_ns;
+
+static const char *const phase_kind_str[] = {
+   [BOOT_PHASE_INIT] = "init",
+   [BOOT_PHASE_ASYNC] = "async",
+   [BOOT_PHASE_MODULE] = "module",
+   [BOOT_PHASE_MARK] = "mark",
+};
+
+int boot_trace_begin(const char *name, enum boot_phase_kind kind)
+{
+   /* Atomic: the phases might run in parallel on other tasks */
+   const u32 idx = __atomic_fetch_add(&boot_events_count, 1, __ATOMIC_RELAXED);
+   struct boot_trace_event *e;
+
+   if (idx >= BOOT_TRACE_MAX_EVENTS) {
+      __atomic_fetch_add(&boot_events_dropped, 1, __ATOMIC_RELAXED);
+      return -1;
+   }
+
+   /*
+    * The slot is already visible to the readers: publish the name last, as
+    * they skip the entries without a name.
+    */
+   e = &boot_events[idx];
+   e->kind = kind;
+   e->start = RDTSC();
+   __atomic_store_n(&e->name, name, __ATOMIC_RELEASE);
+   return (int)idx;
+}
+
+void boot_trace_end(int idx)
+{
+   if (idx >= 0)
+      boot_events[idx].end = RDTSC();
+}
+
+void boot_trace_mark(const char *name)
+{
+   boot_trace_end(boot_trace_begin(name, BOOT_PHASE_MARK));
+}
+
+void boot_trace_calibrate(void)
+{
+   calib_cycles = RDTSC();
+   calib_ns = get_sys_time();
+}
+
+/* ----------------------- /syst/boot/ files ------------------------ */
+
+#if MOD_sysfs
+
+#define TIMELINE_LINE_MAX                                     96
+#define HEADER_MAX                                     192
+
+/*
+ * Returns the number of cycles per millisecond (not microsecond, in order to
+ * keep some precision on slow CPUs), comparing the calibration sample with the
+ * current cycle counter and time. Returns 0 if the calibration didn't happen.
+ */
+static u64 get_cycles_per_ms(void)
+{
+   u64 cycles, ns;
+
+   if (!calib_ns)
+      return 0;
+
+   cycles = RDTSC() - calib_cycles;
+   ns = get_sys_time() - calib_ns;
+
+   if (ns < TS_SCALE / 1000)
+      return 0;   /* too early: not enough precision */
+
+   return cycles / (ns / (TS_SCALE / 1000));
+}
+
+static inline u64 cycles_to_us(u64 cycles, u64 cycles_per_ms)
+{
+   return cycles_per_ms ? cycles * 1000 / cycles_per_ms : 0;
+}
+
+static offt
+boot_timeline_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return HEADER_MAX + BOOT_TRACE_MAX_EVENTS * TIMELINE_LINE_MAX;
+}
+
+static offt
+boot_timeline_load(struct sysobj *obj, void *data,
+                   void *buf, offt buf_sz, offt off)
+{
+   const u32 count = MIN(boot_events_count, (u32)BOOT_TRACE_MAX_EVENTS);
+   const u64 cpms = get_cycles_per_ms();
+   const size_t sz = (size_t)buf_sz;
+   const u64 t0 = count ? boot_events[0].start : 0;
+   char *p = buf;
+   size_t used;
+
+   ASSERT(off == 0);
+
+   used = (size_t)snprintk(p, sz,
+                           "# cycles_per_ms: %llu\n"
+                           "# dropped: %u\n"
+                           "# start_us dur_us cycles kind name\n",
+                           cpms, boot_events_dropped);
+
+   for (u32 i = 0; i < count && used < sz; i++) {
+
+      const char *name =
+         __atomic_load_n(&boot_events[i].name, __ATOMIC_ACQUIRE);
+      struct boot_trace_event e;
+      u64 cycles;
+
+      if (!name)
+         continue;   /* begin() is still filling it */
+
+      e = boot_events[i];
+      cycles = e.end ? e.end - e.start : 0;  /* 0 if running */
+
+      used += (size_t)snprintk(p + used, sz - used,
+                               "%llu %llu %llu %s %s\n",
+                               cycles_to_us(e.start - t0, cpms),
+                               cycles_to_us(cycles, cpms),
+                               cycles,
+                               phase_kind_str[e.kind],
+                               name);
+   }
+
+   return (offt)MIN(used, sz);
+}
+
+static const struct sysobj_prop_type boot_timeline_prop_type = {
+   .buf_type = SYSFS_BUF_BUFFERED,
+   .get_buf_sz = &boot_timeline_get_buf_sz,
+   .load = &boot_timeline_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(timeline, &boot_timeline_prop_type);
+
+DEF_STATIC_SYSOBJ_TYPE(boot_trace_sysobj_type,
+                       &prop_timeline,
+                       NULL);
+
+void register_boot_trace_sysfs(void)
+{
+   struct sysobj *obj = sysfs_create_obj(&boot_trace_sysobj_type, NULL, NULL);
+
+   if (!obj) {
+      printk("WARNING: /syst/boot not registered: out of memory\n");
+      return;
+   }
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "boot", obj) < 0) {
+      printk("WARNING: /syst/boot not registered\n");
+      sysfs_destroy_unregistered_obj(obj);
+   }
+}
+
+#else  /* !MOD_sysfs */
+
+void register_boot_trace_sysfs(void) { /* no-op */ }
+
+#endif /* MOD_sysfs */
+#endif /* KRN_BOOT_TRACE */
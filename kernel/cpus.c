@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/cpus.h>
+
+static u32 cpus_count;
+static u32 enabled_cpus_count;
+static u32 boot_cpu_hw_id;
+
+/*
+ * Called by the firmware-specific code (e.g. the ACPI module parsing the
+ * MADT) for each CPU found, before init_cpus(). The boot CPU must be the
+ * first one: the ACPI spec requires that for the MADT entries.
+ */
+void register_cpu(u32 hw_id, bool enabled)
+{
+   if (!cpus_count) {
+      boot_cpu_hw_id = hw_id;
+      enabled = true;
+   }
+
+   cpus_count++;
+   enabled_cpus_count += enabled;
+}
+
+void init_cpus(void)
+{
+   if (!cpus_count) {
+
+      /* No firmware info: assume a single CPU */
+      register_cpu(0, true);
+   }
+
+   printk("cpus: found %u CPUs (%u enabled), boot CPU id: %u\n",
+          cpus_count, enabled_cpus_count, boot_cpu_hw_id);
+
+   if (cpus_count > 1)
+      printk("cpus: no SMP support, running on the boot CPU only\n");
+}
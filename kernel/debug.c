@@ -190,7 +190,7 @@ static int dump_task_state_cb(void *obj, void *arg)
     * for it.
     */
    if (!is_kernel_thread(ti) && ti->pi) {
-      for (int fd = 0; fd < KRN_MAX_HANDLES; fd++) {
+      for (int fd = 0; fd < (int)get_fd_table_end(ti->pi); fd++) {
          fs_handle h = ti->pi->handles[fd];
          bool is_write_end;
          struct pipe *pipe_p;
@@ -11,6 +11,7 @@
 #include <tilck/kernel/paging_hw.h>
 #include <tilck/kernel/process_mm.h>
 #include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/page_alloc.h>
 #include <tilck/kernel/fs/vfs.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/elf_utils.h>
@@ -73,11 +74,11 @@ load_segment_by_copy(fs_handle *elf_h,
 
       if (!is_mapped(pdir, vaddr)) {
 
-         if (!(p = kzmalloc(PAGE_SIZE)))
+         if (!(p = alloc_pageframe(PAGE_ALLOC_FL_ZERO)))
             return -ENOMEM;
 
          if ((rc = map_page(pdir, vaddr, LIN_VA_TO_PA(p), PAGING_FL_RWUS))) {
-            kfree2(p, PAGE_SIZE);
+            free_pageframe(p);
             return (int)rc;
          }
 
@@ -300,7 +301,7 @@ static int
 alloc_and_map_stack_page(pdir_t *pdir, void *stack_top, u32 i)
 {
    int rc;
-   void *p = kzmalloc(PAGE_SIZE);
+   void *p = alloc_pageframe(PAGE_ALLOC_FL_ZERO);
 
    if (!p)
       return -ENOMEM;
@@ -310,6 +311,9 @@ alloc_and_map_stack_page(pdir_t *pdir, void *stack_top, u32 i)
                  LIN_VA_TO_PA(p),
                  PAGING_FL_RW | PAGING_FL_US);
 
+   if (rc)
+      free_pageframe(p);
+
    return rc;
 }
 
@@ -102,10 +102,10 @@ close_all_handles(void)
    struct process *pi = get_curr_proc();
    ASSERT(is_preemption_enabled());
 
-   for (int i = 0; i < KRN_MAX_HANDLES; i++) {
+   for (u32 i = 0, end = get_fd_table_end(pi); i < end; i++) {
       if (pi->handles[i]) {
          vfs_close(pi->handles[i]);
-         pi->handles[i] = NULL;
+         set_fs_handle(pi, (int)i, NULL);
       }
    }
 }
@@ -11,15 +11,20 @@
 #include <tilck/kernel/process_mm.h>
 #include <tilck/kernel/test/fork.h>
 
-STATIC int fork_dup_all_handles(struct process *pi)
+STATIC int fork_dup_all_handles(struct process *pi, struct process *parent)
 {
+   const u32 end = get_fd_table_end(parent);
    ASSERT(!is_preemption_enabled());
 
-   for (u32 i = 0; i < KRN_MAX_HANDLES; i++) {
+   /* Allocate (if necessary) only the used part of the parent's fd table */
+   if (grow_fd_table(pi, end))
+      return -ENOMEM;
+
+   for (u32 i = 0; i < end; i++) {
 
       int rc;
       fs_handle dup_h = NULL;
-      fs_handle h = pi->handles[i];
+      fs_handle h = parent->handles[i];
       struct user_mapping *um;
 
       if (!h)
@@ -31,8 +36,12 @@ STATIC int fork_dup_all_handles(struct process *pi)
 
          enable_preemption();
          {
-            for (u32 j = 0; j < i; j++)
-               vfs_close(pi->handles[j]);
+            for (u32 j = 0; j < i; j++) {
+               if (pi->handles[j]) {
+                  vfs_close(pi->handles[j]);
+                  set_fs_handle(pi, (int)j, NULL);
+               }
+            }
          }
          disable_preemption();
          return -ENOMEM;
@@ -41,8 +50,7 @@ STATIC int fork_dup_all_handles(struct process *pi)
       /* Update file handle's process pointer to the new process */
       ((struct fs_handle_base *)dup_h)->pi = pi;
 
-      /* Replace the older (parent's) handle with the new one */
-      pi->handles[i] = dup_h;
+      set_fs_handle(pi, (int)i, dup_h);
 
       if (!pi->mi)
          continue;
@@ -114,7 +122,7 @@ int do_fork(regs_t *user_regs, bool vfork)
    // Make the parent to get child's pid as return value.
    set_return_register(user_regs, (ulong) child->tid);
 
-   if (fork_dup_all_handles(child->pi) < 0)
+   if (fork_dup_all_handles(child->pi, curr_pi) < 0)
       goto oom_case;
 
    add_task(child);
@@ -0,0 +1,465 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_mm.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/utils.h>
+
+#include <tilck/kernel/fs/blkdev.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/paging.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/timer.h>
+
+/*
+ * The block devices buffer cache. See the comments in blkdev.h.
+ *
+ * All the state here, including each device's read-ahead state, is protected
+ * by `bcache_mutex`. The mutex is held also during the I/O: Tilck does not
+ * support SMP and the drivers do PIO, so there's no point in allowing other
+ * requests while a device is busy.
+ */
+
+#define BCACHE_HASH_BUCKETS                        128
+#define BCACHE_WB_INTERVAL          (5 * KRN_TIMER_HZ)  /* ticks */
+#define BCACHE_DIRTY_HIGH         (KRN_BCACHE_PAGES / 2)
+
+struct bcache_page {
+
+   struct list_node hash_node;   /* hash bucket or free list */
+   struct list_node lru_node;    /* the first is the most recently used */
+
+   struct block_dev *bdev;
+   u64 index;                    /* offset in the device, in pages */
+   void *data;
+   bool dirty;
+};
+
+static struct kmutex bcache_mutex = STATIC_KMUTEX_INIT(bcache_mutex, 0);
+static struct kcond bcache_cond = STATIC_KCOND_INIT(bcache_cond);
+static struct list lru_list = STATIC_LIST_INIT(lru_list);
+static struct list free_list = STATIC_LIST_INIT(free_list);
+static struct list hash_table[BCACHE_HASH_BUCKETS];
+static struct bcache_stats stats;
+static bool bcache_initialized;
+
+/* Pending read-ahead request. There can be only one at a time. */
+static struct block_dev *ra_bdev;
+static u64 ra_start;
+static u32 ra_count;
+
+static inline struct list *
+bc_bucket(struct block_dev *bdev, u64 index)
+{
+   const ulong h = ((ulong)bdev >> 4) ^ (ulong)index ^ (ulong)(index >> 32);
+   return &hash_table[h % BCACHE_HASH_BUCKETS];
+}
+
+static inline u64 bc_dev_pages(struct block_dev *bdev)
+{
+   return DIV_ROUND_UP(bdev->sectors, BLKDEV_SECTORS_PER_PAGE);
+}
+
+/* The last page of a device might be only partially backed by sectors */
+static inline u32 bc_page_sectors(struct block_dev *bdev, u64 index)
+{
+   const u64 rem = bdev->sectors - index * BLKDEV_SECTORS_PER_PAGE;
+   return (u32)MIN(rem, (u64)BLKDEV_SECTORS_PER_PAGE);
+}
+
+static struct bcache_page *
+bc_lookup(struct block_dev *bdev, u64 index)
+{
+   struct bcache_page *p;
+
+   list_for_each_ro(p, bc_bucket(bdev, index), hash_node) {
+      if (p->bdev == bdev && p->index == index)
+         return p;
+   }
+
+   return NULL;
+}
+
+static int bc_write_back(struct bcache_page *p)
+{
+   const u64 sector = p->index * BLKDEV_SECTORS_PER_PAGE;
+   int rc;
+
+   ASSERT(p->dirty);
+
+   rc = p->bdev->ops->write(p->bdev,
+                            sector,
+                            bc_page_sectors(p->bdev, p->index),
+                            p->data);
+
+   if (rc) {
+      printk("bcache: write error on %s, sector %llu\n",
+             p->bdev->name, (unsigned long long)sector);
+      return rc;
+   }
+
+   p->dirty = false;
+   stats.dirty_pages--;
+   stats.writebacks++;
+   return 0;
+}
+
+static int bc_flush_nolock(struct block_dev *bdev)
+{
+   struct bcache_page *p;
+   int rc, ret = 0;
+
+   ASSERT(kmutex_is_curr_task_holding_lock(&bcache_mutex));
+
+   list_for_each_ro(p, &lru_list, lru_node) {
+
+      if (!p->dirty || (bdev && p->bdev != bdev))
+         continue;
+
+      if ((rc = bc_write_back(p)) && !ret)
+         ret = rc;
+   }
+
+   return ret;
+}
+
+/*
+ * Returns an unused page, allocating a new one if we're below the limit or
+ * recycling the least recently used one otherwise. Returns NULL if there's no
+ * memory or if the page to recycle could not be written back.
+ */
+static struct bcache_page *bc_get_free_page(void)
+{
+   struct bcache_page *p;
+
+   if (!list_is_empty(&free_list)) {
+      p = list_first_obj(&free_list, struct bcache_page, hash_node);
+      list_remove(&p->hash_node);
+      return p;
+   }
+
+   if (stats.tot_pages < KRN_BCACHE_PAGES) {
+
+      if ((p = kzalloc_obj(struct bcache_page))) {
+
+         if ((p->data = kmalloc(PAGE_SIZE))) {
+            list_node_init(&p->hash_node);
+            list_node_init(&p->lru_node);
+            stats.tot_pages++;
+            return p;
+         }
+
+         kfree_obj(p, struct bcache_page);
+      }
+
+      if (!stats.tot_pages)
+         return NULL;
+
+      /* No memory: fall back to recycling a page */
+   }
+
+   if (list_is_empty(&lru_list))
+      return NULL;
+
+   /* Prefer the least recently used clean page */
+   p = list_last_obj(&lru_list, struct bcache_page, lru_node);
+
+   while (&p->lru_node != (struct list_node *)&lru_list && p->dirty)
+      p = list_prev_obj(p, lru_node);
+
+   if (&p->lru_node == (struct list_node *)&lru_list) {
+
+      /* All the pages are dirty: write back the least recently used one */
+      p = list_last_obj(&lru_list, struct bcache_page, lru_node);
+
+      if (bc_write_back(p))
+         return NULL;
+   }
+
+   list_remove(&p->hash_node);
+   list_remove(&p->lru_node);
+   return p;
+}
+
+static inline void bc_put_free_page(struct bcache_page *p)
+{
+   list_add_tail(&free_list, &p->hash_node);
+}
+
+/*
+ * Returns the cached page `index` of `bdev`, reading it from the device if
+ * necessary. When `fill` is false, the page is going to be entirely
+ * overwritten by the caller: don't read it.
+ */
+static struct bcache_page *
+bc_get_page(struct block_dev *bdev, u64 index, bool fill, int *err)
+{
+   struct bcache_page *p;
+   int rc;
+
+   if ((p = bc_lookup(bdev, index))) {
+
+      stats.hits++;
+
+      /* Move the page at the beginning of the LRU list */
+      list_remove(&p->lru_node);
+      list_add_head(&lru_list, &p->lru_node);
+      return p;
+   }
+
+   if (!(p = bc_get_free_page())) {
+      *err = -ENOMEM;
+      return NULL;
+   }
+
+   stats.misses++;
+
+   if (fill) {
+
+      rc = bdev->ops->read(bdev,
+                           index * BLKDEV_SECTORS_PER_PAGE,
+                           bc_page_sectors(bdev, index),
+                           p->data);
+      if (rc) {
+         bc_put_free_page(p);
+         *err = rc;
+         return NULL;
+      }
+   }
+
+   p->bdev = bdev;
+   p->index = index;
+   p->dirty = false;
+   list_add_tail(bc_bucket(bdev, index), &p->hash_node);
+   list_add_head(&lru_list, &p->lru_node);
+   return p;
+}
+
+/*
+ * Called after each read: on sequential reads, ask the worker thread to read
+ * the next KRN_BCACHE_READAHEAD pages, unless most of them have already been
+ * read ahead.
+ */
+static void
+bc_check_readahead(struct block_dev *bdev, u64 first, u64 last)
+{
+   const u64 dev_pages = bc_dev_pages(bdev);
+   u64 start, end;
+
+   if (!KRN_BCACHE_READAHEAD)
+      return;
+
+   if (first != bdev->last_page && first != bdev->last_page + 1) {
+
+      /* Random access: reset the read-ahead window */
+      bdev->last_page = last;
+      bdev->ra_page = last + 1;
+      return;
+   }
+
+   bdev->last_page = last;
+
+   if (bdev->ra_page > last + KRN_BCACHE_READAHEAD / 2)
+      return;  /* We're still far enough from the end of the window */
+
+   start = MAX(bdev->ra_page, last + 1);
+   end = MIN(last + 1 + KRN_BCACHE_READAHEAD, dev_pages);
+
+   if (start >= end || ra_count)
+      return;
+
+   ra_bdev = bdev;
+   ra_start = start;
+   ra_count = (u32)(end - start);
+   bdev->ra_page = end;
+   kcond_signal_one(&bcache_cond);
+}
+
+ssize_t blkdev_read(struct block_dev *bdev, u64 off, void *buf, size_t len)
+{
+   const u64 dev_size = blkdev_get_size(bdev);
+   struct bcache_page *p;
+   size_t done = 0;
+   int rc = 0;
+
+   if (off >= dev_size)
+      return 0;
+
+   len = (size_t)MIN((u64)len, dev_size - off);
+
+   if (!len)
+      return 0;
+
+   kmutex_lock(&bcache_mutex);
+
+   while (done < len) {
+
+      const u64 index = (off + done) >> PAGE_SHIFT;
+      const size_t page_off = (size_t)((off + done) & OFFSET_IN_PAGE_MASK);
+      const size_t n = MIN(len - done, PAGE_SIZE - page_off);
+
+      if (!(p = bc_get_page(bdev, index, true, &rc)))
+         break;
+
+      memcpy((char *)buf + done, (char *)p->data + page_off, n);
+      done += n;
+   }
+
+   if (done) {
+      bc_check_readahead(bdev,
+                         off >> PAGE_SHIFT,
+                         (off + done - 1) >> PAGE_SHIFT);
+   }
+
+   kmutex_unlock(&bcache_mutex);
+   return done ? (ssize_t)done : rc;
+}
+
+ssize_t
+blkdev_write(struct block_dev *bdev, u64 off, const void *buf, size_t len)
+{
+   const u64 dev_size = blkdev_get_size(bdev);
+   struct bcache_page *p;
+   size_t done = 0;
+   int rc = 0;
+
+   if (bdev->read_only)
+      return -EROFS;
+
+   if (off >= dev_size)
+      return len ? -ENOSPC : 0;
+
+   len = (size_t)MIN((u64)len, dev_size - off);
+   kmutex_lock(&bcache_mutex);
+
+   while (done < len) {
+
+      const u64 index = (off + done) >> PAGE_SHIFT;
+      const size_t page_off = (size_t)((off + done) & OFFSET_IN_PAGE_MASK);
+      const size_t n = MIN(len - done, PAGE_SIZE - page_off);
+      const bool whole_page = !page_off && n == PAGE_SIZE;
+
+      if (!(p = bc_get_page(bdev, index, !whole_page, &rc)))
+         break;
+
+      memcpy((char *)p->data + page_off, (const char *)buf + done, n);
+      done += n;
+
+      if (!p->dirty) {
+         p->dirty = true;
+         stats.dirty_pages++;
+      }
+   }
+
+   if (stats.dirty_pages > BCACHE_DIRTY_HIGH) {
+
+      /* Too many dirty pages: throttle the writer */
+      rc = bc_flush_nolock(NULL);
+   }
+
+   kmutex_unlock(&bcache_mutex);
+   return done ? (ssize_t)done : rc;
+}
+
+int blkdev_sync(struct block_dev *bdev)
+{
+   int rc;
+
+   if (!bcache_initialized)
+      return 0;
+
+   kmutex_lock(&bcache_mutex);
+   {
+      rc = bc_flush_nolock(bdev);
+   }
+   kmutex_unlock(&bcache_mutex);
+   return rc;
+}
+
+void bcache_get_stats(struct bcache_stats *out)
+{
+   kmutex_lock(&bcache_mutex);
+   {
+      *out = stats;
+   }
+   kmutex_unlock(&bcache_mutex);
+}
+
+/*
+ * Read the pages of the pending read-ahead request, releasing the mutex after
+ * each page in order to not delay the regular reads.
+ */
+static void bc_do_readahead(void)
+{
+   struct block_dev *bdev = ra_bdev;
+   const u64 start = ra_start;
+   const u32 count = ra_count;
+   struct bcache_page *p;
+   int rc;
+
+   for (u32 i = 0; i < count; i++) {
+
+      if (!bc_lookup(bdev, start + i)) {
+
+         if (!(p = bc_get_page(bdev, start + i, true, &rc)))
+            break;
+
+         /*
+          * Don't count the page as a miss and put it at the end of the LRU
+          * list: it hasn't been used yet and if the read-ahead turns out to be
+          * useless, it should be the first one to be recycled.
+          */
+         stats.misses--;
+         stats.ra_pages++;
+         list_remove(&p->lru_node);
+         list_add_tail(&lru_list, &p->lru_node);
+      }
+
+      kmutex_unlock(&bcache_mutex);
+      kmutex_lock(&bcache_mutex);
+   }
+
+   ra_count = 0;
+}
+
+static void bcache_thread(void *unused)
+{
+   u64 last_wb = get_ticks();
+
+   kmutex_lock(&bcache_mutex);
+
+   while (true) {
+
+      if (!ra_count)
+         kcond_wait(&bcache_cond, &bcache_mutex, BCACHE_WB_INTERVAL);
+
+      if (ra_count)
+         bc_do_readahead();
+
+      if (get_ticks() - last_wb >= BCACHE_WB_INTERVAL) {
+
+         if (stats.dirty_pages)
+            bc_flush_nolock(NULL);
+
+         last_wb = get_ticks();
+      }
+   }
+}
+
+void init_bcache(void)
+{
+   if (bcache_initialized)
+      return;
+
+   for (u32 i = 0; i < BCACHE_HASH_BUCKETS; i++)
+      list_init(&hash_table[i]);
+
+   if (kthread_create(&bcache_thread, 0, NULL) < 0)
+      panic("bcache: unable to create the worker thread");
+
+   bcache_initialized = true;
+}
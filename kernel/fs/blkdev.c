@@ -0,0 +1,247 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/fs/blkdev.h>
+#include <tilck/kernel/fs/devfs.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/kmalloc.h>
+
+#include <linux/fs.h>         // system header
+
+/*
+ * The /dev files of the block devices. All the block devices share the same
+ * (dynamic) major number: the minor is just the index of the device in the
+ * `block_devs` list.
+ */
+
+static struct list block_devs = STATIC_LIST_INIT(block_devs);
+static struct kmutex block_devs_mutex = STATIC_KMUTEX_INIT(block_devs_mutex, 0);
+static struct driver_info *blkdev_driver;
+static u16 next_minor;
+
+static struct block_dev *get_block_dev_by_minor(int minor)
+{
+   struct block_dev *pos;
+
+   list_for_each_ro(pos, &block_devs, node) {
+      if (pos->minor == minor)
+         return pos;
+   }
+
+   return NULL;
+}
+
+static inline struct block_dev *get_handle_bdev(fs_handle h)
+{
+   struct devfs_handle *dh = h;
+   return *(struct block_dev **)dh->extra;
+}
+
+static ssize_t blkdev_file_read(fs_handle h, char *buf, size_t len, offt *pos)
+{
+   ssize_t rc = blkdev_read(get_handle_bdev(h), (u64)*pos, buf, len);
+
+   if (rc > 0)
+      *pos += rc;
+
+   return rc;
+}
+
+static ssize_t blkdev_file_write(fs_handle h, char *buf, size_t len, offt *pos)
+{
+   ssize_t rc = blkdev_write(get_handle_bdev(h), (u64)*pos, buf, len);
+
+   if (rc > 0)
+      *pos += rc;
+
+   return rc;
+}
+
+static offt blkdev_file_seek(fs_handle h, offt off, int whence)
+{
+   struct devfs_handle *dh = h;
+   struct block_dev *bdev = get_handle_bdev(h);
+   offt new_pos;
+
+   switch (whence) {
+
+      case SEEK_SET:
+         new_pos = off;
+         break;
+
+      case SEEK_CUR:
+         new_pos = dh->h_fpos + off;
+         break;
+
+      case SEEK_END:
+         new_pos = (offt)blkdev_get_size(bdev) + off;
+         break;
+
+      default:
+         return -EINVAL;
+   }
+
+   if (new_pos < 0)
+      return -EINVAL;
+
+   dh->h_fpos = new_pos;
+   return dh->h_fpos;
+}
+
+static int blkdev_file_ioctl(fs_handle h, ulong request, void *argp)
+{
+   struct block_dev *bdev = get_handle_bdev(h);
+   u64 size;
+   int ssz;
+
+   switch (request) {
+
+      case BLKGETSIZE64:
+         size = blkdev_get_size(bdev);
+         return copy_to_user(argp, &size, sizeof(size)) ? -EFAULT : 0;
+
+      case BLKSSZGET:
+         ssz = BLKDEV_SECTOR_SIZE;
+         return copy_to_user(argp, &ssz, sizeof(ssz)) ? -EFAULT : 0;
+
+      case BLKFLSBUF:
+         return blkdev_sync(bdev);
+
+      default:
+         return -EINVAL;
+   }
+}
+
+static int blkdev_file_sync(fs_handle h)
+{
+   return blkdev_sync(get_handle_bdev(h));
+}
+
+static const struct file_ops static_ops_blkdev = {
+   .read = blkdev_file_read,
+   .write = blkdev_file_write,
+   .seek = blkdev_file_seek,
+   .ioctl = blkdev_file_ioctl,
+   .sync = blkdev_file_sync,
+   .datasync = blkdev_file_sync,
+};
+
+static int blkdev_create_extra(int minor, void *extra)
+{
+   struct block_dev *bdev;
+
+   kmutex_lock(&block_devs_mutex);
+   {
+      bdev = get_block_dev_by_minor(minor);
+   }
+   kmutex_unlock(&block_devs_mutex);
+
+   if (!bdev)
+      return -ENXIO;
+
+   *(struct block_dev **)extra = bdev;
+   return 0;
+}
+
+static int blkdev_on_dup_extra(int minor, void *extra)
+{
+   /* The bdev pointer copied by devfs is all we need */
+   return 0;
+}
+
+static int
+blkdev_create_device_file(int minor,
+                          enum vfs_entry_type *type,
+                          struct devfs_file_info *nfo)
+{
+   *type = VFS_BLOCK_DEV;
+   nfo->fops = &static_ops_blkdev;
+   nfo->create_extra = &blkdev_create_extra;
+   nfo->on_dup_extra = &blkdev_on_dup_extra;
+   return 0;
+}
+
+static int init_blkdev_driver(void)
+{
+   struct driver_info *di;
+
+   if (!(di = kzalloc_obj(struct driver_info)))
+      return -ENOMEM;
+
+   di->name = "blkdev";
+   di->create_dev_file = blkdev_create_device_file;
+   register_driver(di, -1);
+
+   blkdev_driver = di;
+   init_bcache();
+   return 0;
+}
+
+int register_block_dev(struct block_dev *bdev)
+{
+   int rc = 0;
+
+   ASSERT(bdev->name != NULL);
+   ASSERT(bdev->ops != NULL);
+
+   kmutex_lock(&block_devs_mutex);
+
+   if (!blkdev_driver && (rc = init_blkdev_driver()))
+      goto out;
+
+   bdev->minor = next_minor++;
+   bdev->last_page = 0;
+   bdev->ra_page = 0;
+   list_node_init(&bdev->node);
+   list_add_tail(&block_devs, &bdev->node);
+
+   rc = create_dev_file(bdev->name, blkdev_driver->major, bdev->minor, NULL);
+
+   if (rc) {
+      list_remove(&bdev->node);
+      goto out;
+   }
+
+   printk("blkdev: /dev/%s, %llu sectors (%llu MB)%s\n",
+          bdev->name,
+          (unsigned long long)bdev->sectors,
+          (unsigned long long)(blkdev_get_size(bdev) / MB),
+          bdev->read_only ? ", read-only" : "");
+
+out:
+   kmutex_unlock(&block_devs_mutex);
+   return rc;
+}
+
+struct block_dev *get_block_dev_by_name(const char *name)
+{
+   struct block_dev *pos, *res = NULL;
+
+   kmutex_lock(&block_devs_mutex);
+   {
+      list_for_each_ro(pos, &block_devs, node) {
+         if (!strcmp(pos->name, name)) {
+            res = pos;
+            break;
+         }
+      }
+   }
+   kmutex_unlock(&block_devs_mutex);
+   return res;
+}
+
+struct block_dev *get_block_dev_from_handle(fs_handle h)
+{
+   struct fs_handle_base *hb = h;
+
+   if (!hb || hb->fops != &static_ops_blkdev)
+      return NULL;
+
+   return get_handle_bdev(h);
+}
@@ -2,9 +2,12 @@
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
 
 #include <tilck/kernel/fs/fat32.h>
+#include <tilck/kernel/fs/blkdev.h>
 #include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/flock.h>
 #include <tilck/kernel/kmalloc.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/datetime.h>
@@ -16,41 +19,259 @@ int fat_mmap(struct user_mapping *um, pdir_t *pdir, int flags);
 int fat_munmap(struct user_mapping *um, void *vaddrp, size_t len);
 int fat_ramdisk_prepare_for_mmap(struct fat_fs_device_data *d, size_t rd_size);
 
+/* Defined in fat32_rw.c */
+int fat_rw_init(struct fat_fs_device_data *d, size_t rd_size);
+void fat_rw_destroy(struct fat_fs_device_data *d);
+int fat_rw_flush(struct fat_fs_device_data *d);
+void *fat_rw_get_cluster(void *arg, u32 clu);
+int
+fat_rw_truncate(struct fat_fs_device_data *d, struct fat_entry *e, offt len);
+
+void
+fat_rw_get_cursor(struct fat_fs_device_data *d,
+                  struct fat_entry *e,
+                  offt pos,
+                  struct fat_cursor *c);
+
+ssize_t
+fat_rw_write(struct fat_fs_device_data *d,
+             struct fat_entry *e,
+             struct fat_cursor *c,
+             const char *buf,
+             size_t len);
+
+struct fat_entry *
+fat_rw_create_entry(struct fat_fs_device_data *d,
+                    struct fat_entry *dir,
+                    const char *name,
+                    size_t len,
+                    bool is_dir,
+                    int *err);
+
+/*
+ * Returns the data of the directory cluster `clu` of a FAT fs mounted from a
+ * block device, reading it if necessary. Once read, a cluster stays in memory
+ * until umount. See the comments in fat32.h.
+ */
+void *fat_bdev_get_dir_cluster(void *arg, u32 clu)
+{
+   struct fat_fs_device_data *d = arg;
+   struct fat_dir_cluster *pos, *res = NULL;
+   const u64 off = (u64)fat_get_sector_for_cluster(d->hdr, clu)
+                     * d->hdr->BPB_BytsPerSec;
+
+   kmutex_lock(&d->dir_clusters_mutex);
+
+   list_for_each_ro(pos, &d->dir_clusters, node) {
+      if (pos->clu == clu) {
+         res = pos;
+         goto out;
+      }
+   }
+
+   if (!(res = kmalloc(sizeof(struct fat_dir_cluster) + d->cluster_size)))
+      goto out;
+
+   if (blkdev_read(d->bdev, off, res->data, d->cluster_size) !=
+       (ssize_t)d->cluster_size)
+   {
+      kfree2(res, sizeof(struct fat_dir_cluster) + d->cluster_size);
+      res = NULL;
+      goto out;
+   }
+
+   res->clu = clu;
+   res->dirty = false;
+   list_node_init(&res->node);
+   list_add_tail(&d->dir_clusters, &res->node);
+
+out:
+   kmutex_unlock(&d->dir_clusters_mutex);
+   return res ? res->data : NULL;
+}
+
 /*
  * Special fat_walk() wrapper handling the special case where `e` is NOT a dir
  * entry but a pointer to the entries in the root directory.
  */
 
-static inline int
+int
 fat_fs_walk_generic(struct fat_fs_device_data *d,
                     struct fat_walk_static_params *static_walk_params,
                     struct fat_entry *e)
 {
+   if (d->bdev) {
+      static_walk_params->get_cluster = &fat_bdev_get_dir_cluster;
+      static_walk_params->get_cluster_arg = d;
+   } else if (d->rw) {
+      static_walk_params->get_cluster = &fat_rw_get_cluster;
+      static_walk_params->get_cluster_arg = d;
+   }
+
    return fat_walk(static_walk_params,
                    e == d->root_dir_entries
                      ? d->root_cluster
                      : fat_get_first_cluster(e));
 }
 
-STATIC ssize_t
-fat_read(fs_handle handle, char *buf, size_t bufsize, offt *pos)
+static inline void fat_ra_reset(struct fatfs_handle *h)
 {
-   struct fatfs_handle *h = (struct fatfs_handle *) handle;
-   struct fat_fs_device_data *d = h->fs->device_data;
-   offt fsize = (offt)h->e->DIR_FileSize;
-   offt written_to_buf = 0;
+   h->ra_seq = 0;
+   h->ra_idx = 0;
+   h->ra_count = 0;
+}
 
-   if (pos != &h->h_fpos) {
+static inline void fat_shlock(struct fat_fs_device_data *d)
+{
+   if (d->rw)
+      rwlock_wp_shlock(&d->rwlock);
+}
 
-      /*
-       * We don't support pread() for this filesystem, at the moment.
-       * TODO: make fat32 support pread64().
-       */
-      return -EPERM;
+static inline void fat_shunlock(struct fat_fs_device_data *d)
+{
+   if (d->rw)
+      rwlock_wp_shunlock(&d->rwlock);
+}
+
+/* Caches the numbers of the (up to FAT_RA_CLUSTERS) clusters after curr */
+static void fat_ra_fill(struct fat_fs_device_data *d, struct fatfs_handle *h)
+{
+   u32 clu = h->curr_cluster;
+
+   h->ra_idx = 0;
+   h->ra_count = 0;
+
+   while (h->ra_count < FAT_RA_CLUSTERS) {
+
+      clu = fat_read_fat_entry(d->hdr, d->type, 0, clu);
+
+      if (fat_is_end_of_clusterchain(d->type, clu))
+         break;
+
+      // we do not expect BAD CLUSTERS
+      ASSERT(!fat_is_bad_cluster(d->type, clu));
+      h->ra_clusters[h->ra_count++] = clu;
    }
+}
 
-   if (h->e->directory)
-      return -EISDIR;
+/*
+ * Returns how many of the (at most `max`) clusters following `curr_cluster`
+ * are also *physically* contiguous to it. Because the data of contiguous
+ * clusters is contiguous both in the ramdisk and on the block device, all of
+ * them can be read with a single memcpy() or blkdev_read(). The exception are
+ * the clusters of a r/w ramdisk beyond its image, see fat_rw_get_cluster().
+ */
+static u32
+fat_ra_contiguous(struct fat_fs_device_data *d, struct fatfs_handle *h, u32 max)
+{
+   u32 n = 0;
+
+   if (!max)
+      return 0;
+
+   if (h->ra_idx == h->ra_count)
+      fat_ra_fill(d, h);
+
+   while (n < max &&
+          h->ra_idx + n < h->ra_count &&
+          h->ra_clusters[h->ra_idx + n] == h->curr_cluster + n + 1 &&
+          h->ra_clusters[h->ra_idx + n] < d->img_clusters_end)
+   {
+      n++;
+   }
+
+   return n;
+}
+
+/* Moves `curr_cluster` forward by `n` clusters, already in the cache */
+static inline void fat_ra_advance(struct fatfs_handle *h, u32 n)
+{
+   ASSERT(h->ra_idx + n <= h->ra_count);
+
+   if (n) {
+      h->curr_cluster = h->ra_clusters[h->ra_idx + n - 1];
+      h->ra_idx += n;
+   }
+}
+
+/* Returns the cluster after `curr_cluster` or an end-of-chain value */
+static u32
+fat_next_cluster(struct fat_fs_device_data *d, struct fatfs_handle *h)
+{
+   if (h->ra_idx < h->ra_count)
+      return h->ra_clusters[h->ra_idx++];
+
+   return fat_read_fat_entry(d->hdr, d->type, 0, h->curr_cluster);
+}
+
+/*
+ * When the position is at the end of `curr_cluster` (at_clu_end), move to the
+ * next cluster, if there's one. See struct fat_cursor.
+ */
+static void
+fat_leave_clu_end(struct fat_fs_device_data *d, struct fatfs_handle *h)
+{
+   u32 next;
+
+   if (!h->at_clu_end)
+      return;
+
+   next = fat_next_cluster(d, h);
+
+   if (fat_is_end_of_clusterchain(d->type, next))
+      return;
+
+   // we do not expect BAD CLUSTERS
+   ASSERT(!fat_is_bad_cluster(d->type, next));
+
+   h->curr_cluster = next;
+   h->at_clu_end = false;
+}
+
+/*
+ * On r/w mounts, re-compute the cluster of the current position if the file
+ * might have been truncated or extended by another handle since our last
+ * operation. The caller must hold the fs lock.
+ */
+static void
+fat_check_handle_gen(struct fat_fs_device_data *d, struct fatfs_handle *h)
+{
+   struct fat_cursor c;
+
+   if (!d->rw || h->gen == d->gen)
+      return;
+
+   h->gen = d->gen;
+   fat_ra_reset(h);
+
+   if (h->h_fpos > (offt)h->e->DIR_FileSize) {
+      h->curr_cluster = (u32) -1; /* invalid cluster, as in fat_seek_forward */
+      h->at_clu_end = false;
+      return;
+   }
+
+   fat_rw_get_cursor(d, h->e, h->h_fpos, &c);
+   h->curr_cluster = c.clu;
+   h->at_clu_end = c.at_end;
+}
+
+/*
+ * Reads from the current position, handling the sequential case in a special
+ * way: when the current read is the continuation of the previous one (no seek
+ * in between) or it spans over multiple clusters, the cluster chain is read
+ * ahead (see fat_ra_fill()) and each run of physically contiguous clusters is
+ * copied at once, instead of one cluster at a time.
+ */
+static ssize_t
+fat_read_locked(struct fatfs_handle *h, char *buf, size_t bufsize, offt *pos)
+{
+   struct fat_fs_device_data *d = h->fs->device_data;
+   const offt csize = (offt)d->cluster_size;
+   offt fsize = (offt)h->e->DIR_FileSize;
+   offt written_to_buf = 0;
+   bool seq;
+
+   fat_check_handle_gen(d, h);
 
    if (*pos >= fsize) {
 
@@ -61,37 +282,68 @@ fat_read(fs_handle handle, char *buf, size_t bufsize, offt *pos)
       return 0;
    }
 
-   do {
+   fat_leave_clu_end(d, h);
+   seq = h->ra_seq > 0 || (offt)bufsize > csize;
 
-      char *data = fat_get_pointer_to_cluster_data(d->hdr, h->curr_cluster);
+   if (h->ra_seq < 255)
+      h->ra_seq++;
+
+   do {
 
       const offt file_rem       = fsize - *pos;
       const offt buf_rem        = (offt)bufsize - written_to_buf;
-      const offt cluster_off    = *pos % (offt)d->cluster_size;
-      const offt cluster_rem    = (offt)d->cluster_size - cluster_off;
-      const offt to_read        = MIN3(cluster_rem, buf_rem, file_rem);
+      const offt cluster_off    = *pos % csize;
+      const offt want           = MIN(buf_rem, file_rem);
+      const u32 more_clusters   = (u32)((cluster_off + want - 1) / csize);
+      const u32 max_run_more    = seq ? more_clusters : 0;
+      const u32 run             = 1 + fat_ra_contiguous(d, h, max_run_more);
+      const offt run_rem        = (offt)run * csize - cluster_off;
+      const offt to_read        = MIN(run_rem, want);
 
       ASSERT(to_read >= 0);
 
-      memcpy(buf + written_to_buf, data + cluster_off, (size_t)to_read);
+      if (d->bdev) {
+
+         const u64 off = (u64)fat_get_sector_for_cluster(d->hdr,
+                                                         h->curr_cluster)
+                           * d->hdr->BPB_BytsPerSec + (u64)cluster_off;
+
+         if (blkdev_read(d->bdev, off, buf + written_to_buf,
+                         (size_t)to_read) != (ssize_t)to_read)
+         {
+            return written_to_buf ? (ssize_t)written_to_buf : -EIO;
+         }
+
+      } else {
+
+         char *data = d->rw
+            ? fat_rw_get_cluster(d, h->curr_cluster)
+            : fat_get_pointer_to_cluster_data(d->hdr, h->curr_cluster);
+
+         memcpy(buf + written_to_buf, data + cluster_off, (size_t)to_read);
+      }
+
       written_to_buf += to_read;
       *pos += to_read;
 
-      if (to_read < cluster_rem) {
+      if (to_read < run_rem) {
 
          /*
-          * We read less than cluster_rem because the buf was not big enough
+          * We read less than run_rem because the buf was not big enough
           * or because the file was not big enough. In either case, we cannot
-          * continue.
+          * continue. Just move to the cluster containing the new position.
           */
+         fat_ra_advance(h, (u32)((cluster_off + to_read) / csize));
          break;
       }
 
-      // find the next cluster
-      u32 fatval = fat_read_fat_entry(d->hdr, d->type, 0, h->curr_cluster);
+      // move to the last cluster of the run, then find the next one
+      fat_ra_advance(h, run - 1);
+      u32 fatval = fat_next_cluster(d, h);
 
       if (fat_is_end_of_clusterchain(d->type, fatval)) {
          ASSERT(*pos == fsize);
+         h->at_clu_end = true;
          break;
       }
 
@@ -100,11 +352,38 @@ fat_read(fs_handle handle, char *buf, size_t bufsize, offt *pos)
 
       h->curr_cluster = fatval; // go reading the new cluster in the chain.
 
-   } while (true);
+   } while (written_to_buf < (offt)bufsize);
 
    return (ssize_t)written_to_buf;
 }
 
+STATIC ssize_t
+fat_read(fs_handle handle, char *buf, size_t bufsize, offt *pos)
+{
+   struct fatfs_handle *h = (struct fatfs_handle *) handle;
+   struct fat_fs_device_data *d = h->fs->device_data;
+   ssize_t rc;
+
+   if (pos != &h->h_fpos) {
+
+      /*
+       * We don't support pread() for this filesystem, at the moment.
+       * TODO: make fat32 support pread64().
+       */
+      return -EPERM;
+   }
+
+   if (h->e->directory)
+      return -EISDIR;
+
+   fat_shlock(d);
+   {
+      rc = fat_read_locked(h, buf, bufsize, pos);
+   }
+   fat_shunlock(d);
+   return rc;
+}
+
 
 STATIC int
 fat_rewind(fs_handle handle)
@@ -112,6 +391,8 @@ fat_rewind(fs_handle handle)
    struct fatfs_handle *h = (struct fatfs_handle *) handle;
    h->h_fpos = 0;
    h->curr_cluster = fat_get_first_cluster(h->e);
+   h->at_clu_end = false;
+   fat_ra_reset(h);
    return 0;
 }
 
@@ -126,13 +407,18 @@ fat_seek_forward(fs_handle handle, offt dist)
    if (dist == 0)
       return h->h_fpos;
 
+   fat_ra_reset(h);
+
    if (h->h_fpos + dist > fsize) {
       /* Allow, like Linux does, to seek past the end of a file. */
       h->h_fpos += dist;
       h->curr_cluster = (u32) -1; /* invalid cluster */
+      h->at_clu_end = false;
       return (offt) h->h_fpos;
    }
 
+   fat_leave_clu_end(d, h);
+
    do {
 
       const offt file_rem       = fsize - h->h_fpos;
@@ -154,6 +440,7 @@ fat_seek_forward(fs_handle handle, offt dist)
 
       if (fat_is_end_of_clusterchain(d->type, fatval)) {
          ASSERT(h->h_fpos == fsize);
+         h->at_clu_end = true;
          break;
       }
 
@@ -216,8 +503,8 @@ static offt fat_seek_dir(struct fatfs_handle *fh, offt off)
    return fh->dir_pos;
 }
 
-STATIC offt
-fat_seek(fs_handle handle, offt off, int whence)
+static offt
+fat_seek_locked(fs_handle handle, offt off, int whence)
 {
    struct fatfs_handle *fh = handle;
 
@@ -276,6 +563,24 @@ fat_seek(fs_handle handle, offt off, int whence)
    return fat_seek_forward(handle, off);
 }
 
+STATIC offt
+fat_seek(fs_handle handle, offt off, int whence)
+{
+   struct fatfs_handle *fh = handle;
+   struct fat_fs_device_data *d = fh->fs->device_data;
+   offt rc;
+
+   fat_shlock(d);
+   {
+      if (!fh->e->directory)
+         fat_check_handle_gen(d, fh);
+
+      rc = fat_seek_locked(handle, off, whence);
+   }
+   fat_shunlock(d);
+   return rc;
+}
+
 struct datetime
 fat_datetime_to_regular_datetime(u16 date, u16 time, u8 timetenth)
 {
@@ -409,40 +714,51 @@ static int fat_getdents(fs_handle h, get_dents_func_cb cb, void *arg)
 
 STATIC void fat_exclusive_lock(struct mnt_fs *fs)
 {
+   struct fat_fs_device_data *d = fs->device_data;
+
    if (!(fs->flags & VFS_FS_RW))
       return; /* read-only: no lock is needed */
 
-   NOT_IMPLEMENTED();
+   rwlock_wp_exlock(&d->rwlock);
 }
 
 STATIC void fat_exclusive_unlock(struct mnt_fs *fs)
 {
+   struct fat_fs_device_data *d = fs->device_data;
+
    if (!(fs->flags & VFS_FS_RW))
       return; /* read-only: no lock is needed */
 
-   NOT_IMPLEMENTED();
+   rwlock_wp_exunlock(&d->rwlock);
 }
 
 STATIC void fat_shared_lock(struct mnt_fs *fs)
 {
+   struct fat_fs_device_data *d = fs->device_data;
+
    if (!(fs->flags & VFS_FS_RW))
       return; /* read-only: no lock is needed */
 
-   NOT_IMPLEMENTED();
+   rwlock_wp_shlock(&d->rwlock);
 }
 
 STATIC void fat_shared_unlock(struct mnt_fs *fs)
 {
+   struct fat_fs_device_data *d = fs->device_data;
+
    if (!(fs->flags & VFS_FS_RW))
       return; /* read-only: no lock is needed */
 
-   NOT_IMPLEMENTED();
+   rwlock_wp_shunlock(&d->rwlock);
 }
 
 STATIC ssize_t fat_write(fs_handle handle, char *buf, size_t len, offt *pos)
 {
    struct fatfs_handle *h = (struct fatfs_handle *) handle;
    struct mnt_fs *fs = h->fs;
+   struct fat_fs_device_data *d = fs->device_data;
+   struct fat_cursor c;
+   ssize_t rc;
 
    if (h->e->directory)
       return -EISDIR;
@@ -450,7 +766,118 @@ STATIC ssize_t fat_write(fs_handle handle, char *buf, size_t len, offt *pos)
    if (!(fs->flags & VFS_FS_RW))
       return -EBADF; /* read-only file system: can't write */
 
-   NOT_IMPLEMENTED();
+   if (pos != &h->h_fpos)
+      return -EPERM; /* No pwrite() support, as for pread() */
+
+   rwlock_wp_exlock(&d->rwlock);
+   {
+      fat_check_handle_gen(d, h);
+      fat_ra_reset(h);
+
+      if ((h->fl_flags & O_APPEND) && *pos != (offt)h->e->DIR_FileSize) {
+         *pos = (offt)h->e->DIR_FileSize;
+         fat_rw_get_cursor(d, h->e, *pos, &c);
+      } else {
+         c = (struct fat_cursor) {
+            .pos = *pos,
+            .clu = h->curr_cluster,
+            .at_end = h->at_clu_end,
+         };
+      }
+
+      if (c.pos > (offt)h->e->DIR_FileSize)
+         c.clu = (u32) -1; /* fat_rw_write() will fill the gap first */
+
+      rc = fat_rw_write(d, h->e, &c, buf, len);
+
+      if (rc > 0) {
+         *pos = c.pos;
+         h->curr_cluster = c.clu;
+         h->at_clu_end = c.at_end;
+      }
+
+      h->gen = d->gen;
+      fat_rw_flush(d);
+   }
+   rwlock_wp_exunlock(&d->rwlock);
+   return rc;
+}
+
+static int fat_sync_device(struct fat_fs_device_data *d)
+{
+   int rc;
+
+   if (!d->rw || !d->bdev)
+      return 0; /* ramdisk: the data is already in its final place */
+
+   rwlock_wp_exlock(&d->rwlock);
+   {
+      rc = fat_rw_flush(d);
+   }
+   rwlock_wp_exunlock(&d->rwlock);
+   return rc ? rc : blkdev_sync(d->bdev);
+}
+
+STATIC int fat_fsync(fs_handle handle)
+{
+   struct fatfs_handle *h = (struct fatfs_handle *) handle;
+   return fat_sync_device(h->fs->device_data);
+}
+
+static void fat_syncfs(struct mnt_fs *fs)
+{
+   fat_sync_device(fs->device_data);
+}
+
+static int fat_truncate(struct mnt_fs *fs, vfs_inode_ptr_t i, offt len)
+{
+   struct fat_fs_device_data *d = fs->device_data;
+   struct fat_entry *e = i;
+   int rc;
+
+   if (!(fs->flags & VFS_FS_RW))
+      return -EROFS;
+
+   if (e->directory)
+      return -EISDIR;
+
+   rwlock_wp_exlock(&d->rwlock);
+   {
+      rc = fat_rw_truncate(d, e, len);
+      fat_rw_flush(d);
+   }
+   rwlock_wp_exunlock(&d->rwlock);
+   return rc;
+}
+
+/*
+ * Creates the entry for the last component of the path `p`, in its parent
+ * directory. The caller must hold the fs exlock.
+ */
+static struct fat_entry *
+fat_create_at(struct vfs_path *p, bool is_dir, int *err)
+{
+   struct fat_fs_device_data *d = p->fs->device_data;
+   struct fat_fs_path *fp = (struct fat_fs_path *)&p->fs_path;
+   const char *name = p->last_comp;
+   size_t len = 0;
+
+   while (name[len] && name[len] != '/')
+      len++;
+
+   return fat_rw_create_entry(d, fp->parent_entry, name, len, is_dir, err);
+}
+
+static int fat_mkdir(struct vfs_path *p, mode_t mode)
+{
+   struct fat_fs_device_data *d = p->fs->device_data;
+   int rc = 0;
+
+   if (!fat_create_at(p, true, &rc))
+      return rc;
+
+   fat_rw_flush(d);
+   return 0;
 }
 
 STATIC int fat_ioctl(fs_handle h, ulong request, void *arg)
@@ -466,6 +893,8 @@ static const struct file_ops static_ops_fat =
    .ioctl = fat_ioctl,
    .mmap = fat_mmap,
    .munmap = fat_munmap,
+   .sync = fat_fsync,
+   .datasync = fat_fsync,
 };
 
 STATIC int
@@ -476,35 +905,75 @@ fat_open(struct vfs_path *p, fs_handle *out, int fl, mode_t mode)
    struct fat_fs_path *fp = (struct fat_fs_path *)&p->fs_path;
    struct fat_entry *e = fp->entry;
    struct fat_fs_device_data *d = fs->device_data;
+   struct locked_file *lf = NULL;
+   int rc;
 
    if (!e) {
 
+      if (!(fl & O_CREAT))
+         return -ENOENT;
+
       if (!(fs->flags & VFS_FS_RW))
-         if (fl & O_CREAT)
-            return -EROFS;
+         return -EROFS;
 
-      return -ENOENT;
+      if (!(e = fat_create_at(p, false, &rc)))
+         return rc;
+
+      fat_rw_flush(d);
+
+   } else {
+
+      if ((fl & O_CREAT) && (fl & O_EXCL))
+         return -EEXIST;
+
+      if (!(fs->flags & VFS_FS_RW))
+         if (fl & (O_WRONLY | O_RDWR))
+            return -EROFS;
    }
 
-   if ((fl & O_CREAT) && (fl & O_EXCL))
-      return -EEXIST;
+   if (e->directory && (fl & (O_WRONLY | O_RDWR)))
+      return -EISDIR;
 
-   if (!(fs->flags & VFS_FS_RW))
-      if (fl & (O_WRONLY | O_RDWR))
-         return -EROFS;
+   if ((fl & O_TRUNC) && !(fl & (O_WRONLY | O_RDWR)))
+      return -EINVAL; /* Linux allows it, but it's unspecified by POSIX */
 
-   if (!(h = vfs_create_new_handle(fs, &static_ops_fat)))
-      return -ENOMEM;
+   if (fs->flags & VFS_FS_RW) {
+
+      if (fl & (O_WRONLY | O_RDWR)) {
+         if ((rc = acquire_subsys_flock(fs, e, SUBSYS_VFS, &lf)))
+            return rc;
+      }
+
+      if (fl & O_TRUNC) {
+         if ((rc = fat_truncate(fs, e, 0)))
+            goto err_end;
+      }
+   }
+
+   if (!(h = vfs_create_new_handle(fs, &static_ops_fat))) {
+      rc = -ENOMEM;
+      goto err_end;
+   }
 
    h->e = e;
+   h->lf = lf;
    h->h_fpos = 0;
    h->curr_cluster = fat_get_first_cluster(e);
+   h->at_clu_end = false;
+   h->gen = d->gen;
+   fat_ra_reset(h);
 
    if (d->mmap_support)
       h->spec_flags = VFS_SPFL_MMAP_SUPPORTED;
 
    *out = h;
    return 0;
+
+err_end:
+   if (lf)
+      release_subsys_flock(lf);
+
+   return rc;
 }
 
 static inline void
@@ -578,19 +1047,17 @@ static vfs_inode_ptr_t fat_get_inode(fs_handle h)
    return ((struct fatfs_handle *)h)->e;
 }
 
+/*
+ * The fat entries are never freed while the fs is mounted (files cannot be
+ * removed), so there's no need to count the references to them.
+ */
 static int fat_retain_inode(struct mnt_fs *fs, vfs_inode_ptr_t inode)
 {
-   if (fs->flags & VFS_FS_RW)
-      NOT_IMPLEMENTED();
-
    return 1;
 }
 
 static int fat_release_inode(struct mnt_fs *fs, vfs_inode_ptr_t inode)
 {
-   if (fs->flags & VFS_FS_RW)
-      NOT_IMPLEMENTED();
-
    return 1;
 }
 
@@ -600,9 +1067,9 @@ static const struct fs_ops static_fsops_fat =
    .open = fat_open,
    .getdents = fat_getdents,
    .unlink = NULL,
-   .mkdir = NULL,
+   .mkdir = fat_mkdir,
    .rmdir = NULL,
-   .truncate = NULL,
+   .truncate = fat_truncate,
    .stat = fat_stat,
    .chmod = NULL,
    .get_entry = fat_get_entry,
@@ -610,6 +1077,7 @@ static const struct fs_ops static_fsops_fat =
    .link = NULL,
    .retain_inode = fat_retain_inode,
    .release_inode = fat_release_inode,
+   .syncfs = fat_syncfs,
 
    .fs_exlock = fat_exclusive_lock,
    .fs_exunlock = fat_exclusive_unlock,
@@ -617,14 +1085,29 @@ static const struct fs_ops static_fsops_fat =
    .fs_shunlock = fat_shared_unlock,
 };
 
+static void fat_free_blkdev_data(struct fat_fs_device_data *d)
+{
+   struct fat_dir_cluster *pos, *temp;
+
+   fat_rw_destroy(d);
+
+   list_for_each(pos, temp, &d->dir_clusters, node) {
+      list_remove(&pos->node);
+      kfree2(pos, sizeof(struct fat_dir_cluster) + d->cluster_size);
+   }
+
+   if (d->hdr)
+      vfree2(d->hdr, d->hdr_size);
+
+   kmutex_destroy(&d->dir_clusters_mutex);
+   kfree_obj(d, struct fat_fs_device_data);
+}
+
 struct mnt_fs *fat_mount_ramdisk(void *vaddr, size_t rd_size, u32 flags)
 {
    struct fat_fs_device_data *d;
    struct mnt_fs *fs;
 
-   if (flags & VFS_FS_RW)
-      panic("fat_mount_ramdisk: r/w mode is NOT currently supported");
-
    d = kzalloc_obj(struct fat_fs_device_data);
 
    if (!d)
@@ -634,6 +1117,12 @@ struct mnt_fs *fat_mount_ramdisk(void *vaddr, size_t rd_size, u32 flags)
    d->type = fat_get_type(d->hdr);
    d->cluster_size = d->hdr->BPB_SecPerClus * d->hdr->BPB_BytsPerSec;
    d->root_dir_entries = fat_get_rootdir(d->hdr, d->type, &d->root_cluster);
+   d->img_clusters_end = (u32) -1;
+
+   if ((flags & VFS_FS_RW) && fat_rw_init(d, rd_size)) {
+      kfree_obj(d, struct fat_fs_device_data);
+      return NULL;
+   }
 
    fs = create_fs_obj("fat",
                       &static_fsops_fat,
@@ -641,11 +1130,16 @@ struct mnt_fs *fat_mount_ramdisk(void *vaddr, size_t rd_size, u32 flags)
                       flags | VFS_FS_RQ_DE_SKIP);
 
    if (!fs) {
+      fat_rw_destroy(d);
       kfree_obj(d, struct fat_fs_device_data);
       return NULL;
    }
 
-   if (!fat_ramdisk_prepare_for_mmap(d, rd_size))
+   /*
+    * mmap is supported only in read-only mode: in r/w mode, the clusters
+    * added beyond the end of the image are not contiguous in memory.
+    */
+   if (!(flags & VFS_FS_RW) && !fat_ramdisk_prepare_for_mmap(d, rd_size))
       d->mmap_support = true;
 
    return fs;
@@ -653,6 +1147,123 @@ struct mnt_fs *fat_mount_ramdisk(void *vaddr, size_t rd_size, u32 flags)
 
 void fat_umount_ramdisk(struct mnt_fs *fs)
 {
+   fat_rw_destroy(fs->device_data);
    kfree_obj(fs->device_data, struct fat_fs_device_data);
    destory_fs_obj(fs);
 }
+
+struct mnt_fs *fat_mount_blkdev(struct block_dev *bdev, u32 flags, int *err)
+{
+   struct fat_fs_device_data *d;
+   struct mnt_fs *fs;
+   u32 root_sector;
+
+   struct {
+      struct fat_hdr hdr;
+      struct fat32_header2 h32;     /* read by fat_get_first_data_sector() */
+   } PACKED bs;
+   int rc = -EINVAL;
+
+   if (blkdev_read(bdev, 0, &bs, sizeof(bs)) != sizeof(bs)) {
+      *err = -EIO;
+      return NULL;
+   }
+
+   if (bs.hdr.BPB_BytsPerSec != 512 && bs.hdr.BPB_BytsPerSec != 1024 &&
+       bs.hdr.BPB_BytsPerSec != 2048 && bs.hdr.BPB_BytsPerSec != 4096)
+   {
+      *err = -EINVAL;       /* not a FAT partition */
+      return NULL;
+   }
+
+   if (!bs.hdr.BPB_SecPerClus || !bs.hdr.BPB_NumFATs) {
+      *err = -EINVAL;
+      return NULL;
+   }
+
+   if (!(d = kzalloc_obj(struct fat_fs_device_data))) {
+      *err = -ENOMEM;
+      return NULL;
+   }
+
+   d->bdev = bdev;
+   d->img_clusters_end = (u32) -1;
+   list_init(&d->dir_clusters);
+   kmutex_init(&d->dir_clusters_mutex, 0);
+   d->hdr_size = fat_get_first_data_sector(&bs.hdr) * bs.hdr.BPB_BytsPerSec;
+
+   if (d->hdr_size > blkdev_get_size(bdev))
+      goto err_end;
+
+   if (!(d->hdr = vmalloc(d->hdr_size))) {
+      rc = -ENOMEM;
+      goto err_end;
+   }
+
+   if (blkdev_read(bdev, 0, d->hdr, d->hdr_size) != (ssize_t)d->hdr_size) {
+      rc = -EIO;
+      goto err_end;
+   }
+
+   d->type = fat_get_type(d->hdr);
+
+   if (d->type != fat16_type && d->type != fat32_type)
+      goto err_end;
+
+   d->cluster_size = d->hdr->BPB_SecPerClus * d->hdr->BPB_BytsPerSec;
+
+   if (d->type == fat16_type) {
+
+      /* The root dir is in the metadata region: fat_get_rootdir() works */
+      d->root_dir_entries = fat_get_rootdir(d->hdr, d->type, &d->root_cluster);
+
+   } else {
+
+      struct fat32_header2 *h32 = (struct fat32_header2 *)(d->hdr + 1);
+      d->root_cluster = h32->BPB_RootClus;
+      root_sector = fat_get_sector_for_cluster(d->hdr, d->root_cluster);
+
+      if ((u64)root_sector * d->hdr->BPB_BytsPerSec >= blkdev_get_size(bdev))
+         goto err_end;
+
+      d->root_dir_entries = fat_bdev_get_dir_cluster(d, d->root_cluster);
+
+      if (!d->root_dir_entries) {
+         rc = -EIO;
+         goto err_end;
+      }
+   }
+
+   if ((flags & VFS_FS_RW) && (rc = fat_rw_init(d, 0)))
+      goto err_end;
+
+   fs = create_fs_obj("fat",
+                      &static_fsops_fat,
+                      d,
+                      flags | VFS_FS_RQ_DE_SKIP);
+
+   if (!fs) {
+      rc = -ENOMEM;
+      goto err_end;
+   }
+
+   /* mmap is not supported: the file's data is not contiguous in memory */
+   d->mmap_support = false;
+   return fs;
+
+err_end:
+   fat_free_blkdev_data(d);
+   *err = rc;
+   return NULL;
+}
+
+void fat_umount_blkdev(struct mnt_fs *fs)
+{
+   struct fat_fs_device_data *d = fs->device_data;
+
+   if (d->rw && fat_sync_device(d))
+      printk("fat: failed to write back the data on umount\n");
+
+   fat_free_blkdev_data(d);
+   destory_fs_obj(fs);
+}
@@ -117,32 +117,47 @@ int fat_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
    do {
 
       char *data;
-      const ulong clu_end_off = off + d->cluster_size;
+      ulong run_end_off = off + d->cluster_size;
+      u32 next = fat_read_fat_entry(d->hdr, d->type, 0, clu);
+      u32 last = clu;
 
       // Are we past the end of the mapped region?
       if (off >= off_end)
          break;
 
-      // Does this cluster belong to the mapped region?
-      if (clu_end_off > off_begin) {
+      /*
+       * Extend the cluster to the whole run of physically contiguous clusters
+       * following it, up to the end of the region: that way we walk the chain
+       * only once and map each run with a single map_pages() call.
+       */
+      while (run_end_off < off_end &&
+             !fat_is_end_of_clusterchain(d->type, next) &&
+             next == last + 1)
+      {
+         last = next;
+         run_end_off += d->cluster_size;
+         next = fat_read_fat_entry(d->hdr, d->type, 0, last);
+      }
 
-         // The cluster ends *after* the beginning of our region
+      // Does this run belong to the mapped region?
+      if (run_end_off > off_begin) {
+
+         // The run ends *after* the beginning of our region
          data = fat_get_pointer_to_cluster_data(d->hdr, clu);
 
          if (off < off_begin) {
 
-            // Our region begins somewhere in the middle of this cluster.
-            // This can happen only with cluster_size > PAGE_SIZE.
-            off = off_begin;
+            // Our region begins somewhere in the middle of this run.
             data += off_begin - off;
+            off = off_begin;
          }
 
          /*
           * Calculate the number of pages to mmap, considering that:
-          *    - we cannot mmap in this iteration further than clu_end_off
+          *    - we cannot mmap in this iteration further than run_end_off
           *    - we must not mmap further than off_end
           */
-         size_t pg_count = (MIN(clu_end_off, off_end) - off) >> PAGE_SHIFT;
+         size_t pg_count = (MIN(run_end_off, off_end) - off) >> PAGE_SHIFT;
 
          mapped_cnt = map_pages(pdir,
                                 (void *)vaddr,
@@ -163,16 +178,16 @@ int fat_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
          tot_mapped_cnt += mapped_cnt;
 
          // After each iteration, `off` must always be aligned at `cluster_size`
-         ASSERT((off % d->cluster_size) == 0);
+         ASSERT(off >= off_end || (off % d->cluster_size) == 0);
 
       } else {
 
-         // We skipped the whole cluster
-         off += d->cluster_size;
+         // We skipped the whole run
+         off = run_end_off;
       }
 
-      // Get the next cluster# from the File Allocation Table
-      clu = fat_read_fat_entry(d->hdr, d->type, 0, clu);
+      // The next cluster# from the File Allocation Table, after the run
+      clu = next;
 
       // We do not expect BAD CLUSTERS
       ASSERT(!fat_is_bad_cluster(d->type, clu));
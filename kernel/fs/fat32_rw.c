@@ -0,0 +1,1121 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * Write support for FAT16 and FAT32, used by the r/w mounts.
+ *
+ * Free clusters are found with a bitmap of the used ones, built at mount time
+ * by scanning the FAT. The data is always written in place: in the ramdisk's
+ * memory or, through the buffer cache, on the block device. In the latter
+ * case, the metadata (FATs, FAT16's root dir and dir clusters) is modified in
+ * the in-memory copies kept by fat32.c and the modified parts are marked as
+ * dirty. At the end of each modifying operation, fat_rw_flush() copies them
+ * to the buffer cache, whose worker thread writes them back to the device
+ * later, together with the data. fsync() and syncfs() just force that.
+ *
+ * Limitations: files and directories cannot be removed or renamed.
+ */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/utils.h>
+
+#include <tilck/kernel/fs/fat32.h>
+#include <tilck/kernel/fs/blkdev.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/paging.h>
+#include <tilck/kernel/bintree.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/datetime.h>
+
+#define FAT_MAX_FILE_SIZE                       0xFFFFFFFFull
+#define FAT_ENTRY_FREE                          ((char)0xE5)
+#define FAT_LFN_CHARS                           13
+#define FAT_LFN_LAST                            0x40
+#define FAT_LFN_ATTR                            0x0F
+#define FAT_NAME_MAX                            255
+#define FAT_MAX_LFN_ENTRIES                     \
+   ((FAT_NAME_MAX + FAT_LFN_CHARS - 1) / FAT_LFN_CHARS)
+
+#define FAT_SHORT_NAME_MAX_TAIL                 999999
+#define FAT_FSI_LEAD_SIG                        0x41615252
+
+#define BMP_BITS                                (sizeof(ulong) * 8)
+
+/* Defined in fat32.c */
+void *fat_bdev_get_dir_cluster(void *arg, u32 clu);
+int fat_fs_walk_generic(struct fat_fs_device_data *d,
+                        struct fat_walk_static_params *static_walk_params,
+                        struct fat_entry *e);
+
+/* A cluster of a r/w ramdisk, beyond the end of the loaded image */
+struct fat_extra_cluster {
+
+   struct bintree_node node;
+   ulong clu;
+   void *data;
+};
+
+static inline u32 fat_rw_bmp_words(struct fat_fs_device_data *d)
+{
+   return (d->clusters_end + (u32)BMP_BITS - 1) / (u32)BMP_BITS;
+}
+
+static inline u32 fat_rw_hdr_dirty_words(struct fat_fs_device_data *d)
+{
+   const u32 sectors = (u32)d->hdr_size / d->hdr->BPB_BytsPerSec;
+   return (sectors + (u32)BMP_BITS - 1) / (u32)BMP_BITS;
+}
+
+static inline bool bmp_test(ulong *bmp, u32 n)
+{
+   return !!(bmp[n / BMP_BITS] & (1ul << (n % BMP_BITS)));
+}
+
+static inline void bmp_set(ulong *bmp, u32 n)
+{
+   bmp[n / BMP_BITS] |= (1ul << (n % BMP_BITS));
+}
+
+static inline void bmp_clear(ulong *bmp, u32 n)
+{
+   bmp[n / BMP_BITS] &= ~(1ul << (n % BMP_BITS));
+}
+
+static inline u32 fat_rw_eoc(struct fat_fs_device_data *d)
+{
+   return d->type == fat16_type ? 0xFFFF : 0x0FFFFFFF;
+}
+
+/* Returns the data of the cluster `clu` of a r/w ramdisk */
+void *fat_rw_get_cluster(void *arg, u32 clu)
+{
+   struct fat_fs_device_data *d = arg;
+   struct fat_extra_cluster *ec;
+   ASSERT(!d->bdev);
+
+   if (clu < d->img_clusters_end)
+      return fat_get_pointer_to_cluster_data(d->hdr, clu);
+
+   ec = bintree_find_ptr(d->extra_clusters,
+                         clu,
+                         struct fat_extra_cluster,
+                         node,
+                         clu);
+
+   return ec ? ec->data : NULL;
+}
+
+static void *fat_rw_get_dir_cluster(struct fat_fs_device_data *d, u32 clu)
+{
+   if (d->bdev)
+      return fat_bdev_get_dir_cluster(d, clu);
+
+   return fat_rw_get_cluster(d, clu);
+}
+
+static int fat_rw_alloc_extra(struct fat_fs_device_data *d, u32 clu)
+{
+   struct fat_extra_cluster *ec;
+
+   if (!(ec = kalloc_obj(struct fat_extra_cluster)))
+      return -ENOMEM;
+
+   if (!(ec->data = kzmalloc(d->cluster_size))) {
+      kfree_obj(ec, struct fat_extra_cluster);
+      return -ENOMEM;
+   }
+
+   bintree_node_init(&ec->node);
+   ec->clu = clu;
+
+   DEBUG_ONLY_UNSAFE(bool success =)
+      bintree_insert_ptr(&d->extra_clusters,
+                         ec,
+                         struct fat_extra_cluster,
+                         node,
+                         clu);
+
+   ASSERT(success);
+   return 0;
+}
+
+static void
+fat_rw_destroy_extra(struct fat_fs_device_data *d, struct fat_extra_cluster *ec)
+{
+   bintree_remove_ptr(&d->extra_clusters,
+                      ec,
+                      struct fat_extra_cluster,
+                      node,
+                      clu);
+
+   kfree2(ec->data, d->cluster_size);
+   kfree_obj(ec, struct fat_extra_cluster);
+}
+
+/*
+ * Marks as dirty the metadata in [ptr, ptr + len): sectors of the metadata
+ * region or a dir cluster. No-op on ramdisks, where everything is in place.
+ */
+static void
+fat_rw_mark_dirty(struct fat_fs_device_data *d, void *ptr, size_t len)
+{
+   const char *hdr = (const char *)d->hdr;
+   const char *p = ptr;
+   struct fat_dir_cluster *pos;
+
+   if (!d->bdev)
+      return;
+
+   if (p >= hdr && p < hdr + d->hdr_size) {
+
+      const u32 bps = d->hdr->BPB_BytsPerSec;
+      const u32 first = (u32)(p - hdr) / bps;
+      const u32 last = (u32)(p + len - 1 - hdr) / bps;
+
+      for (u32 s = first; s <= last; s++)
+         bmp_set(d->hdr_dirty, s);
+
+      return;
+   }
+
+   kmutex_lock(&d->dir_clusters_mutex);
+
+   list_for_each_ro(pos, &d->dir_clusters, node) {
+      if (p >= pos->data && p < pos->data + d->cluster_size) {
+         pos->dirty = true;
+         break;
+      }
+   }
+
+   kmutex_unlock(&d->dir_clusters_mutex);
+}
+
+/* Sets the entry of `clu` in all the FATs */
+static void fat_rw_set_fat_entry(struct fat_fs_device_data *d, u32 clu, u32 val)
+{
+   for (u32 i = 0; i < d->hdr->BPB_NumFATs; i++) {
+      fat_write_fat_entry(d->hdr, d->type, i, clu, val);
+      fat_rw_mark_dirty(d, fat_get_entry_ptr(d->hdr, d->type, i, clu), d->type);
+   }
+}
+
+/*
+ * Allocates a free cluster, marking it as the end of its chain, and links it
+ * after `prev`, unless that's 0. Returns 0 if there are no free clusters.
+ */
+static u32 fat_rw_alloc_cluster(struct fat_fs_device_data *d, u32 prev)
+{
+   const u32 words = fat_rw_bmp_words(d);
+   u32 w = d->free_hint / (u32)BMP_BITS;
+   u32 clu = 0;
+
+   if (!d->free_count)
+      return 0;
+
+   for (u32 i = 0; i < words; i++, w = (w + 1) % words) {
+      if (~d->free_bmp[w]) {
+         clu = w * (u32)BMP_BITS + get_first_zero_bit_index_l(d->free_bmp[w]);
+         break;
+      }
+   }
+
+   ASSERT(clu >= 2 && clu < d->clusters_end);
+
+   if (!d->bdev && clu >= d->img_clusters_end)
+      if (fat_rw_alloc_extra(d, clu))
+         return 0; /* out of memory */
+
+   bmp_set(d->free_bmp, clu);
+   d->free_count--;
+   d->free_hint = clu;
+
+   fat_rw_set_fat_entry(d, clu, fat_rw_eoc(d));
+
+   if (prev)
+      fat_rw_set_fat_entry(d, prev, clu);
+
+   return clu;
+}
+
+static void fat_rw_free_chain(struct fat_fs_device_data *d, u32 clu)
+{
+   struct fat_extra_cluster *ec;
+
+   while (clu >= 2 && clu < d->clusters_end) {
+
+      const u32 next = fat_read_fat_entry(d->hdr, d->type, 0, clu);
+      fat_rw_set_fat_entry(d, clu, 0);
+
+      if (bmp_test(d->free_bmp, clu)) {
+         bmp_clear(d->free_bmp, clu);
+         d->free_count++;
+      }
+
+      if (!d->bdev && clu >= d->img_clusters_end) {
+
+         ec = bintree_find_ptr(d->extra_clusters,
+                               clu,
+                               struct fat_extra_cluster,
+                               node,
+                               clu);
+         if (ec)
+            fat_rw_destroy_extra(d, ec);
+      }
+
+      clu = next;
+   }
+}
+
+static void fat_rw_get_now(u16 *date, u16 *time)
+{
+   struct datetime dt;
+   timestamp_to_datetime(get_timestamp(), &dt);
+
+   if (dt.year < 1980) {
+      *date = (1 << 5) | 1;         /* The FAT epoch: 1980-01-01 */
+      *time = 0;
+      return;
+   }
+
+   *date = (u16)(((dt.year - 1980) << 9) | (dt.month << 5) | dt.day);
+   *time = (u16)((dt.hour << 11) | (dt.min << 5) | (dt.sec / 2));
+}
+
+/* Updates the last write time of `e` after its content changed */
+static void
+fat_rw_touch_entry(struct fat_fs_device_data *d, struct fat_entry *e)
+{
+   u16 date, time;
+
+   fat_rw_get_now(&date, &time);
+   e->DIR_WrtDate = date;
+   e->DIR_WrtTime = time;
+   e->DIR_LstAccDate = date;
+   e->archive = 1;
+   fat_rw_mark_dirty(d, e, sizeof(*e));
+}
+
+static int
+fat_rw_write_cluster(struct fat_fs_device_data *d,
+                     u32 clu,
+                     offt off,
+                     const char *buf,  /* NULL: write zeros */
+                     size_t len)
+{
+   if (!d->bdev) {
+
+      char *data = fat_rw_get_cluster(d, clu);
+      ASSERT(data != NULL);
+
+      if (buf)
+         memcpy(data + off, buf, len);
+      else
+         bzero(data + off, len);
+
+      return 0;
+   }
+
+   u64 dev_off = (u64)fat_get_sector_for_cluster(d->hdr, clu)
+                  * d->hdr->BPB_BytsPerSec + (u64)off;
+
+   if (buf) {
+      return blkdev_write(d->bdev, dev_off, buf, len) == (ssize_t)len
+               ? 0 : -EIO;
+   }
+
+   while (len > 0) {
+
+      const size_t n = MIN(len, (size_t)PAGE_SIZE);
+
+      if (blkdev_write(d->bdev, dev_off, zero_page, n) != (ssize_t)n)
+         return -EIO;
+
+      dev_off += n;
+      len -= n;
+   }
+
+   return 0;
+}
+
+/*
+ * Initializes the cursor `c` at the position `pos` of the file `e`, walking
+ * its cluster chain. At the cluster boundaries, the cursor is at the end of the
+ * previous cluster: that way, it's valid also at the end of the file.
+ */
+void
+fat_rw_get_cursor(struct fat_fs_device_data *d,
+                  struct fat_entry *e,
+                  offt pos,
+                  struct fat_cursor *c)
+{
+   const offt csize = (offt)d->cluster_size;
+   u32 clu = fat_get_first_cluster(e);
+   offt n = pos / csize;
+
+   ASSERT(pos <= (offt)e->DIR_FileSize);
+
+   c->pos = pos;
+   c->at_end = false;
+
+   if (clu && n > 0 && (pos % csize) == 0) {
+      c->at_end = true;
+      n--;
+   }
+
+   while (clu && n-- > 0) {
+
+      const u32 next = fat_read_fat_entry(d->hdr, d->type, 0, clu);
+
+      if (fat_is_end_of_clusterchain(d->type, next))
+         break; /* chain shorter than the file: corrupted fs */
+
+      clu = next;
+   }
+
+   c->clu = clu;
+}
+
+/*
+ * Writes `len` bytes from `buf` (zeros if NULL) at the cursor's position,
+ * moving it forward and allocating clusters as necessary. If the position is
+ * past the end of the file, the gap is filled with zeros. Returns the number
+ * of bytes written or an error, if nothing could be written.
+ */
+ssize_t
+fat_rw_write(struct fat_fs_device_data *d,
+             struct fat_entry *e,
+             struct fat_cursor *c,
+             const char *buf,
+             size_t len)
+{
+   const offt csize = (offt)d->cluster_size;
+   const u32 old_first = fat_get_first_cluster(e);
+   const u32 old_size = e->DIR_FileSize;
+   size_t done = 0;
+   int rc = 0;
+
+   if ((u64)c->pos + len > FAT_MAX_FILE_SIZE)
+      return -EFBIG;
+
+   if (c->pos > (offt)e->DIR_FileSize) {
+
+      const offt gap = c->pos - (offt)e->DIR_FileSize;
+      struct fat_cursor zc;
+      ssize_t zrc;
+
+      fat_rw_get_cursor(d, e, (offt)e->DIR_FileSize, &zc);
+
+      if ((zrc = fat_rw_write(d, e, &zc, NULL, (size_t)gap)) != gap)
+         return zrc < 0 ? zrc : -ENOSPC;
+
+      *c = zc;
+   }
+
+   while (done < len) {
+
+      offt off;
+      size_t n;
+
+      if (!c->clu) {
+
+         /* Empty file: allocate its first cluster */
+         ASSERT(c->pos == 0);
+
+         if (!(c->clu = fat_rw_alloc_cluster(d, 0))) {
+            rc = -ENOSPC;
+            break;
+         }
+
+         fat_set_first_cluster(e, c->clu);
+
+      } else if (c->at_end) {
+
+         u32 next = fat_read_fat_entry(d->hdr, d->type, 0, c->clu);
+
+         if (fat_is_end_of_clusterchain(d->type, next)) {
+            if (!(next = fat_rw_alloc_cluster(d, c->clu))) {
+               rc = -ENOSPC;
+               break;
+            }
+         }
+
+         c->clu = next;
+         c->at_end = false;
+      }
+
+      off = c->pos % csize;
+      n = MIN((size_t)(csize - off), len - done);
+
+      if ((rc = fat_rw_write_cluster(d, c->clu, off, buf ? buf+done : NULL, n)))
+         break;
+
+      done += n;
+      c->pos += (offt)n;
+      c->at_end = (off + (offt)n == csize);
+
+      if (c->pos > (offt)e->DIR_FileSize)
+         e->DIR_FileSize = (u32)c->pos;
+   }
+
+   if (done)
+      fat_rw_touch_entry(d, e);
+
+   if (fat_get_first_cluster(e) != old_first || e->DIR_FileSize != old_size)
+      d->gen++;
+
+   return done ? (ssize_t)done : rc;
+}
+
+int fat_rw_truncate(struct fat_fs_device_data *d, struct fat_entry *e, offt len)
+{
+   const offt csize = (offt)d->cluster_size;
+   const offt size = (offt)e->DIR_FileSize;
+   struct fat_cursor c;
+   u32 clu, keep;
+
+   if (len < 0)
+      return -EINVAL;
+
+   if ((u64)len > FAT_MAX_FILE_SIZE)
+      return -EFBIG;
+
+   if (len == size)
+      return 0;
+
+   if (len > size) {
+
+      ssize_t rc;
+
+      fat_rw_get_cursor(d, e, size, &c);
+      rc = fat_rw_write(d, e, &c, NULL, (size_t)(len - size));
+
+      if (rc != len - size)
+         return rc < 0 ? (int)rc : -ENOSPC;
+
+      return 0;
+   }
+
+   clu = fat_get_first_cluster(e);
+   keep = (u32)((len + csize - 1) / csize);
+
+   if (clu && !keep) {
+
+      fat_rw_free_chain(d, clu);
+      fat_set_first_cluster(e, 0);
+
+   } else if (clu) {
+
+      u32 next;
+
+      for (u32 i = 1; i < keep; i++) {
+
+         next = fat_read_fat_entry(d->hdr, d->type, 0, clu);
+
+         if (fat_is_end_of_clusterchain(d->type, next))
+            break;
+
+         clu = next;
+      }
+
+      next = fat_read_fat_entry(d->hdr, d->type, 0, clu);
+
+      if (!fat_is_end_of_clusterchain(d->type, next)) {
+         fat_rw_set_fat_entry(d, clu, fat_rw_eoc(d));
+         fat_rw_free_chain(d, next);
+      }
+   }
+
+   e->DIR_FileSize = (u32)len;
+   fat_rw_touch_entry(d, e);
+   d->gen++;
+   return 0;
+}
+
+/* ---------------------- Creation of dir entries ------------------------ */
+
+struct fat_rw_short_name_ctx {
+   const char *sname;
+   bool found;
+};
+
+static int
+fat_rw_short_name_cb(struct fat_hdr *hdr,
+                     enum fat_type ft,
+                     struct fat_entry *entry,
+                     const char *long_name,
+                     void *arg)
+{
+   struct fat_rw_short_name_ctx *ctx = arg;
+
+   if (!memcmp(entry->DIR_Name, ctx->sname, sizeof(entry->DIR_Name))) {
+      ctx->found = true;
+      return 1; /* stop the walk */
+   }
+
+   return 0;
+}
+
+static bool
+fat_rw_short_name_exists(struct fat_fs_device_data *d,
+                         struct fat_entry *dir,
+                         const char *sname)
+{
+   struct fat_rw_short_name_ctx ctx = { .sname = sname, .found = false };
+   struct fat_walk_static_params walk_params = {
+      .ctx = NULL,
+      .h = d->hdr,
+      .ft = d->type,
+      .cb = &fat_rw_short_name_cb,
+      .arg = &ctx,
+   };
+
+   fat_fs_walk_generic(d, &walk_params, dir);
+   return ctx.found;
+}
+
+static char fat_rw_short_name_char(char c, bool *lossy)
+{
+   if (c >= 'a' && c <= 'z')
+      return (char)(c - 'a' + 'A'); /* not lossy: the long name keeps it */
+
+   if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+      return c;
+
+   for (const char *p = "!#$%&'()-@^_`{}~"; *p; p++)
+      if (*p == c)
+         return c;
+
+   *lossy = true;
+   return '_';
+}
+
+/*
+ * Builds the "basis" short name of `name` as described in the FAT spec: up to
+ * 8 upper-case chars for the name and 3 for the extension. Returns true if the
+ * conversion was lossy, meaning that a numeric tail ("~N") is needed.
+ */
+static bool
+fat_rw_short_name_basis(const char *name,
+                        size_t len,
+                        char *sname,
+                        u32 *base_len)
+{
+   const char *end = name + len;
+   const char *dot = NULL;
+   bool lossy = false;
+   u32 bl = 0, el = 0;
+
+   memset(sname, ' ', 11);
+
+   for (size_t i = len - 1; i > 0; i--) {
+      if (name[i] == '.') {
+         dot = name + i;
+         break;
+      }
+   }
+
+   for (const char *p = name; p < (dot ? dot : end); p++) {
+
+      if (*p == ' ' || *p == '.') {
+         lossy = true;
+         continue;
+      }
+
+      if (bl < 8)
+         sname[bl++] = fat_rw_short_name_char(*p, &lossy);
+      else
+         lossy = true;
+   }
+
+   for (const char *p = dot ? dot + 1 : end; p < end; p++) {
+
+      if (*p == ' ') {
+         lossy = true;
+         continue;
+      }
+
+      if (el < 3)
+         sname[8 + el++] = fat_rw_short_name_char(*p, &lossy);
+      else
+         lossy = true;
+   }
+
+   if (!bl) {
+      sname[bl++] = '_';
+      lossy = true;
+   }
+
+   *base_len = bl;
+   return lossy;
+}
+
+static int
+fat_rw_make_short_name(struct fat_fs_device_data *d,
+                       struct fat_entry *dir,
+                       const char *name,
+                       size_t len,
+                       char *sname)
+{
+   char tail[12];
+   u32 bl;
+
+   if (!fat_rw_short_name_basis(name, len, sname, &bl))
+      if (!fat_rw_short_name_exists(d, dir, sname))
+         return 0;
+
+   for (u32 n = 1; n <= FAT_SHORT_NAME_MAX_TAIL; n++) {
+
+      const u32 tl = (u32)snprintk(tail, sizeof(tail), "~%u", n);
+      memcpy(sname + MIN(bl, 8 - tl), tail, tl);
+
+      if (!fat_rw_short_name_exists(d, dir, sname))
+         return 0;
+   }
+
+   return -EEXIST;
+}
+
+static void
+fat_rw_fill_long_entry(struct fat_long_entry *le,
+                       const char *name,
+                       size_t len,
+                       u32 part,
+                       bool last,
+                       u8 chksum)
+{
+   u8 *dest[FAT_LFN_CHARS];
+   u32 i;
+
+   for (i = 0; i < 5; i++)
+      dest[i] = &le->LDIR_Name1[2 * i];
+
+   for (; i < 11; i++)
+      dest[i] = &le->LDIR_Name2[2 * (i - 5)];
+
+   for (; i < FAT_LFN_CHARS; i++)
+      dest[i] = &le->LDIR_Name3[2 * (i - 11)];
+
+   for (i = 0; i < FAT_LFN_CHARS; i++) {
+
+      const size_t idx = part * FAT_LFN_CHARS + i;
+
+      /* UCS-2 chars: the name, a NUL terminator and then 0xFFFF padding */
+      if (idx < len) {
+         dest[i][0] = (u8)name[idx];
+         dest[i][1] = 0;
+      } else {
+         dest[i][0] = dest[i][1] = idx == len ? 0 : 0xFF;
+      }
+   }
+
+   le->LDIR_Ord = (u8)((part + 1) | (last ? FAT_LFN_LAST : 0));
+   le->LDIR_Attr = FAT_LFN_ATTR;
+   le->LDIR_Type = 0;
+   le->LDIR_Chksum = chksum;
+   le->LDIR_FstClusLO = 0;
+}
+
+static bool
+fat_rw_collect_slots(struct fat_entry *ents,
+                     u32 count,
+                     u32 n,
+                     struct fat_entry **slots,
+                     u32 *cnt)
+{
+   for (u32 i = 0; i < count; i++) {
+
+      const char c = ents[i].DIR_Name[0];
+
+      if (c == 0 || c == FAT_ENTRY_FREE) {
+
+         slots[(*cnt)++] = &ents[i];
+
+         if (*cnt == n)
+            return true;
+
+      } else {
+
+         *cnt = 0;
+      }
+   }
+
+   return false;
+}
+
+/*
+ * Finds `n` consecutive free dir entries in `dir`, extending it if necessary.
+ * The run of free entries might span over more than one cluster.
+ */
+static int
+fat_rw_dir_get_slots(struct fat_fs_device_data *d,
+                     struct fat_entry *dir,
+                     u32 n,
+                     struct fat_entry **slots)
+{
+   const u32 epc = fat_get_dir_entries_per_cluster(d->hdr);
+   struct fat_entry *ents;
+   u32 clu, prev, cnt = 0;
+
+   if (dir == d->root_dir_entries && d->type == fat16_type) {
+
+      /* FAT16's root dir has a fixed size: it cannot be extended */
+      if (fat_rw_collect_slots(dir, d->hdr->BPB_RootEntCnt, n, slots, &cnt))
+         return 0;
+
+      return -ENOSPC;
+   }
+
+   clu = dir == d->root_dir_entries
+            ? d->root_cluster
+            : fat_get_first_cluster(dir);
+
+   do {
+
+      if (!(ents = fat_rw_get_dir_cluster(d, clu)))
+         return -EIO;
+
+      if (fat_rw_collect_slots(ents, epc, n, slots, &cnt))
+         return 0;
+
+      prev = clu;
+      clu = fat_read_fat_entry(d->hdr, d->type, 0, clu);
+
+   } while (!fat_is_end_of_clusterchain(d->type, clu));
+
+   while (true) {
+
+      if (!(clu = fat_rw_alloc_cluster(d, prev)))
+         return -ENOSPC;
+
+      if (!(ents = fat_rw_get_dir_cluster(d, clu)))
+         return -EIO;
+
+      bzero(ents, d->cluster_size);
+      fat_rw_mark_dirty(d, ents, d->cluster_size);
+
+      if (fat_rw_collect_slots(ents, epc, n, slots, &cnt))
+         return 0;
+
+      prev = clu;
+   }
+}
+
+static int
+fat_rw_init_dir_cluster(struct fat_fs_device_data *d,
+                        u32 clu,
+                        u32 parent_clu,
+                        u16 date,
+                        u16 time)
+{
+   struct fat_entry *ents = fat_rw_get_dir_cluster(d, clu);
+
+   if (!ents)
+      return -EIO;
+
+   bzero(ents, d->cluster_size);
+
+   for (int i = 0; i < 2; i++) {
+      memcpy(ents[i].DIR_Name, i ? FAT_DIR_DOT_DOT : FAT_DIR_DOT, 11);
+      ents[i].directory = 1;
+      ents[i].DIR_CrtDate = ents[i].DIR_WrtDate = date;
+      ents[i].DIR_LstAccDate = date;
+      ents[i].DIR_CrtTime = ents[i].DIR_WrtTime = time;
+      fat_set_first_cluster(&ents[i], i ? parent_clu : clu);
+   }
+
+   fat_rw_mark_dirty(d, ents, d->cluster_size);
+   return 0;
+}
+
+/*
+ * Creates a new file or directory named `name` (not necessarily NUL-terminated,
+ * `len` chars) in `dir`. Every entry gets a long name, even when a short one
+ * would be enough, because only long names are case-sensitive in Tilck.
+ */
+struct fat_entry *
+fat_rw_create_entry(struct fat_fs_device_data *d,
+                    struct fat_entry *dir,
+                    const char *name,
+                    size_t len,
+                    bool is_dir,
+                    int *err)
+{
+   struct fat_entry *slots[FAT_MAX_LFN_ENTRIES + 1];
+   const u32 n_lfn = (u32)(len + FAT_LFN_CHARS - 1) / FAT_LFN_CHARS;
+   struct fat_entry *e;
+   char sname[11];
+   u32 clu = 0;
+   u16 date, time;
+   u8 chksum;
+   int rc;
+
+   if (!len) {
+      *err = -ENOENT;
+      return NULL;
+   }
+
+   if (len > FAT_NAME_MAX) {
+      *err = -ENAMETOOLONG;
+      return NULL;
+   }
+
+   for (size_t i = 0; i < len; i++) {
+      if (!fat32_is_valid_filename_character(name[i])) {
+         *err = -EINVAL;
+         return NULL;
+      }
+   }
+
+   if ((rc = fat_rw_make_short_name(d, dir, name, len, sname)))
+      goto err_end;
+
+   fat_rw_get_now(&date, &time);
+
+   if (is_dir) {
+
+      const u32 parent_clu =
+         dir == d->root_dir_entries ? 0 : fat_get_first_cluster(dir);
+
+      if (!(clu = fat_rw_alloc_cluster(d, 0))) {
+         rc = -ENOSPC;
+         goto err_end;
+      }
+
+      if ((rc = fat_rw_init_dir_cluster(d, clu, parent_clu, date, time)))
+         goto err_free_clu;
+   }
+
+   if ((rc = fat_rw_dir_get_slots(d, dir, n_lfn + 1, slots)))
+      goto err_free_clu;
+
+   chksum = fat_shortname_checksum((u8 *)sname);
+
+   /* The long name entries come first, in reverse order */
+   for (u32 i = 0; i < n_lfn; i++) {
+
+      fat_rw_fill_long_entry((struct fat_long_entry *)slots[i],
+                             name,
+                             len,
+                             n_lfn - 1 - i,
+                             i == 0,
+                             chksum);
+
+      fat_rw_mark_dirty(d, slots[i], sizeof(struct fat_entry));
+   }
+
+   e = slots[n_lfn];
+   bzero(e, sizeof(*e));
+   memcpy(e->DIR_Name, sname, sizeof(e->DIR_Name));
+
+   if (is_dir)
+      e->directory = 1;
+   else
+      e->archive = 1;
+
+   e->DIR_CrtDate = e->DIR_WrtDate = e->DIR_LstAccDate = date;
+   e->DIR_CrtTime = e->DIR_WrtTime = time;
+   fat_set_first_cluster(e, clu);
+   fat_rw_mark_dirty(d, e, sizeof(*e));
+   return e;
+
+err_free_clu:
+   if (clu)
+      fat_rw_free_chain(d, clu);
+
+err_end:
+   *err = rc;
+   return NULL;
+}
+
+/* ------------------------ Write-back and mount -------------------------- */
+
+/*
+ * Copies the dirty metadata to the buffer cache. No-op on ramdisks.
+ * The caller must hold the fs lock.
+ */
+int fat_rw_flush(struct fat_fs_device_data *d)
+{
+   const u32 bps = d->hdr->BPB_BytsPerSec;
+   const u32 sectors = (u32)d->hdr_size / bps;
+   struct fat_dir_cluster *pos;
+   int rc = 0;
+
+   if (!d->bdev)
+      return 0;
+
+   for (u32 s = 0; s < sectors; s++) {
+
+      u32 end = s;
+
+      if (!bmp_test(d->hdr_dirty, s))
+         continue;
+
+      while (end < sectors && bmp_test(d->hdr_dirty, end))
+         end++;
+
+      const size_t len = (end - s) * bps;
+
+      if (blkdev_write(d->bdev,
+                       (u64)s * bps,
+                       (char *)d->hdr + s * bps,
+                       len) != (ssize_t)len)
+      {
+         rc = -EIO;
+         s = end;
+         continue;
+      }
+
+      for (; s < end; s++)
+         bmp_clear(d->hdr_dirty, s);
+   }
+
+   kmutex_lock(&d->dir_clusters_mutex);
+
+   list_for_each_ro(pos, &d->dir_clusters, node) {
+
+      const u64 off = (u64)fat_get_sector_for_cluster(d->hdr, pos->clu) * bps;
+
+      if (!pos->dirty)
+         continue;
+
+      if (blkdev_write(d->bdev, off, pos->data, d->cluster_size) !=
+          (ssize_t)d->cluster_size)
+      {
+         rc = -EIO;
+         continue;
+      }
+
+      pos->dirty = false;
+   }
+
+   kmutex_unlock(&d->dir_clusters_mutex);
+   return rc;
+}
+
+/*
+ * On FAT32, the FSInfo sector caches the count of free clusters. We don't
+ * maintain it: just mark it as unknown, as allowed by the spec.
+ */
+static void fat_rw_invalidate_fsinfo(struct fat_fs_device_data *d)
+{
+   struct fat32_header2 *h32 = (struct fat32_header2 *)(d->hdr + 1);
+   u32 *fsi;
+
+   if (d->type != fat32_type)
+      return;
+
+   if (!h32->BPB_FSInfo || h32->BPB_FSInfo >= d->hdr->BPB_RsvdSecCnt)
+      return;
+
+   fsi = (u32 *)((char *)d->hdr + h32->BPB_FSInfo * d->hdr->BPB_BytsPerSec);
+
+   if (fsi[0] != FAT_FSI_LEAD_SIG)
+      return;
+
+   fsi[488 / 4] = 0xFFFFFFFF;       /* FSI_Free_Count */
+   fsi[492 / 4] = 0xFFFFFFFF;       /* FSI_Nxt_Free */
+   fat_rw_mark_dirty(d, &fsi[488 / 4], 8);
+}
+
+void fat_rw_destroy(struct fat_fs_device_data *d)
+{
+   struct fat_extra_cluster *ec;
+
+   while ((ec = bintree_get_first_obj(d->extra_clusters,
+                                      struct fat_extra_cluster,
+                                      node)))
+   {
+      fat_rw_destroy_extra(d, ec);
+   }
+
+   if (d->free_bmp)
+      kfree_array_obj(d->free_bmp, ulong, fat_rw_bmp_words(d));
+
+   if (d->hdr_dirty)
+      kfree_array_obj(d->hdr_dirty, ulong, fat_rw_hdr_dirty_words(d));
+
+   if (d->rw)
+      rwlock_wp_destroy(&d->rwlock);
+
+   d->free_bmp = NULL;
+   d->hdr_dirty = NULL;
+   d->rw = false;
+}
+
+/*
+ * Prepares a FAT fs for r/w mode. `rd_size` is the size of the loaded ramdisk
+ * image or 0 for block devices.
+ */
+int fat_rw_init(struct fat_fs_device_data *d, size_t rd_size)
+{
+   const u32 count = fat_get_cluster_count(d->hdr);
+   u32 words;
+
+   if (d->type != fat16_type && d->type != fat32_type)
+      return -EINVAL;
+
+   d->clusters_end = count + 2;
+   words = fat_rw_bmp_words(d);
+
+   if (!(d->free_bmp = kzalloc_array_obj(ulong, words)))
+      return -ENOMEM;
+
+   if (d->bdev) {
+
+      d->hdr_dirty = kzalloc_array_obj(ulong, fat_rw_hdr_dirty_words(d));
+
+      if (!d->hdr_dirty) {
+         kfree_array_obj(d->free_bmp, ulong, words);
+         d->free_bmp = NULL;
+         return -ENOMEM;
+      }
+
+   } else {
+
+      const size_t data_off =
+         fat_get_first_data_sector(d->hdr) * d->hdr->BPB_BytsPerSec;
+
+      const u32 img_clusters = rd_size > data_off
+         ? (u32)((rd_size - data_off) / d->cluster_size)
+         : 0;
+
+      char *va = (char *)((ulong)d->hdr & PAGE_MASK);
+      pdir_t *pdir = get_kernel_pdir();
+
+      d->img_clusters_end = MIN(2 + img_clusters, d->clusters_end);
+
+      /* The ramdisk might be mapped read-only */
+      for (; va < (char *)d->hdr + rd_size; va += PAGE_SIZE) {
+         if (!is_rw_mapped(pdir, va))
+            set_page_rw(pdir, va, true);
+      }
+   }
+
+   for (u32 clu = 0; clu < words * BMP_BITS; clu++) {
+
+      if (clu < 2 || clu >= d->clusters_end) {
+         bmp_set(d->free_bmp, clu);
+         continue;
+      }
+
+      if (!fat_read_fat_entry(d->hdr, d->type, 0, clu)) {
+         d->free_count++;
+         continue;
+      }
+
+      bmp_set(d->free_bmp, clu);
+
+      if (clu >= d->img_clusters_end) {
+         printk("fat: used cluster %u beyond the ramdisk image\n", clu);
+         fat_rw_destroy(d);
+         return -EINVAL;
+      }
+   }
+
+   rwlock_wp_init(&d->rwlock, RWLOCK_WP_FL_REC);
+   d->rw = true;
+   fat_rw_invalidate_fsinfo(d);
+   return 0;
+}
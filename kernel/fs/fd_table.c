@@ -0,0 +1,172 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/utils.h>
+
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+
+/*
+ * Per-process fd table
+ * ----------------------
+ *
+ * Every process starts with the KRN_MAX_HANDLES slots embedded in its struct.
+ * When an fd beyond the current capacity is needed, the table is moved on the
+ * heap, doubling its size each time, up to KRN_NOFILE_MAX. The table never
+ * shrinks during the life of the process.
+ *
+ * A heap-allocated table is a single kmalloc block containing the handles
+ * array followed by the bitmap of the used slots.
+ */
+
+STATIC_ASSERT(KRN_MAX_HANDLES >= 3);
+STATIC_ASSERT(KRN_MAX_HANDLES <= KRN_NOFILE_MAX);
+
+static ALWAYS_INLINE bool is_fd_table_inline(struct process *pi)
+{
+   return pi->handles == pi->handles_inline;
+}
+
+static ALWAYS_INLINE size_t fd_table_alloc_size(u32 cap)
+{
+   return cap * sizeof(fs_handle) + FD_BMP_WORDS(cap) * sizeof(ulong);
+}
+
+void init_fd_table(struct process *pi)
+{
+   pi->handles = pi->handles_inline;
+   pi->handles_bmp = pi->handles_bmp_inline;
+   pi->handles_cap = KRN_MAX_HANDLES;
+
+   bzero(pi->handles_inline, sizeof(pi->handles_inline));
+   bzero(pi->handles_bmp_inline, sizeof(pi->handles_bmp_inline));
+}
+
+void free_fd_table(struct process *pi)
+{
+   if (!is_fd_table_inline(pi))
+      kfree2(pi->handles, fd_table_alloc_size(pi->handles_cap));
+
+   init_fd_table(pi);
+}
+
+int grow_fd_table(struct process *pi, u32 min_cap)
+{
+   const u32 old_cap = pi->handles_cap;
+   u32 new_cap = old_cap;
+   fs_handle *new_handles;
+   ulong *new_bmp;
+
+   if (min_cap <= old_cap)
+      return 0;
+
+   if (min_cap > KRN_NOFILE_MAX)
+      return -EMFILE;
+
+   while (new_cap < min_cap)
+      new_cap *= 2;
+
+   new_cap = MIN(new_cap, (u32)KRN_NOFILE_MAX);
+
+   if (!(new_handles = kzmalloc(fd_table_alloc_size(new_cap))))
+      return -ENOMEM;
+
+   new_bmp = (ulong *)(new_handles + new_cap);
+   memcpy(new_handles, pi->handles, old_cap * sizeof(fs_handle));
+   memcpy(new_bmp, pi->handles_bmp, FD_BMP_WORDS(old_cap) * sizeof(ulong));
+
+   if (!is_fd_table_inline(pi))
+      kfree2(pi->handles, fd_table_alloc_size(old_cap));
+
+   pi->handles = new_handles;
+   pi->handles_bmp = new_bmp;
+   pi->handles_cap = new_cap;
+   return 0;
+}
+
+/*
+ * Returns the lowest free slot >= `ge` in the current table or `handles_cap`
+ * when there are no such free slots.
+ */
+static u32 find_free_slot_ge(struct process *pi, u32 ge)
+{
+   const u32 cap = pi->handles_cap;
+   const u32 words = FD_BMP_WORDS(cap);
+   u32 w = ge / NBITS;
+   ulong val;
+
+   if (ge >= cap)
+      return cap;
+
+   /* Pretend that all the slots before `ge` are used */
+   val = pi->handles_bmp[w] | ((1UL << (ge % NBITS)) - 1);
+
+   while (val == ~0UL) {
+
+      if (++w == words)
+         return cap;
+
+      val = pi->handles_bmp[w];
+   }
+
+   return MIN(w * NBITS + get_first_zero_bit_index_l(val), cap);
+}
+
+/*
+ * Returns the lowest free fd >= `ge`, growing the table if necessary, or
+ * -EMFILE when such fd would not be below the RLIMIT_NOFILE soft limit.
+ */
+int get_free_handle_num_ge(struct process *pi, int ge)
+{
+   const u32 limit = get_nofile_limit(pi);
+   u32 fd;
+   int rc;
+
+   ASSERT(kmutex_is_curr_task_holding_lock(&pi->fslock));
+   ASSERT(ge >= 0);
+
+   fd = find_free_slot_ge(pi, (u32)ge);
+
+   if (fd == pi->handles_cap)
+      fd = MAX(fd, (u32)ge);
+
+   if (fd >= limit)
+      return -EMFILE;
+
+   if ((rc = grow_fd_table(pi, fd + 1)))
+      return rc;
+
+   return (int)fd;
+}
+
+void set_fs_handle(struct process *pi, int fd, fs_handle h)
+{
+   const u32 w = (u32)fd / NBITS;
+   const ulong bit = 1UL << ((u32)fd % NBITS);
+
+   ASSERT((u32)fd < pi->handles_cap);
+   pi->handles[fd] = h;
+
+   if (h)
+      pi->handles_bmp[w] |= bit;
+   else
+      pi->handles_bmp[w] &= ~bit;
+}
+
+/*
+ * Returns the highest used fd + 1 or 0 if no fds are open.
+ */
+u32 get_fd_table_end(struct process *pi)
+{
+   for (u32 w = FD_BMP_WORDS(pi->handles_cap); w > 0; w--) {
+
+      const ulong val = pi->handles_bmp[w - 1];
+
+      if (val)
+         return (w - 1) * NBITS + (NBITS - (u32)__builtin_clzl(val));
+   }
+
+   return 0;
+}
@@ -6,26 +6,29 @@
 #include <tilck/kernel/hal.h>
 #include <tilck/kernel/fs/vfs.h>
 #include <tilck/kernel/fs/kernelfs.h>
+#include <tilck/kernel/fs/blkdev.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/user.h>
 #include <tilck/kernel/fault_resumable.h>
 #include <tilck/kernel/syscalls.h>
 #include <tilck/kernel/pipe.h>
 
-static inline bool is_fd_in_valid_range(int fd)
+#ifndef CLOSE_RANGE_UNSHARE
+   #define CLOSE_RANGE_UNSHARE      (1U << 1)
+#endif
+
+#ifndef CLOSE_RANGE_CLOEXEC
+   #define CLOSE_RANGE_CLOEXEC      (1U << 2)
+#endif
+
+static inline bool is_fd_in_table(struct process *pi, int fd)
 {
-   return IN_RANGE(fd, 0, KRN_MAX_HANDLES);
+   return IN_RANGE(fd, 0, (int)pi->handles_cap);
 }
 
-static int get_free_handle_num_ge(struct process *pi, int ge)
+static inline bool is_fd_below_limit(struct process *pi, int fd)
 {
-   ASSERT(kmutex_is_curr_task_holding_lock(&pi->fslock));
-
-   for (int free_fd = ge; free_fd < KRN_MAX_HANDLES; free_fd++)
-      if (!pi->handles[free_fd])
-         return free_fd;
-
-   return -1;
+   return fd >= 0 && (u32)fd < get_nofile_limit(pi);
 }
 
 static int get_free_handle_num(struct process *pi)
@@ -48,7 +51,7 @@ fs_handle get_fs_handle(int fd)
 
    kmutex_lock(&curr->pi->fslock);
 
-   if (is_fd_in_valid_range(fd) && curr->pi->handles[fd])
+   if (is_fd_in_table(curr->pi, fd))
       handle = curr->pi->handles[fd];
 
    kmutex_unlock(&curr->pi->fslock);
@@ -85,24 +88,20 @@ int sys_open(const char *u_path, int flags, mode_t mode)
 
    kmutex_lock(&curr->pi->fslock);
 
-   if ((free_fd = get_free_handle_num(curr->pi)) < 0)
-      goto no_fds;
+   if ((ret = free_fd = get_free_handle_num(curr->pi)) < 0)
+      goto end;
 
    if ((ret = vfs_open(path, &h, flags, mode)) < 0)
       goto end;
 
    ASSERT(h != NULL);
 
-   curr->pi->handles[free_fd] = h;
+   set_fs_handle(curr->pi, free_fd, h);
    ret = free_fd;
 
 end:
    kmutex_unlock(&curr->pi->fslock);
    return ret;
-
-no_fds:
-   ret = -EMFILE;
-   goto end;
 }
 
 long sys_openat(int dfd, const char *u_path, int flags, mode_t mode)
@@ -170,7 +169,7 @@ int sys_close(int fd)
    kmutex_lock(&curr->pi->fslock);
    {
       vfs_close(handle);
-      curr->pi->handles[fd] = NULL;
+      set_fs_handle(curr->pi, fd, NULL);
    }
    kmutex_unlock(&curr->pi->fslock);
    return ret;
@@ -680,10 +679,7 @@ int sys_dup2(int oldfd, int newfd)
    fs_handle old_h, new_h;
    struct task *curr = get_curr_task();
 
-   if (!is_fd_in_valid_range(oldfd))
-      return -EBADF;
-
-   if (!is_fd_in_valid_range(newfd))
+   if (!is_fd_below_limit(curr->pi, newfd))
       return -EBADF;
 
    if (newfd == oldfd)
@@ -696,6 +692,9 @@ int sys_dup2(int oldfd, int newfd)
       goto out;
    }
 
+   if ((rc = grow_fd_table(curr->pi, (u32)newfd + 1)))
+      goto out;
+
    new_h = get_fs_handle(newfd);
 
    if (new_h) {
@@ -707,6 +706,7 @@ int sys_dup2(int oldfd, int newfd)
        * reusing it.
        */
       vfs_close(new_h);
+      set_fs_handle(curr->pi, newfd, NULL);
       new_h = NULL;
    }
 
@@ -732,7 +732,7 @@ int sys_dup2(int oldfd, int newfd)
       goto out;
    }
 
-   curr->pi->handles[newfd] = new_h;
+   set_fs_handle(curr->pi, newfd, new_h);
    rc = newfd;
 
 out:
@@ -752,15 +752,13 @@ long sys_dup3(int oldfd, int newfd, int flags)
 
 int sys_dup(int oldfd)
 {
-   int rc = -EMFILE, free_fd;
+   int rc;
    struct process *pi = get_curr_proc();
 
    kmutex_lock(&pi->fslock);
    {
-      free_fd = get_free_handle_num(pi);
-
-      if (is_fd_in_valid_range(free_fd))
-         rc = sys_dup2(oldfd, free_fd);
+      if ((rc = get_free_handle_num(pi)) >= 0)
+         rc = sys_dup2(oldfd, rc);
    }
    kmutex_unlock(&pi->fslock);
    return rc;
@@ -809,19 +807,55 @@ void close_cloexec_handles(struct process *pi)
 {
    kmutex_lock(&pi->fslock);
 
-   for (u32 i = 0; i < KRN_MAX_HANDLES; i++) {
+   for (u32 i = 0, end = get_fd_table_end(pi); i < end; i++) {
 
       struct fs_handle_base *h = pi->handles[i];
 
       if (h && (h->fd_flags & FD_CLOEXEC)) {
          vfs_close(h);
-         pi->handles[i] = NULL;
+         set_fs_handle(pi, (int)i, NULL);
       }
    }
 
    kmutex_unlock(&pi->fslock);
 }
 
+int sys_close_range(u32 first, u32 last, u32 flags)
+{
+   struct process *pi = get_curr_proc();
+
+   if (first > last)
+      return -EINVAL;
+
+   if (flags & ~(CLOSE_RANGE_UNSHARE | CLOSE_RANGE_CLOEXEC))
+      return -EINVAL;
+
+   /*
+    * CLOSE_RANGE_UNSHARE is a no-op: Tilck has no CLONE_FILES, therefore the
+    * fd table is never shared with other processes.
+    */
+
+   kmutex_lock(&pi->fslock);
+
+   for (u32 i = first, end = get_fd_table_end(pi); i < end && i <= last; i++) {
+
+      struct fs_handle_base *h = pi->handles[i];
+
+      if (!h)
+         continue;
+
+      if (flags & CLOSE_RANGE_CLOEXEC) {
+         h->fd_flags |= FD_CLOEXEC;
+      } else {
+         vfs_close(h);
+         set_fs_handle(pi, (int)i, NULL);
+      }
+   }
+
+   kmutex_unlock(&pi->fslock);
+   return 0;
+}
+
 int sys_fcntl64(int fd, int cmd, int arg)
 {
    int rc = 0;
@@ -835,20 +869,31 @@ int sys_fcntl64(int fd, int cmd, int arg)
 
       case F_DUPFD:
          {
+            if (!is_fd_below_limit(curr->pi, arg))
+               return -EINVAL;
+
             kmutex_lock(&curr->pi->fslock);
-            int new_fd = get_free_handle_num_ge(curr->pi, arg);
-            rc = sys_dup2(fd, new_fd);
+
+            if ((rc = get_free_handle_num_ge(curr->pi, arg)) >= 0)
+               rc = sys_dup2(fd, rc);
+
             kmutex_unlock(&curr->pi->fslock);
             return rc;
          }
 
       case F_DUPFD_CLOEXEC:
          {
+            if (!is_fd_below_limit(curr->pi, arg))
+               return -EINVAL;
+
             kmutex_lock(&curr->pi->fslock);
-            int new_fd = get_free_handle_num_ge(curr->pi, arg);
-            if (!(rc = sys_dup2(fd, new_fd))) {
+
+            if ((rc = get_free_handle_num_ge(curr->pi, arg)) >= 0)
+               rc = sys_dup2(fd, rc);
+
+            if (rc >= 0) {
                /* dup2 succeeded */
-               struct fs_handle_base *h2 = get_fs_handle(new_fd);
+               struct fs_handle_base *h2 = get_fs_handle(rc);
                ASSERT(h2 != NULL);
                h2->fd_flags |= FD_CLOEXEC;
             }
@@ -984,6 +1029,7 @@ int sys_syncfs(int fd)
 int sys_sync(void)
 {
    vfs_sync();
+   blkdev_sync(NULL);
    return 0;
 }
 
@@ -1131,21 +1177,22 @@ int sys_pipe2(int u_pipefd[2], int flags)
       goto no_mem;
    }
 
-   if ((fds[0] = get_free_handle_num(curr->pi)) < 0)
-      goto no_fds;
+   if ((ret = fds[0] = get_free_handle_num(curr->pi)) < 0)
+      goto err_end;
 
    if (!(read_h = pipe_create_read_handle(p)))
       goto fault;
 
-   curr->pi->handles[fds[0]] = read_h;
+   set_fs_handle(curr->pi, fds[0], read_h);
 
-   if ((fds[1] = get_free_handle_num(curr->pi)) < 0)
-      goto no_fds;
+   if ((ret = fds[1] = get_free_handle_num(curr->pi)) < 0)
+      goto err_end;
 
    if (!(write_h = pipe_create_write_handle(p)))
       goto fault;
 
-   curr->pi->handles[fds[1]] = write_h;
+   set_fs_handle(curr->pi, fds[1], write_h);
+   ret = 0;
 
    if (copy_to_user(u_pipefd, fds, sizeof(fds)))
       goto fault;
@@ -1162,12 +1209,12 @@ end:
 err_end:
 
    if (read_h) {
-      curr->pi->handles[fds[0]] = NULL;
+      set_fs_handle(curr->pi, fds[0], NULL);
       kfs_destroy_handle((void *)read_h);
    }
 
    if (write_h) {
-      curr->pi->handles[fds[1]] = NULL;
+      set_fs_handle(curr->pi, fds[1], NULL);
       kfs_destroy_handle((void *)write_h);
    }
 
@@ -1184,9 +1231,5 @@ fault:
 no_mem:
    ret = -ENOMEM;
    goto err_end;
-
-no_fds:
-   ret = -EMFILE;
-   goto err_end;
 }
 
@@ -1,10 +1,52 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/cmdline.h>
 #include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/fat32.h>
+#include <tilck/kernel/fs/blkdev.h>
+#include <tilck/kernel/process.h>
 #include <tilck/kernel/syscalls.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/errno.h>
+
+#include <linux/fs.h>         // system header
 
 #include "fs_int.h"
 
+static struct block_dev *get_block_dev_at(const char *path, int *err)
+{
+   struct block_dev *bdev;
+   fs_handle h;
+   int rc;
+
+   if ((rc = vfs_open(path, &h, O_RDONLY, 0))) {
+      *err = rc;
+      return NULL;
+   }
+
+   /*
+    * It's fine to close the handle right away: the block devices are never
+    * unregistered.
+    */
+   bdev = get_block_dev_from_handle(h);
+   vfs_close(h);
+
+   if (!bdev)
+      *err = -ENOTBLK;
+
+   return bdev;
+}
+
+/*
+ * At the moment, only FAT filesystems on block devices can be mounted. They're
+ * read-only unless the kernel has been booted with -blkdev_rw (-brw): in that
+ * case, without MS_RDONLY they're mounted in r/w mode, but files cannot be
+ * removed or renamed (see fat32_rw.c). Otherwise, without MS_RDONLY we fail
+ * with -EROFS like Linux does for read-only media, so that tools like
+ * busybox's mount retry in read-only mode.
+ */
 int
 sys_mount(const char *user_source,
           const char *user_target,
@@ -12,7 +54,47 @@ sys_mount(const char *user_source,
           unsigned long mountflags,
           const void *user_data)
 {
-   return -ENOSYS;
+   struct task *curr = get_curr_task();
+   char *source = curr->args_copybuf;
+   char *target = curr->args_copybuf + MAX_PATH;
+   char fstype[16];
+   struct block_dev *bdev;
+   struct mnt_fs *fs;
+   u32 fs_flags;
+   int rc, rc1, rc2, rc3;
+
+   STATIC_ASSERT(ARGS_COPYBUF_SIZE >= 2 * MAX_PATH);
+
+   rc1 = copy_str_from_user(source, user_source, MAX_PATH, NULL);
+   rc2 = copy_str_from_user(target, user_target, MAX_PATH, NULL);
+   rc3 = copy_str_from_user(fstype, user_fstype, sizeof(fstype), NULL);
+
+   if (rc1 < 0 || rc2 < 0 || rc3 < 0)
+      return -EFAULT;
+
+   if (rc1 > 0 || rc2 > 0)
+      return -ENAMETOOLONG;
+
+   if (rc3 > 0 || (strcmp(fstype, "vfat") && strcmp(fstype, "fat")))
+      return -ENODEV;
+
+   if (!(mountflags & MS_RDONLY) && !kopt_blkdev_rw)
+      return -EROFS;
+
+   if (!(bdev = get_block_dev_at(source, &rc)))
+      return rc;
+
+   fs_flags = (mountflags & MS_RDONLY) ? 0 : VFS_FS_RW;
+
+   if (!(fs = fat_mount_blkdev(bdev, fs_flags, &rc)))
+      return rc;
+
+   if ((rc = mp_add(fs, target))) {
+      fat_umount_blkdev(fs);
+      return rc;
+   }
+
+   return 0;
 }
 
 int sys_umount(const char *target, int flags)
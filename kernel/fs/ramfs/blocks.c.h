@@ -11,7 +11,7 @@ static struct ramfs_block *ramfs_new_block(offt page)
       return NULL;
 
    /* Allocate block's data */
-   if (!(b->vaddr = kzmalloc(PAGE_SIZE))) {
+   if (!(b->vaddr = alloc_pageframe(PAGE_ALLOC_FL_ZERO))) {
       kfree_obj(b, struct ramfs_block);
       return NULL;
    }
@@ -31,7 +31,7 @@ static void ramfs_destroy_block(struct ramfs_block *b)
    release_pageframes_mapped_at(get_kernel_pdir(), b->vaddr, PAGE_SIZE);
 
    /* Free the memory pointed by this block */
-   kfree2(b->vaddr, PAGE_SIZE);
+   free_pageframe(b->vaddr);
 
    /* Free the memory used by the block object itself */
    kfree_obj(b, struct ramfs_block);
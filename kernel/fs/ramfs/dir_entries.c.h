@@ -2,18 +2,120 @@
 
 #include "ramfs_int.h"
 
-static long ramfs_insert_remove_entry_cmp(const void *a, const void *b)
+#define RAMFS_DIR_MIN_ORDER                                  2
+#define RAMFS_DIR_MAX_ORDER                                 16
+#define RAMFS_DIR_MAX_LOAD                                   2
+
+/*
+ * FNV-1a hash of the name, except for "." and "..", which have hash 0: being
+ * also the first two entries added to any directory, they get the keys 0 and
+ * 1 and getdents() always returns them first, as applications expect.
+ */
+static u32 ramfs_name_hash(const char *name, size_t len)
+{
+   u32 h = 2166136261u;
+
+   if (name[0] == '.' && (len == 1 || (len == 2 && name[1] == '.')))
+      return 0;
+
+   for (size_t i = 0; i < len; i++) {
+      h ^= (u8)name[i];
+      h *= 16777619u;
+   }
+
+   return h;
+}
+
+static inline u32 ramfs_bucket_of(struct ramfs_inode *idir, u32 hash)
+{
+   return hash >> (32 - idir->buckets_order);
+}
+
+static int ramfs_dir_alloc_buckets(struct ramfs_inode *idir)
+{
+   const u32 n = 1u << RAMFS_DIR_MIN_ORDER;
+
+   if (!(idir->buckets = kzalloc_array_obj(struct ramfs_entry *, n)))
+      return -ENOMEM;
+
+   idir->buckets_order = RAMFS_DIR_MIN_ORDER;
+   return 0;
+}
+
+static void ramfs_dir_free_buckets(struct ramfs_inode *idir)
+{
+   const u32 n = 1u << idir->buckets_order;
+
+   kfree_array_obj(idir->buckets, struct ramfs_entry *, n);
+   idir->buckets = NULL;
+   idir->buckets_order = 0;
+}
+
+/*
+ * Doubles the number of buckets: because the bucket index is made by the top
+ * bits of the hash, each bucket B splits in 2*B and 2*B+1, preserving the
+ * order of the entries in both the chains.
+ */
+static void ramfs_dir_grow(struct ramfs_inode *idir)
 {
-   const struct ramfs_entry *e1 = a;
-   const struct ramfs_entry *e2 = b;
-   return strcmp(e1->name, e2->name);
+   const u32 old_n = 1u << idir->buckets_order;
+   const u32 order = idir->buckets_order + 1;
+   struct ramfs_entry **nb, **tails[2], *e, *next;
+
+   if (!(nb = kzalloc_array_obj(struct ramfs_entry *, 2 * old_n)))
+      return;     /* Not a problem: we'll just have longer chains */
+
+   for (u32 i = 0; i < old_n; i++) {
+
+      tails[0] = &nb[2 * i];
+      tails[1] = &nb[2 * i + 1];
+
+      for (e = idir->buckets[i]; e; e = next) {
+
+         const u32 half = (e->hash >> (32 - order)) & 1;
+
+         next = e->next;
+         e->next = NULL;
+         *tails[half] = e;
+         tails[half] = &e->next;
+      }
+   }
+
+   kfree_array_obj(idir->buckets, struct ramfs_entry *, old_n);
+   idir->buckets = nb;
+   idir->buckets_order = order;
 }
 
-static long ramfs_find_entry_cmp(const void *obj, const void *valptr)
+/*
+ * Links `e` in its bucket, keeping the chain sorted by key: the entry takes
+ * the first discriminator not used by the other entries with the same key
+ * prefix. NOTE: only an absurd number of names with the same 22-bit hash
+ * prefix can make this fail.
+ */
+static int ramfs_dir_link_entry(struct ramfs_inode *idir, struct ramfs_entry *e)
 {
-   const struct ramfs_entry *e = obj;
-   const char *searched_str = valptr;
-   return strcmp(e->name, searched_str);
+   const u32 prefix = ramfs_key_prefix(e->hash);
+   struct ramfs_entry **pp = &idir->buckets[ramfs_bucket_of(idir, e->hash)];
+   u32 disc;
+
+   while (*pp && ramfs_key_prefix((*pp)->hash) < prefix)
+      pp = &(*pp)->next;
+
+   for (disc = 0; *pp && ramfs_key_prefix((*pp)->hash) == prefix; disc++) {
+
+      if ((*pp)->disc != disc)
+         break;      /* found a hole */
+
+      pp = &(*pp)->next;
+   }
+
+   if (disc > RAMFS_KEY_DISC_MAX)
+      return -ENOSPC;
+
+   e->disc = (u8) disc;
+   e->next = *pp;
+   *pp = e;
+   return 0;
 }
 
 static int
@@ -28,71 +130,77 @@ ramfs_dir_add_entry(struct ramfs_inode *idir,
    if (enl == 1)
       return -ENOENT;
 
-   if (enl > sizeof(e->name))
+   if (iname[enl-2] == '/')
+      enl--;            /* drop the trailing slash */
+
+   if (enl > RAMFS_ENTRY_MAX_LEN)
       return -ENAMETOOLONG;
 
-   if (!(e = kalloc_obj(struct ramfs_entry)))
+   if (!idir->buckets && ramfs_dir_alloc_buckets(idir))
       return -ENOSPC;
 
    ASSERT(ie->parent_dir != NULL);
 
-   bintree_node_init(&e->node);
-   list_node_init(&e->lnode);
+   if (!(e = kmalloc(sizeof(struct ramfs_entry) + enl)))
+      goto oom;
 
    e->inode = ie;
-   memcpy(e->name, iname, enl);
-
-   if (e->name[enl-2] == '/') {
-      e->name[enl-2] = 0; /* drop the trailing slash */
-      enl--;
-   }
-
    e->name_len = (u8) enl;
+   memcpy(e->name, iname, enl - 1);
+   e->name[enl - 1] = 0;
+   e->hash = ramfs_name_hash(e->name, enl - 1);
 
-   bintree_insert(&idir->entries_tree_root,
-                  e,
-                  ramfs_insert_remove_entry_cmp,
-                  struct ramfs_entry,
-                  node);
-
-   list_add_tail(&idir->entries_list, &e->lnode);
+   if (ramfs_dir_link_entry(idir, e)) {
+      kfree2(e, ramfs_entry_size(e));
+      goto oom;
+   }
 
    ie->nlink++;
    idir->num_entries++;
+
+   if (idir->num_entries > RAMFS_DIR_MAX_LOAD << idir->buckets_order &&
+       idir->buckets_order < RAMFS_DIR_MAX_ORDER)
+   {
+      ramfs_dir_grow(idir);
+   }
+
    return 0;
+
+oom:
+   if (!idir->num_entries)
+      ramfs_dir_free_buckets(idir);
+
+   return -ENOSPC;
 }
 
 static void
 ramfs_dir_remove_entry(struct ramfs_inode *idir, struct ramfs_entry *e)
 {
-   struct ramfs_handle *pos;
    struct ramfs_inode *ie = e->inode;
+   struct ramfs_entry **pp;
    ASSERT(idir->type == VFS_DIR);
 
    /*
-    * Before removing this entry, we have to check if, among the handles opened
-    * for `idir`, there are any having dpos == e. For each one of them, we have
-    * to move `dpos` forward, before removing the entry `e`.
+    * NOTE: the open handles of `idir` don't need to be touched: their position
+    * is a key, not a pointer to an entry (see ramfs_getdents()).
     */
 
-   list_for_each_ro(pos, &idir->handles_list, node) {
+   pp = &idir->buckets[ramfs_bucket_of(idir, e->hash)];
 
-      if (pos->dpos == e)
-         pos->dpos = list_next_obj(pos->dpos, lnode);
+   while (*pp != e) {
+      ASSERT(*pp != NULL);
+      pp = &(*pp)->next;
    }
 
-   bintree_remove(&idir->entries_tree_root,
-                  e,
-                  ramfs_insert_remove_entry_cmp,
-                  struct ramfs_entry,
-                  node);
-
-   list_remove(&e->lnode);
+   *pp = e->next;
 
    ASSERT(ie->nlink > 0);
    ie->nlink--;
-   idir->num_entries--;
-   kfree_obj(e, struct ramfs_entry);
+
+   if (!--idir->num_entries)
+      ramfs_dir_free_buckets(idir);
+
+   kfree2(e, ramfs_entry_size(e));
 }
 
 static struct ramfs_entry *
@@ -100,13 +208,64 @@ ramfs_dir_get_entry_by_name(struct ramfs_inode *idir,
                             const char *name,
                             ssize_t len)
 {
-   char buf[RAMFS_ENTRY_MAX_LEN];
-   memcpy(buf, name, (size_t) len);
-   buf[len] = 0;
-
-   return bintree_find(idir->entries_tree_root,
-                       buf,
-                       ramfs_find_entry_cmp,
-                       struct ramfs_entry,
-                       node);
+   const u32 hash = ramfs_name_hash(name, (size_t) len);
+   struct ramfs_entry *e;
+
+   if (!idir->buckets)
+      return NULL;
+
+   for (e = idir->buckets[ramfs_bucket_of(idir, hash)]; e; e = e->next) {
+
+      if (e->hash == hash &&
+          e->name_len == len + 1 &&
+          !memcmp(e->name, name, (size_t) len))
+      {
+         return e;
+      }
+   }
+
+   return NULL;
+}
+
+static struct ramfs_entry *
+ramfs_dir_first_in_buckets(struct ramfs_inode *idir, u32 b)
+{
+   const u32 n = 1u << idir->buckets_order;
+
+   for (; b < n; b++) {
+      if (idir->buckets[b])
+         return idir->buckets[b];
+   }
+
+   return NULL;
+}
+
+/* Returns the first entry having key >= `key`, or NULL */
+static struct ramfs_entry *
+ramfs_dir_first_entry_from(struct ramfs_inode *idir, offt key)
+{
+   struct ramfs_entry *e;
+   u32 b;
+
+   if (!idir->buckets || key >= (1 << 30))
+      return NULL;
+
+   /* Rebuild the top bits of the hash from the key's prefix */
+   b = ramfs_bucket_of(idir, ((u32) key >> RAMFS_KEY_DISC_BITS) << 10);
+
+   for (e = idir->buckets[b]; e; e = e->next) {
+      if (ramfs_entry_key(e) >= key)
+         return e;
+   }
+
+   return ramfs_dir_first_in_buckets(idir, b + 1);
+}
+
+static struct ramfs_entry *
+ramfs_dir_next_entry(struct ramfs_inode *idir, struct ramfs_entry *e)
+{
+   if (e->next)
+      return e->next;
+
+   return ramfs_dir_first_in_buckets(idir, ramfs_bucket_of(idir, e->hash) + 1);
 }
@@ -6,6 +6,7 @@ static int ramfs_getdents(fs_handle h, get_dents_func_cb cb, void *arg)
 {
    struct ramfs_handle *rh = h;
    struct ramfs_inode *inode = rh->inode;
+   struct ramfs_entry *e;
    int rc = 0;
 
    if (inode->type != VFS_DIR)
@@ -14,13 +15,21 @@ static int ramfs_getdents(fs_handle h, get_dents_func_cb cb, void *arg)
    if ((inode->mode & 0400) != 0400) /* read permission */
       return -EACCES;
 
-   list_for_each_ro_kp(rh->dpos, &inode->entries_list, lnode) {
+   /*
+    * The position is the key of the next entry to return: looking for it
+    * costs a hash lookup and keeps working when entries are added or removed
+    * between two getdents() calls.
+    */
+   e = ramfs_dir_first_entry_from(inode, rh->dir_pos);
+
+   for (; e; e = ramfs_dir_next_entry(inode, e)) {
 
       struct vfs_dent64 dent = {
-         .ino        = rh->dpos->inode->ino,
-         .type       = rh->dpos->inode->type,
-         .name_len   = rh->dpos->name_len,
-         .name       = rh->dpos->name,
+         .ino        = e->inode->ino,
+         .type       = e->inode->type,
+         .name_len   = e->name_len,
+         .name       = e->name,
+         .next_off   = (offt) ramfs_entry_key(e) + 1,
       };
 
       if ((rc = cb(&dent, arg)))
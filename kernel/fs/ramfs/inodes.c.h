@@ -11,7 +11,7 @@ static struct ramfs_inode *ramfs_new_inode(struct ramfs_data *d)
    if (!i)
       return NULL;
 
-   rwlock_wp_init(&i->rwlock, true);
+   rwlock_wp_init(&i->rwlock, RWLOCK_WP_FL_REC);
    list_init(&i->mappings_list);
 
    i->type = VFS_NONE;
@@ -36,8 +36,6 @@ ramfs_create_inode_dir(struct ramfs_data *d,
 
    i->type = VFS_DIR;
    i->mode = (mode & 0777) | S_IFDIR;
-   list_init(&i->entries_list);
-   list_init(&i->handles_list);
 
    if (!parent) {
       /* root case */
@@ -53,8 +51,7 @@ ramfs_create_inode_dir(struct ramfs_data *d,
 
    if (ramfs_dir_add_entry(i, "..", parent) < 0) {
 
-      struct ramfs_entry *e = i->entries_tree_root;
-      ramfs_dir_remove_entry(i, e);
+      ramfs_dir_remove_entry(i, ramfs_dir_get_entry_by_name(i, ".", 1));
 
       kfree_obj(i, struct ramfs_inode);
       return NULL;
@@ -105,7 +102,7 @@ static int ramfs_destroy_inode(struct ramfs_data *d, struct ramfs_inode *i)
          break;
 
       case VFS_DIR:
-         ASSERT(i->entries_tree_root == NULL);
+         ASSERT(i->buckets == NULL);
          break;
 
       case VFS_SYMLINK:
@@ -30,27 +30,12 @@ ramfs_open_int(struct mnt_fs *fs,
    h->spec_flags = VFS_SPFL_MMAP_SUPPORTED;
    retain_obj(inode);
 
-   if (inode->type == VFS_DIR) {
-
-      /*
-       * If we're opening a directory, register its handle in inode's handles
-       * list so that if unlink() is called on an entry E and there are open
-       * handles to E's parent-dir where h->dpos == E, their dpos is moved
-       * forward. This is a VERY CORNER CASE, but it *MUST BE* handled.
-       */
-      list_node_init(&h->node);
-      list_add_tail(&inode->handles_list, &h->node);
-      h->dpos = list_first_obj(&inode->entries_list, struct ramfs_entry, lnode);
+   if (inode->type != VFS_DIR && (fl & O_TRUNC)) {
 
-   } else {
-
-      if (fl & O_TRUNC) {
+      DEBUG_ONLY_UNSAFE(int rc =)
+         ramfs_inode_truncate_safe(inode, 0, false);
 
-         DEBUG_ONLY_UNSAFE(int rc =)
-            ramfs_inode_truncate_safe(inode, 0, false);
-
-         ASSERT(rc == 0);
-      }
+      ASSERT(rc == 0);
    }
 
    *out = h;
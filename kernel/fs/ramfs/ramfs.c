@@ -52,17 +52,6 @@ static int ramfs_unlink(struct vfs_path *p)
    return 0;
 }
 
-static void ramfs_on_close(fs_handle h)
-{
-   struct ramfs_handle *rh = h;
-   struct ramfs_inode *i = rh->inode;
-
-   if (i->type == VFS_DIR) {
-      /* Remove this handle from h->inode->handles_list */
-      list_remove(&rh->node);
-   }
-}
-
 static void ramfs_on_close_last_handle(fs_handle h)
 {
    struct ramfs_handle *rh = h;
@@ -304,7 +293,6 @@ static const struct fs_ops static_fsops_ramfs =
 {
    .get_inode = ramfs_getinode,
    .open = ramfs_open,
-   .on_close = ramfs_on_close,
    .on_close_last_handle = ramfs_on_close_last_handle,
    .getdents = ramfs_getdents,
    .unlink = ramfs_unlink,
@@ -343,7 +331,7 @@ struct mnt_fs *ramfs_create(void)
       return NULL;
    }
 
-   rwlock_wp_init(&d->rwlock, false);
+   rwlock_wp_init(&d->rwlock, 0);
    d->next_inode_num = 1;
    d->root = ramfs_create_inode_dir(d, 0777, NULL);
 
@@ -19,8 +19,10 @@
 #include <tilck/kernel/datetime.h>
 #include <tilck/kernel/bintree.h>
 #include <tilck/kernel/paging.h>
+#include <tilck/kernel/page_alloc.h>
 #include <tilck/kernel/process_mm.h>
 #include <tilck/kernel/process.h>
+#include <tilck/kernel/hal.h>
 
 #include <tilck/kernel/test/vfs.h>
 
@@ -37,30 +39,47 @@ struct ramfs_block {
 };
 
 /*
- * Ramfs entries do not *necessarily* need to have a fixed size, as they are
- * allocated dynamically on the heap. Said that, a fixed-size entry struct is
- * simpler to manage and faster to alloc/free, in particular with Tilck's
- * current kmalloc implementation.
+ * Ramfs entries are allocated with exactly the size they need: the header
+ * below plus the name. Each directory indexes its entries with a resizable
+ * hash table (see dir_entries.c.h), using the top bits of the name's hash as
+ * bucket index. Each chain is sorted by entry key (see ramfs_entry_key()):
+ * that way, walking the buckets in order visits the entries in key order and
+ * the keys can be used as getdents positions, stable across inserts.
  */
-#define RAMFS_ENTRY_SIZE 256
-#define RAMFS_ENTRY_MAX_LEN (                   \
-   RAMFS_ENTRY_SIZE                             \
-   - sizeof(struct bintree_node)                \
-   - sizeof(struct list_node)                   \
-   - sizeof(struct ramfs_inode *)               \
-   - sizeof(u8)                                 \
-)
+#define RAMFS_ENTRY_MAX_LEN                         255  /* including the \0 */
+#define RAMFS_KEY_DISC_BITS                           8
+#define RAMFS_KEY_DISC_MAX       ((1u << RAMFS_KEY_DISC_BITS) - 1)
 
 struct ramfs_entry {
 
-   struct bintree_node node;
-   struct list_node lnode;
+   struct ramfs_entry *next;        /* next entry in the same bucket */
    struct ramfs_inode *inode;
+   u32 hash;                        /* see ramfs_name_hash() */
+   u8 disc;                         /* see ramfs_entry_key() */
    u8 name_len;                     /* NOTE: includes the final \0 */
-   char name[RAMFS_ENTRY_MAX_LEN];
+   char name[];
 };
 
-STATIC_ASSERT(sizeof(struct ramfs_entry) == RAMFS_ENTRY_SIZE);
+static inline u32 ramfs_key_prefix(u32 hash)
+{
+   return hash >> 10;
+}
+
+/*
+ * The position of an entry in its directory: the top 22 bits of the hash,
+ * followed by a discriminator, unique among the entries with the same prefix.
+ * Keys are < 2^30 because userspace (telldir(), on 32-bit) must see them as
+ * positive `long` values, even after adding 1 to them (see ramfs_getdents()).
+ */
+static inline u32 ramfs_entry_key(struct ramfs_entry *e)
+{
+   return ramfs_key_prefix(e->hash) << RAMFS_KEY_DISC_BITS | e->disc;
+}
+
+static inline size_t ramfs_entry_size(struct ramfs_entry *e)
+{
+   return sizeof(struct ramfs_entry) + e->name_len;
+}
 
 struct ramfs_inode {
 
@@ -90,9 +109,8 @@ struct ramfs_inode {
       /* valid when type == VFS_DIR */
       struct {
          offt num_entries;
-         struct ramfs_entry *entries_tree_root;
-         struct list entries_list;
-         struct list handles_list;
+         struct ramfs_entry **buckets;    /* NULL when there are no entries */
+         u32 buckets_order;               /* log2 of the number of buckets */
       };
 
       /* valid when type == VFS_SYMLINK */
@@ -112,14 +130,11 @@ struct ramfs_handle {
    /* struct fs_handle_base */
    FS_HANDLE_BASE_FIELDS
 
-   /* ramfs-specific fields */
+   /*
+    * ramfs-specific fields. NOTE: for directories, `dir_pos` is the key of the
+    * next entry to return (see ramfs_entry_key()), not an index.
+    */
    struct ramfs_inode *inode;
-
-   /* valid only if inode->type == VFS_DIR */
-   struct {
-      struct list_node node;        /* node in inode->handles_list */
-      struct ramfs_entry *dpos;     /* current entry position */
-   };
 };
 
 STATIC_ASSERT(sizeof(struct ramfs_handle) <= MAX_FS_HANDLE_SIZE);
@@ -179,6 +194,17 @@ ramfs_dir_add_entry(struct ramfs_inode *idir,
 static void
 ramfs_dir_remove_entry(struct ramfs_inode *idir, struct ramfs_entry *e);
 
+static struct ramfs_entry *
+ramfs_dir_get_entry_by_name(struct ramfs_inode *idir,
+                            const char *name,
+                            ssize_t len);
+
+static struct ramfs_entry *
+ramfs_dir_first_entry_from(struct ramfs_inode *idir, offt key);
+
+static struct ramfs_entry *
+ramfs_dir_next_entry(struct ramfs_inode *idir, struct ramfs_entry *e);
+
 static struct ramfs_inode *
 ramfs_create_inode_dir(struct ramfs_data *d,
                        mode_t mode,
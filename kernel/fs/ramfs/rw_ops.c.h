@@ -9,21 +9,11 @@ static int ramfs_ioctl(fs_handle h, ulong cmd, void *argp)
 
 static offt ramfs_dir_seek(struct ramfs_handle *rh, offt target_off)
 {
-   struct ramfs_inode *i = rh->inode;
-   struct ramfs_entry *dpos;
-   offt off = 0;
-
-   list_for_each_ro(dpos, &i->entries_list, lnode) {
-
-      if (off == target_off) {
-         rh->dir_pos = off;
-         rh->dpos = dpos;
-         break;
-      }
-
-      off++;
-   }
-
+   /*
+    * Any position is valid: it's the key of the next entry to return and
+    * ramfs_getdents() will start from the first entry having key >= pos.
+    */
+   rh->dir_pos = target_off;
    return rh->dir_pos;
 }
 
@@ -287,10 +277,10 @@ ramfs_read_nolock(struct ramfs_handle *rh, char *buf, size_t len, offt *pos)
 
       if (block) {
          /* reading a regular block */
-         memcpy(buf + tot_read, block->vaddr + page_off, (size_t)to_read);
+         bulk_memcpy(buf + tot_read, block->vaddr + page_off, (size_t)to_read);
       } else {
          /* reading a hole */
-         memset(buf + tot_read, 0, (size_t)to_read);
+         bulk_bzero(buf + tot_read, (size_t)to_read);
       }
 
       tot_read += to_read;
@@ -354,7 +344,7 @@ ramfs_write_nolock(struct ramfs_handle *rh, char *buf, size_t len, offt *pos)
          ramfs_append_new_block(inode, block);
       }
 
-      memcpy(block->vaddr + page_off, buf + tot_written, (size_t)to_write);
+      bulk_memcpy(block->vaddr + page_off, buf + tot_written, (size_t)to_write);
       tot_written += to_write;
       buf_rem     -= to_write;
       *pos     += to_write;
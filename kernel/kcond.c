@@ -11,6 +11,7 @@ void kcond_init(struct kcond *c)
 {
    DEBUG_ONLY(check_not_in_irq_handler());
    list_init(&c->wait_list);
+   LOCKSTAT_ONLY(lockstat_init(&c->lstat, __builtin_return_address(0)));
 }
 
 bool kcond_is_anyone_waiting(struct kcond *c)
@@ -38,6 +39,7 @@ bool kcond_wait(struct kcond *c, struct kmutex *m, u32 timeout_ticks)
    ASSERT(!m || !(m->flags & KMUTEX_FL_RECURSIVE) || m->lock_count == 1);
 
    struct task *curr = get_curr_task();
+   LOCKSTAT_ONLY(const u64 wait_start = RDTSC());
    bool ret;
 
 panic_retry_hack:
@@ -82,6 +84,7 @@ panic_retry_hack:
     */
 
    ret = !wait_obj_reset(&curr->wobj);
+   LOCKSTAT_ONLY(lockstat_acquired(&c->lstat, LOCKSTAT_KCOND, wait_start));
 
    if (m) {
       kmutex_lock(m); // Re-acquire the lock [if any]
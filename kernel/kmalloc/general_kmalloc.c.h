@@ -49,8 +49,13 @@ main_heaps_kmalloc(size_t *size, u32 flags)
       if (heaps[i]->dma != !!(flags & KMALLOC_FL_DMA))
          continue;
 
+      const size_t req_size = *size;
+
       if ((vaddr = per_heap_kmalloc(heaps[i], size, flags))) {
 
+         if (KRN_KMALLOC_PROFILER && ~flags & KMALLOC_FL_DONT_ACCOUNT)
+            kmalloc_prof_account_heap(i, req_size, *size);
+
          if (KRN_KMALLOC_SUPPORT_LEAK_DETECTOR && leak_detector_enabled) {
             debug_kmalloc_register_alloc(vaddr, *size);
          }
@@ -102,7 +107,7 @@ main_heaps_kfree(void *ptr, size_t *size, u32 flags)
    return 0;
 }
 
-void *general_kmalloc(size_t *size, u32 flags)
+static void *__general_kmalloc(size_t *size, u32 flags, void *caller)
 {
    void *res;
    const u32 sub_block_sz = flags & KMALLOC_FL_SUB_BLOCK_MIN_SIZE_MASK;
@@ -121,6 +126,10 @@ void *general_kmalloc(size_t *size, u32 flags)
          ASSERT(~flags & KMALLOC_FL_DMA);
          res = small_heaps_kmalloc(size, flags);
 
+         if (KRN_KMALLOC_PROFILER && res && ~flags & KMALLOC_FL_DONT_ACCOUNT)
+            kmalloc_prof_account_heap(KMALLOC_PROF_SMALL_HEAPS,
+                                      orig_size, *size);
+
       } else {
 
          res = main_heaps_kmalloc(size, flags);
@@ -132,11 +141,20 @@ void *general_kmalloc(size_t *size, u32 flags)
       if (KRN_KMALLOC_HEAVY_STATS && res != NULL)
          if (~flags & KMALLOC_FL_DONT_ACCOUNT)
             kmalloc_account_alloc(orig_size);
+
+      if (KRN_KMALLOC_PROFILER && res != NULL)
+         if (!(flags & (KMALLOC_FL_DONT_ACCOUNT | KMALLOC_FL_MULTI_STEP)))
+            kmalloc_prof_alloc(res, orig_size, caller);
    }
    enable_preemption();
    return res;
 }
 
+void *general_kmalloc(size_t *size, u32 flags)
+{
+   return __general_kmalloc(size, flags, KMALLOC_PROF_CALLER());
+}
+
 void general_kfree(void *ptr, size_t *size, u32 flags)
 {
    int rc;
@@ -174,6 +192,9 @@ void general_kfree(void *ptr, size_t *size, u32 flags)
          if (rc)
             rc = main_heaps_kfree(ptr, size, flags);
       }
+
+      if (KRN_KMALLOC_PROFILER && !rc)
+         kmalloc_prof_free(ptr);
    }
    enable_preemption();
 
@@ -191,7 +212,7 @@ void general_kfree(void *ptr, size_t *size, u32 flags)
  */
 void *aligned_kmalloc(size_t size, u32 align)
 {
-   void *res = general_kmalloc(&size, 0);
+   void *res = __general_kmalloc(&size, 0, KMALLOC_PROF_CALLER());
 
    ASSERT(align > 0);
    ASSERT(align <= size);
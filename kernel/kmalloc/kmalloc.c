@@ -626,6 +626,198 @@ per_heap_kmalloc(struct kmalloc_heap *h, size_t *size, u32 flags)
    return res;
 }
 
+/*
+ * Returns the size of the biggest block starting at `vaddr` that is naturally
+ * aligned (relative to the beginning of the heap) and not bigger than `size`.
+ * Splitting a range with this function produces exactly the buddy tree nodes
+ * covering it. For ranges aligned at their rounded-up size (like those
+ * returned by the multi-step kmalloc), the blocks are the same as the
+ * power-of-two decomposition of `size`, biggest first.
+ */
+static size_t
+get_aligned_block_size(struct kmalloc_heap *h, ulong vaddr, size_t size)
+{
+   const ulong off = vaddr - h->vaddr;
+   size_t bs = off ? (size_t)(off & -off) : h->size;
+
+   while (bs > size)
+      bs >>= 1;
+
+   ASSERT(bs >= h->min_block_size);
+   return bs;
+}
+
+static bool
+is_block_free_at(struct kmalloc_heap *h, ulong vaddr, size_t size)
+{
+   struct block_node *nodes = h->metadata_nodes;
+   const int target = ptr_to_node(h, (void *)vaddr, size);
+   ulong va = h->vaddr;
+   size_t s = h->size;
+   int n = 0;
+
+   while (n != target) {
+
+      if (!nodes[n].split) {
+
+         /*
+          * A non-split node is either a whole allocated block or completely
+          * free, together with its whole sub-tree.
+          */
+         return !nodes[n].full;
+      }
+
+      s >>= 1;
+
+      if (vaddr >= va + s) {
+         va += s;
+         n = NODE_RIGHT(n);
+      } else {
+         n = NODE_LEFT(n);
+      }
+   }
+
+   return is_block_node_free(nodes[n]);
+}
+
+static bool
+internal_kmalloc_at(struct kmalloc_heap *h,
+                    ulong vaddr,
+                    size_t size,
+                    bool do_actual_alloc)
+{
+   struct block_node *nodes = h->metadata_nodes;
+   const int target = ptr_to_node(h, (void *)vaddr, size);
+   ulong va = h->vaddr;
+   size_t s = h->size;
+   void *ptr = NULL;
+   bool success;
+   int n = 0;
+
+   /* Split all the nodes in the path from the root to our node */
+   while (n != target) {
+
+      ASSERT(!nodes[n].full);
+      nodes[n].split = true;
+      s >>= 1;
+
+      if (vaddr >= va + s) {
+         va += s;
+         n = NODE_RIGHT(n);
+      } else {
+         n = NODE_LEFT(n);
+      }
+   }
+
+   ASSERT(s == size);
+   ASSERT(is_block_node_free(nodes[n]));
+
+   success = actual_allocate_node(h, size, n, &ptr, do_actual_alloc);
+   ASSERT(ptr == (void *)vaddr);
+
+   /* Mark the parent nodes as 'full', when necessary. */
+   while (n != 0) {
+
+      n = NODE_PARENT(n);
+
+      if (!nodes[NODE_LEFT(n)].full || !nodes[NODE_RIGHT(n)].full)
+         break;
+
+      nodes[n].full = true;
+   }
+
+   if (UNLIKELY(!success)) {
+
+      /* Same corner case as in internal_kmalloc() */
+      size_t actual_size = size;
+      per_heap_kfree_unsafe(h, ptr, &actual_size, 0);
+      return false;
+   }
+
+   if (do_actual_alloc)
+      h->mem_allocated += size;
+
+   return true;
+}
+
+static void *
+per_heap_kmalloc_at_unsafe(struct kmalloc_heap *h,
+                           void *ptr,
+                           size_t size,
+                           u32 flags)
+{
+   const ulong vaddr = (ulong)ptr;
+   const bool do_actual_alloc = !(flags & KMALLOC_FL_NO_ACTUAL_ALLOC);
+   const u32 sub_blocks_min_size = flags & KMALLOC_FL_SUB_BLOCK_MIN_SIZE_MASK;
+   const bool do_split = (sub_blocks_min_size != 0);
+   size_t tot, bs;
+
+   ASSERT(size != 0);
+   ASSERT(!do_split || sub_blocks_min_size >= h->min_block_size);
+   ASSERT(!is_preemption_enabled());
+
+   if (vaddr < h->vaddr || size > h->size)
+      return NULL;
+
+   if (vaddr + size - 1 > h->heap_last_byte)
+      return NULL;
+
+   if (((vaddr - h->vaddr) | size) & (h->min_block_size - 1))
+      return NULL;
+
+   /* First, check that the whole range is free, without any side effects */
+   for (tot = 0; tot < size; tot += bs) {
+
+      bs = get_aligned_block_size(h, vaddr + tot, size - tot);
+
+      if (!is_block_free_at(h, vaddr + tot, bs))
+         return NULL;
+   }
+
+   for (tot = 0; tot < size; tot += bs) {
+
+      bs = get_aligned_block_size(h, vaddr + tot, size - tot);
+
+      if (UNLIKELY(!internal_kmalloc_at(h, vaddr + tot, bs, do_actual_alloc)))
+      {
+         if (tot > 0) {
+
+            /* Roll-back the blocks we already allocated */
+            u32 kfree_flags = KFREE_FL_MULTI_STEP;
+
+            if (do_split)
+               kfree_flags |= KFREE_FL_ALLOW_SPLIT;
+
+            if (!do_actual_alloc)
+               kfree_flags |= KFREE_FL_NO_ACTUAL_FREE;
+
+            per_heap_kfree_unsafe(h, ptr, &tot, kfree_flags);
+         }
+
+         return NULL;
+      }
+
+      if (do_split)
+         internal_kmalloc_split_block(h, ptr + tot, bs, sub_blocks_min_size);
+   }
+
+   return ptr;
+}
+
+void *
+per_heap_kmalloc_at(struct kmalloc_heap *h, void *ptr, size_t size, u32 flags)
+{
+   bool expected = false;
+   void *res;
+
+   if (!atomic_cas_strong(&h->in_use, &expected, true, mo_relaxed, mo_relaxed))
+      return NULL; /* heap already in use (we're in IRQ context) */
+
+   res = per_heap_kmalloc_at_unsafe(h, ptr, size, flags);
+   atomic_store_explicit(&h->in_use, false, mo_relaxed);
+   return res;
+}
+
 static void
 internal_kfree(struct kmalloc_heap *h,
                void *ptr,
@@ -799,17 +991,20 @@ per_heap_kfree_unsafe(struct kmalloc_heap *h,
    ASSERT(vaddr + size - 1 <= h->heap_last_byte);
    ASSERT(pow2_round_up_at(size, h->min_block_size) == size);
 
-   size_t tot = 0;
+   size_t tot, sub_block_size;
 
-   for (int i = (int)h->heap_data_size_log2 - 1; i >= 0 && tot < size; i--) {
-
-      const size_t sub_block_size = (1 << i);
-
-      if (!(size & sub_block_size))
-         continue;
+   /*
+    * Free the chunk one naturally-aligned block at a time. For chunks returned
+    * by the multi-step kmalloc this is the same as freeing the power-of-two
+    * blocks corresponding to the bits set in `size`, biggest first, but it
+    * works also for partial frees of ranges not aligned at their size, like
+    * those allowed by KFREE_FL_ALLOW_SPLIT or allocated with
+    * per_heap_kmalloc_at().
+    */
+   for (tot = 0; tot < size; tot += sub_block_size) {
 
+      sub_block_size = get_aligned_block_size(h, vaddr + tot, size - tot);
       internal_kfree(h, ptr + tot, sub_block_size, allow_split, do_actual_free);
-      tot += sub_block_size;
    }
 
    ASSERT(tot == size);
@@ -941,7 +1136,8 @@ per_heap_kfree(struct kmalloc_heap *h,
 
 void *kzmalloc(size_t size)
 {
-   void *res = kmalloc(size);
+   size_t sz = size;
+   void *res = __general_kmalloc(&sz, 0, KMALLOC_PROF_CALLER());
 
    if (!res)
       return NULL;
@@ -960,13 +1156,14 @@ void vfree_internal(ulong va_begin, ulong va_end)
 void *vmalloc(size_t size)
 {
    size_t actual_sz = pow2_round_up_at(size, PAGE_SIZE);
+   size_t sz = size;
    ulong va, va_begin, va_end;
    void *ptr;
 
-   if (!hi_vmem_avail())
-      return kmalloc(size);
+   ptr = __general_kmalloc(&sz, 0, KMALLOC_PROF_CALLER());
 
-   ptr = kmalloc(size);
+   if (!hi_vmem_avail())
+      return ptr;
 
    if (ptr)
       return ptr;
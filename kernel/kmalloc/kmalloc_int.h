@@ -11,6 +11,7 @@
 #include <tilck_gen_headers/config_kmalloc.h>
 
 #include "kmalloc_heap_struct.h"
+#include "kmalloc_prof.h"
 
 /*
  * NOTE: the trick to make the small heap to work well without the number of
@@ -60,4 +61,5 @@ STATIC_INLINE void *node_to_ptr(struct kmalloc_heap *h, int node, size_t size);
 static void kmalloc_init_heavy_stats(void);
 static void *small_heaps_kmalloc(size_t *size, u32 flags);
 static int small_heaps_kfree(void *ptr, size_t *size, u32 flags);
+static void *__general_kmalloc(size_t *size, u32 flags, void *caller);
 
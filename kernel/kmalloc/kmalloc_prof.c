@@ -0,0 +1,585 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_kmalloc.h>
+#include <tilck_gen_headers/mod_sysfs.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/kmalloc_debug.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/elf_utils.h>
+
+#include "kmalloc_prof.h"
+
+#if MOD_sysfs
+   #include <tilck/mods/sysfs.h>
+   #include <tilck/mods/sysfs_utils.h>
+#endif
+
+#if KRN_KMALLOC_PROFILER
+
+/*
+ * Sampling kmalloc profiler
+ * ---------------------------
+ *
+ * Like pprof's heap profiles, allocations are sampled on average once every
+ * KMALLOC_PROF_SAMPLE_RATE allocated bytes, with exponentially distributed
+ * intervals: an allocation of `size` bytes is sampled with probability
+ * 1 - exp(-size / RATE). A sampled allocation is attributed to its call site
+ * (the return address of general_kmalloc() or of the kmalloc wrappers), and
+ * its address is kept in the `blocks` table until it gets freed, in order to
+ * track the live objects per call site as well.
+ *
+ * For each call site we keep both the raw sampled counters (used as they are
+ * in the pprof heap_v2 output, because pprof does the scaling by itself) and
+ * estimates of the actual numbers: each sample of `size` bytes accounts for
+ * size / (1 - exp(-size / RATE)) bytes. The scale factor is approximated
+ * with an error below ~5%.
+ *
+ * Independently from the sampling, each heap (and the small heaps as a whole)
+ * has a histogram of the allocated block sizes and counters for requested vs.
+ * allocated bytes, showing the internal fragmentation.
+ *
+ * Allocations with KMALLOC_FL_MULTI_STEP (they can be freed in pieces) and
+ * with KMALLOC_FL_DONT_ACCOUNT (kmalloc's internal ones) are not sampled.
+ */
+
+#define PROF_SITES_BITS                                       9
+#define PROF_BLOCKS_BITS                                     12
+#define PROF_MAX_SITES                     (1 << PROF_SITES_BITS)
+#define PROF_MAX_BLOCKS                   (1 << PROF_BLOCKS_BITS)
+#define PROF_SIZE_CLASSES                                    24
+
+/* ln(2) in 16.16 fixed point */
+#define LN2_Q16                                           45426
+
+struct prof_site {
+
+   void *pc;
+   u32 alloc_objs;               /* sampled */
+   u32 live_objs;                /* sampled */
+   u64 alloc_bytes;              /* sampled */
+   u64 live_bytes;               /* sampled */
+   u64 est_alloc_objs;           /* estimate, 16.16 fixed point */
+   u64 est_live_objs;            /* estimate, 16.16 fixed point */
+   u64 est_alloc_bytes;          /* estimate */
+   u64 est_live_bytes;           /* estimate */
+};
+
+struct prof_block {
+
+   void *ptr;                    /* NULL: free slot */
+   u32 size;
+   u32 site;                     /* index in `sites` */
+};
+
+/*
+ * hist[i] counts the allocated blocks of [2^i, 2^(i+1)) bytes, while the last
+ * bucket counts everything above.
+ */
+struct prof_heap {
+
+   u64 allocs;
+   u64 req_bytes;
+   u64 bytes;
+   u32 hist[PROF_SIZE_CLASSES];
+};
+
+static struct prof_site sites[PROF_MAX_SITES];
+static struct prof_block blocks[PROF_MAX_BLOCKS];
+static struct prof_heap prof_heaps[KMALLOC_HEAPS_COUNT + 1];
+
+static u32 sites_count;
+static u32 live_blocks;
+static u64 samples;
+static u64 dropped;              /* samples dropped because of full tables */
+static size_t next_sample;       /* bytes to allocate before the next sample */
+static u32 rnd_state;
+
+static ALWAYS_INLINE u32 prof_hash(const void *ptr)
+{
+   return (u32)(ulong)ptr * 2654435761u;
+}
+
+static u32 prof_rand(void)
+{
+   u32 x = rnd_state;
+
+   if (UNLIKELY(!x))
+      x = (u32)RDTSC() | 1;
+
+   /* xorshift32 */
+   x ^= x << 13;
+   x ^= x >> 17;
+   x ^= x << 5;
+   return rnd_state = x;
+}
+
+/*
+ * Returns -log2(x / 2^32) in 16.16 fixed point, for x > 0. The fractional part
+ * of the log of the mantissa is computed bit by bit, by repeated squaring.
+ */
+static u32 prof_neg_log2_q16(u32 x)
+{
+   const u32 lz = (u32)__builtin_clz(x);
+   u64 m = (u64)x << lz;         /* mantissa in [1, 2), 1.31 fixed point */
+   u32 frac = 0;
+
+   for (int i = 15; i >= 0; i--) {
+
+      m = (m * m) >> 31;
+
+      if (m >= (1ull << 32)) {
+         m >>= 1;
+         frac |= 1u << i;
+      }
+   }
+
+   return ((lz + 1) << 16) - frac;
+}
+
+/* Exponentially distributed interval with mean KMALLOC_PROF_SAMPLE_RATE */
+static size_t prof_next_sample_interval(void)
+{
+   /* -ln(u) = -log2(u) * ln(2), with `u` uniform in (0, 1) */
+   const u64 neg_ln_q32 = (u64)prof_neg_log2_q16(prof_rand()) * LN2_Q16;
+   return (size_t)((KMALLOC_PROF_SAMPLE_RATE * neg_ln_q32) >> 32);
+}
+
+/*
+ * Scale factor of a sample of `size` bytes, in 16.16 fixed point: it's
+ * u / (1 - exp(-u)) with u = size / RATE, multiplied by RATE. For u < 3, use
+ * 1 + u/2 + u^2/12 (Taylor series), otherwise just u.
+ */
+static u64 prof_get_scale_q16(size_t size)
+{
+   const u64 u = ((u64)size << 16) / KMALLOC_PROF_SAMPLE_RATE;
+
+   if (u >= (3 << 16))
+      return u;
+
+   return (1 << 16) + u / 2 + ((u * u) >> 16) / 12;
+}
+
+static u64 prof_est_bytes(size_t size)
+{
+   return (KMALLOC_PROF_SAMPLE_RATE * prof_get_scale_q16(size)) >> 16;
+}
+
+static u64 prof_est_objs_q16(size_t size)
+{
+   const u64 u = ((u64)size << 16) / KMALLOC_PROF_SAMPLE_RATE;
+   return (prof_get_scale_q16(size) << 16) / MAX(u, 1ull);
+}
+
+static int prof_get_site(void *pc)
+{
+   const u32 h = prof_hash(pc) >> (32 - PROF_SITES_BITS);
+
+   for (u32 i = 0; i < PROF_MAX_SITES; i++) {
+
+      const u32 idx = (h + i) & (PROF_MAX_SITES - 1);
+      struct prof_site *s = &sites[idx];
+
+      if (s->pc == pc)
+         return (int)idx;
+
+      if (!s->pc) {
+         s->pc = pc;
+         sites_count++;
+         return (int)idx;
+      }
+   }
+
+   return -1;
+}
+
+static ALWAYS_INLINE u32 prof_block_slot(const void *ptr)
+{
+   return prof_hash(ptr) >> (32 - PROF_BLOCKS_BITS);
+}
+
+static int prof_find_block(void *ptr)
+{
+   const u32 h = prof_block_slot(ptr);
+
+   for (u32 i = 0; i < PROF_MAX_BLOCKS; i++) {
+
+      const u32 idx = (h + i) & (PROF_MAX_BLOCKS - 1);
+
+      if (blocks[idx].ptr == ptr)
+         return (int)idx;
+
+      if (!blocks[idx].ptr)
+         break;
+   }
+
+   return -1;
+}
+
+static bool prof_add_block(void *ptr, size_t size, u32 site)
+{
+   const u32 h = prof_block_slot(ptr);
+
+   /* Keep at least one free slot, for prof_find_block() to stop */
+   if (live_blocks >= PROF_MAX_BLOCKS - 1)
+      return false;
+
+   for (u32 i = 0; i < PROF_MAX_BLOCKS; i++) {
+
+      struct prof_block *b = &blocks[(h + i) & (PROF_MAX_BLOCKS - 1)];
+
+      if (!b->ptr) {
+         *b = (struct prof_block) { ptr, (u32)size, site };
+         live_blocks++;
+         return true;
+      }
+   }
+
+   NOT_REACHED();
+}
+
+/*
+ * Linear probing removal without tombstones: move back the following entries
+ * of the cluster, unless their home slot is cyclically in (i, j].
+ */
+static void prof_remove_block(u32 i)
+{
+   const u32 mask = PROF_MAX_BLOCKS - 1;
+   u32 j = i;
+
+   while (true) {
+
+      j = (j + 1) & mask;
+
+      if (!blocks[j].ptr)
+         break;
+
+      const u32 k = prof_block_slot(blocks[j].ptr);
+
+      if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+         continue;
+
+      blocks[i] = blocks[j];
+      i = j;
+   }
+
+   blocks[i].ptr = NULL;
+   live_blocks--;
+}
+
+void kmalloc_prof_alloc(void *ptr, size_t size, void *caller)
+{
+   struct prof_site *s;
+   int site;
+
+   ASSERT(!is_preemption_enabled());
+
+   if (next_sample > size) {
+      next_sample -= size;
+      return;
+   }
+
+   next_sample = prof_next_sample_interval();
+
+   if ((site = prof_get_site(caller)) < 0 ||
+       !prof_add_block(ptr, size, (u32)site))
+   {
+      dropped++;
+      return;
+   }
+
+   s = &sites[site];
+   samples++;
+
+   s->alloc_objs++;
+   s->live_objs++;
+   s->alloc_bytes += size;
+   s->live_bytes += size;
+   s->est_alloc_objs += prof_est_objs_q16(size);
+   s->est_live_objs += prof_est_objs_q16(size);
+   s->est_alloc_bytes += prof_est_bytes(size);
+   s->est_live_bytes += prof_est_bytes(size);
+}
+
+void kmalloc_prof_free(void *ptr)
+{
+   struct prof_site *s;
+   size_t size;
+   int idx;
+
+   ASSERT(!is_preemption_enabled());
+
+   if (!live_blocks || (idx = prof_find_block(ptr)) < 0)
+      return;
+
+   s = &sites[blocks[idx].site];
+   size = blocks[idx].size;
+
+   s->live_objs--;
+   s->live_bytes -= size;
+   s->est_live_objs -= prof_est_objs_q16(size);
+   s->est_live_bytes -= prof_est_bytes(size);
+
+   prof_remove_block((u32)idx);
+}
+
+void kmalloc_prof_account_heap(int heap, size_t req_size, size_t size)
+{
+   struct prof_heap *h = &prof_heaps[heap];
+   const u32 log2 = size ? 31 - (u32)__builtin_clz((u32)size) : 0;
+
+   ASSERT(!is_preemption_enabled());
+   ASSERT(0 <= heap && heap <= KMALLOC_PROF_SMALL_HEAPS);
+
+   h->allocs++;
+   h->req_bytes += req_size;
+   h->bytes += size;
+   h->hist[MIN(log2, (u32)PROF_SIZE_CLASSES - 1)]++;
+}
+
+/* --------------------- /syst/kmalloc_prof/ files ---------------------- */
+
+#if MOD_sysfs
+
+#define SITE_NAME_MAX                                            64
+#define HEAP_LINE_MAX                                            96
+#define SITE_LINE_MAX                         (SITE_NAME_MAX + 4 * 21)
+#define SIZES_LINE_MAX                        (64 + 16 * PROF_SIZE_CLASSES)
+#define HEADER_MAX                                              256
+
+struct prof_dump_ctx {
+   char *buf;
+   size_t sz;
+   size_t used;
+};
+
+static void prof_dump(struct prof_dump_ctx *ctx, const char *fmt, ...)
+{
+   va_list args;
+
+   if (ctx->used >= ctx->sz)
+      return;
+
+   va_start(args, fmt);
+   ctx->used += (size_t)vsnprintk(ctx->buf + ctx->used,
+                                  ctx->sz - ctx->used,
+                                  fmt, args);
+   va_end(args);
+}
+
+static bool prof_get_site_copy(u32 i, struct prof_site *s)
+{
+   disable_preemption();
+   {
+      *s = sites[i];
+   }
+   enable_preemption();
+   return s->pc != NULL;
+}
+
+static void prof_get_site_name(void *pc, char *buf, size_t buf_sz)
+{
+   long off = 0;
+   const char *sym = find_sym_at_addr((ulong)pc, &off, NULL);
+
+   if (sym)
+      snprintk(buf, buf_sz, "%s+0x%lx", sym, off);
+   else
+      snprintk(buf, buf_sz, "0x%lx", (ulong)pc);
+}
+
+static offt
+prof_heap_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return HEADER_MAX + PROF_MAX_SITES * HEAP_LINE_MAX;
+}
+
+/*
+ * The legacy text format of pprof's heap profiles: a header with the totals
+ * and the sampling rate, then one line per call site with the sampled live
+ * and allocated objects and bytes, followed by the call stack (just the call
+ * site, in our case). Symbolize with the kernel's ELF file.
+ */
+static offt
+prof_heap_load(struct sysobj *obj, void *data,
+               void *buf, offt buf_sz, offt off)
+{
+   struct prof_dump_ctx ctx = { .buf = buf, .sz = (size_t)buf_sz };
+   u64 live_objs = 0, live_bytes = 0, alloc_objs = 0, alloc_bytes = 0;
+   struct prof_site s;
+
+   ASSERT(off == 0);
+
+   for (u32 i = 0; i < PROF_MAX_SITES; i++) {
+
+      if (!prof_get_site_copy(i, &s))
+         continue;
+
+      live_objs += s.live_objs;
+      live_bytes += s.live_bytes;
+      alloc_objs += s.alloc_objs;
+      alloc_bytes += s.alloc_bytes;
+   }
+
+   prof_dump(&ctx,
+             "heap profile: %llu: %llu [%llu: %llu] @ heap_v2/%u\n",
+             live_objs, live_bytes, alloc_objs, alloc_bytes,
+             KMALLOC_PROF_SAMPLE_RATE);
+
+   for (u32 i = 0; i < PROF_MAX_SITES; i++) {
+
+      if (!prof_get_site_copy(i, &s))
+         continue;
+
+      prof_dump(&ctx, "%u: %llu [%u: %llu] @ 0x%lx\n",
+                s.live_objs, s.live_bytes, s.alloc_objs, s.alloc_bytes,
+                (ulong)s.pc);
+   }
+
+   return (offt)MIN(ctx.used, ctx.sz);
+}
+
+static offt
+prof_sites_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return HEADER_MAX + PROF_MAX_SITES * SITE_LINE_MAX;
+}
+
+static offt
+prof_sites_load(struct sysobj *obj, void *data,
+                void *buf, offt buf_sz, offt off)
+{
+   struct prof_dump_ctx ctx = { .buf = buf, .sz = (size_t)buf_sz };
+   char name[SITE_NAME_MAX];
+   struct prof_site s;
+
+   ASSERT(off == 0);
+
+   prof_dump(&ctx,
+             "# rate: %u, sites: %u, samples: %llu, dropped: %llu\n"
+             "# live_objs live_bytes alloc_objs alloc_bytes site "
+             "(estimates)\n",
+             KMALLOC_PROF_SAMPLE_RATE, sites_count, samples, dropped);
+
+   for (u32 i = 0; i < PROF_MAX_SITES; i++) {
+
+      if (!prof_get_site_copy(i, &s))
+         continue;
+
+      prof_get_site_name(s.pc, name, sizeof(name));
+      prof_dump(&ctx, "%llu %llu %llu %llu %s\n",
+                s.est_live_objs >> 16, s.est_live_bytes,
+                s.est_alloc_objs >> 16, s.est_alloc_bytes,
+                name);
+   }
+
+   return (offt)MIN(ctx.used, ctx.sz);
+}
+
+static offt
+prof_sizes_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return HEADER_MAX + ARRAY_SIZE(prof_heaps) * SIZES_LINE_MAX;
+}
+
+static offt
+prof_sizes_load(struct sysobj *obj, void *data,
+                void *buf, offt buf_sz, offt off)
+{
+   struct prof_dump_ctx ctx = { .buf = buf, .sz = (size_t)buf_sz };
+   struct debug_kmalloc_heap_info hi;
+   struct prof_heap h;
+
+   ASSERT(off == 0);
+
+   prof_dump(&ctx,
+             "# heap vaddr allocs req_bytes bytes "
+             "[log2(block_size):count ...]\n");
+
+   for (int i = 0; i < ARRAY_SIZE(prof_heaps); i++) {
+
+      disable_preemption();
+      {
+         h = prof_heaps[i];
+
+         if (i != KMALLOC_PROF_SMALL_HEAPS)
+            if (!debug_kmalloc_get_heap_info(i, &hi))
+               hi.vaddr = 0;
+      }
+      enable_preemption();
+
+      if (!h.allocs)
+         continue;
+
+      if (i == KMALLOC_PROF_SMALL_HEAPS)
+         prof_dump(&ctx, "small -");
+      else
+         prof_dump(&ctx, "%d 0x%lx", i, hi.vaddr);
+
+      prof_dump(&ctx, " %llu %llu %llu", h.allocs, h.req_bytes, h.bytes);
+
+      for (u32 b = 0; b < PROF_SIZE_CLASSES; b++) {
+         if (h.hist[b])
+            prof_dump(&ctx, " %u:%u", b, h.hist[b]);
+      }
+
+      prof_dump(&ctx, "\n");
+   }
+
+   return (offt)MIN(ctx.used, ctx.sz);
+}
+
+static const struct sysobj_prop_type prof_heap_prop_type = {
+   .buf_type = SYSFS_BUF_BUFFERED,
+   .get_buf_sz = &prof_heap_get_buf_sz,
+   .load = &prof_heap_load,
+};
+
+static const struct sysobj_prop_type prof_sites_prop_type = {
+   .buf_type = SYSFS_BUF_BUFFERED,
+   .get_buf_sz = &prof_sites_get_buf_sz,
+   .load = &prof_sites_load,
+};
+
+static const struct sysobj_prop_type prof_sizes_prop_type = {
+   .buf_type = SYSFS_BUF_BUFFERED,
+   .get_buf_sz = &prof_sizes_get_buf_sz,
+   .load = &prof_sizes_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(heap, &prof_heap_prop_type);
+DEF_STATIC_SYSOBJ_PROP(sites, &prof_sites_prop_type);
+DEF_STATIC_SYSOBJ_PROP(sizes, &prof_sizes_prop_type);
+
+DEF_STATIC_SYSOBJ_TYPE(prof_sysobj_type,
+                       &prop_heap,
+                       &prop_sites,
+                       &prop_sizes,
+                       NULL);
+
+void register_kmalloc_prof_sysfs(void)
+{
+   struct sysobj *obj = sysfs_create_obj(&prof_sysobj_type, NULL, NULL);
+
+   if (!obj) {
+      printk("WARNING: /syst/kmalloc_prof not registered: out of memory\n");
+      return;
+   }
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "kmalloc_prof", obj) < 0) {
+      printk("WARNING: /syst/kmalloc_prof not registered\n");
+      sysfs_destroy_unregistered_obj(obj);
+   }
+}
+
+#else  /* !MOD_sysfs */
+
+void register_kmalloc_prof_sysfs(void) { /* no-op */ }
+
+#endif /* MOD_sysfs */
+#endif /* KRN_KMALLOC_PROFILER */
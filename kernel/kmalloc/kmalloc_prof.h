@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck_gen_headers/config_kmalloc.h>
+
+/*
+ * Hooks of the sampling kmalloc profiler (KRN_KMALLOC_PROFILER), called by
+ * kmalloc.c with preemption disabled. See kmalloc_prof.c.
+ */
+
+/* Pseudo heap index used in the size-class histograms for the small heaps */
+#define KMALLOC_PROF_SMALL_HEAPS                 KMALLOC_HEAPS_COUNT
+
+/* The call site attributed to an allocation: our caller's return address */
+#define KMALLOC_PROF_CALLER()                                         \
+   __builtin_extract_return_addr(__builtin_return_address(0))
+
+#if KRN_KMALLOC_PROFILER
+
+   void kmalloc_prof_alloc(void *ptr, size_t size, void *caller);
+   void kmalloc_prof_free(void *ptr);
+   void kmalloc_prof_account_heap(int heap, size_t req_size, size_t size);
+
+#else
+
+   static inline void
+   kmalloc_prof_alloc(void *ptr, size_t size, void *caller) { }
+
+   static inline void kmalloc_prof_free(void *ptr) { }
+
+   static inline void
+   kmalloc_prof_account_heap(int heap, size_t req_size, size_t size) { }
+
+#endif
@@ -0,0 +1,421 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_sched.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/atomics.h>
+
+#include <tilck/kernel/kmsg.h>
+#include <tilck/kernel/modules.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/devfs.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/interrupts.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/signal.h>
+#include <tilck/kernel/worker_thread.h>
+
+#include <fcntl.h>        // system header
+
+/*
+ * Kernel log ring
+ * -----------------
+ *
+ * The records live in KMSG_RECORDS fixed-size slots: the record with sequence
+ * number `seq` is stored in the slot `seq % KMSG_RECORDS`, overwriting the
+ * record `seq - KMSG_RECORDS`. There are no locks: a writer reserves its seq
+ * with an atomic increment of `kmsg_next_seq`, marks the slot as "being
+ * written" by setting `begin`, fills the record and finally sets `end`. Both
+ * the markers contain seq + 1, in order to keep 0 for the never used slots.
+ *
+ * The readers never block the writers: they copy the record and then check
+ * that `begin` still matches, like a seqlock. A record overwritten while it
+ * was being read is reported as lost (-EPIPE), exactly like one overwritten
+ * before. The writers disable the preemption while filling the slot, so a
+ * record is left incomplete only by a writer interrupted by an IRQ handler.
+ *
+ * After storing a record, printk() calls kmsg_kick() which queues (at most
+ * once) the kmsg job on a dedicated worker thread: the job flushes the new
+ * records on the console, when KRN_PRINTK_DEFERRED is enabled, and wakes up
+ * the readers of /dev/kmsg.
+ *
+ * /dev/kmsg works like on Linux: each read() returns a single record, as one
+ * line in the format:
+ *
+ *    <level>,<seq>,<usec>,<flag>,caller=<T<tid>|C<cpu>>,tsc=<tsc>;<text>\n
+ *
+ * where <flag> is 'c' for the records continuing the previous one's line and
+ * '-' otherwise. The non-printable chars in the text are escaped as \xNN.
+ * A reader opening the file starts from the oldest record still in the ring;
+ * a reader too slow to keep up gets -EPIPE once and then continues from the
+ * oldest record. lseek() works with sequence numbers: SEEK_SET moves to the
+ * given seq (or the oldest one available), SEEK_END to the next record that
+ * will be stored plus the offset. poll() reports the file as readable when
+ * there are records after the current position.
+ */
+
+/* Power of 2: `seq % KMSG_RECORDS` must not jump when `seq` wraps around */
+STATIC_ASSERT((KMSG_RECORDS & (KMSG_RECORDS - 1)) == 0);
+
+struct kmsg_slot {
+
+   ATOMIC(u32) begin;
+   ATOMIC(u32) end;
+   struct kmsg_record rec;
+};
+
+struct kmsg_handle_extra {
+   u32 seq;
+};
+
+STATIC_ASSERT(sizeof(struct kmsg_handle_extra) <= DEVFS_EXTRA_SIZE);
+
+static struct kmsg_slot kmsg_slots[KMSG_RECORDS];
+static ATOMIC(u32) kmsg_next_seq;
+
+static struct worker_thread *kmsg_wth;
+static ATOMIC(bool) kmsg_job_queued;
+static struct kcond kmsg_cond;
+
+void kmsg_store(u8 level, u8 flags, const char *text, u32 len)
+{
+   struct kmsg_slot *s;
+   struct kmsg_record *r;
+   u32 seq;
+
+   if (in_irq())
+      flags |= KMSG_FL_IRQ;
+
+   len = MIN(len, (u32)KMSG_TEXT_MAX);
+   disable_preemption();
+   {
+      seq = atomic_fetch_add_explicit(&kmsg_next_seq, 1, mo_relaxed);
+      s = &kmsg_slots[seq % KMSG_RECORDS];
+      r = &s->rec;
+
+      atomic_store_explicit(&s->begin, seq + 1, mo_relaxed);
+      atomic_thread_fence(mo_release);
+
+      r->seq = seq;
+      r->level = level;
+      r->flags = flags;
+      r->len = (u16)len;
+      r->cpu = 0;                /* no SMP: always the boot CPU */
+      r->tid = get_curr_tid();
+      r->tsc = RDTSC();
+      r->ts = get_sys_time();
+      memcpy(r->text, text, len);
+
+      atomic_store_explicit(&s->end, seq + 1, mo_release);
+   }
+   enable_preemption();
+}
+
+u32 kmsg_get_next_seq(void)
+{
+   return atomic_load_explicit(&kmsg_next_seq, mo_relaxed);
+}
+
+u32 kmsg_get_first_seq(void)
+{
+   const u32 next = kmsg_get_next_seq();
+   return next > KMSG_RECORDS ? next - KMSG_RECORDS : 0;
+}
+
+int kmsg_read(u32 seq, struct kmsg_record *out)
+{
+   const u32 next = kmsg_get_next_seq();
+   struct kmsg_slot *s = &kmsg_slots[seq % KMSG_RECORDS];
+   u32 end;
+
+   if ((s32)(next - seq) <= 0)
+      return -EAGAIN;
+
+   if (next - seq > KMSG_RECORDS)
+      return -EPIPE;
+
+   end = atomic_load_explicit(&s->end, mo_acquire);
+
+   if (end != seq + 1) {
+
+      /*
+       * The slot contains an older record: ours is still being written.
+       * Otherwise, ours has already been overwritten by a newer one.
+       */
+      return (s32)(end - (seq + 1)) < 0 ? -EAGAIN : -EPIPE;
+   }
+
+   memcpy(out, &s->rec, sizeof(*out));
+   atomic_thread_fence(mo_acquire);
+
+   if (atomic_load_explicit(&s->begin, mo_relaxed) != seq + 1)
+      return -EPIPE;       /* overwritten while we were copying it */
+
+   out->len = MIN(out->len, (u16)KMSG_TEXT_MAX);
+   return 0;
+}
+
+static void kmsg_job(void *arg)
+{
+   u32 seen;
+
+   do {
+
+      seen = kmsg_get_next_seq();
+      printk_flush_deferred();
+      kcond_signal_all(&kmsg_cond);
+      atomic_store_explicit(&kmsg_job_queued, false, mo_release);
+
+      /*
+       * Records stored after we cleared `kmsg_job_queued` will queue the job
+       * again; the ones stored before, while we were running, won't.
+       */
+
+   } while (kmsg_get_next_seq() != seen &&
+            !atomic_exchange_explicit(&kmsg_job_queued, true, mo_acquire));
+}
+
+bool kmsg_kick(void)
+{
+   if (!kmsg_wth || in_panic())
+      return false;
+
+   if (!in_irq()) {
+
+      /* We're printing from the kmsg job itself: it will re-check */
+      if (get_curr_task() == wth_get_task(kmsg_wth))
+         return true;
+
+      /*
+       * With the interrupts disabled outside of IRQ context we might be in
+       * the middle of the scheduler's code: don't wake up the worker.
+       */
+      if (!are_interrupts_enabled())
+         return false;
+   }
+
+   if (atomic_exchange_explicit(&kmsg_job_queued, true, mo_acquire))
+      return true;
+
+   if (!wth_enqueue_on(kmsg_wth, &kmsg_job, NULL)) {
+      atomic_store_explicit(&kmsg_job_queued, false, mo_release);
+      return false;
+   }
+
+   return true;
+}
+
+/* ------------------------------ /dev/kmsg ------------------------------- */
+
+static inline struct kmsg_handle_extra *kmsg_extra(fs_handle h)
+{
+   return (void *)((struct devfs_handle *)h)->extra;
+}
+
+static int kmsg_create_extra(int minor, void *extra)
+{
+   ((struct kmsg_handle_extra *)extra)->seq = kmsg_get_first_seq();
+   return 0;
+}
+
+static int
+kmsg_format_record(const struct kmsg_record *r, char *buf, size_t size)
+{
+   static const char hex[] = "0123456789abcdef";
+   u32 len = r->len;
+   int n;
+
+   /* The trailing newline is implicit */
+   if (len > 0 && r->text[len - 1] == '\n')
+      len--;
+
+   n = snprintk(buf, size, "%u,%u,%llu,%c,caller=%c%u,tsc=%llu;",
+                r->level,
+                r->seq,
+                r->ts / (TS_SCALE / 1000000),
+                (r->flags & KMSG_FL_CONT) ? 'c' : '-',
+                (r->flags & KMSG_FL_IRQ) || !r->tid ? 'C' : 'T',
+                (r->flags & KMSG_FL_IRQ) || !r->tid ? r->cpu : (u32)r->tid,
+                r->tsc);
+
+   if (n < 0 || (size_t)n >= size)
+      return -EINVAL;
+
+   for (u32 i = 0; i < len; i++) {
+
+      const u8 c = (u8)r->text[i];
+
+      if (c >= 32 && c < 127 && c != '\\') {
+
+         if ((size_t)n + 1 >= size)
+            return -EINVAL;
+
+         buf[n++] = (char)c;
+
+      } else {
+
+         if ((size_t)n + 4 >= size)
+            return -EINVAL;
+
+         buf[n++] = '\\';
+         buf[n++] = 'x';
+         buf[n++] = hex[c >> 4];
+         buf[n++] = hex[c & 0xf];
+      }
+   }
+
+   buf[n++] = '\n';
+   return n;
+}
+
+static ssize_t kmsg_dev_read(fs_handle h, char *buf, size_t size, offt *pos)
+{
+   struct devfs_handle *dh = h;
+   struct kmsg_handle_extra *e = kmsg_extra(h);
+   struct kmsg_record *r;
+   int rc;
+
+   if (!(r = kmalloc(sizeof(*r))))
+      return -ENOMEM;
+
+   while (true) {
+
+      rc = kmsg_read(e->seq, r);
+
+      if (rc == -EPIPE) {
+         /* We lost some records: report that and restart from the oldest */
+         e->seq = kmsg_get_first_seq();
+         break;
+      }
+
+      if (rc == 0) {
+
+         if ((rc = kmsg_format_record(r, buf, size)) > 0)
+            e->seq++;
+
+         break;
+      }
+
+      if (dh->fl_flags & O_NONBLOCK)
+         break;
+
+      /* See the comment in tty_read_int() about the finite timeout */
+      kcond_wait(&kmsg_cond, NULL, KRN_TIMER_HZ / 4);
+
+      if (pending_signals()) {
+         rc = -EINTR;
+         break;
+      }
+   }
+
+   *pos = e->seq;
+   kfree2(r, sizeof(*r));
+   return rc;
+}
+
+static offt kmsg_dev_seek(fs_handle h, offt off, int whence)
+{
+   struct devfs_handle *dh = h;
+   struct kmsg_handle_extra *e = kmsg_extra(h);
+   const u32 first = kmsg_get_first_seq();
+   const u32 next = kmsg_get_next_seq();
+   offt seq;
+
+   switch (whence) {
+
+      case SEEK_SET:
+         seq = off;
+         break;
+
+      case SEEK_CUR:
+         seq = (offt)e->seq + off;
+         break;
+
+      case SEEK_END:
+         seq = (offt)next + off;
+         break;
+
+      default:
+         return -EINVAL;
+   }
+
+   if (seq < 0)
+      return -EINVAL;
+
+   e->seq = (u32)CLAMP(seq, (offt)first, (offt)next);
+   dh->h_fpos = e->seq;
+   return dh->h_fpos;
+}
+
+static int kmsg_dev_read_ready(fs_handle h)
+{
+   return (s32)(kmsg_get_next_seq() - kmsg_extra(h)->seq) > 0;
+}
+
+static struct kcond *kmsg_dev_get_rready_cond(fs_handle h)
+{
+   return &kmsg_cond;
+}
+
+static const struct file_ops kmsg_fops = {
+   .read = kmsg_dev_read,
+   .seek = kmsg_dev_seek,
+   .read_ready = kmsg_dev_read_ready,
+   .get_rready_cond = kmsg_dev_get_rready_cond,
+};
+
+static int
+kmsg_create_device_file(int minor,
+                        enum vfs_entry_type *type,
+                        struct devfs_file_info *nfo)
+{
+   *type = VFS_CHAR_DEV;
+   nfo->fops = &kmsg_fops;
+   nfo->create_extra = &kmsg_create_extra;
+   return 0;
+}
+
+static void init_kmsg(void)
+{
+   struct driver_info *di = kzalloc_obj(struct driver_info);
+   int rc;
+
+   if (!di)
+      panic("kmsg: not enough memory for struct driver_info");
+
+   kcond_init(&kmsg_cond);
+
+   di->name = "kmsg";
+   di->create_dev_file = kmsg_create_device_file;
+   register_driver(di, -1);
+
+   if ((rc = create_dev_file("kmsg", di->major, 0, NULL)) < 0)
+      panic("kmsg: unable to create /dev/kmsg (error: %d)", rc);
+
+   disable_preemption();
+   {
+      kmsg_wth = wth_create_thread("kmsg", 5 /* priority */, 4 /* queue */);
+   }
+   enable_preemption();
+
+   if (!kmsg_wth) {
+      printk("WARNING: kmsg: no worker thread, using synchronous printk\n");
+      return;
+   }
+
+   printk_start_deferred();
+}
+
+static struct module kmsg_module = {
+   .name = "kmsg",
+   .priority = MOD_kmsg_prio,
+   .init = &init_kmsg,
+};
+
+REGISTER_MODULE(&kmsg_module);
@@ -6,18 +6,135 @@
 #include <tilck/kernel/sync.h>
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/irq.h>
+#include <tilck/kernel/hal.h>
+
+/*
+ * Max length of the chain of PI boosts: a waiter boosts the owner of the lock,
+ * which might be waiting on another PI lock and so on.
+ */
+#define PI_MAX_CHAIN_DEPTH                                     8
 
 bool kmutex_is_curr_task_holding_lock(struct kmutex *m)
 {
    return m->owner_task == get_curr_task();
 }
 
+static struct task *wobj_get_task(struct wait_obj *wo)
+{
+   if (wo->type == WOBJ_MWO_ELEM)
+      return ((struct mwobj_elem *)wo)->ti;
+
+   return CONTAINER_OF(wo, struct task, wobj);
+}
+
+static int pi_get_top_waiter_prio(struct pi_lock *pl)
+{
+   struct wait_obj *wo;
+   int prio = 0;
+
+   list_for_each_ro(wo, pl->wait_list, wait_list_node)
+      prio = MAX(prio, sched_get_prio(wobj_get_task(wo)));
+
+   return prio;
+}
+
+/* Recalculate the PI boost of `ti` from the waiters of the locks it holds */
+static void pi_update_boost(struct task *ti)
+{
+   struct pi_lock *pl;
+   int prio = 0;
+
+   list_for_each_ro(pl, &ti->pi_held_list, held_node)
+      prio = MAX(prio, pi_get_top_waiter_prio(pl));
+
+   sched_set_task_pi_prio(ti, prio > sched_get_base_prio(ti) ? prio : 0);
+}
+
+void pi_lock_acquired(struct pi_lock *pl, struct task *owner)
+{
+   ASSERT(!is_preemption_enabled());
+   list_add_tail(&owner->pi_held_list, &pl->held_node);
+
+   /* The waiters left, if any, now boost the new owner */
+   if (!list_is_empty(pl->wait_list))
+      pi_update_boost(owner);
+}
+
+void pi_lock_released(struct pi_lock *pl, struct task *owner)
+{
+   ASSERT(!is_preemption_enabled());
+   list_remove(&pl->held_node);
+
+   if (owner->pi_prio)
+      pi_update_boost(owner);
+}
+
+/*
+ * Links the wait obj of `ti`, waiting on the PI mutex `m`, before the first
+ * waiter with a lower priority: the list is sorted by priority and FIFO
+ * among the tasks having the same one.
+ */
+static void kmutex_pi_enqueue(struct kmutex *m, struct task *ti)
+{
+   const int prio = sched_get_prio(ti);
+   struct wait_obj *pos;
+
+   list_for_each_ro(pos, &m->wait_list, wait_list_node) {
+
+      if (sched_get_prio(wobj_get_task(pos)) < prio) {
+         list_add_before(&pos->wait_list_node, &ti->wobj.wait_list_node);
+         return;
+      }
+   }
+
+   list_add_tail(&m->wait_list, &ti->wobj.wait_list_node);
+}
+
+/*
+ * If `ti` is waiting on a PI mutex, moves it to its new place in the wait
+ * list, after its priority changed. Returns the owner of that mutex.
+ */
+static struct task *pi_requeue_waiter(struct task *ti)
+{
+   struct kmutex *m;
+
+   if (ti->wobj.type != WOBJ_KMUTEX)
+      return NULL;
+
+   m = wait_obj_get_ptr(&ti->wobj);
+
+   if (!m || !(m->flags & KMUTEX_FL_PI))
+      return NULL;
+
+   list_remove(&ti->wobj.wait_list_node);
+   kmutex_pi_enqueue(m, ti);
+   return m->owner_task;
+}
+
+void pi_boost_owner(struct task *owner, struct task *waiter)
+{
+   const int prio = sched_get_prio(waiter);
+   ASSERT(!is_preemption_enabled());
+
+   for (int i = 0; owner && i < PI_MAX_CHAIN_DEPTH; i++) {
+
+      if (sched_get_prio(owner) >= prio)
+         break;
+
+      sched_set_task_pi_prio(owner, prio);
+      owner = pi_requeue_waiter(owner);
+   }
+}
+
 void kmutex_init(struct kmutex *m, u32 flags)
 {
    DEBUG_ONLY(check_not_in_irq_handler());
    bzero(m, sizeof(struct kmutex));
    m->flags = flags;
    list_init(&m->wait_list);
+   list_node_init(&m->pi.held_node);
+   m->pi.wait_list = &m->wait_list;
+   LOCKSTAT_ONLY(lockstat_init(&m->lstat, __builtin_return_address(0)));
 }
 
 void kmutex_destroy(struct kmutex *m)
@@ -52,6 +169,10 @@ void kmutex_lock(struct kmutex *m)
          m->lock_count++;
       }
 
+      if (m->flags & KMUTEX_FL_PI)
+         pi_lock_acquired(&m->pi, m->owner_task);
+
+      LOCKSTAT_ONLY(lockstat_acquired(&m->lstat, LOCKSTAT_KMUTEX, 0));
       kmutex_lock_enable_preemption_wrapper(m);
       enable_preemption();
       return;
@@ -76,7 +197,19 @@ void kmutex_lock(struct kmutex *m)
    m->max_num_waiters = MAX(m->num_waiters, m->max_num_waiters);
 #endif
 
+   LOCKSTAT_ONLY(const u64 wait_start = RDTSC());
    prepare_to_wait_on(WOBJ_KMUTEX, m, NO_EXTRA, &m->wait_list);
+
+   if (m->flags & KMUTEX_FL_PI) {
+
+      struct task *curr = get_curr_task();
+
+      /* Wait in priority order and lend our priority to the owner */
+      list_remove(&curr->wobj.wait_list_node);
+      kmutex_pi_enqueue(m, curr);
+      pi_boost_owner(m->owner_task, curr);
+   }
+
    kmutex_lock_enable_preemption_wrapper(m);
 
    /*
@@ -93,6 +226,7 @@ void kmutex_lock(struct kmutex *m)
 
    /* Now for sure this task should hold the mutex */
    ASSERT(kmutex_is_curr_task_holding_lock(m));
+   LOCKSTAT_ONLY(lockstat_acquired(&m->lstat, LOCKSTAT_KMUTEX, wait_start));
 
    /*
     * DEBUG check: in case we went to sleep with a recursive mutex, then the
@@ -119,6 +253,11 @@ bool kmutex_trylock(struct kmutex *m)
       if (m->flags & KMUTEX_FL_RECURSIVE)
          m->lock_count++;
 
+      if (m->flags & KMUTEX_FL_PI)
+         pi_lock_acquired(&m->pi, m->owner_task);
+
+      LOCKSTAT_ONLY(lockstat_acquired(&m->lstat, LOCKSTAT_KMUTEX, 0));
+
    } else {
 
       /*
@@ -161,8 +300,15 @@ void kmutex_unlock(struct kmutex *m)
    }
 
    m->owner_task = NULL;
+   LOCKSTAT_ONLY(lockstat_released(&m->lstat));
+
+   if (m->flags & KMUTEX_FL_PI)
+      pi_lock_released(&m->pi, get_curr_task());
 
-   /* Unlock one task waiting to acquire the mutex 'm' (if any) */
+   /*
+    * Unlock one task waiting to acquire the mutex 'm' (if any). With PI, the
+    * first one is the one with the highest priority.
+    */
    if (!list_is_empty(&m->wait_list)) {
 
       struct wait_obj *task_wo =
@@ -178,6 +324,9 @@ void kmutex_unlock(struct kmutex *m)
       ASSERT_TASK_STATE(ti->state, TASK_STATE_SLEEPING);
       wake_up(ti);
 
+      if (m->flags & KMUTEX_FL_PI)
+         pi_lock_acquired(&m->pi, ti);
+
    } // if (!list_is_empty(&m->wait_list))
 
    enable_preemption();
@@ -0,0 +1,267 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_debug.h>
+#include <tilck_gen_headers/mod_sysfs.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/lockstat.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/elf_utils.h>
+
+#if MOD_sysfs
+   #include <tilck/mods/sysfs.h>
+   #include <tilck/mods/sysfs_utils.h>
+#endif
+
+#if KRN_LOCKSTAT
+
+/*
+ * Open addressing hash table, keyed by the class key. Classes are never
+ * removed, therefore there's no need for tombstones.
+ */
+static struct lockstat_class lockstat_classes[LOCKSTAT_MAX_CLASSES];
+
+u32 lockstat_classes_count;
+u32 lockstat_untracked;       /* locks not tracked because the table is full */
+
+static ALWAYS_INLINE u32 lockstat_hash(const void *key)
+{
+   return ((u32)(ulong)key * 2654435761u) >> (32 - LOCKSTAT_HASH_BITS);
+}
+
+static struct lockstat_class *
+lockstat_get_class(const void *key, enum lockstat_type type)
+{
+   const u32 h = lockstat_hash(key);
+   struct lockstat_class *c;
+
+   for (u32 i = 0; i < LOCKSTAT_MAX_CLASSES; i++) {
+
+      c = &lockstat_classes[(h + i) & (LOCKSTAT_MAX_CLASSES - 1)];
+
+      if (c->key == key)
+         return c;
+
+      if (!c->key) {
+         c->key = key;
+         c->type = type;
+         lockstat_classes_count++;
+         return c;
+      }
+   }
+
+   return NULL;
+}
+
+static struct lockstat_class *
+lockstat_get_lock_class(struct lockstat *ls, enum lockstat_type type)
+{
+   if (LIKELY(ls->cls != NULL))
+      return ls->cls;
+
+   if (!ls->key)
+      return NULL;
+
+   if (!(ls->cls = lockstat_get_class(ls->key, type))) {
+
+      /* No free classes: stop tracking this lock */
+      ls->key = NULL;
+      lockstat_untracked++;
+      return NULL;
+   }
+
+   ls->cls->locks++;
+   return ls->cls;
+}
+
+void
+lockstat_acquired(struct lockstat *ls, enum lockstat_type type, u64 wait_start)
+{
+   const u64 now = RDTSC();
+   struct lockstat_class *c;
+
+   disable_preemption();
+
+   if ((c = lockstat_get_lock_class(ls, type))) {
+
+      c->acquired++;
+
+      if (wait_start) {
+
+         const u64 wait = now - wait_start;
+
+         c->contended++;
+         c->wait_tot += wait;
+         c->wait_max = MAX(c->wait_max, wait);
+      }
+
+      ls->acq_cycles = now;
+   }
+
+   enable_preemption();
+}
+
+void lockstat_released(struct lockstat *ls)
+{
+   const u64 now = RDTSC();
+   struct lockstat_class *c;
+   u64 hold;
+
+   disable_preemption();
+
+   if ((c = ls->cls) && ls->acq_cycles) {
+
+      hold = now - ls->acq_cycles;
+      ls->acq_cycles = 0;
+
+      c->holds++;
+      c->hold_tot += hold;
+      c->hold_max = MAX(c->hold_max, hold);
+   }
+
+   enable_preemption();
+}
+
+/* Copies the used classes in `buf` and returns their number */
+u32 lockstat_get_classes(struct lockstat_class *buf, u32 max_count)
+{
+   u32 count = 0;
+
+   disable_preemption();
+
+   for (u32 i = 0; i < LOCKSTAT_MAX_CLASSES && count < max_count; i++) {
+      if (lockstat_classes[i].key)
+         buf[count++] = lockstat_classes[i];
+   }
+
+   enable_preemption();
+   return count;
+}
+
+/*
+ * The name of a class is the symbol of its key: the function calling the
+ * lock's init function (+ offset) or the name of the static lock itself.
+ */
+void
+lockstat_get_class_name(const struct lockstat_class *c,
+                        char *buf,
+                        size_t buf_sz)
+{
+   long off = 0;
+   const char *sym = find_sym_at_addr((ulong)c->key, &off, NULL);
+
+   if (!sym)
+      snprintk(buf, buf_sz, "%p", c->key);
+   else if (off)
+      snprintk(buf, buf_sz, "%s+0x%lx", sym, off);
+   else
+      snprintk(buf, buf_sz, "%s", sym);
+}
+
+const char *lockstat_get_type_name(u32 type)
+{
+   switch (type) {
+      case LOCKSTAT_KMUTEX:      return "mutex";
+      case LOCKSTAT_RWLOCK_WP:   return "rwlock";
+      case LOCKSTAT_KCOND:       return "cond";
+   }
+
+   return "?";
+}
+
+/* ----------------------- /syst/lockstat/ files ------------------------ */
+
+#if MOD_sysfs
+
+#define LOCKSTAT_NAME_MAX                                        64
+#define LOCKSTAT_LINE_MAX               (LOCKSTAT_NAME_MAX + 8 + 21 * 8)
+#define LOCKSTAT_HEADER_MAX                                     256
+
+static offt
+lockstat_classes_get_buf_sz(struct sysobj *obj, void *data)
+{
+   /* Allow all the classes that might be created in the meanwhile */
+   return LOCKSTAT_HEADER_MAX + LOCKSTAT_MAX_CLASSES * LOCKSTAT_LINE_MAX;
+}
+
+static offt
+lockstat_classes_load(struct sysobj *obj, void *data,
+                      void *buf, offt buf_sz, offt off)
+{
+   const size_t sz = (size_t)buf_sz;
+   char name[LOCKSTAT_NAME_MAX];
+   struct lockstat_class c;
+   char *p = buf;
+   size_t used;
+
+   ASSERT(off == 0);
+
+   used = (size_t)snprintk(p, sz,
+                           "# classes: %u, untracked locks: %u\n"
+                           "# name type locks acquired contended "
+                           "wait_cycles max_wait_cycles "
+                           "holds hold_cycles max_hold_cycles\n",
+                           lockstat_classes_count, lockstat_untracked);
+
+   for (u32 i = 0; i < LOCKSTAT_MAX_CLASSES && used < sz; i++) {
+
+      disable_preemption();
+      {
+         c = lockstat_classes[i];
+      }
+      enable_preemption();
+
+      if (!c.key)
+         continue;
+
+      lockstat_get_class_name(&c, name, sizeof(name));
+
+      used += (size_t)snprintk(p + used, sz - used,
+                               "%s %s %u %llu %llu %llu %llu "
+                               "%llu %llu %llu\n",
+                               name, lockstat_get_type_name(c.type),
+                               c.locks, c.acquired, c.contended,
+                               c.wait_tot, c.wait_max,
+                               c.holds, c.hold_tot, c.hold_max);
+   }
+
+   return (offt)MIN(used, sz);
+}
+
+static const struct sysobj_prop_type lockstat_classes_prop_type = {
+   .buf_type = SYSFS_BUF_BUFFERED,
+   .get_buf_sz = &lockstat_classes_get_buf_sz,
+   .load = &lockstat_classes_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(classes, &lockstat_classes_prop_type);
+
+DEF_STATIC_SYSOBJ_TYPE(lockstat_sysobj_type,
+                       &prop_classes,
+                       NULL);
+
+void register_lockstat_sysfs(void)
+{
+   struct sysobj *obj = sysfs_create_obj(&lockstat_sysobj_type, NULL, NULL);
+
+   if (!obj) {
+      printk("WARNING: /syst/lockstat not registered: out of memory\n");
+      return;
+   }
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "lockstat", obj) < 0) {
+      printk("WARNING: /syst/lockstat not registered\n");
+      sysfs_destroy_unregistered_obj(obj);
+   }
+}
+
+#else  /* !MOD_sysfs */
+
+void register_lockstat_sysfs(void) { /* no-op */ }
+
+#endif /* MOD_sysfs */
+#endif /* KRN_LOCKSTAT */
@@ -11,6 +11,7 @@
 #include <tilck/common/string_util.h>
 #include <tilck/common/printk.h>
 #include <tilck/common/utils.h>
+#include <tilck/common/lz4.h>
 
 #include <multiboot.h>
 
@@ -19,6 +20,7 @@
 #include <tilck/kernel/irq.h>
 #include <tilck/kernel/net.h>
 #include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/page_alloc.h>
 #include <tilck/kernel/debug_utils.h>
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/elf_loader.h>
@@ -36,6 +38,8 @@
 #include <tilck/kernel/fs/kernelfs.h>
 #include <tilck/kernel/fs/vfs.h>
 #include <tilck/kernel/uefi.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/boot_trace.h>
 
 #include <tilck/mods/console.h>
 #include <tilck/mods/fb_console.h>
@@ -260,6 +264,46 @@ out:
    saved_multiboot_mbi = NULL;
 }
 
+/*
+ * Fallback for LZ4-compressed ramdisks not decompressed by the bootloader
+ * (e.g. when booted by QEMU's -initrd or by U-Boot). The compressed ramdisk
+ * stays in its reserved memory region, while the decompressed one lives in
+ * vmalloc'd memory, with one extra page for fat_ramdisk_prepare_for_mmap().
+ */
+static void *
+decompress_lz4_ramdisk(void *ramdisk, size_t *ramdisk_size)
+{
+   struct lz4f_info info;
+   size_t size;
+   void *buf;
+   u64 start;
+   long rc;
+
+   if (lz4f_read_header(ramdisk, (u32)*ramdisk_size, &info))
+      panic("Unsupported LZ4 ramdisk");
+
+   if (!info.content_size || info.content_size >= 1ull << 31)
+      panic("Unsupported LZ4 ramdisk: content size: %llu", info.content_size);
+
+   size = pow2_round_up_at((size_t)info.content_size + PAGE_SIZE, PAGE_SIZE);
+
+   if (!(buf = vmalloc(size)))
+      panic("No memory for decompressing the LZ4 ramdisk");
+
+   start = get_sys_time();
+   rc = lz4f_decompress(ramdisk, (u32)*ramdisk_size, buf, (u32)size);
+
+   if (rc != (long)info.content_size)
+      panic("LZ4 ramdisk corrupted");
+
+   printk("initrd: LZ4 ramdisk: %u -> %u KB in %u ms\n",
+          (u32)(*ramdisk_size / KB), (u32)(rc / KB),
+          (u32)((get_sys_time() - start) / (TS_SCALE / 1000)));
+
+   *ramdisk_size = size;
+   return buf;
+}
+
 static void
 mount_initrd(void)
 {
@@ -296,7 +340,12 @@ mount_initrd(void)
 
    if (LIKELY(ramdisk != NULL)) {
 
-      if (!(initrd = fat_mount_ramdisk(ramdisk, ramdisk_size, 0)))
+      const u32 flags = kopt_initrd_rw ? VFS_FS_RW : 0;
+
+      if (ramdisk_size >= LZ4F_MAX_HEADER_SIZE && lz4f_is_frame(ramdisk))
+         ramdisk = decompress_lz4_ramdisk(ramdisk, &ramdisk_size);
+
+      if (!(initrd = fat_mount_ramdisk(ramdisk, ramdisk_size, flags)))
          panic("Unable to mount the initrd fat32 RAMDISK");
 
       if ((rc = vfs_mkdir("/initrd", 0777)))
@@ -341,12 +390,13 @@ static void do_async_init(void *unused)
    /* declare the show_hello_message() function */
    void show_hello_message(void);
 
-   mount_initrd();
-   init_devfs();
-   init_modules();
-   init_extra_debug_features();
+   BOOT_TRACE(ASYNC, mount_initrd);
+   BOOT_TRACE(ASYNC, init_devfs);
+   BOOT_TRACE(ASYNC, init_modules);
+   BOOT_TRACE(ASYNC, init_extra_debug_features);
 
    show_hello_message();
+   boot_trace_mark("run_init");
    run_init_or_selftest();
 }
 
@@ -360,34 +410,37 @@ async_init(void)
 void
 kmain(u32 multiboot_magic, u32 mbi_addr)
 {
-   call_kernel_global_ctors();
+   BOOT_TRACE(INIT, call_kernel_global_ctors);
    save_multiboot_info(multiboot_magic, mbi_addr);
 
-   early_init_serial_ports();
-   init_cpu_exception_handling();
-   early_init_paging();
-   early_init_kmalloc();
-
-   read_multiboot_info();
-   enable_cpu_features();
-   kmain_early_checks();
-   init_segmentation();
-   init_fpu_memcpy();
-   init_kmalloc();
-   init_paging();
-
-   setup_uefi_runtime_services();
-   acpi_mod_init_tables();
-
-   init_console();
-   init_self_tests();
-   init_irq_handling();
-   init_sched();
-   init_syscall_interfaces();
-   init_worker_threads();
-   init_timer();
-   init_system_time();
-   init_kernelfs();
+   BOOT_TRACE(INIT, early_init_serial_ports);
+   BOOT_TRACE(INIT, init_cpu_exception_handling);
+   BOOT_TRACE(INIT, early_init_paging);
+   BOOT_TRACE(INIT, early_init_kmalloc);
+
+   BOOT_TRACE(INIT, read_multiboot_info);
+   BOOT_TRACE(INIT, enable_cpu_features);
+   BOOT_TRACE(INIT, kmain_early_checks);
+   BOOT_TRACE(INIT, init_segmentation);
+   BOOT_TRACE(INIT, init_fpu_memcpy);
+   BOOT_TRACE(INIT, init_kmalloc);
+   BOOT_TRACE(INIT, init_paging);
+   BOOT_TRACE(INIT, init_page_alloc);
+
+   BOOT_TRACE(INIT, setup_uefi_runtime_services);
+   BOOT_TRACE(INIT, acpi_mod_init_tables);
+
+   BOOT_TRACE(INIT, init_console);
+   BOOT_TRACE(INIT, init_self_tests);
+   BOOT_TRACE(INIT, init_irq_handling);
+   BOOT_TRACE(INIT, init_sched);
+   BOOT_TRACE(INIT, init_syscall_interfaces);
+   BOOT_TRACE(INIT, init_worker_threads);
+   BOOT_TRACE(INIT, init_page_alloc_worker);
+   BOOT_TRACE(INIT, init_timer);
+   BOOT_TRACE(INIT, init_system_time);
+   boot_trace_calibrate();
+   BOOT_TRACE(INIT, init_kernelfs);
 
    async_init();
    do_schedule();
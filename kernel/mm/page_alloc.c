@@ -0,0 +1,405 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_mm.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/page_alloc.h>
+#include <tilck/kernel/paging.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/list.h>
+#include <tilck/kernel/system_mmap.h>
+#include <tilck/kernel/worker_thread.h>
+
+STATIC_ASSERT(KRN_PAGE_ALLOC_POOL_PERCENT >= 1);
+STATIC_ASSERT(KRN_PAGE_ALLOC_POOL_PERCENT <= 90);
+STATIC_ASSERT(PAGE_ALLOC_ZERO_CACHE_LOW < PAGE_ALLOC_ZERO_CACHE_MAX);
+
+/*
+ * Per-pageframe info byte, indexed by (pfn - pool_first_pfn).
+ *
+ * Only the first pageframe of a free block is marked with PFI_FREE and the
+ * order of the block. All the other managed pageframes (allocated ones and
+ * the ones inside free blocks) have info == 0. The pageframes in the gaps
+ * between the pool's regions are marked as PFI_UNMANAGED.
+ */
+#define PFI_UNMANAGED                                0xff
+#define PFI_FREE                                     0x80
+#define PFI_ORDER_MASK                               0x1f
+
+STATIC_ASSERT(PAGE_ALLOC_MAX_ORDER <= PFI_ORDER_MASK);
+
+static u8 *pf_info;
+static ulong pool_first_pfn;
+static ulong pool_pfn_count;
+
+/* The free blocks are linked through their first page (linear mapping) */
+static struct list free_lists[PAGE_ALLOC_MAX_ORDER + 1];
+static size_t free_blocks[PAGE_ALLOC_MAX_ORDER + 1];
+static size_t tot_pages;
+static size_t free_pages_count;
+static size_t fallback_allocs;
+
+static struct list zero_cache;
+static size_t zero_cache_count;
+static bool zero_cache_refill_pending;
+static struct worker_thread *zero_cache_wth;
+
+static ALWAYS_INLINE ulong va_to_pfn(void *va)
+{
+   return LIN_VA_TO_PA(va) >> PAGE_SHIFT;
+}
+
+static ALWAYS_INLINE void *pfn_to_va(ulong pfn)
+{
+   return PA_TO_LIN_VA(pfn << PAGE_SHIFT);
+}
+
+static ALWAYS_INLINE bool is_pool_pfn(ulong pfn)
+{
+   const ulong idx = pfn - pool_first_pfn;
+   return idx < pool_pfn_count && pf_info[idx] != PFI_UNMANAGED;
+}
+
+static void free_list_add(ulong pfn, u32 order)
+{
+   list_add_head(&free_lists[order], pfn_to_va(pfn));
+   pf_info[pfn - pool_first_pfn] = (u8)(PFI_FREE | order);
+   free_blocks[order]++;
+}
+
+static void free_list_remove(ulong pfn, u32 order)
+{
+   ASSERT(pf_info[pfn - pool_first_pfn] == (PFI_FREE | order));
+   list_remove(pfn_to_va(pfn));
+   pf_info[pfn - pool_first_pfn] = 0;
+   free_blocks[order]--;
+}
+
+static void *__alloc_pages(u32 order)
+{
+   struct list_node *n;
+   ulong pfn;
+   u32 o;
+
+   ASSERT(!is_preemption_enabled());
+
+   for (o = order; o <= PAGE_ALLOC_MAX_ORDER; o++)
+      if (!list_is_empty(&free_lists[o]))
+         break;
+
+   if (o > PAGE_ALLOC_MAX_ORDER)
+      return NULL;
+
+   n = free_lists[o].first;
+   pfn = va_to_pfn(n);
+   free_list_remove(pfn, o);
+
+   /* Split the block, giving back to the free lists the upper halves */
+   while (o > order) {
+      o--;
+      free_list_add(pfn + (1ul << o), o);
+   }
+
+   free_pages_count -= (1ul << order);
+   return pfn_to_va(pfn);
+}
+
+static void __free_pages(ulong pfn, u32 order)
+{
+   ulong buddy;
+
+   ASSERT(!is_preemption_enabled());
+   ASSERT(is_pool_pfn(pfn));
+   ASSERT(pf_info[pfn - pool_first_pfn] == 0);
+
+   free_pages_count += (1ul << order);
+
+   /* Merge the block with its buddy, as long as the buddy is free */
+   while (order < PAGE_ALLOC_MAX_ORDER) {
+
+      buddy = pfn ^ (1ul << order);
+
+      if (!is_pool_pfn(buddy))
+         break;
+
+      if (pf_info[buddy - pool_first_pfn] != (PFI_FREE | order))
+         break;
+
+      free_list_remove(buddy, order);
+      pfn &= ~(1ul << order);
+      order++;
+   }
+
+   free_list_add(pfn, order);
+}
+
+void *alloc_pages(u32 order)
+{
+   void *va;
+   ASSERT(order <= PAGE_ALLOC_MAX_ORDER);
+
+   if (!tot_pages)
+      return NULL;
+
+   disable_preemption();
+   {
+      va = __alloc_pages(order);
+   }
+   enable_preemption();
+   return va;
+}
+
+void free_pages(void *vaddr, u32 order)
+{
+   ASSERT(order <= PAGE_ALLOC_MAX_ORDER);
+   ASSERT(IS_PAGE_ALIGNED(vaddr));
+
+   disable_preemption();
+   {
+      __free_pages(va_to_pfn(vaddr), order);
+   }
+   enable_preemption();
+}
+
+static void *zero_cache_pop(void)
+{
+   struct list_node *n;
+
+   if (list_is_empty(&zero_cache))
+      return NULL;
+
+   n = zero_cache.first;
+   list_remove(n);
+   zero_cache_count--;
+
+   /* The list node was the only non-zero thing in the page */
+   bzero(n, sizeof(*n));
+   return n;
+}
+
+static void zero_cache_refill_job(void *unused)
+{
+   void *va;
+
+   while (true) {
+
+      disable_preemption();
+
+      if (zero_cache_count >= PAGE_ALLOC_ZERO_CACHE_MAX ||
+          !(va = __alloc_pages(0)))
+      {
+         zero_cache_refill_pending = false;
+         enable_preemption();
+         break;
+      }
+
+      enable_preemption();
+
+      /* The page is ours: zero it with preemption enabled */
+      bulk_bzero(va, PAGE_SIZE);
+
+      disable_preemption();
+      {
+         list_add_tail(&zero_cache, va);
+         zero_cache_count++;
+      }
+      enable_preemption();
+   }
+}
+
+static void zero_cache_check_watermark(void)
+{
+   ASSERT(!is_preemption_enabled());
+
+   if (zero_cache_count >= PAGE_ALLOC_ZERO_CACHE_LOW)
+      return;
+
+   if (!zero_cache_wth || zero_cache_refill_pending || !free_pages_count)
+      return;
+
+   if (wth_enqueue_on(zero_cache_wth, &zero_cache_refill_job, NULL))
+      zero_cache_refill_pending = true;
+}
+
+void *alloc_pageframe(u32 flags)
+{
+   const bool zero = !!(flags & PAGE_ALLOC_FL_ZERO);
+   bool zeroed = false;
+   void *va = NULL;
+
+   if (tot_pages) {
+
+      disable_preemption();
+      {
+         if (zero)
+            zeroed = !!(va = zero_cache_pop());
+
+         if (!va)
+            va = __alloc_pages(0);
+
+         if (!va)
+            zeroed = !!(va = zero_cache_pop()); /* last resort */
+
+         if (!va)
+            fallback_allocs++;
+
+         zero_cache_check_watermark();
+      }
+      enable_preemption();
+   }
+
+   if (!va && !(va = kmalloc(PAGE_SIZE)))
+      return NULL;
+
+   ASSERT(IS_PAGE_ALIGNED(va));
+   ASSERT(get_pageframe_ref_count(LIN_VA_TO_PA(va)) == 0);
+
+   if (zero && !zeroed)
+      bulk_bzero(va, PAGE_SIZE);
+
+   return va;
+}
+
+void free_pageframe(void *vaddr)
+{
+   const ulong paddr = LIN_VA_TO_PA(vaddr);
+
+   ASSERT(IS_PAGE_ALIGNED(vaddr));
+   ASSERT(get_pageframe_ref_count(paddr) == 0);
+
+   if (!is_page_alloc_frame(paddr)) {
+      kfree2(vaddr, PAGE_SIZE);
+      return;
+   }
+
+   disable_preemption();
+   {
+      __free_pages(paddr >> PAGE_SHIFT, 0);
+   }
+   enable_preemption();
+}
+
+bool is_page_alloc_frame(ulong paddr)
+{
+   return pf_info && is_pool_pfn(paddr >> PAGE_SHIFT);
+}
+
+void page_alloc_get_stats(struct page_alloc_stats *stats)
+{
+   bzero(stats, sizeof(*stats));
+   stats->largest_free_order = -1;
+
+   disable_preemption();
+   {
+      stats->tot_pages = tot_pages;
+      stats->free_pages = free_pages_count;
+      stats->zero_cache_pages = zero_cache_count;
+      stats->fallback_allocs = fallback_allocs;
+
+      for (int i = 0; i <= PAGE_ALLOC_MAX_ORDER; i++) {
+
+         stats->free_blocks[i] = free_blocks[i];
+
+         if (free_blocks[i])
+            stats->largest_free_order = i;
+      }
+   }
+   enable_preemption();
+}
+
+static void add_free_range(ulong pfn, ulong end_pfn)
+{
+   while (pfn < end_pfn) {
+
+      u32 order = PAGE_ALLOC_MAX_ORDER;
+
+      /* Add the biggest naturally-aligned block fitting in the range */
+      while (order > 0) {
+
+         if (!(pfn & ((1ul << order) - 1)) && pfn + (1ul << order) <= end_pfn)
+            break;
+
+         order--;
+      }
+
+      free_list_add(pfn, order);
+      free_pages_count += (1ul << order);
+      pfn += (1ul << order);
+   }
+}
+
+void init_page_alloc(void)
+{
+   struct mem_region r;
+   ulong first = ~0ul, end = 0;
+
+   for (int i = 0; i <= PAGE_ALLOC_MAX_ORDER; i++)
+      list_init(&free_lists[i]);
+
+   list_init(&zero_cache);
+   bzero(free_blocks, sizeof(free_blocks));
+   pf_info = NULL;
+   tot_pages = free_pages_count = fallback_allocs = zero_cache_count = 0;
+
+   if (!KRN_PAGE_ALLOC)
+      return;
+
+   ASSERT(!is_preemption_enabled());
+
+   for (int i = 0; i < get_mem_regions_count(); i++) {
+
+      get_mem_region(i, &r);
+
+      if (r.extra != MEM_REG_EXTRA_PAGE_ALLOC)
+         continue;
+
+      first = MIN(first, (ulong)(r.addr >> PAGE_SHIFT));
+      end = MAX(end, (ulong)((r.addr + r.len) >> PAGE_SHIFT));
+   }
+
+   if (!end)
+      return; /* No memory reserved for the page allocator */
+
+   if (!(pf_info = kmalloc(end - first)))
+      panic("Unable to allocate the page allocator's metadata");
+
+   memset(pf_info, PFI_UNMANAGED, end - first);
+   pool_first_pfn = first;
+   pool_pfn_count = end - first;
+
+   for (int i = 0; i < get_mem_regions_count(); i++) {
+
+      get_mem_region(i, &r);
+
+      if (r.extra != MEM_REG_EXTRA_PAGE_ALLOC)
+         continue;
+
+      const ulong rfirst = (ulong)(r.addr >> PAGE_SHIFT);
+      const ulong rend = (ulong)((r.addr + r.len) >> PAGE_SHIFT);
+
+      bzero(pf_info + (rfirst - first), rend - rfirst);
+      tot_pages += rend - rfirst;
+      add_free_range(rfirst, rend);
+   }
+
+   printk("page_alloc: %zu KB in the pool\n", tot_pages << (PAGE_SHIFT - 10));
+}
+
+void init_page_alloc_worker(void)
+{
+   if (!tot_pages)
+      return;
+
+   zero_cache_wth =
+      wth_create_thread("pg_zero", WTH_PRIO_LOWEST, 4 /* queue size */);
+
+   if (!zero_cache_wth)
+      panic("page_alloc: unable to create the zero-cache worker thread");
+
+   zero_cache_check_watermark();
+}
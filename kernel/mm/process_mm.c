@@ -9,12 +9,25 @@
 #include <tilck/kernel/process.h>
 #include <tilck/kernel/process_mm.h>
 #include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/page_alloc.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/fs/devfs.h>
 #include <tilck/kernel/syscalls.h>
 
 #include <sys/mman.h>      // system header
 
+#ifndef MAP_FIXED_NOREPLACE
+   #define MAP_FIXED_NOREPLACE      0x100000
+#endif
+
+#ifndef MREMAP_MAYMOVE
+   #define MREMAP_MAYMOVE           1
+#endif
+
+#ifndef MREMAP_FIXED
+   #define MREMAP_FIXED             2
+#endif
+
 char page_size_buf[PAGE_SIZE] ALIGNED_AT(PAGE_SIZE);
 
 static void
@@ -50,7 +63,7 @@ brk_syscall_int(struct process *pi, void *new_brk)
 
    while (vaddr < new_brk) {
 
-      void *kernel_vaddr = kmalloc(PAGE_SIZE);
+      void *kernel_vaddr = alloc_pageframe(PAGE_ALLOC_FL_ZERO);
 
       if (!kernel_vaddr)
          break; /* we've allocated as much as possible */
@@ -58,7 +71,7 @@ brk_syscall_int(struct process *pi, void *new_brk)
       const ulong paddr = LIN_VA_TO_PA(kernel_vaddr);
 
       if (map_page(pi->pdir, vaddr, paddr, PAGING_FL_RWUS) != 0) {
-         kfree2(kernel_vaddr, PAGE_SIZE);
+         free_pageframe(kernel_vaddr);
          break;
       }
 
@@ -161,42 +174,108 @@ mmap_err_case_free(struct process *pi, void *ptr, size_t actual_len)
                   KFREE_FL_NO_ACTUAL_FREE);
 }
 
-static struct user_mapping *
-mmap_on_user_heap(struct process *pi,
-                  size_t *actual_len_ref,
-                  fs_handle handle,
-                  u32 per_heap_kmalloc_flags,
-                  size_t off,
-                  int prot)
+static int
+expand_mmap_heap(struct process *pi)
 {
-   void *res;
-   struct user_mapping *um;
+   struct kmalloc_heap *new_heap;
+   struct kmalloc_heap *h = pi->mi->mmap_heap;
+   size_t heap_sz = pi->mi->mmap_heap_size;
 
-   while (true) {
+   if (heap_sz == USER_MMAP_MAX_SZ)
+      return -ENOMEM; /* cannot expand the heap more than that */
+
+   new_heap = kmalloc_heap_dup_expanded(h, heap_sz * 2);
+
+   if (!new_heap)
+      return -ENOMEM; /* no enough memory */
+
+   pi->mi->mmap_heap_size = heap_sz * 2;
+   pi->mi->mmap_heap = new_heap;
+   kmalloc_destroy_heap(h);
+   return 0;
+}
+
+static inline bool
+is_in_mmap_area(ulong vaddr, size_t len)
+{
+   return vaddr >= USER_MMAP_BEGIN &&
+          len <= USER_MMAP_MAX_SZ &&
+          vaddr - USER_MMAP_BEGIN <= USER_MMAP_MAX_SZ - len;
+}
+
+static void *
+mmap_alloc_at(struct process *pi,
+              void *vaddrp,
+              size_t len,
+              u32 per_heap_kmalloc_flags)
+{
+   const ulong vaddr = (ulong)vaddrp;
+
+   ASSERT(is_in_mmap_area(vaddr, len));
+
+   while (vaddr + len > USER_MMAP_BEGIN + pi->mi->mmap_heap_size) {
+      if (expand_mmap_heap(pi))
+         return NULL;
+   }
+
+   return per_heap_kmalloc_at(pi->mi->mmap_heap,
+                              vaddrp,
+                              len,
+                              per_heap_kmalloc_flags);
+}
+
+static void *
+mmap_alloc(struct process *pi,
+           void *vaddr,
+           bool fixed,
+           size_t *actual_len_ref,
+           u32 per_heap_kmalloc_flags)
+{
+   void *res = NULL;
+
+   if (vaddr) {
 
-      struct kmalloc_heap *new_heap;
-      struct kmalloc_heap *h = pi->mi->mmap_heap;
-      size_t heap_sz = pi->mi->mmap_heap_size;
+      res = mmap_alloc_at(pi, vaddr, *actual_len_ref, per_heap_kmalloc_flags);
 
-      res = per_heap_kmalloc(h,
+      if (res || fixed)
+         return res;
+
+      /* `vaddr` was just a hint: fall-back to any address */
+   }
+
+   while (true) {
+
+      res = per_heap_kmalloc(pi->mi->mmap_heap,
                              actual_len_ref,
                              per_heap_kmalloc_flags);
 
       if (LIKELY(res != NULL))
          break;        /* great! */
 
-      if (heap_sz == USER_MMAP_MAX_SZ)
-         return NULL; /* cannot expand the heap more than that */
+      if (expand_mmap_heap(pi))
+         return NULL;
+   }
 
-      new_heap = kmalloc_heap_dup_expanded(h, heap_sz * 2);
+   return res;
+}
 
-      if (!new_heap)
-         return NULL; /* no enough memory */
+static struct user_mapping *
+mmap_on_user_heap(struct process *pi,
+                  void *vaddr,
+                  bool fixed,
+                  size_t *actual_len_ref,
+                  fs_handle handle,
+                  u32 per_heap_kmalloc_flags,
+                  size_t off,
+                  int prot)
+{
+   void *res;
+   struct user_mapping *um;
 
-      pi->mi->mmap_heap_size = heap_sz * 2;
-      pi->mi->mmap_heap = new_heap;
-      kmalloc_destroy_heap(h);
-   }
+   res = mmap_alloc(pi, vaddr, fixed, actual_len_ref, per_heap_kmalloc_flags);
+
+   if (!res)
+      return NULL;
 
    /* NOTE: here `handle` might be NULL (zero-map case) and that's OK */
    um = process_add_user_mapping(handle, res, *actual_len_ref, off, prot);
@@ -209,6 +288,74 @@ mmap_on_user_heap(struct process *pi,
    return um;
 }
 
+static u32
+mmap_prot_to_pg_flags(int prot)
+{
+   if (prot & PROT_WRITE)
+      return PAGING_FL_US | PAGING_FL_RW;
+
+   if (prot & PROT_READ)
+      return PAGING_FL_US;
+
+   /* PROT_NONE: keep the pages mapped, but make them kernel-only */
+   return 0;
+}
+
+static void
+set_user_range_prot(struct process *pi, void *vaddrp, size_t len, int prot)
+{
+   const u32 pg_flags = mmap_prot_to_pg_flags(prot);
+   void *const vend = vaddrp + len;
+
+   for (void *va = vaddrp; va < vend; va += PAGE_SIZE) {
+
+      /* File mappings might have pages not mapped yet (lazy mapping) */
+      if (is_mapped(pi->pdir, va))
+         set_page_prot(pi->pdir, va, pg_flags);
+   }
+}
+
+static bool
+is_user_range_mapped(struct process *pi, ulong vaddr, size_t len)
+{
+   struct user_mapping *pos;
+
+   list_for_each_ro(pos, &pi->mi->mappings, pi_node) {
+
+      if (pos->vaddr < vaddr + len && vaddr < pos->vaddr + pos->len)
+         return true;
+   }
+
+   return false;
+}
+
+static int munmap_int(struct process *pi, void *vaddrp, size_t len);
+
+/*
+ * Un-map all the parts of the user mappings intersecting [vaddr, vaddr + len).
+ * Unlike munmap_int(), the range can span multiple mappings and holes.
+ */
+static int
+munmap_range_int(struct process *pi, ulong vaddr, size_t len)
+{
+   struct user_mapping *pos, *temp;
+   const ulong vend = vaddr + len;
+   int rc;
+
+   list_for_each(pos, temp, &pi->mi->mappings, pi_node) {
+
+      const ulong s = MAX(vaddr, pos->vaddr);
+      const ulong e = MIN(vend, pos->vaddr + pos->len);
+
+      if (s < e) {
+         if ((rc = munmap_int(pi, (void *)s, e - s)))
+            return rc;
+      }
+   }
+
+   return 0;
+}
+
 long
 sys_mmap_pgoff(void *addr, size_t len, int prot,
                int flags, int fd, size_t pgoffset)
@@ -218,6 +365,7 @@ sys_mmap_pgoff(void *addr, size_t len, int prot,
    struct process *pi = curr->pi;
    struct fs_handle_base *handle = NULL;
    struct user_mapping *um = NULL;
+   const bool fixed = !!(flags & (MAP_FIXED | MAP_FIXED_NOREPLACE));
    size_t actual_len;
    int rc, fl;
 
@@ -227,14 +375,26 @@ sys_mmap_pgoff(void *addr, size_t len, int prot,
    if (!len)
       return -EINVAL;
 
-   if (addr)
-      return -EINVAL; /* addr != NULL not supported */
-
-   if (!(prot & PROT_READ))
+   if (prot & ~(PROT_READ | PROT_WRITE | PROT_EXEC))
       return -EINVAL;
 
    actual_len = pow2_round_up_at(len, PAGE_SIZE);
 
+   if (fixed) {
+
+      if (!IS_PAGE_ALIGNED(addr))
+         return -EINVAL;
+
+      if (!is_in_mmap_area((ulong)addr, actual_len))
+         return -ENOMEM; /* Tilck supports mmap() only in its mmap area */
+
+   } else if (addr) {
+
+      /* `addr` is just a hint: ignore it, if cannot be used as it is */
+      if (!IS_PAGE_ALIGNED(addr) || !is_in_mmap_area((ulong)addr, actual_len))
+         addr = NULL;
+   }
+
    if (fd == -1) {
 
       if (!(flags & MAP_ANONYMOUS))
@@ -246,8 +406,8 @@ sys_mmap_pgoff(void *addr, size_t len, int prot,
       if (!(flags & MAP_PRIVATE))
          return -EINVAL;
 
-      if ((prot & (PROT_READ | PROT_WRITE)) != (PROT_READ | PROT_WRITE))
-         return -EINVAL;
+      if (prot & (PROT_WRITE | PROT_EXEC))
+         prot |= PROT_READ; /* write-only or exec-only pages don't exist */
 
       if (pgoffset != 0)
          return -EINVAL; /* pgoffset != 0 does not make sense here */
@@ -286,15 +446,35 @@ sys_mmap_pgoff(void *addr, size_t len, int prot,
 
    disable_preemption();
    {
-      um = mmap_on_user_heap(pi,
-                             &actual_len,
-                             handle,
-                             per_heap_kmalloc_flags,
-                             pgoffset << PAGE_SHIFT,
-                             prot);
+      rc = 0;
+
+      if (flags & MAP_FIXED_NOREPLACE) {
+
+         if (is_user_range_mapped(pi, (ulong)addr, actual_len))
+            rc = -EEXIST;
+
+      } else if (flags & MAP_FIXED) {
+
+         /* Discard any existing mapping overlapping with the new one */
+         rc = munmap_range_int(pi, (ulong)addr, actual_len);
+      }
+
+      if (!rc) {
+         um = mmap_on_user_heap(pi,
+                                addr,
+                                fixed,
+                                &actual_len,
+                                handle,
+                                per_heap_kmalloc_flags,
+                                pgoffset << PAGE_SHIFT,
+                                prot);
+      }
    }
    enable_preemption();
 
+   if (rc)
+      return rc;
+
    if (!um)
       return -ENOMEM;
 
@@ -324,6 +504,14 @@ sys_mmap_pgoff(void *addr, size_t len, int prot,
 
       if (MMAP_NO_COW)
          bzero(um->vaddrp, actual_len);
+
+      if (!(prot & PROT_WRITE)) {
+         disable_preemption();
+         {
+            set_user_range_prot(pi, um->vaddrp, actual_len, prot);
+         }
+         enable_preemption();
+      }
    }
 
    return (long)um->vaddr;
@@ -451,6 +639,9 @@ int sys_munmap(void *vaddrp, size_t len)
    if (!len || !pi->mi->mmap_heap)
       return -EINVAL;
 
+   if (!IS_PAGE_ALIGNED(vaddr))
+      return -EINVAL;
+
    if (!IN_RANGE(vaddr,
                  USER_MMAP_BEGIN,
                  USER_MMAP_BEGIN + pi->mi->mmap_heap_size))
@@ -460,9 +651,316 @@ int sys_munmap(void *vaddrp, size_t len)
 
    disable_preemption();
    {
-      rc = munmap_int(pi, vaddrp, len);
+      rc = munmap_range_int(pi, vaddr, pow2_round_up_at(len, PAGE_SIZE));
+   }
+   enable_preemption();
+   return rc;
+}
+
+/*
+ * Split `um` in two mappings: [um->vaddr, at) and [at, um end). Returns the
+ * 2nd one, or NULL in case of out-of-memory (leaving `um` unchanged).
+ */
+static struct user_mapping *
+split_user_mapping(struct process *pi, struct user_mapping *um, ulong at)
+{
+   const ulong um_vend = um->vaddr + um->len;
+   struct user_mapping *um2;
+
+   ASSERT(!is_preemption_enabled());
+   ASSERT(IS_PAGE_ALIGNED(at));
+   ASSERT(um->vaddr < at && at < um_vend);
+
+   /* Shrink `um` first: process_add_user_mapping() requires no overlaps */
+   um->len = at - um->vaddr;
+
+   um2 = process_add_user_mapping(um->h,
+                                  (void *)at,
+                                  um_vend - at,
+                                  um->off + um->len,
+                                  um->prot);
+
+   if (!um2) {
+      um->len = um_vend - um->vaddr;
+      return NULL;
+   }
+
+   if (um->h)
+      vfs_mmap(um2, pi->pdir, VFS_MM_DONT_MMAP);
+
+   return um2;
+}
+
+static bool
+is_mapping_prot_allowed(struct user_mapping *um, int prot)
+{
+   struct fs_handle_base *hb = um->h;
+
+   if (!hb || !(prot & PROT_WRITE))
+      return true;
+
+   /* Same check as in sys_mmap_pgoff() */
+   return (hb->fl_flags & O_WRONLY) || (hb->fl_flags & O_RDWR) == O_RDWR;
+}
+
+static int
+mprotect_int(struct process *pi, ulong vaddr, size_t len, int prot)
+{
+   const ulong vend = vaddr + len;
+   struct user_mapping *um, *um2;
+   ulong va;
+
+   ASSERT(!is_preemption_enabled());
+
+   /*
+    * First, check the whole range without changing anything: all of its pages
+    * must belong to some mapping [Linux behavior].
+    */
+   for (va = vaddr; va < vend; va = um->vaddr + um->len) {
+
+      if (!(um = process_get_user_mapping((void *)va)))
+         return -ENOMEM;
+
+      if (!is_mapping_prot_allowed(um, prot))
+         return -EACCES;
+   }
+
+   for (va = vaddr; va < vend; va = um->vaddr + um->len) {
+
+      um = process_get_user_mapping((void *)va);
+      ASSERT(um != NULL);
+
+      if (um->prot == prot)
+         continue;
+
+      if (um->vaddr < va) {
+
+         if (!(um2 = split_user_mapping(pi, um, va)))
+            return -ENOMEM;
+
+         um = um2;
+      }
+
+      if (um->vaddr + um->len > vend) {
+         if (!split_user_mapping(pi, um, vend))
+            return -ENOMEM;
+      }
+
+      um->prot = prot;
+      set_user_range_prot(pi, um->vaddrp, um->len, prot);
+   }
+
+   return 0;
+}
+
+int sys_mprotect(void *addr, size_t len, int prot)
+{
+   struct process *pi = get_curr_proc();
+   const ulong vaddr = (ulong)addr;
+   int rc;
+
+   if (!IS_PAGE_ALIGNED(vaddr))
+      return -EINVAL;
+
+   if (prot & ~(PROT_READ | PROT_WRITE | PROT_EXEC))
+      return -EINVAL;
+
+   if (!len)
+      return 0;
+
+   len = pow2_round_up_at(len, PAGE_SIZE);
+
+   if (!pi->mi || !is_in_mmap_area(vaddr, len))
+      return -ENOMEM;
+
+   if (prot & (PROT_WRITE | PROT_EXEC))
+      prot |= PROT_READ; /* write-only or exec-only pages don't exist */
+
+   disable_preemption();
+   {
+      rc = mprotect_int(pi, vaddr, len, prot);
    }
    enable_preemption();
    return rc;
 }
 
+/*
+ * Move the first `old_len` bytes of the anonymous mapping at `old_vaddr` to
+ * a new mapping of `new_len` bytes, at `new_vaddr` if `fixed` or anywhere
+ * otherwise. The pages are moved by swapping the page table entries, not by
+ * copying their contents.
+ */
+static long
+mremap_move(struct process *pi,
+            struct user_mapping *um,
+            void *old_vaddr,
+            size_t old_len,
+            void *new_vaddr,
+            size_t new_len,
+            bool fixed)
+{
+   const size_t move_len = MIN(old_len, new_len);
+   const int prot = um->prot;
+   struct user_mapping *new_um;
+   void *res;
+   int rc;
+
+   ASSERT(!um->h);
+
+   res = mmap_alloc(pi,
+                    new_vaddr,
+                    fixed,
+                    &new_len,
+                    KMALLOC_FL_MULTI_STEP | PAGE_SIZE);
+
+   if (!res)
+      return -ENOMEM;
+
+   new_um = process_add_user_mapping(NULL, res, new_len, 0, prot);
+
+   if (!new_um) {
+      per_heap_kfree(pi->mi->mmap_heap,
+                     res,
+                     &new_len,
+                     KFREE_FL_ALLOW_SPLIT | KFREE_FL_MULTI_STEP);
+      return -ENOMEM;
+   }
+
+   for (size_t off = 0; off < move_len; off += PAGE_SIZE)
+      swap_page_mappings(pi->pdir, old_vaddr + off, res + off);
+
+   if ((rc = munmap_int(pi, old_vaddr, old_len))) {
+
+      /* Undo everything: the un-map of a whole mapping cannot fail */
+      for (size_t off = 0; off < move_len; off += PAGE_SIZE)
+         swap_page_mappings(pi->pdir, old_vaddr + off, res + off);
+
+      munmap_int(pi, res, new_len);
+      return rc;
+   }
+
+   if (!(prot & PROT_WRITE))
+      set_user_range_prot(pi, res, new_len, prot);
+
+   return (long)res;
+}
+
+static long
+mremap_int(struct process *pi,
+           void *old_vaddr,
+           size_t old_len,
+           size_t new_len,
+           int flags,
+           void *new_vaddr)
+{
+   const ulong old_end = (ulong)old_vaddr + old_len;
+   struct user_mapping *um;
+   int rc;
+
+   ASSERT(!is_preemption_enabled());
+   um = process_get_user_mapping(old_vaddr);
+
+   if (!um || old_end > um->vaddr + um->len)
+      return -EFAULT;
+
+   if (flags & MREMAP_FIXED) {
+
+      if (um->h)
+         return -EINVAL; /* moving file mappings is not supported */
+
+      if ((rc = munmap_range_int(pi, (ulong)new_vaddr, new_len)))
+         return rc;
+
+      return mremap_move(pi, um, old_vaddr, old_len,
+                         new_vaddr, new_len, true);
+   }
+
+   if (new_len <= old_len) {
+
+      if (new_len < old_len) {
+         if ((rc = munmap_int(pi, old_vaddr + new_len, old_len - new_len)))
+            return rc;
+      }
+
+      return (long)old_vaddr;
+   }
+
+   if (um->h)
+      return -EINVAL; /* growing file mappings is not supported */
+
+   /* Try first to expand the mapping in place */
+   if (old_end == um->vaddr + um->len &&
+       is_in_mmap_area(old_end, new_len - old_len))
+   {
+      const size_t delta = new_len - old_len;
+
+      if (mmap_alloc_at(pi,
+                        (void *)old_end,
+                        delta,
+                        KMALLOC_FL_MULTI_STEP | PAGE_SIZE))
+      {
+         um->len += delta;
+
+         if (MMAP_NO_COW)
+            bzero((void *)old_end, delta);
+
+         if (!(um->prot & PROT_WRITE))
+            set_user_range_prot(pi, (void *)old_end, delta, um->prot);
+
+         return (long)old_vaddr;
+      }
+   }
+
+   if (!(flags & MREMAP_MAYMOVE))
+      return -ENOMEM;
+
+   return mremap_move(pi, um, old_vaddr, old_len, NULL, new_len, false);
+}
+
+long sys_mremap(void *old_addr,
+                size_t old_len,
+                size_t new_len,
+                int flags,
+                void *new_addr)
+{
+   struct process *pi = get_curr_proc();
+   long rc;
+
+   if (!IS_PAGE_ALIGNED(old_addr))
+      return -EINVAL;
+
+   if (flags & ~(MREMAP_MAYMOVE | MREMAP_FIXED))
+      return -EINVAL;
+
+   if ((flags & MREMAP_FIXED) && !(flags & MREMAP_MAYMOVE))
+      return -EINVAL;
+
+   /* old_len == 0 (duplicate a shared mapping) is not supported */
+   if (!old_len || !new_len)
+      return -EINVAL;
+
+   old_len = pow2_round_up_at(old_len, PAGE_SIZE);
+   new_len = pow2_round_up_at(new_len, PAGE_SIZE);
+
+   if (!pi->mi || !is_in_mmap_area((ulong)old_addr, old_len))
+      return -EFAULT;
+
+   if (flags & MREMAP_FIXED) {
+
+      const ulong new_vaddr = (ulong)new_addr;
+      const ulong old_vaddr = (ulong)old_addr;
+
+      if (!IS_PAGE_ALIGNED(new_vaddr) || !is_in_mmap_area(new_vaddr, new_len))
+         return -EINVAL;
+
+      if (new_vaddr < old_vaddr + old_len && old_vaddr < new_vaddr + new_len)
+         return -EINVAL; /* the old and the new range overlap */
+   }
+
+   disable_preemption();
+   {
+      rc = mremap_int(pi, old_addr, old_len, new_len, flags, new_addr);
+   }
+   enable_preemption();
+   return rc;
+}
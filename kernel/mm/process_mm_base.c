@@ -3,6 +3,7 @@
 #include <tilck/kernel/process_mm.h>
 #include <tilck/kernel/process.h>
 #include <tilck/kernel/paging_hw.h>
+#include <tilck/kernel/page_alloc.h>
 
 struct user_mapping *
 process_add_user_mapping(fs_handle h,
@@ -141,7 +142,7 @@ void remove_all_file_mappings(struct process *pi)
 {
    fs_handle *h;
 
-   for (u32 i = 0; i < KRN_MAX_HANDLES; i++) {
+   for (u32 i = 0, end = get_fd_table_end(pi); i < end; i++) {
 
       if (!(h = pi->handles[i]))
          continue;
@@ -228,7 +229,7 @@ void user_vfree_and_unmap(ulong user_vaddr, size_t page_count)
    }
 }
 
-bool user_valloc_and_map_slow(ulong user_vaddr, size_t page_count)
+static bool user_valloc_and_map_per_page(ulong user_vaddr, size_t page_count)
 {
    pdir_t *pdir = get_curr_pdir();
    ulong pa, va = user_vaddr;
@@ -241,7 +242,7 @@ bool user_valloc_and_map_slow(ulong user_vaddr, size_t page_count)
          return false;
       }
 
-      if (!(kernel_vaddr = kmalloc(PAGE_SIZE))) {
+      if (!(kernel_vaddr = alloc_pageframe(0))) {
          user_vfree_and_unmap(user_vaddr, i);
          return false;
       }
@@ -249,7 +250,7 @@ bool user_valloc_and_map_slow(ulong user_vaddr, size_t page_count)
       pa = LIN_VA_TO_PA(kernel_vaddr);
 
       if (map_page(pdir, (void *)va, pa, PAGING_FL_RWUS) != 0) {
-         kfree2(kernel_vaddr, PAGE_SIZE);
+         free_pageframe(kernel_vaddr);
          user_vfree_and_unmap(user_vaddr, i);
          return false;
       }
@@ -263,12 +264,20 @@ bool user_valloc_and_map(ulong user_vaddr, size_t page_count)
    pdir_t *pdir = get_curr_pdir();
    size_t size = (size_t)page_count << PAGE_SHIFT;
    size_t count;
+   void *kernel_vaddr;
+
+   /*
+    * User pages don't need to be contiguous in physical memory: when the
+    * page allocator is enabled, take them from its pool one by one, leaving
+    * the kmalloc heaps alone.
+    */
+   if (KRN_PAGE_ALLOC)
+      return user_valloc_and_map_per_page(user_vaddr, page_count);
 
-   void *kernel_vaddr =
-      general_kmalloc(&size, KMALLOC_FL_MULTI_STEP | PAGE_SIZE);
+   kernel_vaddr = general_kmalloc(&size, KMALLOC_FL_MULTI_STEP | PAGE_SIZE);
 
    if (!kernel_vaddr)
-      return user_valloc_and_map_slow(user_vaddr, page_count);
+      return user_valloc_and_map_per_page(user_vaddr, page_count);
 
    ASSERT(size == (size_t)page_count << PAGE_SHIFT);
 
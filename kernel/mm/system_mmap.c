@@ -1,5 +1,7 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
+#include <tilck_gen_headers/config_mm.h>
+
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/utils.h>
 #include <tilck/common/printk.h>
@@ -34,6 +36,8 @@ const char *mem_region_extra_to_str(u32 e)
          return "FBUF";
       case MEM_REG_EXTRA_DMA:
          return "DMA ";
+      case MEM_REG_EXTRA_PAGE_ALLOC:
+         return "PGAL";
       default:
          return "MIXD";
    }
@@ -489,6 +493,81 @@ void dump_memory_map(void)
    printk("\n");
 }
 
+/*
+ * Reserve KRN_PAGE_ALLOC_POOL_PERCENT of the linearly-mapped usable memory
+ * for the page-frame allocator (see kernel/mm/page_alloc.c). The pool is
+ * carved from the top of the usable regions, leaving the lower memory to
+ * kmalloc, the same way DMA regions are carved by the arch code: a new region
+ * with the MEM_REG_EXTRA_PAGE_ALLOC flag is appended and the original one is
+ * shrunk. Because of the extra flag, kmalloc will ignore the new regions.
+ */
+STATIC bool add_page_alloc_mem_regions(void)
+{
+   const u64 lin_end = LIN_VA_TO_PA(BASE_VA) + LINEAR_MAPPING_SIZE;
+   const int count = mem_regions_count;
+   u64 tot = 0, pool, carved = 0;
+
+   if (!KRN_PAGE_ALLOC)
+      return false;
+
+   for (int i = 0; i < count; i++) {
+
+      struct mem_region *m = mem_regions + i;
+
+      if (m->type != MULTIBOOT_MEMORY_AVAILABLE || m->extra)
+         continue;
+
+      if (m->addr >= lin_end)
+         continue;
+
+      tot += MIN(m->addr + m->len, lin_end) - m->addr;
+   }
+
+   pool = tot * KRN_PAGE_ALLOC_POOL_PERCENT / 100;
+   pool &= ~((u64)PAGE_SIZE - 1);
+
+   for (int i = count - 1; i >= 0 && carved < pool; i--) {
+
+      struct mem_region *m = mem_regions + i;
+
+      if (m->type != MULTIBOOT_MEMORY_AVAILABLE || m->extra)
+         continue;
+
+      if (m->addr >= lin_end)
+         continue;
+
+      const u64 end = m->addr + m->len;
+      const u64 lin_part_end = MIN(end, lin_end);
+      const u64 len = MIN(lin_part_end - m->addr, pool - carved);
+
+      append_mem_region((struct mem_region) {
+         .addr = lin_part_end - len,
+         .len = len,
+         .type = MULTIBOOT_MEMORY_AVAILABLE,
+         .extra = MEM_REG_EXTRA_PAGE_ALLOC,
+      });
+
+      if (lin_part_end < end) {
+
+         /* The part above the linear mapping remains a regular region */
+         append_mem_region((struct mem_region) {
+            .addr = lin_part_end,
+            .len = end - lin_part_end,
+            .type = MULTIBOOT_MEMORY_AVAILABLE,
+            .extra = 0,
+         });
+      }
+
+      m->len = lin_part_end - len - m->addr;
+      carved += len;
+
+      if (!m->len)
+         remove_mem_region(i); /* The whole region went to the pool */
+   }
+
+   return carved > 0;
+}
+
 void system_mmap_set(multiboot_info_t *mbi)
 {
    ulong ma_addr = mbi->mmap_addr;
@@ -513,6 +592,9 @@ void system_mmap_set(multiboot_info_t *mbi)
    if (arch_add_final_mem_regions())
       fix_mem_regions();
 
+   if (add_page_alloc_mem_regions())
+      fix_mem_regions();
+
    dump_memory_map();
 }
 
@@ -577,9 +659,16 @@ linear_map_mem_region(struct mem_region *r, ulong *vbegin, ulong *vend)
 
 bool system_mmap_check_for_extra_ramdisk_region(void *rd)
 {
-   int ri = system_mmap_get_region_of(LIN_VA_TO_PA(rd));
    struct mem_region *r;
-   VERIFY(ri >= 0);
+   int ri;
+
+   if (!IN_RANGE((ulong)rd, BASE_VA, LINEAR_MAPPING_END))
+      return false; /* Not a ramdisk region: e.g. a decompressed ramdisk */
+
+   ri = system_mmap_get_region_of(LIN_VA_TO_PA(rd));
+
+   if (ri < 0 || !(mem_regions[ri].extra & MEM_REG_EXTRA_RAMDISK))
+      return false;
 
    if (ri == MAX_MEM_REGIONS - 1)
       return false; /* our region is the last one; no extra region */
@@ -2,17 +2,41 @@
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
 
 #include <tilck/kernel/modules.h>
 #include <tilck/kernel/sort.h>
+#include <tilck/kernel/boot_trace.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/test/modules.h>
 
-static int mods_count;
-static struct module *modules[32];
+/*
+ * Kernel modules are initialized by a small pool of kernel threads, following
+ * their dependencies (see struct module): a module is initialized as soon as
+ * all of its dependencies are, by any of the threads. Among the modules ready
+ * to be initialized, the ones with the lowest priority are picked first. That
+ * way, independent modules overlap their sleeps and I/O waits while probing.
+ *
+ * The thread calling init_modules() takes part in the work as well, but it
+ * picks only non-background modules and returns as soon as all of them have
+ * been initialized. The background ones are completed by the other threads.
+ */
+
+static struct module *modules[MOD_MAX_COUNT];
+
+static struct mod_init_ctx kernel_mods_ctx = {
+   .mods = modules,
+   .mutex = STATIC_KMUTEX_INIT(kernel_mods_ctx.mutex, 0),
+   .cond = STATIC_KCOND_INIT(kernel_mods_ctx.cond),
+};
 
 void register_module(struct module *m)
 {
-   ASSERT(mods_count < ARRAY_SIZE(modules) - 1);
-   modules[mods_count++] = m;
+   struct mod_init_ctx *ctx = &kernel_mods_ctx;
+
+   ASSERT(ctx->count < MOD_MAX_COUNT - 1);
+   modules[ctx->count++] = m;
 }
 
 static long mod_cmp_func(const void *a, const void *b)
@@ -22,13 +46,202 @@ static long mod_cmp_func(const void *a, const void *b)
    return (*ma)->priority - (*mb)->priority;
 }
 
-void init_modules(void)
+static int find_module(struct mod_init_ctx *ctx, const char *name)
+{
+   for (int i = 0; i < ctx->count; i++) {
+      if (!strcmp(ctx->mods[i]->name, name))
+         return i;
+   }
+
+   return -1;
+}
+
+static u32 get_deps_mask(struct mod_init_ctx *ctx, int idx)
+{
+   struct module *m = ctx->mods[idx];
+   u32 mask = 0;
+
+   if (!m->deps) {
+
+      /* Default: depend on all the lower-priority non-background modules */
+      for (int j = 0; j < idx; j++) {
+         if (!ctx->mods[j]->background)
+            mask |= (1u << j);
+      }
+
+      return mask;
+   }
+
+   for (const char *const *dep = m->deps; *dep; dep++) {
+
+      const int j = find_module(ctx, *dep);
+
+      if (j < 0)
+         continue;      /* Not compiled-in: nothing to wait for */
+
+      if (j == idx)
+         panic("Module %s depends on itself", m->name);
+
+      mask |= (1u << j);
+   }
+
+   return mask;
+}
+
+static void resolve_module_deps(struct mod_init_ctx *ctx)
+{
+   u32 ok = 0;
+   bool progress = true;
+
+   ctx->all_mask = (1u << ctx->count) - 1;
+   ctx->fg_mask = 0;
+   ctx->started_mask = 0;
+   ctx->done_mask = 0;
+
+   for (int i = 0; i < ctx->count; i++) {
+
+      ctx->deps_masks[i] = get_deps_mask(ctx, i);
+
+      if (!ctx->mods[i]->background)
+         ctx->fg_mask |= (1u << i);
+   }
+
+   /* Check that a topological order exists: no cycles */
+   while (progress) {
+
+      progress = false;
+
+      for (int i = 0; i < ctx->count; i++) {
+
+         const u32 deps = ctx->deps_masks[i];
+
+         if (!(ok & (1u << i)) && (deps & ok) == deps) {
+            ok |= (1u << i);
+            progress = true;
+         }
+      }
+   }
+
+   if (ok != ctx->all_mask)
+      panic("Circular dependencies between kernel modules");
+}
+
+static int pick_ready_module(struct mod_init_ctx *ctx, bool fg_only)
+{
+   for (int i = 0; i < ctx->count; i++) {
+
+      const u32 bit = 1u << i;
+      const u32 deps = ctx->deps_masks[i];
+
+      if (ctx->started_mask & bit)
+         continue;
+
+      if (fg_only && !(ctx->fg_mask & bit))
+         continue;
+
+      if ((deps & ctx->done_mask) == deps)
+         return i;
+   }
+
+   return -1;
+}
+
+static void init_module(struct mod_init_ctx *ctx, struct module *m)
+{
+   int bt_idx = -1;
+
+   printk("*** Init kernel module: %s\n", m->name);
+
+   /* Keep the self-tests' fake modules out of the boot trace */
+   if (ctx == &kernel_mods_ctx)
+      bt_idx = boot_trace_begin(m->name, BOOT_PHASE_MODULE);
+
+   m->init();
+   boot_trace_end(bt_idx);
+}
+
+/*
+ * With `fg_only` (the thread calling init_modules()), initialize only
+ * non-background modules and return once all of them are done. Otherwise
+ * (the pool threads), initialize any module and return once there's nothing
+ * left to start.
+ */
+static void run_init_modules(struct mod_init_ctx *ctx, bool fg_only)
 {
-   insertion_sort_ptr(modules, (u32)mods_count, &mod_cmp_func);
+   const u32 todo = fg_only ? ctx->fg_mask : ctx->all_mask;
+   int idx;
+
+   kmutex_lock(&ctx->mutex);
+
+   while ((ctx->done_mask & todo) != todo) {
+
+      if ((idx = pick_ready_module(ctx, fg_only)) < 0) {
+
+         if (!fg_only && (ctx->started_mask & todo) == todo)
+            break;
+
+         /* Wait for some other thread to complete a module */
+         kcond_wait(&ctx->cond, &ctx->mutex, KCOND_WAIT_FOREVER);
+         continue;
+      }
+
+      ctx->started_mask |= (1u << idx);
+      kmutex_unlock(&ctx->mutex);
+      {
+         init_module(ctx, ctx->mods[idx]);
+      }
+      kmutex_lock(&ctx->mutex);
 
-   for (int i = 0; i < mods_count; i++) {
-      struct module *m = modules[i];
-      printk("*** Init kernel module: %s\n", m->name);
-      m->init();
+      ctx->done_mask |= (1u << idx);
+      kcond_signal_all(&ctx->cond);
    }
+
+   kmutex_unlock(&ctx->mutex);
+}
+
+static void mod_init_thread(void *arg)
+{
+   run_init_modules(arg, false);
+}
+
+/*
+ * Initializes the modules in `ctx` and returns the number of helper threads
+ * created, after saving their tids in `tids`, if not NULL. When this function
+ * returns, all the non-background modules have been initialized.
+ */
+int do_init_modules(struct mod_init_ctx *ctx, int *tids)
+{
+   int threads = 0;
+   int tid;
+
+   ASSERT(ctx->count < MOD_MAX_COUNT);
+   insertion_sort_ptr(ctx->mods, (u32)ctx->count, &mod_cmp_func);
+   resolve_module_deps(ctx);
+
+   for (int i = 0; i < MOD_INIT_THREADS - 1 && i < ctx->count; i++) {
+
+      tid = kthread_create(&mod_init_thread, KTH_ALLOC_BUFS, ctx);
+
+      if (tid < 0) {
+         printk("WARNING: unable to create a thread for init_modules()\n");
+         break;
+      }
+
+      if (tids)
+         tids[threads] = tid;
+
+      threads++;
+   }
+
+   /*
+    * Without helper threads, we have to initialize the background modules
+    * as well, in this thread.
+    */
+   run_init_modules(ctx, threads > 0);
+   return threads;
+}
+
+void init_modules(void)
+{
+   do_init_modules(&kernel_mods_ctx, NULL);
 }
@@ -13,6 +13,8 @@
 #include <tilck/kernel/term.h>
 #include <tilck/kernel/tty.h>
 #include <tilck/kernel/datetime.h>
+#include <tilck/kernel/kmsg.h>
+#include <tilck/kernel/errno.h>
 
 #include <tilck/mods/tracing.h>
 
@@ -32,6 +34,8 @@
 #define PRINTK_NOSPACE_IN_RBUF_FLUSH_COLOR    COLOR_MAGENTA
 #define PRINTK_PANIC_COLOR                    COLOR_RED
 
+STATIC_ASSERT(PRINTK_BUF_SZ <= KMSG_TEXT_MAX);
+
 struct ringbuf_stat {
 
    union {
@@ -362,6 +366,156 @@ vsnprintk_with_truc_suffix(char *buf, u32 bufsz, const char *fmt, va_list args)
    return written;
 }
 
+static int
+printk_format_prefix(char *prefixbuf, u64 systime, bool lowss)
+{
+   return snprintk(
+      prefixbuf, PRINTK_PREFIXBUF_SZ, "[%5u.%03u] %s",
+      (u32)(systime / TS_SCALE),
+      (u32)((systime % TS_SCALE) / (TS_SCALE / 1000)),
+      lowss ? "[LOWSS] " : ""
+   );
+}
+
+#if KRN_PRINTK_DEFERRED
+
+/*
+ * Deferred printk flush
+ * -----------------------
+ *
+ * Once the kmsg worker thread is running, printk() just stores its record in
+ * the kmsg ring (which it always does) and queues the kmsg job, which renders
+ * on the console the records after `printk_console_seq`. Only one context at
+ * a time renders records, the one which set `printk_flushing`; the others just
+ * leave their records to it. Since the flusher re-checks for new records after
+ * clearing the flag, no record is left behind.
+ *
+ * In panic and during the shutdown, the pending records are flushed and
+ * printk() goes back to rendering its output directly.
+ */
+
+static bool printk_deferred;
+static ATOMIC(bool) printk_flushing;
+static u32 printk_console_seq;
+static struct kmsg_record printk_flush_rec;   /* protected by printk_flushing */
+
+/* Returns the number of records consumed */
+static u32 printk_flush_records(void)
+{
+   struct kmsg_record *const r = &printk_flush_rec;
+   char prefixbuf[PRINTK_PREFIXBUF_SZ];
+   u32 count = 0, first;
+   int rc, prefix_sz;
+
+   while ((rc = kmsg_read(printk_console_seq, r)) != -EAGAIN) {
+
+      count++;
+      disable_preemption();
+
+      if (rc == -EPIPE) {
+
+         first = MAX(kmsg_get_first_seq(), printk_console_seq + 1);
+
+         prefix_sz = snprintk(prefixbuf, sizeof(prefixbuf),
+                              "{_DROPPED_ %u}\n", first - printk_console_seq);
+
+         printk_direct_flush(prefixbuf,
+                             (size_t)prefix_sz,
+                             PRINTK_NOSPACE_IN_RBUF_FLUSH_COLOR);
+
+         printk_console_seq = first;
+
+      } else {
+
+         prefix_sz = 0;
+
+         if (r->flags & KMSG_FL_PREFIX) {
+            prefix_sz = printk_format_prefix(prefixbuf,
+                                             r->ts,
+                                             !!(r->flags & KMSG_FL_LOWSS));
+         }
+
+         printk_direct_flush(prefixbuf, (size_t)prefix_sz, PRINTK_COLOR);
+         printk_direct_flush(r->text, r->len, PRINTK_COLOR);
+         printk_console_seq++;
+      }
+
+      enable_preemption();
+   }
+
+   return count;
+}
+
+static void __printk_flush_deferred(void)
+{
+   u32 count;
+
+   do {
+
+      if (atomic_exchange_explicit(&printk_flushing, true, mo_acquire))
+         return; /* the current flusher will take care of our records */
+
+      count = printk_flush_records();
+      atomic_store_explicit(&printk_flushing, false, mo_release);
+
+      /*
+       * If we didn't flush anything, the next record is still being stored
+       * by an interrupted writer: it will flush it (or kick the job) itself.
+       */
+
+   } while (count && kmsg_get_next_seq() != printk_console_seq);
+}
+
+void printk_flush_deferred(void)
+{
+   if (printk_deferred)
+      __printk_flush_deferred();
+}
+
+void printk_start_deferred(void)
+{
+   ulong var;
+
+   /* Flush what the IRQ handlers might have left in the early ringbuf */
+   printk_flush_ringbuf();
+
+   disable_interrupts(&var);
+   {
+      /* All the records stored so far have already been flushed */
+      printk_console_seq = kmsg_get_next_seq();
+      printk_deferred = true;
+   }
+   enable_interrupts(&var);
+}
+
+static void printk_stop_deferred(bool panic)
+{
+   if (panic) {
+
+      /* The flusher, if any, won't ever run again: just take its place */
+      atomic_store_explicit(&printk_flushing, true, mo_relaxed);
+      printk_flush_records();
+      atomic_store_explicit(&printk_flushing, false, mo_relaxed);
+
+   } else {
+
+      __printk_flush_deferred();
+   }
+
+   /* From now on, printk() flushes everything directly */
+   printk_deferred = false;
+}
+
+#else
+
+#define printk_deferred                            false
+
+void printk_flush_deferred(void) { /* no-op */ }
+void printk_start_deferred(void) { /* no-op */ }
+static void printk_stop_deferred(bool panic) { /* no-op */ }
+
+#endif /* KRN_PRINTK_DEFERRED */
+
 static void
 __tilck_vprintk(char *prefixbuf,
                 char *buf,
@@ -371,6 +525,8 @@ __tilck_vprintk(char *prefixbuf,
                 va_list args)
 {
    const bool panic = in_panic();
+   const bool lowss = bufsz < PRINTK_BUF_SZ;
+   const u64 systime = get_sys_time();
    bool prefix = !panic;
    bool has_newline = false;
    struct ringbuf_stat old;
@@ -404,22 +560,23 @@ __tilck_vprintk(char *prefixbuf,
 
    old = try_set_first_printk_on_stack(has_newline);
 
-   if (prefix && old.newline) {
-
-      const u64 systime = get_sys_time();
-
-      prefix_sz = snprintk(
-         prefixbuf, PRINTK_PREFIXBUF_SZ, "[%5u.%03u] %s",
-         (u32)(systime / TS_SCALE),
-         (u32)((systime % TS_SCALE) / (TS_SCALE / 1000)),
-         bufsz < PRINTK_BUF_SZ ? "[LOWSS] " : ""
-      );
-
-   } else {
-
+   if (prefix && old.newline)
+      prefix_sz = printk_format_prefix(prefixbuf, systime, lowss);
+   else
       prefix = false;
+
+   if (printk_deferred && (panic || in_kernel_shutdown())) {
+      /* Flush the pending records before ours, which we'll flush directly */
+      printk_stop_deferred(panic);
    }
 
+   if (written > 0) {
+      kmsg_store(panic ? KMSG_LEVEL_EMERG : KMSG_LEVEL_INFO,
+                 (old.newline ? 0 : KMSG_FL_CONT) |
+                 (prefix ? KMSG_FL_PREFIX : 0) |
+                 (lowss ? KMSG_FL_LOWSS : 0),
+                 buf, (u32)written);
+   }
 
    if (!term_is_initialized()) {
       printk_append_to_ringbuf(prefixbuf, (size_t) prefix_sz);
@@ -436,6 +593,23 @@ __tilck_vprintk(char *prefixbuf,
    }
 
    trace_printk_raw(1, buf, (size_t) written);
+
+   if (printk_deferred) {
+
+      /*
+       * The record has already been stored: the kmsg job will flush it.
+       * When the job cannot be queued from here, flush it ourselves.
+       */
+      if (!kmsg_kick())
+         printk_flush_deferred();
+
+      restore_first_printk_value();
+      return;
+   }
+
+   /* Just wake up the /dev/kmsg readers */
+   kmsg_kick();
+
    disable_preemption();
    {
       if (!old.first_printk) {
@@ -19,6 +19,7 @@
 #include <tilck/kernel/fs/vfs.h>
 #include <tilck/kernel/paging_hw.h>
 #include <tilck/kernel/process_int.h>
+#include <tilck/kernel/syscall_stats.h>
 
 #include <sys/prctl.h>        // system header
 
@@ -192,6 +193,7 @@ void init_task_lists(struct task *ti)
 
    list_init(&ti->tasks_waiting_list);
    list_init(&ti->on_exit);
+   list_init(&ti->pi_held_list);
    bzero(&ti->wobj, sizeof(struct wait_obj));
 }
 
@@ -221,6 +223,8 @@ allocate_new_process(struct task *parent, int pid, pdir_t *new_pdir)
 
    memcpy(ti, parent, sizeof(struct task));
    memcpy(pi, parent_pi, sizeof(struct process));
+   pi->sys_stats = NULL;          /* each process has its own stats */
+   pi->rlimits = NULL;            /* and its own copy of the limits */
 
    if (MOD_debugpanel) {
 
@@ -234,6 +238,12 @@ allocate_new_process(struct task *parent, int pid, pdir_t *new_pdir)
       }
    }
 
+   if (UNLIKELY(alloc_proc_syscall_stats(pi)))
+      goto oom_case;
+
+   if (UNLIKELY(dup_proc_rlimits(pi, parent_pi)))
+      goto oom_case;
+
    pi->parent_pid = parent_pi->pid;
    pi->pdir = new_pdir;
    pi->ref_count = 1;
@@ -244,6 +254,9 @@ allocate_new_process(struct task *parent, int pid, pdir_t *new_pdir)
    pi->vforked = false;
    pi->inherited_mmap_heap = false;
 
+   /* The handles are duplicated later, by fork_dup_all_handles() */
+   init_fd_table(pi);
+
    if (new_pdir != parent_pi->pdir) {
 
       if (parent_pi->mi) {
@@ -276,6 +289,23 @@ allocate_new_process(struct task *parent, int pid, pdir_t *new_pdir)
 
    /* Reset sched ticks in the new process */
    bzero(&ti->ticks, sizeof(ti->ticks));
+   ti->rt_yield = false;
+   ti->pi_prio = 0;
+
+   /*
+    * The scheduling policy and the nice value are inherited, unless the
+    * parent asked for SCHED_RESET_ON_FORK. See sched(7).
+    */
+   if (ti->sched_reset_on_fork) {
+
+      if (sched_is_rt_policy(ti->sched_policy)) {
+         ti->sched_policy = SCHED_NORMAL;
+         ti->rt_prio = 0;
+      }
+
+      ti->nice = (s8)MAX(ti->nice, 0);
+      ti->sched_reset_on_fork = false;
+   }
 
    /* Copy parent's `cwd` while retaining the `fs` and the inode obj */
    process_set_cwd2_nolock_raw(pi, &parent_pi->cwd);
@@ -314,6 +344,8 @@ oom_case:
       if (MOD_debugpanel && pi->debug_cmdline)
          kfree2(pi->debug_cmdline, PROCESS_CMDLINE_BUF_SIZE);
 
+      free_proc_syscall_stats(pi);
+      free_proc_rlimits(pi);
       kfree_obj((void *)ti, struct task_and_process);
    }
 
@@ -365,6 +397,9 @@ static void free_process_int(struct process *pi)
       if (MOD_debugpanel)
          kfree2(pi->debug_cmdline, PROCESS_CMDLINE_BUF_SIZE);
 
+      free_fd_table(pi);
+      free_proc_syscall_stats(pi);
+      free_proc_rlimits(pi);
       arch_specific_free_proc(pi);
       kfree_obj((void *)get_process_task(pi), struct task_and_process);
    }
@@ -945,8 +980,17 @@ kthread_create2(kthread_func_ptr func, const char *name, int fl, void *arg)
 
    ret = ti->tid;
 
-   if (fl & KTH_WORKER_THREAD)
+   if (fl & KTH_WORKER_THREAD) {
+
+      /*
+       * Worker threads are SCHED_FIFO tasks above any user RT task: they
+       * have no timeslice and they're picked before anything else by
+       * do_schedule(). Their policy cannot be changed.
+       */
       ti->worker_thread = arg;
+      ti->sched_policy = SCHED_FIFO;
+      ti->rt_prio = SCHED_RT_PRIO_MAX;
+   }
 
    /*
     * After the following call to add_task(), given that preemption is enabled,
@@ -0,0 +1,236 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/syscalls.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+
+/*
+ * Resource limits. Each process has the whole set of limits (inherited on
+ * fork and preserved across execve), but only RLIMIT_NOFILE is enforced.
+ * All the other limits are just stored and reported back, which is what
+ * user programs like shells expect.
+ *
+ * Almost no process ever changes its limits: in order to keep struct process
+ * small, `pi->rlimits` is NULL as long as all the limits have their default
+ * values. The RLIM_NLIMITS array is allocated on the first change.
+ */
+
+#define DEFAULT_NOFILE_CUR                      MIN(1024, KRN_NOFILE_MAX)
+#define RLIMITS_ALLOC_SIZE       (RLIM_NLIMITS * sizeof(struct k_rlimit64))
+
+/* The largest value returned by the old 32-bit getrlimit() syscall */
+#define OLD_RLIM_INFINITY                                   0x7fffffffUL
+
+static struct k_rlimit64 get_default_rlimit(u32 resource)
+{
+   if (resource == RLIMIT_NOFILE) {
+      return (struct k_rlimit64) {
+         .rlim_cur = DEFAULT_NOFILE_CUR,
+         .rlim_max = KRN_NOFILE_MAX,
+      };
+   }
+
+   return (struct k_rlimit64) {
+      .rlim_cur = K_RLIM64_INFINITY,
+      .rlim_max = K_RLIM64_INFINITY,
+   };
+}
+
+void init_default_rlimits(struct process *pi)
+{
+   pi->rlimits = NULL;
+}
+
+int dup_proc_rlimits(struct process *pi, struct process *parent)
+{
+   pi->rlimits = NULL;
+
+   if (!parent->rlimits)
+      return 0;
+
+   if (!(pi->rlimits = kmalloc(RLIMITS_ALLOC_SIZE)))
+      return -ENOMEM;
+
+   memcpy(pi->rlimits, parent->rlimits, RLIMITS_ALLOC_SIZE);
+   return 0;
+}
+
+void free_proc_rlimits(struct process *pi)
+{
+   if (pi->rlimits) {
+      kfree2(pi->rlimits, RLIMITS_ALLOC_SIZE);
+      pi->rlimits = NULL;
+   }
+}
+
+u32 get_nofile_limit(struct process *pi)
+{
+   u64 val = DEFAULT_NOFILE_CUR;
+
+   if (pi->rlimits)
+      val = pi->rlimits[RLIMIT_NOFILE].rlim_cur;
+
+   ASSERT(val <= KRN_NOFILE_MAX);
+   return (u32)val;
+}
+
+static int
+do_prlimit(struct process *pi,
+           u32 resource,
+           const struct k_rlimit64 *new_lim,
+           struct k_rlimit64 *old_lim)
+{
+   ASSERT(!is_preemption_enabled());
+
+   if (resource >= RLIM_NLIMITS)
+      return -EINVAL;
+
+   if (new_lim) {
+
+      if (new_lim->rlim_cur > new_lim->rlim_max)
+         return -EINVAL;
+
+      /*
+       * Like Linux with nr_open, the fd limit cannot go beyond a given
+       * kernel-wide value. Because of that, it cannot be infinite either.
+       */
+      if (resource == RLIMIT_NOFILE && new_lim->rlim_max > KRN_NOFILE_MAX)
+         return -EPERM;
+   }
+
+   if (old_lim) {
+      *old_lim = pi->rlimits
+         ? pi->rlimits[resource]
+         : get_default_rlimit(resource);
+   }
+
+   if (new_lim) {
+
+      if (!pi->rlimits) {
+
+         if (!(pi->rlimits = kmalloc(RLIMITS_ALLOC_SIZE)))
+            return -ENOMEM;
+
+         for (u32 i = 0; i < RLIM_NLIMITS; i++)
+            pi->rlimits[i] = get_default_rlimit(i);
+      }
+
+      pi->rlimits[resource] = *new_lim;
+   }
+
+   return 0;
+}
+
+static u64 rlim_to_rlim64(ulong val)
+{
+   return val == K_RLIM_INFINITY ? K_RLIM64_INFINITY : val;
+}
+
+static ulong rlim64_to_rlim(u64 val, ulong infinity)
+{
+   return val >= infinity ? infinity : (ulong)val;
+}
+
+static int
+getrlimit_int(u32 resource, struct k_rlimit *user_rlim, ulong infinity)
+{
+   struct k_rlimit64 lim;
+   struct k_rlimit buf;
+   int rc;
+
+   disable_preemption();
+   {
+      rc = do_prlimit(get_curr_proc(), resource, NULL, &lim);
+   }
+   enable_preemption();
+
+   if (rc)
+      return rc;
+
+   buf = (struct k_rlimit) {
+      .rlim_cur = rlim64_to_rlim(lim.rlim_cur, infinity),
+      .rlim_max = rlim64_to_rlim(lim.rlim_max, infinity),
+   };
+
+   if (copy_to_user(user_rlim, &buf, sizeof(buf)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_getrlimit(u32 resource, struct k_rlimit *user_rlim)
+{
+   return getrlimit_int(resource, user_rlim, K_RLIM_INFINITY);
+}
+
+int sys_old_getrlimit(u32 resource, struct k_rlimit *user_rlim)
+{
+   return getrlimit_int(resource, user_rlim, OLD_RLIM_INFINITY);
+}
+
+int sys_setrlimit(u32 resource, const struct k_rlimit *user_rlim)
+{
+   struct k_rlimit buf;
+   struct k_rlimit64 lim;
+   int rc;
+
+   if (copy_from_user(&buf, user_rlim, sizeof(buf)))
+      return -EFAULT;
+
+   lim = (struct k_rlimit64) {
+      .rlim_cur = rlim_to_rlim64(buf.rlim_cur),
+      .rlim_max = rlim_to_rlim64(buf.rlim_max),
+   };
+
+   disable_preemption();
+   {
+      rc = do_prlimit(get_curr_proc(), resource, &lim, NULL);
+   }
+   enable_preemption();
+   return rc;
+}
+
+int sys_prlimit64(int pid,
+                  u32 resource,
+                  const struct k_rlimit64 *user_new_lim,
+                  struct k_rlimit64 *user_old_lim)
+{
+   struct k_rlimit64 new_lim, old_lim;
+   struct process *pi;
+   int rc;
+
+   if (user_new_lim) {
+      if (copy_from_user(&new_lim, user_new_lim, sizeof(new_lim)))
+         return -EFAULT;
+   }
+
+   disable_preemption();
+   {
+      pi = pid ? get_process(pid) : get_curr_proc();
+
+      if (pi) {
+         rc = do_prlimit(pi,
+                         resource,
+                         user_new_lim ? &new_lim : NULL,
+                         user_old_lim ? &old_lim : NULL);
+      } else {
+         rc = -ESRCH;
+      }
+   }
+   enable_preemption();
+
+   if (rc)
+      return rc;
+
+   if (user_old_lim) {
+      if (copy_to_user(user_old_lim, &old_lim, sizeof(old_lim)))
+         return -EFAULT;
+   }
+
+   return 0;
+}
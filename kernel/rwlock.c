@@ -2,10 +2,13 @@
 
 #include <tilck/kernel/rwlock.h>
 #include <tilck/kernel/sched.h>
+#include <tilck/kernel/hal.h>
 
 void rwlock_rp_init(struct rwlock_rp *r)
 {
    kmutex_init(&r->readers_lock, 0);
+   LOCKSTAT_ONLY(lockstat_init(&r->readers_lock.lstat,
+                               __builtin_return_address(0)));
    ksem_init(&r->writers_sem, 1, 1);
    r->readers_count = 0;
    DEBUG_ONLY(r->ex_owner = NULL);
@@ -57,14 +60,46 @@ void rwlock_rp_exunlock(struct rwlock_rp *r)
 
 /* ---------------------------------------------- */
 
-void rwlock_wp_init(struct rwlock_wp *rw, bool recursive)
+void rwlock_wp_init(struct rwlock_wp *rw, u32 flags)
 {
-   kmutex_init(&rw->m, 0);
+   kmutex_init(&rw->m, (flags & RWLOCK_WP_FL_PI) ? KMUTEX_FL_PI : 0);
    kcond_init(&rw->c);
    rw->ex_owner = NULL;
    rw->r = 0;
    rw->w = false;
-   rw->rec = recursive;
+   rw->rec = !!(flags & RWLOCK_WP_FL_REC);
+   list_node_init(&rw->pi.held_node);
+   rw->pi.wait_list = &rw->c.wait_list;
+
+   /* Account the rwlock as a whole, not its internal mutex and condition */
+   LOCKSTAT_ONLY(lockstat_init(&rw->lstat, __builtin_return_address(0)));
+   LOCKSTAT_ONLY(lockstat_init(&rw->m.lstat, NULL));
+   LOCKSTAT_ONLY(lockstat_init(&rw->c.lstat, NULL));
+}
+
+/*
+ * `wait_start` is the time we started to acquire the rwlock, or 0 if we
+ * didn't have to wait on the condition.
+ */
+static ALWAYS_INLINE void
+rwlock_wp_lockstat_acquired(struct rwlock_wp *rw, u64 wait_start)
+{
+#if KRN_LOCKSTAT
+   lockstat_acquired(&rw->lstat, LOCKSTAT_RWLOCK_WP, wait_start);
+#endif
+}
+
+/* Lend our priority to the exclusive owner we're going to wait for, if any */
+static void rwlock_wp_pi_boost(struct rwlock_wp *rw)
+{
+   if (!(rw->m.flags & KMUTEX_FL_PI) || !rw->ex_owner)
+      return;
+
+   disable_preemption();
+   {
+      pi_boost_owner(rw->ex_owner, get_curr_task());
+   }
+   enable_preemption();
 }
 
 void rwlock_wp_destroy(struct rwlock_wp *rw)
@@ -78,10 +113,15 @@ void rwlock_wp_destroy(struct rwlock_wp *rw)
 
 void rwlock_wp_shlock(struct rwlock_wp *rw)
 {
+   const u64 start = KRN_LOCKSTAT ? RDTSC() : 0;
+   u64 wait_start = 0;
+
    kmutex_lock(&rw->m);
    {
       /* Wait until there's at least one writer waiting (they have priority) */
       while (rw->w) {
+         wait_start = start;
+         rwlock_wp_pi_boost(rw);
          kcond_wait(&rw->c, &rw->m, KCOND_WAIT_FOREVER);
       }
 
@@ -91,6 +131,7 @@ void rwlock_wp_shlock(struct rwlock_wp *rw)
        * lock.
        */
       rw->r++;
+      rwlock_wp_lockstat_acquired(rw, wait_start);
    }
    kmutex_unlock(&rw->m);
 }
@@ -109,8 +150,10 @@ void rwlock_wp_shunlock(struct rwlock_wp *rw)
    kmutex_unlock(&rw->m);
 }
 
-static void rwlock_wp_exlock_int(struct rwlock_wp *rw)
+static void rwlock_wp_exlock_int(struct rwlock_wp *rw, u64 start)
 {
+   u64 wait_start = 0;
+
    if (rw->rec) {
       if (rw->ex_owner == get_curr_task()) {
          ASSERT(rw->w);
@@ -123,6 +166,8 @@ static void rwlock_wp_exlock_int(struct rwlock_wp *rw)
 
    /* Wait our turn until other writers are waiting to write */
    while (rw->w) {
+      wait_start = start;
+      rwlock_wp_pi_boost(rw);
       kcond_wait(&rw->c, &rw->m, KCOND_WAIT_FOREVER);
    }
 
@@ -134,6 +179,7 @@ static void rwlock_wp_exlock_int(struct rwlock_wp *rw)
 
    /* Wait until there are any readers currently holding the rwlock */
    while (rw->r > 0) {
+      wait_start = start;
       kcond_wait(&rw->c, &rw->m, KCOND_WAIT_FOREVER);
    }
 
@@ -145,6 +191,15 @@ static void rwlock_wp_exlock_int(struct rwlock_wp *rw)
 
    ASSERT(rw->ex_owner == NULL);
    rw->ex_owner = get_curr_task();
+   rwlock_wp_lockstat_acquired(rw, wait_start);
+
+   if (rw->m.flags & KMUTEX_FL_PI) {
+      disable_preemption();
+      {
+         pi_lock_acquired(&rw->pi, rw->ex_owner);
+      }
+      enable_preemption();
+   }
 
    if (rw->rec) {
       /* recursive locking count */
@@ -155,9 +210,11 @@ static void rwlock_wp_exlock_int(struct rwlock_wp *rw)
 
 void rwlock_wp_exlock(struct rwlock_wp *rw)
 {
+   const u64 start = KRN_LOCKSTAT ? RDTSC() : 0;
+
    kmutex_lock(&rw->m);
    {
-      rwlock_wp_exlock_int(rw);
+      rwlock_wp_exlock_int(rw, start);
    }
    kmutex_unlock(&rw->m);
 }
@@ -178,6 +235,15 @@ static void rwlock_wp_exunlock_int(struct rwlock_wp *rw)
    }
 
    rw->ex_owner = NULL;
+   LOCKSTAT_ONLY(lockstat_released(&rw->lstat));
+
+   if (rw->m.flags & KMUTEX_FL_PI) {
+      disable_preemption();
+      {
+         pi_lock_released(&rw->pi, get_curr_task());
+      }
+      enable_preemption();
+   }
 
    /* The `w` flag must be set */
    ASSERT(rw->w);
@@ -8,6 +8,7 @@
 #include <tilck/kernel/list.h>
 #include <tilck/kernel/kmalloc.h>
 #include <tilck/kernel/hal.h>
+#include <tilck/kernel/cpus.h>
 #include <tilck/kernel/worker_thread.h>
 #include <tilck/kernel/timer.h>
 #include <tilck/kernel/errno.h>
@@ -25,10 +26,11 @@ struct list runnable_tasks_list;
 
 /* Static variables */
 static struct task *tree_by_tid_root;
-static u64 idle_ticks;
-static ATOMIC(int) runnable_tasks_count;     /* see docs/atomics.md */
 static int current_max_pid = -1;
 static int current_max_kernel_tid = -1;
+static ATOMIC(int) rt_runnable_tasks_count;  /* RT tasks in the list above */
+u64 idle_ticks;
+ATOMIC(int) runnable_tasks_count;            /* see docs/atomics.md */
 struct task *idle_task;
 
 static ALWAYS_INLINE int get_runnable_tasks_count(void)
@@ -36,6 +38,11 @@ static ALWAYS_INLINE int get_runnable_tasks_count(void)
    return atomic_load_explicit(&runnable_tasks_count, mo_relaxed);
 }
 
+static ALWAYS_INLINE int get_rt_runnable_tasks_count(void)
+{
+   return atomic_load_explicit(&rt_runnable_tasks_count, mo_relaxed);
+}
+
 const char *const task_state_str[5] = {
    [TASK_STATE_INVALID]  = "invalid",
    [TASK_STATE_RUNNABLE] = "runnable",
@@ -402,7 +409,7 @@ void yield_until_last(void)
     *
     * Worker threads are a separate schedulable class for bottom-half
     * processing (see wth.c); they live in worker_threads[], not in
-    * runnable_tasks_list, and are therefore INVISIBLE to this
+    * the runqueue, and are therefore INVISIBLE to this
     * function. A worker chewing through queued jobs will NOT delay
     * our return. Callers that need worker quiescence too should
     * additionally call wth_wait_for_completion() on each worker they
@@ -431,6 +438,8 @@ static void create_kernel_process(void)
    s_kernel_ti->pi = s_kernel_pi;
    init_task_lists(s_kernel_ti);
    init_process_lists(s_kernel_pi);
+   init_fd_table(s_kernel_pi);
+   init_default_rlimits(s_kernel_pi);
 
    s_kernel_ti->is_main_thread = true;
    s_kernel_ti->running_in_kernel = IN_SYSCALL_FLAG;
@@ -472,6 +481,8 @@ void init_sched(void)
    ASSERT(kernel_process_pi->pid == 0);
    ASSERT(kernel_process_pi->parent_pid == 0);
 
+   init_cpus();
+
    kernel_process->pi->pdir = get_kernel_pdir();
    tid = kthread_create(&idle, 0, NULL);
 
@@ -504,6 +515,18 @@ static void task_add_to_state_list(struct task *ti)
       case TASK_STATE_RUNNABLE:
          list_add_tail(&runnable_tasks_list, &ti->runnable_node);
          atomic_fetch_add_explicit(&runnable_tasks_count, 1, mo_relaxed);
+
+         if (is_rt_task(ti)) {
+
+            struct task *curr = get_curr_task();
+            atomic_fetch_add_explicit(&rt_runnable_tasks_count,
+                                      1, mo_relaxed);
+
+            /* A RT task preempts the fair ones and the lower RT ones */
+            if (ti != curr)
+               if (sched_get_prio(curr) < sched_get_prio(ti))
+                  sched_set_need_resched();
+         }
          break;
 
       case TASK_STATE_SLEEPING:
@@ -546,6 +569,13 @@ static void task_remove_from_state_list(struct task *ti)
          DEBUG_ONLY_UNSAFE(prev =)
             atomic_fetch_sub_explicit(&runnable_tasks_count, 1, mo_relaxed);
          ASSERT(prev >= 1);
+
+         if (is_rt_task(ti)) {
+            DEBUG_ONLY_UNSAFE(prev =)
+               atomic_fetch_sub_explicit(&rt_runnable_tasks_count,
+                                         1, mo_relaxed);
+            ASSERT(prev >= 1);
+         }
          break;
       }
 
@@ -638,13 +668,58 @@ void remove_task(struct task *ti)
    enable_preemption();
 }
 
+/*
+ * The load weights of the nice levels, the same as Linux's CFS ones: each nice
+ * level is worth ~10% of CPU time relative to the next one, the weights being
+ * ~1.25x apart. Nice 0 has weight 1024.
+ */
+static const u32 sched_nice_to_weight[40] = {
+ /* -20 */     88761,     71755,     56483,     46273,     36291,
+ /* -15 */     29154,     23254,     18705,     14949,     11916,
+ /* -10 */      9548,      7620,      6100,      4904,      3906,
+ /*  -5 */      3121,      2501,      1991,      1586,      1277,
+ /*   0 */      1024,       820,       655,       526,       423,
+ /*   5 */       335,       272,       215,       172,       137,
+ /*  10 */       110,        87,        70,        56,        45,
+ /*  15 */        36,        29,        23,        18,        15,
+};
+
+#define SCHED_NICE_0_WEIGHT                                 1024
+#define SCHED_IDLE_WEIGHT                                      3
+
+u32 sched_get_task_weight(struct task *ti)
+{
+   const int prio = sched_get_prio(ti);
+
+   if (prio > SCHED_PRIO_RT_BASE)
+      return SCHED_NICE_0_WEIGHT;   /* not used by the RT class */
+
+   if (ti->sched_policy == SCHED_IDLE && prio == sched_get_base_prio(ti))
+      return SCHED_IDLE_WEIGHT;
+
+   /* Boosted tasks in the fair class get the weight of their booster */
+   return sched_nice_to_weight[SCHED_PRIO_RT_BASE - prio];
+}
+
+/*
+ * The vruntime cost of a tick in which `others` tasks waited for the CPU. It's
+ * inversely proportional to the weight of the task, with a nice 0 task paying
+ * SCHED_NICE_0_WEIGHT per waiting task: the finer unit avoids rounding the
+ * cost of the heaviest tasks down to 0.
+ */
+static ALWAYS_INLINE u64 sched_vruntime_delta(struct task *ti, int others)
+{
+   const u32 w = sched_get_task_weight(ti);
+   return (u64)others * (SCHED_NICE_0_WEIGHT * SCHED_NICE_0_WEIGHT / w);
+}
+
 void sched_account_ticks(void)
 {
    struct task *curr = get_curr_task();
    const enum task_state state = get_curr_task_state();
    const bool is_running = (state == TASK_STATE_RUNNING);
-   const bool is_worker = is_worker_thread(curr);
    struct sched_ticks *t = &curr->ticks;
+   bool timeout;
 
    ASSERT(curr != NULL);
    ASSERT(!is_preemption_enabled());
@@ -655,12 +730,14 @@ void sched_account_ticks(void)
    if (curr->running_in_kernel)
       t->total_kernel++;
 
-   if (curr != idle_task) {
+   if (curr != idle_task && !is_rt_task(curr)) {
 
       /*
        * Grow vruntime by the number of *other* non-idle tasks waiting
        * for the CPU — i.e. how much this tick costs us in fairness
-       * terms relative to the contenders.
+       * terms relative to the contenders — scaled by the inverse of
+       * our weight (see sched_vruntime_delta()): with N contenders
+       * spinning, each one gets CPU time proportional to its weight.
        *
        * runnable_tasks_count tallies what's in runnable_tasks_list:
        * RUNNABLE non-idle tasks (curr is RUNNING, not in the list)
@@ -679,21 +756,130 @@ void sched_account_ticks(void)
        * picking the lowest `total` ticks, because tasks that
        * monopolized the CPU while nothing else wanted it aren't
        * penalized for it later.
+       *
+       * RT tasks don't accumulate vruntime at all: they don't compete
+       * with the fair ones (see sched_set_task_attr()).
        */
-      t->vruntime += (u64)(get_runnable_tasks_count() - 1);
+      t->vruntime += sched_vruntime_delta(curr, get_runnable_tasks_count() - 1);
    }
 
    /*
-    * need_resched is never set for worker threads when they used too much
-    * CPU time: their timeslice is unlimited and can preempted only be another
-    * worker thread.
+    * need_resched is never set for SCHED_FIFO tasks when they used too much
+    * CPU time: their timeslice is unlimited and they can be preempted only by
+    * higher priority RT tasks. Worker threads are SCHED_FIFO tasks and can be
+    * preempted only by other worker threads (see do_schedule()).
     */
-   const bool timeout = !is_worker && t->timeslice >= TIME_SLICE_TICKS;
+   timeout = curr->sched_policy != SCHED_FIFO &&
+             t->timeslice >= TIME_SLICE_TICKS;
+
+   /* A RT task is waiting while we're running in the fair class */
+   if (!is_rt_task(curr) && get_rt_runnable_tasks_count() > 0)
+      timeout = true;
 
    if (curr->stopped || !is_running || timeout)
       sched_set_need_resched();
 }
 
+/*
+ * The lowest vruntime among the fair tasks competing for the CPU, `ti`
+ * excluded. Used to place a task entering the fair class, so that it doesn't
+ * get a huge advantage (or disadvantage) because of the time it spent
+ * running as a RT task. Returns ti's vruntime when there are no contenders.
+ */
+static u64 sched_get_min_vruntime(struct task *ti)
+{
+   struct task *curr = get_curr_task();
+   u64 min = ti->ticks.vruntime;
+   bool found = false;
+   struct task *pos;
+
+   list_for_each_ro(pos, &runnable_tasks_list, runnable_node) {
+
+      if (pos == ti || pos == idle_task || is_rt_task(pos))
+         continue;
+
+      if (!found || pos->ticks.vruntime < min) {
+         min = pos->ticks.vruntime;
+         found = true;
+      }
+   }
+
+   if (curr != ti && curr != idle_task && !is_rt_task(curr))
+      if (!found || curr->ticks.vruntime < min)
+         min = curr->ticks.vruntime;
+
+   return min;
+}
+
+/*
+ * Change the scheduling parameters of `ti`, including its priority boost.
+ * The task has to be re-added to its state list because the RT tasks are
+ * counted separately there. Interrupts are disabled because the timer handler
+ * might change the state of `ti` in the meanwhile.
+ */
+static void
+sched_change_task_prio(struct task *ti,
+                       int policy, int nice, int rt_prio, int pi_prio)
+{
+   const bool was_rt = is_rt_task(ti);
+   ulong var;
+
+   ASSERT(!is_preemption_enabled());
+   ASSERT(!is_worker_thread(ti));
+
+   disable_interrupts(&var);
+   {
+      task_remove_from_state_list(ti);
+
+      ti->sched_policy = (u8)policy;
+      ti->nice = (s8)nice;
+      ti->rt_prio = (u8)rt_prio;
+      ti->pi_prio = (u8)pi_prio;
+
+      if (was_rt && !is_rt_task(ti))
+         ti->ticks.vruntime = sched_get_min_vruntime(ti);
+
+      task_add_to_state_list(ti);
+   }
+   enable_interrupts(&var);
+
+   /*
+    * Whatever changed, the currently running task might not be the right
+    * one anymore: let the scheduler decide.
+    */
+   sched_set_need_resched();
+}
+
+/*
+ * Change the scheduling policy and parameters of `ti`. The caller is expected
+ * to have validated them and to run with preemption disabled. Worker threads
+ * are not allowed here: they're always SCHED_FIFO (see kthread_create2()).
+ */
+void sched_set_task_attr(struct task *ti, int policy, int nice, int rt_prio)
+{
+   ASSERT(SCHED_NICE_MIN <= nice && nice <= SCHED_NICE_MAX);
+   ASSERT(sched_is_rt_policy(policy) == (rt_prio > 0));
+
+   sched_change_task_prio(ti, policy, nice, rt_prio, ti->pi_prio);
+}
+
+/*
+ * Boost `ti` to the priority `prio` (see sched_get_prio()), or remove the
+ * boost when `prio` is 0. Used by priority inheritance: see kmutex.c.
+ */
+void sched_set_task_pi_prio(struct task *ti, int prio)
+{
+   ASSERT(0 <= prio && prio <= SCHED_PRIO_MAX);
+
+   if (is_worker_thread(ti))
+      return;     /* workers run above everything else anyway */
+
+   if (ti->pi_prio == prio)
+      return;
+
+   sched_change_task_prio(ti, ti->sched_policy, ti->nice, ti->rt_prio, prio);
+}
+
 static bool
 sched_should_return_immediately(struct task *curr, enum task_state curr_state)
 {
@@ -729,6 +915,71 @@ sched_should_return_immediately(struct task *curr, enum task_state curr_state)
    return false;
 }
 
+/*
+ * Should the running RT task `curr` leave the CPU to a runnable RT task with
+ * its same priority? SCHED_FIFO tasks do that only by calling sched_yield(),
+ * while the SCHED_RR ones also at the end of each timeslice.
+ */
+static bool sched_rt_should_rotate(struct task *curr)
+{
+   if (curr->rt_yield)
+      return true;
+
+   if (curr->sched_policy == SCHED_RR)
+      return curr->ticks.timeslice >= TIME_SLICE_TICKS;
+
+   return false;
+}
+
+/*
+ * Select the RT task to run, if any. Among the runnable ones with the highest
+ * priority, the first in the list wins: it's the one waiting for longer, as
+ * preempted tasks are appended at the end of the list.
+ *
+ * NOTE: a running worker thread is left to sched_do_select_runnable_task():
+ * that's the only point where workers can be preempted by a yield, while the
+ * runnable ones always win via wth_get_runnable_thread().
+ */
+static struct task *
+sched_do_select_rt_task(enum task_state curr_state)
+{
+   struct task *curr = get_curr_task();
+   struct task *selected = NULL;
+   struct task *pos;
+   bool curr_rt;
+
+   curr_rt = curr_state == TASK_STATE_RUNNING &&
+             !curr->stopped &&
+             !is_worker_thread(curr) &&
+             is_rt_task(curr);
+
+   if (!curr_rt && !get_rt_runnable_tasks_count())
+      return NULL;
+
+   list_for_each_ro(pos, &runnable_tasks_list, runnable_node) {
+
+      ASSERT_TASK_STATE(pos->state, TASK_STATE_RUNNABLE);
+
+      if (pos->stopped || !is_rt_task(pos))
+         continue;
+
+      if (!selected || sched_get_prio(pos) > sched_get_prio(selected))
+         selected = pos;
+   }
+
+   if (curr_rt) {
+
+      if (!selected || sched_get_prio(curr) > sched_get_prio(selected))
+         return curr;
+
+      if (sched_get_prio(curr) == sched_get_prio(selected))
+         if (!sched_rt_should_rotate(curr))
+            return curr;
+   }
+
+   return selected;
+}
+
 static struct task *
 sched_do_select_runnable_task(enum task_state curr_state, bool resched)
 {
@@ -740,7 +991,7 @@ sched_do_select_runnable_task(enum task_state curr_state, bool resched)
 
       ASSERT_TASK_STATE(pos->state, TASK_STATE_RUNNABLE);
 
-      if (pos->stopped || pos == idle_task)
+      if (pos->stopped || pos == idle_task || is_rt_task(pos))
          continue;
 
       if (pos->timer_ready) {
@@ -795,10 +1046,17 @@ void do_schedule(void)
     * Workers are picked here, BEFORE the regular runnable-list lookup
     * below. They're a separate schedulable class for bottom-half
     * processing (see wth.c), and a runnable worker always wins
-    * against a runnable non-worker.
+    * against a runnable non-worker. In terms of policies, they're
+    * SCHED_FIFO tasks above any user RT priority.
     */
    selected = wth_get_runnable_thread();
 
+   /* Then, the RT tasks always win against the fair ones */
+   if (!selected)
+      selected = sched_do_select_rt_task(curr_state);
+
+   curr->rt_yield = false;
+
    /* Check for regular runnable tasks */
    if (!selected) {
 
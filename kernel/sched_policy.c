@@ -0,0 +1,563 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/syscalls.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/datetime.h>
+
+/*
+ * Scheduling policies and nice values. The fair class (SCHED_NORMAL,
+ * SCHED_BATCH and SCHED_IDLE) shares the CPU in proportion to the weights
+ * of the tasks, derived from their nice values. The RT class (SCHED_FIFO and
+ * SCHED_RR) always wins against the fair one. See sched_account_ticks() and
+ * do_schedule() for the details.
+ *
+ * NOTE: there are no users other than root in Tilck, therefore there are no
+ * permission checks here. The only restriction is on the worker threads,
+ * whose policy is fixed.
+ */
+
+#define NICE_TO_PRIO(n)                     (20 - (n))   /* getpriority(2) */
+#define SCHED_ATTR_MAX_SIZE                 PAGE_SIZE
+
+struct sched_param_req {
+   int policy;
+   int nice;
+   int rt_prio;
+   bool reset_on_fork;
+};
+
+static bool sched_is_valid_policy(int policy)
+{
+   switch (policy) {
+
+      case SCHED_NORMAL:
+      case SCHED_FIFO:
+      case SCHED_RR:
+      case SCHED_BATCH:
+      case SCHED_IDLE:
+         return true;
+
+      default:
+         return false; /* SCHED_DEADLINE is not supported */
+   }
+}
+
+/* Returns the task `tid` or the current one when `tid` is 0 */
+static struct task *sched_get_target(int tid)
+{
+   ASSERT(!is_preemption_enabled());
+   return tid ? get_task(tid) : get_curr_task();
+}
+
+static int
+sched_apply_req(struct task *ti, const struct sched_param_req *req)
+{
+   ASSERT(!is_preemption_enabled());
+
+   if (!sched_is_valid_policy(req->policy))
+      return -EINVAL;
+
+   if (sched_is_rt_policy(req->policy)) {
+
+      if (req->rt_prio < SCHED_RT_PRIO_MIN || req->rt_prio > SCHED_RT_PRIO_MAX)
+         return -EINVAL;
+
+   } else {
+
+      if (req->rt_prio != 0)
+         return -EINVAL;
+   }
+
+   if (is_worker_thread(ti))
+      return -EPERM;
+
+   sched_set_task_attr(ti,
+                       req->policy,
+                       CLAMP(req->nice, SCHED_NICE_MIN, SCHED_NICE_MAX),
+                       req->rt_prio);
+
+   ti->sched_reset_on_fork = req->reset_on_fork;
+   return 0;
+}
+
+static void sched_get_req(struct task *ti, struct sched_param_req *req)
+{
+   *req = (struct sched_param_req) {
+      .policy = ti->sched_policy,
+      .nice = ti->nice,
+      .rt_prio = ti->rt_prio,
+      .reset_on_fork = ti->sched_reset_on_fork,
+   };
+}
+
+/*
+ * After changing the policy of a task, the scheduler might want to run
+ * another task right away: that has to happen before returning to user space.
+ */
+static int sched_end_change(int rc)
+{
+   enable_preemption();
+
+   if (!rc && need_reschedule())
+      kernel_yield();
+
+   return rc;
+}
+
+int sys_nice(int inc)
+{
+   struct task *curr = get_curr_task();
+   struct sched_param_req req;
+   int rc;
+
+   disable_preemption();
+   {
+      sched_get_req(curr, &req);
+      req.nice += CLAMP(inc, -40, 40);
+      rc = sched_apply_req(curr, &req);
+   }
+   return sched_end_change(rc);
+}
+
+struct prio_visit_ctx {
+
+   int which;
+   int who;
+   int nice;          /* the value to set, unused by getpriority() */
+   bool set;
+   int rc;            /* -ESRCH until a task is found */
+   int best_prio;     /* the highest NICE_TO_PRIO() among the tasks found */
+};
+
+static bool prio_ctx_match(struct prio_visit_ctx *ctx, struct task *ti)
+{
+   if (is_kernel_thread(ti))
+      return false;
+
+   if (ctx->which == PRIO_PGRP)
+      return ti->pi->pgid == ctx->who;
+
+   /* PRIO_USER: all the processes belong to root */
+   return true;
+}
+
+static int prio_visit_cb(void *obj, void *arg)
+{
+   struct prio_visit_ctx *ctx = arg;
+   struct task *ti = obj;
+   struct sched_param_req req;
+   int rc;
+
+   if (!prio_ctx_match(ctx, ti))
+      return 0;
+
+   if (ctx->rc == -ESRCH)
+      ctx->rc = 0;
+
+   ctx->best_prio = MAX(ctx->best_prio, NICE_TO_PRIO(ti->nice));
+
+   if (ctx->set) {
+
+      sched_get_req(ti, &req);
+      req.nice = ctx->nice;
+
+      if ((rc = sched_apply_req(ti, &req)))
+         ctx->rc = rc;
+   }
+
+   return 0;
+}
+
+static int do_prio_op(struct prio_visit_ctx *ctx)
+{
+   struct sched_param_req req;
+   struct task *ti;
+
+   ASSERT(!is_preemption_enabled());
+
+   switch (ctx->which) {
+
+      case PRIO_PROCESS:
+
+         if (!(ti = sched_get_target(ctx->who)))
+            return -ESRCH;
+
+         ctx->best_prio = NICE_TO_PRIO(ti->nice);
+
+         if (!ctx->set)
+            return 0;
+
+         sched_get_req(ti, &req);
+         req.nice = ctx->nice;
+         return sched_apply_req(ti, &req);
+
+      case PRIO_PGRP:
+
+         if (!ctx->who)
+            ctx->who = get_curr_proc()->pgid;
+
+         break;
+
+      case PRIO_USER:
+
+         if (ctx->who != 0)
+            return -ESRCH;  /* no users other than root */
+
+         break;
+
+      default:
+         return -EINVAL;
+   }
+
+   ctx->rc = -ESRCH;
+   iterate_over_tasks(&prio_visit_cb, ctx);
+   return ctx->rc;
+}
+
+int sys_getpriority(int which, int who)
+{
+   struct prio_visit_ctx ctx = {
+      .which = which,
+      .who = who,
+      .set = false,
+      .best_prio = 0,
+   };
+   int rc;
+
+   if (who < 0)
+      return -ESRCH;
+
+   disable_preemption();
+   {
+      rc = do_prio_op(&ctx);
+   }
+   enable_preemption();
+   return rc ? rc : ctx.best_prio;
+}
+
+int sys_setpriority(int which, int who, int niceval)
+{
+   struct prio_visit_ctx ctx = {
+      .which = which,
+      .who = who,
+      .nice = CLAMP(niceval, SCHED_NICE_MIN, SCHED_NICE_MAX),
+      .set = true,
+   };
+   int rc;
+
+   if (who < 0)
+      return -ESRCH;
+
+   disable_preemption();
+   {
+      rc = do_prio_op(&ctx);
+   }
+   return sched_end_change(rc);
+}
+
+static int
+sched_setscheduler_int(int tid, int policy, const int *u_prio, bool keep_pol)
+{
+   struct sched_param_req req;
+   struct task *ti;
+   int prio, rc;
+
+   if (tid < 0 || !u_prio)
+      return -EINVAL;
+
+   if (copy_from_user(&prio, u_prio, sizeof(prio)))
+      return -EFAULT;
+
+   disable_preemption();
+
+   if (!(ti = sched_get_target(tid))) {
+      rc = -ESRCH;
+      goto out;
+   }
+
+   sched_get_req(ti, &req);
+   req.rt_prio = prio;
+
+   if (!keep_pol) {
+      req.policy = policy & ~SCHED_RESET_ON_FORK;
+      req.reset_on_fork = !!(policy & SCHED_RESET_ON_FORK);
+   }
+
+   rc = sched_apply_req(ti, &req);
+
+out:
+   return sched_end_change(rc);
+}
+
+/* NOTE: struct sched_param has just the `int sched_priority` field */
+int sys_sched_setscheduler(int tid, int policy, const int *u_param)
+{
+   return sched_setscheduler_int(tid, policy, u_param, false);
+}
+
+int sys_sched_setparam(int tid, const int *u_param)
+{
+   return sched_setscheduler_int(tid, 0, u_param, true);
+}
+
+int sys_sched_getscheduler(int tid)
+{
+   struct sched_param_req req;
+   struct task *ti;
+
+   if (tid < 0)
+      return -EINVAL;
+
+   disable_preemption();
+   {
+      if ((ti = sched_get_target(tid)))
+         sched_get_req(ti, &req);
+   }
+   enable_preemption();
+
+   if (!ti)
+      return -ESRCH;
+
+   return req.policy | (req.reset_on_fork ? SCHED_RESET_ON_FORK : 0);
+}
+
+int sys_sched_getparam(int tid, int *u_param)
+{
+   struct task *ti;
+   int prio = 0;
+
+   if (tid < 0 || !u_param)
+      return -EINVAL;
+
+   disable_preemption();
+   {
+      if ((ti = sched_get_target(tid)))
+         prio = ti->rt_prio;
+   }
+   enable_preemption();
+
+   if (!ti)
+      return -ESRCH;
+
+   if (copy_to_user(u_param, &prio, sizeof(prio)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_sched_get_priority_max(int policy)
+{
+   if (!sched_is_valid_policy(policy))
+      return -EINVAL;
+
+   return sched_is_rt_policy(policy) ? SCHED_RT_PRIO_MAX : 0;
+}
+
+int sys_sched_get_priority_min(int policy)
+{
+   if (!sched_is_valid_policy(policy))
+      return -EINVAL;
+
+   return sched_is_rt_policy(policy) ? SCHED_RT_PRIO_MIN : 0;
+}
+
+static int sched_rr_get_interval_int(int tid, struct k_timespec64 *ts)
+{
+   struct task *ti;
+   int policy = 0;
+
+   if (tid < 0)
+      return -EINVAL;
+
+   disable_preemption();
+   {
+      if ((ti = sched_get_target(tid)))
+         policy = ti->sched_policy;
+   }
+   enable_preemption();
+
+   if (!ti)
+      return -ESRCH;
+
+   /* SCHED_FIFO tasks have an infinite timeslice, reported as 0 */
+   ticks_to_timespec(policy == SCHED_FIFO ? 0 : TIME_SLICE_TICKS, ts);
+   return 0;
+}
+
+int sys_sched_rr_get_interval(int tid, struct k_timespec64 *u_interval)
+{
+   struct k_timespec64 ts;
+   int rc;
+
+   if ((rc = sched_rr_get_interval_int(tid, &ts)))
+      return rc;
+
+   if (copy_to_user(u_interval, &ts, sizeof(ts)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int
+sys_sched_rr_get_interval_time32(int tid, struct k_timespec32 *u_interval)
+{
+   struct k_timespec64 ts;
+   struct k_timespec32 ts32;
+   int rc;
+
+   if ((rc = sched_rr_get_interval_int(tid, &ts)))
+      return rc;
+
+   ts32 = to_k_timespec32(ts);
+
+   if (copy_to_user(u_interval, &ts32, sizeof(ts32)))
+      return -EFAULT;
+
+   return 0;
+}
+
+/*
+ * Copies the user's struct sched_attr, which might be larger than ours, as
+ * long as the extra fields are all zero. Like Linux, on -E2BIG the size we
+ * support is written back in `size`.
+ */
+static int
+sched_copy_attr_from_user(struct k_sched_attr *attr,
+                          struct k_sched_attr *u_attr)
+{
+   const u32 ksize = sizeof(*attr);
+   u32 size;
+   u8 tail[16];
+
+   if (copy_from_user(&size, &u_attr->size, sizeof(size)))
+      return -EFAULT;
+
+   if (!size)
+      size = K_SCHED_ATTR_SIZE_VER0;
+
+   if (size < K_SCHED_ATTR_SIZE_VER0 || size > SCHED_ATTR_MAX_SIZE)
+      goto e2big;
+
+   bzero(attr, ksize);
+
+   if (copy_from_user(attr, u_attr, MIN(size, ksize)))
+      return -EFAULT;
+
+   for (u32 off = ksize; off < size; off += sizeof(tail)) {
+
+      const u32 n = MIN(size - off, (u32)sizeof(tail));
+
+      if (copy_from_user(tail, (u8 *)u_attr + off, n))
+         return -EFAULT;
+
+      for (u32 i = 0; i < n; i++)
+         if (tail[i])
+            goto e2big;
+   }
+
+   attr->size = size;
+   return 0;
+
+e2big:
+   if (copy_to_user(&u_attr->size, &ksize, sizeof(ksize)))
+      return -EFAULT;
+
+   return -E2BIG;
+}
+
+int sys_sched_setattr(int tid, struct k_sched_attr *u_attr, u32 flags)
+{
+   const u64 supported_flags = SCHED_FLAG_RESET_ON_FORK |
+                               SCHED_FLAG_KEEP_POLICY |
+                               SCHED_FLAG_KEEP_PARAMS;
+
+   struct sched_param_req req;
+   struct k_sched_attr attr;
+   struct task *ti;
+   int rc;
+
+   if (tid < 0 || !u_attr || flags)
+      return -EINVAL;
+
+   if ((rc = sched_copy_attr_from_user(&attr, u_attr)))
+      return rc;
+
+   if (attr.sched_flags & ~supported_flags)
+      return -EINVAL;
+
+   disable_preemption();
+
+   if (!(ti = sched_get_target(tid))) {
+      rc = -ESRCH;
+      goto out;
+   }
+
+   sched_get_req(ti, &req);
+   req.reset_on_fork = !!(attr.sched_flags & SCHED_FLAG_RESET_ON_FORK);
+
+   if (!(attr.sched_flags & SCHED_FLAG_KEEP_POLICY))
+      req.policy = (int)attr.sched_policy;
+
+   if (!(attr.sched_flags & SCHED_FLAG_KEEP_PARAMS)) {
+
+      req.rt_prio = (int)attr.sched_priority;
+
+      /* The nice value is meaningful only for the fair policies */
+      if (!sched_is_rt_policy(req.policy))
+         req.nice = attr.sched_nice;
+
+   } else if (sched_is_rt_policy(req.policy) != is_rt_task(ti)) {
+
+      /* Changing class requires new parameters */
+      rc = -EINVAL;
+      goto out;
+   }
+
+   rc = sched_apply_req(ti, &req);
+
+out:
+   return sched_end_change(rc);
+}
+
+int
+sys_sched_getattr(int tid, struct k_sched_attr *u_attr, u32 size, u32 flags)
+{
+   struct sched_param_req req;
+   struct k_sched_attr attr;
+   struct task *ti;
+
+   if (tid < 0 || !u_attr || flags)
+      return -EINVAL;
+
+   if (size < K_SCHED_ATTR_SIZE_VER0 || size > SCHED_ATTR_MAX_SIZE)
+      return -EINVAL;
+
+   disable_preemption();
+   {
+      if ((ti = sched_get_target(tid)))
+         sched_get_req(ti, &req);
+   }
+   enable_preemption();
+
+   if (!ti)
+      return -ESRCH;
+
+   attr = (struct k_sched_attr) {
+      .size = MIN(size, (u32)sizeof(attr)),
+      .sched_policy = (u32)req.policy,
+      .sched_flags = req.reset_on_fork ? SCHED_FLAG_RESET_ON_FORK : 0,
+      .sched_nice = req.nice,
+      .sched_priority = (u32)req.rt_prio,
+      .sched_util_max = 1024,  /* SCHED_CAPACITY_SCALE: no clamping */
+   };
+
+   if (copy_to_user(u_attr, &attr, attr.size))
+      return -EFAULT;
+
+   return 0;
+}
@@ -1,6 +1,5 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
-#include <tilck_gen_headers/config_userlim.h>
 #include <tilck/common/basic_defs.h>
 
 #include <tilck/kernel/syscalls.h>
@@ -361,7 +360,8 @@ int sys_select(int user_nfds,
 
    int rc;
 
-   if (user_nfds < 0 || user_nfds > KRN_MAX_HANDLES)
+   /* The fd sets are copied in kernel space as fixed-size fd_set structs */
+   if (user_nfds < 0 || user_nfds > FD_SETSIZE)
       return -EINVAL;
 
    if ((rc = select_read_user_sets(ctx.sets, ctx.u_sets)))
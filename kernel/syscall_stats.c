@@ -0,0 +1,294 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_debug.h>
+#include <tilck_gen_headers/mod_sysfs.h>
+#include <tilck_gen_headers/mod_tracing.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/syscall_stats.h>
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+
+#if MOD_sysfs
+   #include <tilck/mods/sysfs.h>
+   #include <tilck/mods/sysfs_utils.h>
+#endif
+
+#if MOD_tracing
+   #include <tilck/mods/tracing.h>
+#endif
+
+#if KRN_SYSCALL_STATS
+
+struct syscall_stats global_syscall_stats[MAX_SYSCALLS];
+
+static ALWAYS_INLINE u32 get_latency_bucket(u64 cycles)
+{
+   const u32 log2 = cycles ? 63 - (u32)__builtin_clzll(cycles) : 0;
+   return MIN(log2, (u32)SYSCALL_STATS_BUCKETS - 1);
+}
+
+void syscall_stats_account(struct process *pi, u32 sn, u64 cycles)
+{
+   struct syscall_stats *s = &global_syscall_stats[sn];
+   struct proc_syscall_stats *ps = pi->sys_stats;
+
+   ASSERT(sn < MAX_SYSCALLS);
+   ASSERT(!is_preemption_enabled());
+
+   s->count++;
+   s->tot_cycles += cycles;
+   s->max_cycles = MAX(s->max_cycles, cycles);
+   s->hist[get_latency_bucket(cycles)]++;
+
+   if (ps) {
+      ps->count[sn]++;
+      ps->tot_cycles[sn] += cycles;
+   }
+}
+
+int alloc_proc_syscall_stats(struct process *pi)
+{
+   ASSERT(!pi->sys_stats);
+
+   if (!(pi->sys_stats = kzalloc_obj(struct proc_syscall_stats)))
+      return -ENOMEM;
+
+   return 0;
+}
+
+void free_proc_syscall_stats(struct process *pi)
+{
+   if (pi->sys_stats) {
+      kfree_obj(pi->sys_stats, struct proc_syscall_stats);
+      pi->sys_stats = NULL;
+   }
+}
+
+/* ----------------------- /syst/syscalls/ files ------------------------ */
+
+#if MOD_sysfs
+
+/*
+ * Upper bounds for the length of a single line in the files below. The
+ * buffer size is calculated on open(), while the content is generated right
+ * after that: a few extra lines are allowed for the syscalls or the processes
+ * that might appear in between. Anything beyond that is truncated.
+ */
+#define GLOBAL_LINE_MAX              (64 + 12 * SYSCALL_STATS_BUCKETS)
+#define PROC_LINE_MAX                                                 80
+#define EXTRA_LINES                                                   16
+#define HEADER_MAX                                                   128
+
+static const char *get_sys_name(u32 sn)
+{
+   const char *name = NULL;
+
+#if MOD_tracing
+   name = tracing_get_syscall_name(sn);
+#endif
+
+   if (!name)
+      return "?";
+
+   if (!strncmp(name, "sys_", 4))
+      name += 4;
+
+   return name;
+}
+
+static u32 get_used_syscalls_count(void)
+{
+   u32 count = 0;
+
+   for (u32 sn = 0; sn < MAX_SYSCALLS; sn++)
+      count += !!global_syscall_stats[sn].count;
+
+   return count;
+}
+
+static offt
+sys_stats_global_get_buf_sz(struct sysobj *obj, void *data)
+{
+   u32 lines;
+
+   disable_preemption();
+   {
+      lines = get_used_syscalls_count();
+   }
+   enable_preemption();
+   return HEADER_MAX + (offt)(lines + EXTRA_LINES) * GLOBAL_LINE_MAX;
+}
+
+static offt
+sys_stats_global_load(struct sysobj *obj, void *data,
+                      void *buf, offt buf_sz, offt off)
+{
+   const size_t sz = (size_t)buf_sz;
+   struct syscall_stats s;
+   char *p = buf;
+   size_t used;
+
+   ASSERT(off == 0);
+
+   used = (size_t)snprintk(p, sz,
+                           "# nr name calls cycles max_cycles "
+                           "[log2(cycles):calls ...]\n");
+
+   for (u32 sn = 0; sn < MAX_SYSCALLS && used < sz; sn++) {
+
+      disable_preemption();
+      {
+         s = global_syscall_stats[sn];
+      }
+      enable_preemption();
+
+      if (!s.count)
+         continue;
+
+      used += (size_t)snprintk(p + used, sz - used,
+                               "%u %s %llu %llu %llu",
+                               sn, get_sys_name(sn),
+                               s.count, s.tot_cycles, s.max_cycles);
+
+      for (u32 b = 0; b < SYSCALL_STATS_BUCKETS && used < sz; b++) {
+         if (s.hist[b])
+            used += (size_t)snprintk(p + used, sz - used,
+                                     " %u:%u", b, s.hist[b]);
+      }
+
+      if (used < sz)
+         used += (size_t)snprintk(p + used, sz - used, "\n");
+   }
+
+   return (offt)MIN(used, sz);
+}
+
+struct sys_stats_procs_ctx {
+   char *buf;
+   size_t sz;
+   size_t used;
+   u32 lines;
+};
+
+static int sys_stats_count_procs_cb(void *obj, void *arg)
+{
+   struct task *ti = obj;
+   struct sys_stats_procs_ctx *ctx = arg;
+   struct proc_syscall_stats *ps = ti->pi->sys_stats;
+
+   if (!ti->is_main_thread || !ps)
+      return 0;
+
+   for (u32 sn = 0; sn < MAX_SYSCALLS; sn++)
+      ctx->lines += !!ps->count[sn];
+
+   return 0;
+}
+
+static int sys_stats_dump_procs_cb(void *obj, void *arg)
+{
+   struct task *ti = obj;
+   struct sys_stats_procs_ctx *ctx = arg;
+   struct proc_syscall_stats *ps = ti->pi->sys_stats;
+
+   if (!ti->is_main_thread || !ps)
+      return 0;
+
+   for (u32 sn = 0; sn < MAX_SYSCALLS; sn++) {
+
+      if (!ps->count[sn])
+         continue;
+
+      if (ctx->used >= ctx->sz)
+         return 1;      /* stop the iteration: no more space */
+
+      ctx->used += (size_t)snprintk(ctx->buf + ctx->used,
+                                    ctx->sz - ctx->used,
+                                    "%d %u %s %u %llu\n",
+                                    ti->pi->pid, sn, get_sys_name(sn),
+                                    ps->count[sn], ps->tot_cycles[sn]);
+   }
+
+   return 0;
+}
+
+static offt
+sys_stats_procs_get_buf_sz(struct sysobj *obj, void *data)
+{
+   struct sys_stats_procs_ctx ctx = {0};
+
+   disable_preemption();
+   {
+      iterate_over_tasks(sys_stats_count_procs_cb, &ctx);
+   }
+   enable_preemption();
+   return HEADER_MAX + (offt)(ctx.lines + EXTRA_LINES) * PROC_LINE_MAX;
+}
+
+static offt
+sys_stats_procs_load(struct sysobj *obj, void *data,
+                     void *buf, offt buf_sz, offt off)
+{
+   struct sys_stats_procs_ctx ctx = {
+      .buf = buf,
+      .sz = (size_t)buf_sz,
+   };
+
+   ASSERT(off == 0);
+   ctx.used = (size_t)snprintk(buf, ctx.sz, "# pid nr name calls cycles\n");
+
+   disable_preemption();
+   {
+      iterate_over_tasks(sys_stats_dump_procs_cb, &ctx);
+   }
+   enable_preemption();
+   return (offt)MIN(ctx.used, ctx.sz);
+}
+
+static const struct sysobj_prop_type sys_stats_global_prop_type = {
+   .buf_type = SYSFS_BUF_BUFFERED,
+   .get_buf_sz = &sys_stats_global_get_buf_sz,
+   .load = &sys_stats_global_load,
+};
+
+static const struct sysobj_prop_type sys_stats_procs_prop_type = {
+   .buf_type = SYSFS_BUF_BUFFERED,
+   .get_buf_sz = &sys_stats_procs_get_buf_sz,
+   .load = &sys_stats_procs_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(global, &sys_stats_global_prop_type);
+DEF_STATIC_SYSOBJ_PROP(procs, &sys_stats_procs_prop_type);
+
+DEF_STATIC_SYSOBJ_TYPE(sys_stats_sysobj_type,
+                       &prop_global,
+                       &prop_procs,
+                       NULL);
+
+void register_syscall_stats_sysfs(void)
+{
+   struct sysobj *obj = sysfs_create_obj(&sys_stats_sysobj_type, NULL, NULL);
+
+   if (!obj) {
+      printk("WARNING: /syst/syscalls not registered: out of memory\n");
+      return;
+   }
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "syscalls", obj) < 0) {
+      printk("WARNING: /syst/syscalls not registered\n");
+      sysfs_destroy_unregistered_obj(obj);
+   }
+}
+
+#else  /* !MOD_sysfs */
+
+void register_syscall_stats_sysfs(void) { /* no-op */ }
+
+#endif /* MOD_sysfs */
+#endif /* KRN_SYSCALL_STATS */
@@ -348,6 +348,8 @@ int sys_reboot(u32 magic, u32 magic2, u32 cmd, void *arg)
 
 int sys_sched_yield(void)
 {
+   /* Let the RT tasks with our same priority run: see do_schedule() */
+   get_curr_task()->rt_yield = true;
    kernel_yield();
    return 0;
 }
@@ -297,6 +297,7 @@ static ALWAYS_INLINE bool timer_nested_irq(void)
 static enum irq_action timer_irq_handler(void *ctx)
 {
    u32 ns_delta;
+   u64 now;
    ASSERT(are_interrupts_enabled());
 
    if (KRN_TRACK_NESTED_INTERR)
@@ -312,13 +313,14 @@ static enum irq_action timer_irq_handler(void *ctx)
          ns_delta = __tick_duration;
       }
 
-      __ticks++;
+      now = ++__ticks;
       __time_ns += ns_delta;
    }
    enable_interrupts_forced();
 
    sched_account_ticks();
    tick_all_timers();
+   wth_run_delayed_jobs(now);
    return IRQ_HANDLED;
 }
 
@@ -87,41 +87,6 @@ static int tty_read_ready(fs_handle h)
    return tty_read_ready_int(t, dh);
 }
 
-int
-tty_create_extra(int minor, void *extra)
-{
-   struct tty_handle_extra *eh = extra;
-   eh->read_buf = kzmalloc(TTY_READ_BS);
-
-   if (!eh->read_buf)
-      return -ENOMEM;
-
-   return 0;
-}
-
-int
-tty_on_dup_extra(int minor, void *extra)
-{
-   struct tty_handle_extra *eh = extra;
-   char *new_buf;
-   ASSERT(eh->read_buf);
-
-   if (!(new_buf = kmalloc(TTY_READ_BS)))
-      return -ENOMEM;
-
-   memcpy32(new_buf, eh->read_buf, TTY_READ_BS / 4);
-   eh->read_buf = new_buf;
-   return 0;
-}
-
-void
-tty_destroy_extra(int minor, void *extra)
-{
-   struct tty_handle_extra *eh = extra;
-   ASSERT(eh->read_buf);
-   kfree2(eh->read_buf, TTY_READ_BS);
-}
-
 static int
 tty_create_device_file(int minor,
                        enum vfs_entry_type *type,
@@ -143,9 +108,6 @@ tty_create_device_file(int minor,
 
    *type = VFS_CHAR_DEV;
    nfo->fops = &static_ops_tty;
-   nfo->create_extra = &tty_create_extra;
-   nfo->destroy_extra = &tty_destroy_extra;
-   nfo->on_dup_extra = &tty_on_dup_extra;
    return 0;
 }
 
@@ -230,8 +192,11 @@ tty_full_destroy(struct tty *t)
       free_console_data(t->console_data);
    }
 
+   tty_output_destroy(t);
    kfree_array_obj(t->ctrl_handlers, tty_ctrl_sig_func, 256);
-   kfree_obj(t->input_buf, TTY_INPUT_BS);
+   kfree_array_obj(t->input_lines, u16, TTY_INPUT_MAX_LINES);
+   kfree2(t->edit_buf, TTY_INPUT_BS);
+   kfree2(t->input_buf, TTY_INPUT_BS);
    kfree_obj(t, struct tty);
 }
 
@@ -251,11 +216,26 @@ allocate_and_init_tty(u16 minor, u16 serial_port_fwd, int rows_buf)
       return NULL;
    }
 
+   if (!(t->edit_buf = kzmalloc(TTY_INPUT_BS))) {
+      tty_full_destroy(t);
+      return NULL;
+   }
+
+   if (!(t->input_lines = kzalloc_array_obj(u16, TTY_INPUT_MAX_LINES))) {
+      tty_full_destroy(t);
+      return NULL;
+   }
+
    if (!(t->ctrl_handlers = kzalloc_array_obj(tty_ctrl_sig_func, 256))) {
       tty_full_destroy(t);
       return NULL;
    }
 
+   if (tty_output_init(t) < 0) {
+      tty_full_destroy(t);
+      return NULL;
+   }
+
    if (MOD_console_actual && !serial_port_fwd) {
       if (!(t->console_data = alloc_console_data())) {
          tty_full_destroy(t);
@@ -371,6 +351,14 @@ tty_write_int(struct tty *t,
               size_t size)
 {
    size = MIN(size, MAX_TERM_WRITE_LEN);
+
+   /*
+    * Only writes on a file handle (write(2)) go through the async output
+    * queue. The kernel's own writes (printk) are rendered immediately.
+    */
+   if (KRN_TTY_ASYNC_OUTPUT && h)
+      return tty_output_write(t, h, buf, size);
+
    t->tintf->write(t->tstate, buf, size, t->curr_color);
    return (ssize_t) size;
 }
@@ -406,6 +394,7 @@ STATIC void init_tty(void)
     * to the current tty. Therefore, just create the dev file.
     */
    tty_create_devfile_or_panic("tty0", di->major, 0, NULL);
+   init_tty_output();
 
    if (!kopt_sercon)
       if (video_term_intf)
@@ -68,9 +68,7 @@ static bool tty_ctrl_quit(struct tty *t, bool block)
 static bool tty_ctrl_eof(struct tty *t, bool block)
 {
    if (t->c_term.c_lflag & ICANON) {
-      t->end_line_delim_count++;
-      tty_inbuf_write_elem(t, t->c_term.c_cc[VEOF], block);
-      kcond_signal_one(&t->input_cond);
+      tty_inbuf_end_line(t, -1 /* EOF is not kept */, block);
       return true;
    }
 
@@ -80,9 +78,7 @@ static bool tty_ctrl_eof(struct tty *t, bool block)
 static bool tty_ctrl_eol(struct tty *t, bool block)
 {
    if (t->c_term.c_lflag & ICANON) {
-      t->end_line_delim_count++;
-      tty_inbuf_write_elem(t, t->c_term.c_cc[VEOL], block);
-      kcond_signal_one(&t->input_cond);
+      tty_inbuf_end_line(t, t->c_term.c_cc[VEOL], block);
       return true;
    }
    return false;
@@ -91,9 +87,7 @@ static bool tty_ctrl_eol(struct tty *t, bool block)
 static bool tty_ctrl_eol2(struct tty *t, bool block)
 {
    if (t->c_term.c_lflag & ICANON) {
-      t->end_line_delim_count++;
-      tty_inbuf_write_elem(t, t->c_term.c_cc[VEOL2], block);
-      kcond_signal_one(&t->input_cond);
+      tty_inbuf_end_line(t, t->c_term.c_cc[VEOL2], block);
       return true;
    }
    return false;
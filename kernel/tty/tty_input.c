@@ -20,7 +20,7 @@
 
 #include "tty_int.h"
 
-static void tty_inbuf_write_elem(struct tty *t, u8 c, bool block);
+static void tty_inbuf_end_line(struct tty *t, int delim, bool block);
 static void tty_keypress_echo(struct tty *t, char c);
 
 #include "tty_ctrl_handlers.c.h"
@@ -39,7 +39,7 @@ static void tty_keypress_echo(struct tty *t, char c)
        *    ECHONL: If ICANON is also set, echo the NL character even if ECHO
        *            is not set.
        */
-      t->tintf->write(t->tstate, &c, 1, t->curr_color);
+      tty_output_echo(t, &c, 1);
       return;
    }
 
@@ -59,7 +59,7 @@ static void tty_keypress_echo(struct tty *t, char c)
 
       if (c_term->c_lflag & ECHOK) {
          if (c == c_term->c_cc[VKILL]) {
-            t->tintf->write(t->tstate, &c, 1, t->curr_color);
+            tty_output_echo(t, &c, 1);
             return;
          }
       }
@@ -77,7 +77,7 @@ static void tty_keypress_echo(struct tty *t, char c)
 
 
          if (c == c_term->c_cc[VWERASE] || c == c_term->c_cc[VERASE]) {
-            t->tintf->write(t->tstate, &c, 1, t->curr_color);
+            tty_output_echo(t, &c, 1);
             return;
          }
       }
@@ -98,25 +98,40 @@ static void tty_keypress_echo(struct tty *t, char c)
       if (c != '\t' && c != '\n') {
          if (c != c_term->c_cc[VSTART] && c != c_term->c_cc[VSTOP]) {
             char mini_buf[2] = { '^', c + 0x40 };
-            t->tintf->write(t->tstate, mini_buf, 2, t->curr_color);
+            tty_output_echo(t, mini_buf, 2);
             return;
          }
       }
    }
 
    /* Just ECHO a regular character */
-   t->tintf->write(t->tstate, &c, 1, t->curr_color);
+   tty_output_echo(t, &c, 1);
 }
 
-static inline bool tty_inbuf_is_empty(struct tty *t)
+/*
+ * Input buffering
+ * -----------------
+ *
+ * The input ready to be read is in `input_ringbuf`. In raw mode, that's all:
+ * every byte is made available as soon as it's written. In canonical mode,
+ * the line being edited is kept in `edit_buf`, where VERASE, VWERASE and
+ * VKILL operate, and it's moved to `input_ringbuf` all at once when it's
+ * terminated. For each line in the ringbuf we keep its length (a span) in the
+ * small circular array `input_lines`: read() just pops the first span and
+ * copies its bytes with a single ringbuf_read_bytes(). A line terminated by
+ * VEOF doesn't contain the EOF char, therefore an empty line means EOF.
+ *
+ * In canonical mode, the sum of the spans is always equal to the number of
+ * bytes in the ringbuf. Both the buffers are protected by disabling the
+ * preemption. The input that doesn't fit in them is discarded and counted in
+ * `input_overruns`.
+ */
+
+STATIC_ASSERT(64 <= TTY_INPUT_BS && TTY_INPUT_BS <= 32768);
+
+static inline bool tty_is_cc(struct tty *t, u8 c, int cc)
 {
-   bool ret;
-   disable_preemption();
-   {
-      ret = ringbuf_is_empty(&t->input_ringbuf);
-   }
-   enable_preemption();
-   return ret;
+   return c && c == t->c_term.c_cc[cc];
 }
 
 void tty_inbuf_reset(struct tty *t)
@@ -124,35 +139,73 @@ void tty_inbuf_reset(struct tty *t)
    disable_preemption();
    {
       ringbuf_reset(&t->input_ringbuf);
-      t->end_line_delim_count = 0;
+      t->input_lines_first = 0;
+      t->input_lines_count = 0;
+      t->edit_len = 0;
    }
    enable_preemption();
 }
 
-static inline u8 tty_inbuf_read_elem(struct tty *t)
+/* Must be called with preemption disabled */
+static bool tty_inbuf_commit_line(struct tty *t)
 {
-   u8 ret = 0;
-   disable_preemption();
-   {
-      ASSERT(!tty_inbuf_is_empty(t));
-      DEBUG_CHECKED_SUCCESS(ringbuf_read_elem1(&t->input_ringbuf, &ret));
-      kcond_signal_all(&t->output_cond);
-   }
-   enable_preemption();
-   return ret;
+   struct ringbuf *const rb = &t->input_ringbuf;
+   u16 idx;
+
+   ASSERT(!is_preemption_enabled());
+
+   if (t->input_lines_count == TTY_INPUT_MAX_LINES)
+      return false;
+
+   if (rb->max_elems - ringbuf_get_elems(rb) < t->edit_len)
+      return false;
+
+   ringbuf_write_bytes(rb, (u8 *)t->edit_buf, t->edit_len);
+
+   idx = (t->input_lines_first + t->input_lines_count) % TTY_INPUT_MAX_LINES;
+   t->input_lines[idx] = t->edit_len;
+   t->input_lines_count++;
+   t->edit_len = 0;
+   return true;
 }
 
-static inline bool tty_inbuf_drop_last_written_elem(struct tty *t)
+/*
+ * Called after c_term has been changed. Switching to raw mode, the line being
+ * edited becomes readable; switching to canonical mode, the unread input goes
+ * back to the line being edited, as if it had been just typed.
+ */
+void tty_inbuf_on_mode_change(struct tty *t, tcflag_t old_lflag)
 {
-   bool ret;
-   tty_keypress_echo(t, (char)t->c_term.c_cc[VERASE]);
+   struct ringbuf *const rb = &t->input_ringbuf;
+   size_t n;
+
+   if ((t->c_term.c_lflag & ICANON) == (old_lflag & ICANON))
+      return;
 
    disable_preemption();
-   {
-      ret = ringbuf_unwrite_elem(&t->input_ringbuf, NULL);
+
+   if (t->c_term.c_lflag & ICANON) {
+
+      if (!ringbuf_is_empty(rb)) {
+         n = ringbuf_read_bytes(rb, (u8 *)t->edit_buf, TTY_INPUT_BS - 1);
+         t->edit_len = (u16)n;
+         t->input_overruns += ringbuf_get_elems(rb);
+         ringbuf_reset(rb);
+      }
+
+   } else {
+
+      if (t->edit_len) {
+         n = ringbuf_write_bytes(rb, (u8 *)t->edit_buf, t->edit_len);
+         t->input_overruns += t->edit_len - n;
+         t->edit_len = 0;
+      }
+
+      t->input_lines_first = 0;
+      t->input_lines_count = 0;
    }
+
    enable_preemption();
-   return ret;
 }
 
 static void
@@ -161,11 +214,32 @@ tty_inbuf_write_elem(struct tty *t, u8 c, bool block)
    ASSERT(in_panic() || !block || is_preemption_enabled());
    bool ok;
 
+   if (t->c_term.c_lflag & ICANON) {
+
+      /* Append `c` to the line being edited, keeping a byte for the delim */
+      disable_preemption();
+      {
+         if ((ok = t->edit_len < TTY_INPUT_BS - 1))
+            t->edit_buf[t->edit_len++] = (char)c;
+         else
+            t->input_overruns++;
+      }
+      enable_preemption();
+
+      if (ok)
+         tty_keypress_echo(t, (char)c);
+
+      return;
+   }
+
    while (true) {
 
       disable_preemption();
       {
          ok = ringbuf_write_elem1(&t->input_ringbuf, c);
+
+         if (!ok && !block)
+            t->input_overruns++;
       }
       enable_preemption();
 
@@ -190,6 +264,111 @@ tty_inbuf_write_elem(struct tty *t, u8 c, bool block)
    }
 }
 
+/*
+ * Terminates the line being edited with `delim` (or with nothing, for VEOF:
+ * delim < 0) and makes it readable.
+ */
+static void
+tty_inbuf_end_line(struct tty *t, int delim, bool block)
+{
+   ASSERT(in_panic() || !block || is_preemption_enabled());
+   bool ok;
+
+   disable_preemption();
+   {
+      if (delim >= 0) {
+         ASSERT(t->edit_len < TTY_INPUT_BS);
+         t->edit_buf[t->edit_len++] = (char)delim;
+      }
+   }
+   enable_preemption();
+
+   if (delim >= 0)
+      tty_keypress_echo(t, (char)delim);
+
+   while (true) {
+
+      disable_preemption();
+      {
+         ok = tty_inbuf_commit_line(t);
+
+         if (!ok && !block) {
+            /* We cannot block, discard the whole line */
+            t->input_overruns += t->edit_len;
+            t->edit_len = 0;
+         }
+      }
+      enable_preemption();
+
+      if (ok || !block)
+         break;
+
+      kcond_signal_all(&t->input_cond);
+      kcond_wait(&t->output_cond, NULL, TIME_SLICE_TICKS);
+   }
+
+   kcond_signal_one(&t->input_cond);
+}
+
+/* Removes the last `n` bytes of the line being edited and echoes `c` */
+static void tty_inbuf_erase(struct tty *t, u16 n, u8 c)
+{
+   disable_preemption();
+   {
+      n = MIN(n, t->edit_len);
+      t->edit_len -= n;
+   }
+   enable_preemption();
+
+   if (n)
+      tty_keypress_echo(t, (char)c);
+}
+
+static void tty_inbuf_erase_word(struct tty *t)
+{
+   const char *const buf = t->edit_buf;
+   u16 len = t->edit_len;
+
+   while (len > 0 && isspace(buf[len - 1]))
+      len--;
+
+   while (len > 0 && !isspace(buf[len - 1]))
+      len--;
+
+   tty_inbuf_erase(t, t->edit_len - len, t->c_term.c_cc[VWERASE]);
+}
+
+static void tty_inbuf_kill_line(struct tty *t)
+{
+   const tcflag_t lflag = t->c_term.c_lflag;
+   const u8 erase_c = t->c_term.c_cc[VERASE];
+   u16 n;
+
+   disable_preemption();
+   {
+      n = t->edit_len;
+      t->edit_len = 0;
+   }
+   enable_preemption();
+
+   if (!n)
+      return;
+
+   if ((lflag & (ECHOKE | ECHOE)) == (ECHOKE | ECHOE)) {
+
+      /* Visually erase the whole line, one char at a time */
+      while (n--)
+         tty_keypress_echo(t, (char)erase_c);
+
+      return;
+   }
+
+   tty_keypress_echo(t, (char)t->c_term.c_cc[VKILL]);
+
+   if ((lflag & (ECHO | ECHOK)) == (ECHO | ECHOK))
+      tty_output_echo(t, "\n", 1);
+}
+
 static int
 tty_handle_non_printable_key(struct kb_dev *kb,
                              struct tty *t,
@@ -216,29 +395,28 @@ tty_handle_non_printable_key(struct kb_dev *kb,
    return kb_handler_ok_and_continue;
 }
 
-static inline bool tty_is_line_delim_char(struct tty *t, u8 c)
-{
-   return c == '\n' ||
-          c == t->c_term.c_cc[VEOF] ||
-          c == t->c_term.c_cc[VEOL] ||
-          c == t->c_term.c_cc[VEOL2];
-}
-
 static void
 tty_keypress_handle_canon_mode(struct tty *t, u32 key, u8 c, bool block)
 {
-   if (c == t->c_term.c_cc[VERASE]) {
+   if (tty_is_cc(t, c, VERASE)) {
+
+      tty_inbuf_erase(t, 1, c);
+
+   } else if (tty_is_cc(t, c, VWERASE) && (t->c_term.c_lflag & IEXTEN)) {
+
+      tty_inbuf_erase_word(t);
 
-      tty_inbuf_drop_last_written_elem(t);
+   } else if (tty_is_cc(t, c, VKILL)) {
+
+      tty_inbuf_kill_line(t);
+
+   } else if (c == '\n') {
+
+      tty_inbuf_end_line(t, c, block);
 
    } else {
 
       tty_inbuf_write_elem(t, c, block);
-
-      if (tty_is_line_delim_char(t, c)) {
-         t->end_line_delim_count++;
-         kcond_signal_one(&t->input_cond);
-      }
    }
 }
 
@@ -382,98 +560,72 @@ tty_keypress_handler(struct kb_dev *kb, struct key_event ke)
    return tty_keypress_handler_int(t, kb, ke);
 }
 
-static size_t tty_flush_read_buf(struct devfs_handle *h, char *buf, size_t size)
-{
-   struct tty_handle_extra *eh = (void *)&h->extra;
-   offt rem = eh->read_buf_used - eh->read_pos;
-   ASSERT(rem >= 0);
-
-   size_t m = MIN((size_t)rem, size);
-   memcpy(buf, eh->read_buf + eh->read_pos, m);
-   eh->read_pos += m;
-
-   if (eh->read_pos == eh->read_buf_used) {
-      eh->read_buf_used = 0;
-      eh->read_pos = 0;
-   }
-
-   return m;
-}
-
 /*
- * Returns:
- *    - TRUE when caller's read loop should continue
- *    - FALSE when caller's read loop should STOP
+ * Canonical mode: reads (up to `size` bytes of) the first complete line.
+ * Returns false if there are no complete lines.
  */
 static bool
-tty_internal_read_single_char_from_kb(struct tty *t,
-                                      struct devfs_handle *h,
-                                      bool *delim_break)
+tty_inbuf_read_line(struct tty *t, char *buf, size_t size, size_t *cnt)
 {
-   struct tty_handle_extra *eh = (void *)&h->extra;
-   u8 c = tty_inbuf_read_elem(t);
-   eh->read_buf[eh->read_buf_used++] = (char)c;
+   u16 *len;
+   size_t n;
 
-   if (t->c_term.c_lflag & ICANON) {
+   ASSERT(!is_preemption_enabled());
 
-      if (tty_is_line_delim_char(t, c)) {
-         ASSERT(t->end_line_delim_count > 0);
-         t->end_line_delim_count--;
-         *delim_break = true;
+   if (!t->input_lines_count)
+      return false;
 
-         /* All line delimiters except EOF are kept */
-         if (c == t->c_term.c_cc[VEOF])
-            eh->read_buf_used--;
-      }
+   len = &t->input_lines[t->input_lines_first];
+   n = ringbuf_read_bytes(&t->input_ringbuf, (u8 *)buf, MIN(size, *len));
+   *len -= (u16)n;
+   *cnt = n;
 
-      return !*delim_break;
+   if (!*len) {
+      /* The line has been completely read (or it was an EOF) */
+      t->input_lines_first = (t->input_lines_first + 1) % TTY_INPUT_MAX_LINES;
+      t->input_lines_count--;
    }
 
-   /*
-    * In raw mode it makes no sense to read until a line delim is
-    * found: we should read the minimum necessary.
-    */
-   return !(eh->read_buf_used >= t->c_term.c_cc[VMIN]);
+   return true;
 }
 
-static inline bool
-tty_internal_should_read_return(struct tty *t,
-                                struct devfs_handle *h,
-                                size_t read_cnt,
-                                bool delim_break)
+/*
+ * Raw mode: reads everything available, up to `size` bytes. Returns true when
+ * we read at least VMIN bytes (but at least 1, as we don't support VTIME).
+ */
+static bool
+tty_inbuf_read_raw(struct tty *t, char *buf, size_t size, size_t *cnt)
 {
-   struct tty_handle_extra *eh = (void *)&h->extra;
+   const size_t vmin = MIN((size_t)t->c_term.c_cc[VMIN], size);
 
-   if (t->c_term.c_lflag & ICANON) {
-      return
-         delim_break ||
-            (t->end_line_delim_count > 0 &&
-               (eh->read_buf_used == TTY_READ_BS || read_cnt == TTY_INPUT_BS));
-   }
+   ASSERT(!is_preemption_enabled());
 
-   /* Raw mode handling */
-   return read_cnt >= t->c_term.c_cc[VMIN];
+   *cnt += ringbuf_read_bytes(&t->input_ringbuf,
+                              (u8 *)buf + *cnt,
+                              size - *cnt);
+   return *cnt >= MAX(1u, vmin);
 }
 
 bool tty_read_ready_int(struct tty *t, struct devfs_handle *h)
 {
-   struct tty_handle_extra *eh = (void *)&h->extra;
-
-   if (t->c_term.c_lflag & ICANON) {
-      return eh->read_allowed_to_return || t->end_line_delim_count > 0;
+   bool ret;
+   disable_preemption();
+   {
+      if (t->c_term.c_lflag & ICANON)
+         ret = t->input_lines_count > 0;
+      else
+         ret = ringbuf_get_elems(&t->input_ringbuf) >= t->c_term.c_cc[VMIN];
    }
-
-   /* Raw mode handling */
-   return ringbuf_get_elems(&t->input_ringbuf) >= t->c_term.c_cc[VMIN];
+   enable_preemption();
+   return ret;
 }
 
 ssize_t
 tty_read_int(struct tty *t, struct devfs_handle *h, char *buf, size_t size)
 {
-   struct tty_handle_extra *eh = (void *)&h->extra;
    struct process *pi = get_curr_proc();
    size_t read_count = 0;
-   bool delim_break;
+   bool done;
 
    ASSERT(is_preemption_enabled());
 
@@ -501,105 +653,59 @@ tty_read_int(struct tty *t, struct devfs_handle *h, char *buf, size_t size)
    if (!size)
       return 0;
 
-   if (eh->read_buf_used) {
-
-      if (!(h->fl_flags & O_NONBLOCK))
-         return (ssize_t) tty_flush_read_buf(h, buf, size);
-
-      /*
-       * The file description is in NON-BLOCKING mode: this means we cannot
-       * just return the buffer to the user even if there is something left in
-       * it because the tty might be in canonical mode (and we're not sure the
-       * user pressed ENTER). Therefore, we have to check an additional flag
-       * called read_allowed_to_return that is set if the user actually pressed
-       * ENTER (precisely: a line delimiter has been written to the tty). In
-       * the BLOCKING mode case (default), we can, instead, actually flush the
-       * buffer and return because read_buf_used > 0 means just that user's
-       * buffer was just not big enough.
-       */
-
-      if (eh->read_allowed_to_return) {
-
-         ssize_t ret = (ssize_t) tty_flush_read_buf(h, buf, size);
-
-         if (!eh->read_buf_used)
-            eh->read_allowed_to_return = false;
-
-         return ret;
-      }
-   }
+   if (t->c_term.c_lflag & ICANON) {
 
-   if (t->c_term.c_lflag & ICANON)
+      /* The col offset must be after the prompt: wait for it to be rendered */
+      tty_output_drain(t);
       t->tintf->set_col_offset(t->tstate, -1 /* current col */);
+   }
 
-   eh->read_allowed_to_return = false;
-
-   do {
-
-      if ((h->fl_flags & O_NONBLOCK) && tty_inbuf_is_empty(t))
-         return -EAGAIN;
-
-      while (tty_inbuf_is_empty(t)) {
-
-         /*
-          * Use a finite timeout instead of KCOND_WAIT_FOREVER: this loop
-          * checks tty_inbuf_is_empty() with no lock held, so a writer
-          * (the kb_worker_thread bottom half) that signals input_cond
-          * between our predicate check and our entry into kcond_wait()
-          * will hit an empty wait_list and the wakeup is lost. The
-          * outer while() re-checks the predicate, so a wakeup arriving
-          * via timeout instead of signal is handled correctly; worst-
-          * case latency on a missed signal becomes the timeout.
-          *
-          * The timeout is intentionally not TIME_SLICE_TICKS: under the
-          * stress config (KRN_MINIMAL_TIME_SLICE) that's 1 tick, which
-          * makes every blocked tty reader add itself to the wakeup-timer
-          * list every tick and forces tick_all_timers() to walk it on
-          * each interrupt. That's enough scheduler pressure to perturb
-          * boot timing on slow emulators (riscv64 without KVM hangs at
-          * the first shell prompt with TIME_SLICE_TICKS here). 250ms is
-          * still imperceptible for interactive input but keeps the
-          * timer-list churn bounded.
-          */
-         kcond_wait(&t->input_cond, NULL, KRN_TIMER_HZ / 4);
-
-         if (pending_signals())
-            return -EINTR;
-      }
+   while (true) {
 
-      delim_break = false;
+      disable_preemption();
+      {
+         if (t->c_term.c_lflag & ICANON)
+            done = tty_inbuf_read_line(t, buf, size, &read_count);
+         else
+            done = tty_inbuf_read_raw(t, buf, size, &read_count);
 
-      if (!(h->fl_flags & O_NONBLOCK)) {
-         ASSERT(eh->read_buf_used == 0);
-         ASSERT(eh->read_pos == 0);
+         if (read_count)
+            kcond_signal_all(&t->output_cond);
       }
+      enable_preemption();
 
-      while (!tty_inbuf_is_empty(t) &&
-             eh->read_buf_used < TTY_READ_BS &&
-             tty_internal_read_single_char_from_kb(t, h, &delim_break)) { }
-
-      if (!(h->fl_flags & O_NONBLOCK) || !(t->c_term.c_lflag & ICANON))
-         read_count += tty_flush_read_buf(h, buf+read_count, size-read_count);
-
-      ASSERT(t->end_line_delim_count >= 0);
-
-   } while (!tty_internal_should_read_return(t, h, read_count, delim_break));
+      if (done)
+         break;
 
-   if (h->fl_flags & O_NONBLOCK) {
+      if (h->fl_flags & O_NONBLOCK)
+         return read_count ? (ssize_t)read_count : -EAGAIN;
 
       /*
-       * If we got here in NONBLOCK mode, that means we exited the loop properly
-       * with tty_internal_should_read_return() returning true. Now we have to
-       * flush the read buffer.
+       * Use a finite timeout instead of KCOND_WAIT_FOREVER: this loop
+       * checks the input buffer with no lock held, so a writer (the
+       * kb_worker_thread bottom half) that signals input_cond between our
+       * predicate check and our entry into kcond_wait() will hit an empty
+       * wait_list and the wakeup is lost. The loop re-checks the predicate,
+       * so a wakeup arriving via timeout instead of signal is handled
+       * correctly; worst-case latency on a missed signal becomes the timeout.
+       *
+       * The timeout is intentionally not TIME_SLICE_TICKS: under the
+       * stress config (KRN_MINIMAL_TIME_SLICE) that's 1 tick, which
+       * makes every blocked tty reader add itself to the wakeup-timer
+       * list every tick and forces tick_all_timers() to walk it on
+       * each interrupt. That's enough scheduler pressure to perturb
+       * boot timing on slow emulators (riscv64 without KVM hangs at
+       * the first shell prompt with TIME_SLICE_TICKS here). 250ms is
+       * still imperceptible for interactive input but keeps the
+       * timer-list churn bounded.
        */
+      kcond_wait(&t->input_cond, NULL, KRN_TIMER_HZ / 4);
 
-      read_count += tty_flush_read_buf(h, buf+read_count, size-read_count);
-
-      if (eh->read_buf_used)
-         eh->read_allowed_to_return = true;
+      if (pending_signals())
+         return read_count ? (ssize_t)read_count : -EINTR;
    }
 
-   return (ssize_t) read_count;
+   return (ssize_t)read_count;
 }
 
 void tty_update_ctrl_handlers(struct tty *t)
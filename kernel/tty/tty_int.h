@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <tilck_gen_headers/mod_console.h>
 #include <tilck/common/basic_defs.h>
 #include <tilck/kernel/sync.h>
 #include <tilck/kernel/term.h>
@@ -11,18 +12,8 @@
 #include <tilck/kernel/fs/vfs_base.h>
 #include <tilck/kernel/fs/devfs.h>
 
-#define TTY_READ_BS   4096
-
-struct tty_handle_extra {
-   offt read_pos;
-   offt read_buf_used;
-   char *read_buf;
-   bool read_allowed_to_return;
-};
-
-STATIC_ASSERT(sizeof(struct tty_handle_extra) <= DEVFS_EXTRA_SIZE);
-
 void tty_input_init(struct tty *t);
+void tty_inbuf_on_mode_change(struct tty *t, tcflag_t old_lflag);
 
 enum kb_handler_action
 tty_keypress_handler(struct kb_dev *, struct key_event ke);
@@ -45,16 +36,46 @@ tty_ioctl_int(struct tty *t, struct devfs_handle *h, ulong request, void *argp);
 bool
 tty_read_ready_int(struct tty *t, struct devfs_handle *h);
 
-int
-tty_create_extra(int minor, void *extra);
-
-void
-tty_destroy_extra(int minor, void *extra);
-
-int
-tty_on_dup_extra(int minor, void *extra);
-
 void init_ttyaux(void);
+
+#if KRN_TTY_ASYNC_OUTPUT
+
+   void init_tty_output(void);
+   int tty_output_init(struct tty *t);
+   void tty_output_destroy(struct tty *t);
+   int tty_output_drain(struct tty *t);
+   void tty_output_echo(struct tty *t, const char *buf, size_t size);
+
+   ssize_t
+   tty_output_write(struct tty *t,
+                    struct devfs_handle *h,
+                    const char *buf,
+                    size_t size);
+
+#else
+
+   static inline void init_tty_output(void) { }
+   static inline int tty_output_init(struct tty *t) { return 0; }
+   static inline void tty_output_destroy(struct tty *t) { }
+   static inline int tty_output_drain(struct tty *t) { return 0; }
+
+   static inline void
+   tty_output_echo(struct tty *t, const char *buf, size_t size)
+   {
+      t->tintf->write(t->tstate, buf, size, t->curr_color);
+   }
+
+   static inline ssize_t
+   tty_output_write(struct tty *t,
+                    struct devfs_handle *h,
+                    const char *buf,
+                    size_t size)
+   {
+      t->tintf->write(t->tstate, buf, size, t->curr_color);
+      return (ssize_t)size;
+   }
+
+#endif
 void tty_create_devfile_or_panic(const char *filename,
                                  u16 major,
                                  u16 minor,
@@ -51,11 +51,15 @@ void tty_set_raw_mode(struct tty *t)
 {
    disable_preemption();
    {
-      tty_reset_termios(t);
+      const tcflag_t old_lflag = t->c_term.c_lflag;
+
+      t->c_term = default_termios;
+      t->mediumraw_mode = false;
       t->c_term.c_iflag = 0;
       t->c_term.c_oflag = 0;
       t->c_term.c_cflag = CREAD | B38400 | CS8;
       t->c_term.c_lflag = 0;
+      tty_inbuf_on_mode_change(t, old_lflag);
    }
    enable_preemption();
 }
@@ -78,8 +82,11 @@ void tty_reset_termios(struct tty *t)
 {
    disable_preemption();
    {
+      const tcflag_t old_lflag = t->c_term.c_lflag;
+
       t->c_term = default_termios;
       t->mediumraw_mode = false;
+      tty_inbuf_on_mode_change(t, old_lflag);
    }
    enable_preemption();
 }
@@ -104,9 +111,7 @@ static int tty_ioctl_tcsets(struct tty *t, void *argp)
       return -EFAULT;
    }
 
-   if ((t->c_term.c_lflag & ICANON) != (saved.c_lflag & ICANON))
-      t->end_line_delim_count = 0;
-
+   tty_inbuf_on_mode_change(t, saved.c_lflag);
    tty_update_ctrl_handlers(t);
    tty_update_default_state_tables(t);
    return 0;
@@ -167,6 +172,7 @@ static int tty_ioctl_kdsetmode(struct tty *t, void *argp)
    }
 
    if (opt == KD_GRAPHICS) {
+      tty_output_drain(t);
       t->tintf->pause_output(t->tstate);
       t->kd_gfx_mode = KD_GRAPHICS;
       return 0;
@@ -327,12 +333,19 @@ tty_ioctl_int(struct tty *t, struct devfs_handle *h, ulong request, void *argp)
          return tty_ioctl_tcsets(t, argp);
 
       case TCSETSW: // equivalent to: tcsetattr(fd, TCSADRAIN, argp)
+         if (tty_output_drain(t) < 0)
+            return -EINTR;
          return tty_ioctl_tcsets(t, argp);
 
       case TCSETSF: // equivalent to: tcsetattr(fd, TCSAFLUSH, argp)
+         if (tty_output_drain(t) < 0)
+            return -EINTR;
          tty_inbuf_reset(t);
          return tty_ioctl_tcsets(t, argp);
 
+      case TCSBRK: // tcdrain(fd) is TCSBRK with arg != 0; no breaks on ttys
+         return tty_output_drain(t);
+
       case TIOCGWINSZ:
          return tty_ioctl_tiocgwinsz(t, argp);
 
@@ -0,0 +1,304 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/mod_console.h>
+#include <tilck_gen_headers/config_kernel.h>
+#include <tilck_gen_headers/config_sched.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/fs/vfs_base.h>
+#include <tilck/kernel/fs/devfs.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/term.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/signal.h>
+#include <tilck/kernel/worker_thread.h>
+
+#include <fcntl.h>        // system header
+
+#include "tty_int.h"
+
+#if KRN_TTY_ASYNC_OUTPUT
+
+/*
+ * Asynchronous tty output
+ * -------------------------
+ *
+ * write() on a tty just copies the data in the tty's output ringbuf and
+ * returns; a dedicated worker thread renders the data on the term. Because
+ * the worker threads preempt the user tasks, the flush job is not queued
+ * right away: a delayed job (see wth_enqueue_delayed()) queues it after
+ * TTY_OUTPUT_FLUSH_TICKS, so that all the writes done in the meanwhile are
+ * rendered together, in chunks of TTY_OUTPUT_FLUSH_BS bytes. The flush job is
+ * queued immediately when the ringbuf is half full and when somebody waits
+ * for the output to be drained. The writers block only when the ringbuf is
+ * full, until the flush job makes some space.
+ *
+ * The ringbuf and the `out_*` flags are protected by disabling the preemption,
+ * like the input ringbuf. Additionally, `out_lock` serializes the writers
+ * (a write() blocked on a full ringbuf is not interleaved with other ones) and
+ * guarantees that the signals on `out_space_cond` and `out_drain_cond` are
+ * not lost, since the flush job takes it before signaling.
+ *
+ * The echo of the input and the ttys' printk() output (see tty_write_int())
+ * don't take `out_lock` and never block: the echo is queued, in order to keep
+ * it after the output written before, but it's discarded if the ringbuf is
+ * full. The printk() output is still rendered directly.
+ */
+
+/* Max delay between a write() and its rendering: ~10 ms, at least 1 tick */
+#define TTY_OUTPUT_FLUSH_TICKS                  MAX(1, KRN_TIMER_HZ / 100)
+
+STATIC_ASSERT(MAX_TTYS + 4 <= WTH_TTY_OUT_QUEUE_SIZE);
+
+STATIC struct worker_thread *tty_out_wth;
+
+static void tty_output_flush_job(void *arg)
+{
+   struct tty *const t = arg;
+   size_t n;
+
+   while (true) {
+
+      disable_preemption();
+      {
+         n = ringbuf_read_bytes(&t->out_ringbuf,
+                                (u8 *)t->out_flush_buf,
+                                TTY_OUTPUT_FLUSH_BS);
+
+         t->out_flushing = n > 0;
+
+         if (!n)
+            t->out_job_queued = false;
+      }
+      enable_preemption();
+
+      kmutex_lock(&t->out_lock);
+      {
+         kcond_signal_all(n ? &t->out_space_cond : &t->out_drain_cond);
+      }
+      kmutex_unlock(&t->out_lock);
+
+      if (!n)
+         break;
+
+      t->tintf->write(t->tstate, t->out_flush_buf, n, t->curr_color);
+   }
+}
+
+static void tty_output_delayed_flush(void *arg);
+
+/*
+ * Queues the flush job, right away if `now` is true, otherwise after
+ * TTY_OUTPUT_FLUSH_TICKS. Must be called with preemption disabled.
+ */
+static void tty_output_queue_flush(struct tty *t, bool now)
+{
+   ASSERT(!is_preemption_enabled());
+
+   if (t->out_job_queued)
+      return;     /* the flush job will render all the data in the ringbuf */
+
+   if (!now) {
+
+      if (t->out_flush_delayed)
+         return;
+
+      if (wth_enqueue_delayed(WTH_PRIO_LOWEST,
+                              TTY_OUTPUT_FLUSH_TICKS,
+                              &tty_output_delayed_flush,
+                              t))
+      {
+         t->out_flush_delayed = true;
+         return;
+      }
+
+      /* No free slots for delayed jobs: just flush right away */
+   }
+
+   t->out_job_queued = true;
+
+   /* There's at most one flush job per tty: this cannot fail */
+   if (!wth_enqueue_on(tty_out_wth, &tty_output_flush_job, t))
+      panic("tty: unable to enqueue the output flush job");
+}
+
+/* Runs in a generic worker thread, TTY_OUTPUT_FLUSH_TICKS after a write */
+static void tty_output_delayed_flush(void *arg)
+{
+   struct tty *const t = arg;
+
+   disable_preemption();
+   {
+      t->out_flush_delayed = false;
+
+      if (!ringbuf_is_empty(&t->out_ringbuf))
+         tty_output_queue_flush(t, true);
+   }
+   enable_preemption();
+}
+
+/* Must be called with preemption disabled */
+static inline bool tty_output_is_half_full(struct tty *t)
+{
+   return ringbuf_get_elems(&t->out_ringbuf) >= TTY_OUTPUT_BS / 2;
+}
+
+static bool tty_output_is_drained(struct tty *t)
+{
+   bool ret;
+   disable_preemption();
+   {
+      ret = ringbuf_is_empty(&t->out_ringbuf) && !t->out_flushing;
+   }
+   enable_preemption();
+   return ret;
+}
+
+ssize_t
+tty_output_write(struct tty *t,
+                 struct devfs_handle *h,
+                 const char *buf,
+                 size_t size)
+{
+   const bool nonblock = h && (h->fl_flags & O_NONBLOCK);
+   size_t written = 0;
+
+   if (!tty_out_wth) {
+      /* No worker thread: render the data synchronously, as usual */
+      t->tintf->write(t->tstate, buf, size, t->curr_color);
+      return (ssize_t)size;
+   }
+
+   if (!size)
+      return 0;
+
+   kmutex_lock(&t->out_lock);
+
+   while (true) {
+
+      disable_preemption();
+      {
+         written += ringbuf_write_bytes(&t->out_ringbuf,
+                                        (u8 *)buf + written,
+                                        size - written);
+
+         if (written)
+            tty_output_queue_flush(t, tty_output_is_half_full(t));
+      }
+      enable_preemption();
+
+      if (written == size || nonblock)
+         break;
+
+      /* The ringbuf is full: wait for the flush job to make some space */
+      kcond_wait(&t->out_space_cond, &t->out_lock, KCOND_WAIT_FOREVER);
+
+      if (pending_signals())
+         break;
+   }
+
+   kmutex_unlock(&t->out_lock);
+
+   if (!written)
+      return nonblock ? -EAGAIN : -EINTR;
+
+   return (ssize_t)written;
+}
+
+void tty_output_echo(struct tty *t, const char *buf, size_t size)
+{
+   if (!tty_out_wth) {
+      t->tintf->write(t->tstate, buf, size, t->curr_color);
+      return;
+   }
+
+   disable_preemption();
+   {
+      if (ringbuf_write_bytes(&t->out_ringbuf, (u8 *)buf, size))
+         tty_output_queue_flush(t, tty_output_is_half_full(t));
+   }
+   enable_preemption();
+}
+
+/* Waits until all the queued output has been rendered (tcdrain) */
+int tty_output_drain(struct tty *t)
+{
+   int rc = 0;
+
+   if (!tty_out_wth)
+      return 0;
+
+   kmutex_lock(&t->out_lock);
+
+   /* Don't wait for the delayed flush */
+   disable_preemption();
+   {
+      if (!ringbuf_is_empty(&t->out_ringbuf))
+         tty_output_queue_flush(t, true);
+   }
+   enable_preemption();
+
+   while (!tty_output_is_drained(t)) {
+
+      kcond_wait(&t->out_drain_cond, &t->out_lock, KCOND_WAIT_FOREVER);
+
+      if (pending_signals()) {
+         rc = -EINTR;
+         break;
+      }
+   }
+
+   kmutex_unlock(&t->out_lock);
+   return rc;
+}
+
+int tty_output_init(struct tty *t)
+{
+   if (!(t->out_buf = kmalloc(TTY_OUTPUT_BS)))
+      return -ENOMEM;
+
+   if (!(t->out_flush_buf = kmalloc(TTY_OUTPUT_FLUSH_BS))) {
+      kfree2(t->out_buf, TTY_OUTPUT_BS);
+      t->out_buf = NULL;
+      return -ENOMEM;
+   }
+
+   ringbuf_init(&t->out_ringbuf, TTY_OUTPUT_BS, 1, t->out_buf);
+   kmutex_init(&t->out_lock, 0);
+   kcond_init(&t->out_space_cond);
+   kcond_init(&t->out_drain_cond);
+   return 0;
+}
+
+void tty_output_destroy(struct tty *t)
+{
+   if (!t->out_buf)
+      return;
+
+   kcond_destroy(&t->out_drain_cond);
+   kcond_destroy(&t->out_space_cond);
+   kmutex_destroy(&t->out_lock);
+   ringbuf_destory(&t->out_ringbuf);
+   kfree2(t->out_flush_buf, TTY_OUTPUT_FLUSH_BS);
+   kfree2(t->out_buf, TTY_OUTPUT_BS);
+   t->out_buf = t->out_flush_buf = NULL;
+}
+
+void init_tty_output(void)
+{
+   disable_preemption();
+   {
+      tty_out_wth =
+         wth_create_thread("tty_out", 2 /* priority */, WTH_TTY_OUT_QUEUE_SIZE);
+   }
+   enable_preemption();
+
+   if (!tty_out_wth)
+      printk("WARNING: tty: no worker thread, using synchronous output\n");
+}
+
+#endif /* KRN_TTY_ASYNC_OUTPUT */
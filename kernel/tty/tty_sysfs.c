@@ -0,0 +1,178 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/mod_sysfs.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/tty.h>
+#include <tilck/kernel/tty_struct.h>
+#include <tilck/kernel/term.h>
+#include <tilck/kernel/errno.h>
+
+#include "tty_int.h"
+
+/* ------------------------- /syst/tty/ files -------------------------- */
+
+#if MOD_sysfs
+
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+/*
+ * One directory per tty:
+ *
+ *    input_overruns [ro] the input bytes discarded because the buffer was full
+ *
+ * Plus, for the ttys having a term with a scrollback (video ttys):
+ *
+ *    sb_max_rows    [rw] the scrollback depth, in rows (0 = no scrollback)
+ *    sb_rows        [ro] the rows currently in the scrollback
+ *    sb_mem         [ro] the memory allocated for the scrollback, in bytes
+ *    sb_data_size   [ro] the bytes used by the (encoded) rows
+ *    sb_raw_size    [ro] the bytes the same rows would take, unencoded
+ */
+
+static offt
+tty_input_overruns_load(struct sysobj *obj, void *data,
+                        void *buf, offt buf_sz, offt off)
+{
+   struct tty *t = data;
+   ASSERT(off == 0);
+   return snprintk(buf, (size_t)buf_sz, "%u\n", t->input_overruns);
+}
+
+static void tty_sysfs_get_sb_info(void *data, struct term_sb_info *out)
+{
+   struct tty *t = data;
+   t->tintf->get_sb_info(t->tstate, out);
+}
+
+#define DEF_TTY_SB_INFO_LOAD(field)                                       \
+   static offt                                                            \
+   tty_sb_##field##_load(struct sysobj *obj, void *data,                  \
+                         void *buf, offt buf_sz, offt off)                \
+   {                                                                      \
+      struct term_sb_info info;                                           \
+      ASSERT(off == 0);                                                   \
+      tty_sysfs_get_sb_info(data, &info);                                 \
+      return snprintk(buf, (size_t)buf_sz, "%u\n", info.field);           \
+   }
+
+DEF_TTY_SB_INFO_LOAD(max_rows)
+DEF_TTY_SB_INFO_LOAD(rows)
+DEF_TTY_SB_INFO_LOAD(mem)
+DEF_TTY_SB_INFO_LOAD(data_size)
+DEF_TTY_SB_INFO_LOAD(raw_size)
+
+static offt
+tty_sb_max_rows_store(struct sysobj *obj, void *data, void *buf, offt buf_sz)
+{
+   struct tty *t = data;
+   char tmp[32] = {0};
+   int err = 0;
+   ulong val;
+
+   memcpy(tmp, buf, (size_t)MIN(buf_sz, (offt)sizeof(tmp) - 1));
+   val = tilck_strtoul(tmp, NULL, 10, &err);
+
+   if (err)
+      return -EINVAL;
+
+   t->tintf->set_sb_max_rows(t->tstate, (u32)MIN(val, 0xffffffffUL));
+   return buf_sz;
+}
+
+static const struct sysobj_prop_type tty_input_overruns_prop_type = {
+   .load = &tty_input_overruns_load,
+};
+
+static const struct sysobj_prop_type tty_sb_max_rows_prop_type = {
+   .load = &tty_sb_max_rows_load,
+   .store = &tty_sb_max_rows_store,
+};
+
+static const struct sysobj_prop_type tty_sb_rows_prop_type = {
+   .load = &tty_sb_rows_load,
+};
+
+static const struct sysobj_prop_type tty_sb_mem_prop_type = {
+   .load = &tty_sb_mem_load,
+};
+
+static const struct sysobj_prop_type tty_sb_data_size_prop_type = {
+   .load = &tty_sb_data_size_load,
+};
+
+static const struct sysobj_prop_type tty_sb_raw_size_prop_type = {
+   .load = &tty_sb_raw_size_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(input_overruns, &tty_input_overruns_prop_type);
+DEF_STATIC_SYSOBJ_PROP(sb_max_rows, &tty_sb_max_rows_prop_type);
+DEF_STATIC_SYSOBJ_PROP(sb_rows, &tty_sb_rows_prop_type);
+DEF_STATIC_SYSOBJ_PROP(sb_mem, &tty_sb_mem_prop_type);
+DEF_STATIC_SYSOBJ_PROP(sb_data_size, &tty_sb_data_size_prop_type);
+DEF_STATIC_SYSOBJ_PROP(sb_raw_size, &tty_sb_raw_size_prop_type);
+
+DEF_STATIC_SYSOBJ_TYPE(tty_sysobj_type,
+                       &prop_input_overruns,
+                       NULL);
+
+DEF_STATIC_SYSOBJ_TYPE(tty_video_sysobj_type,
+                       &prop_input_overruns,
+                       &prop_sb_max_rows,
+                       &prop_sb_rows,
+                       &prop_sb_mem,
+                       &prop_sb_data_size,
+                       &prop_sb_raw_size,
+                       NULL);
+
+static void register_tty_sysobj(struct sysobj *dir, struct tty *t)
+{
+   struct sysobj *obj;
+
+   if (t->tintf->get_sb_info)
+      obj = sysfs_create_obj(&tty_video_sysobj_type, NULL, t, t, t, t, t, t);
+   else
+      obj = sysfs_create_obj(&tty_sysobj_type, NULL, t);
+
+   if (!obj) {
+      printk("WARNING: /syst/tty/%s not registered: out of memory\n",
+             t->dev_filename);
+      return;
+   }
+
+   if (sysfs_register_obj(NULL, dir, t->dev_filename, obj) < 0) {
+      printk("WARNING: /syst/tty/%s not registered\n", t->dev_filename);
+      sysfs_destroy_unregistered_obj(obj);
+   }
+}
+
+void register_tty_sysfs(void)
+{
+   struct sysobj *dir = sysfs_create_empty_obj();
+
+   if (!dir) {
+      printk("WARNING: /syst/tty not registered: out of memory\n");
+      return;
+   }
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "tty", dir) < 0) {
+      printk("WARNING: /syst/tty not registered\n");
+      sysfs_destroy_unregistered_obj(dir);
+      return;
+   }
+
+   for (u32 i = 1; i < ARRAY_SIZE(ttys); i++) {
+      if (ttys[i])
+         register_tty_sysobj(dir, ttys[i]);
+   }
+}
+
+#else  /* !MOD_sysfs */
+
+void register_tty_sysfs(void) { /* no-op */ }
+
+#endif /* MOD_sysfs */
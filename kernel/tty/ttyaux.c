@@ -66,9 +66,6 @@ ttyaux_create_device_file(int minor,
 
    *type = VFS_CHAR_DEV;
    nfo->fops = &static_ops_ttyaux;
-   nfo->create_extra = &tty_create_extra;
-   nfo->destroy_extra = &tty_destroy_extra;
-   nfo->on_dup_extra = &tty_on_dup_extra;
    return 0;
 }
 
@@ -75,7 +75,9 @@ static int vfs_getdents_cb(struct vfs_dent64 *vde, void *arg)
    }
 
    ctx->ent.d_ino    = vde->ino;
-   ctx->ent.d_off    = (u64) ctx->off + 1; /* "offset" (=ID) of the next dent */
+   ctx->ent.d_off    = vde->next_off > 0
+                          ? (u64) vde->next_off   /* fs-specific position */
+                          : (u64) ctx->off + 1;   /* "offset" (=ID) of next */
    ctx->ent.d_reclen = entry_size;
    ctx->ent.d_type   = vfs_type_to_linux_dirent_type(vde->type);
 
@@ -90,7 +92,7 @@ static int vfs_getdents_cb(struct vfs_dent64 *vde, void *arg)
 
    ctx->offset += entry_size;
    ctx->off++;
-   ctx->h->dir_pos++;
+   ctx->h->dir_pos = (offt) ctx->ent.d_off;
    return 0;
 }
 
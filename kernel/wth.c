@@ -16,17 +16,18 @@
  * ordinary tasks. In particular:
  *
  *   - They live in worker_threads[] (sorted by priority), NOT in the
- *     scheduler's runnable_tasks_list. The scheduler picks them via
+ *     scheduler's runqueue. The scheduler picks them via
  *     a dedicated pass (wth_get_runnable_thread() in do_schedule)
  *     that runs BEFORE the regular runnable-list lookup, so a
  *     runnable worker always wins against a runnable non-worker.
  *
- *   - They have no timeslice: sched_account_ticks() never sets
- *     need_resched for a running worker. A worker yields voluntarily
- *     when its queue drains, or gets preempted only by a
- *     higher-priority worker waking up.
+ *   - They're SCHED_FIFO tasks with the max RT priority, so they have
+ *     no timeslice: sched_account_ticks() never sets need_resched for
+ *     a running worker. A worker yields voluntarily when its queue
+ *     drains, or gets preempted only by a higher-priority worker
+ *     waking up. Their policy cannot be changed from user space.
  *
- *   - They are intentionally invisible to runnable_tasks_count, so
+ *   - They are intentionally invisible to the runqueues' counters, so
  *     code that polls it — yield_until_last(), idle's halt-loop
  *     check, sched_account_ticks()'s vruntime weighting — is
  *     worker-blind by design. Workers are bottom halves, not tasks
@@ -37,10 +38,37 @@
  * Subsystems (acpi, e1000, serial, kb, ...) register their own
  * dedicated worker via wth_create_thread() at a strictly lower
  * priority — see the assert in wth_create_thread().
+ *
+ * The generic workers form a pool, which grows under load:
+ *
+ *   - wth_enqueue_anywhere() picks the least loaded generic worker,
+ *     preferring the idle ones. When even that one is blocked inside
+ *     a job or has its queue half full, it asks for another generic
+ *     worker at the same priority, up to WTH_POOL_MAX_THREADS. The
+ *     worker is created right away by the caller, when running in
+ *     task context with preemption enabled, otherwise by the first
+ *     generic worker reaching a job boundary.
+ *
+ *   - An idle generic worker steals the jobs queued on a generic
+ *     worker of the same priority busy running a job. When a job is
+ *     queued behind a blocked job, an idle peer is woken up for that.
+ *     Therefore, the jobs of generic workers are NOT guaranteed to
+ *     run in order, nor one at a time: only the dedicated workers
+ *     guarantee that.
+ *
+ * Delayed jobs (wth_enqueue_delayed()) wait in a small fixed table,
+ * checked by the timer IRQ handler: when they're due, they're just
+ * moved to the pool. No timer thread is needed.
+ *
+ * Each worker counts its jobs and keeps histograms of the queue
+ * depth at enqueue time and of the enqueue-to-run latency, exported
+ * in /syst/wth/stats (see wth_sysfs.c).
  */
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/atomics.h>
+#include <tilck/common/utils.h>
+#include <tilck/common/printk.h>
 
 #include <tilck/kernel/worker_thread.h>
 #include <tilck/kernel/kmalloc.h>
@@ -55,9 +83,23 @@
 
 #include "wth_int.h"
 
+struct wth_delayed_job {
+   u64 deadline;                 /* in ticks */
+   void (*func)(void *);         /* NULL: free slot */
+   void *arg;
+   int lowest_prio;
+};
+
 int worker_threads_cnt;
 struct worker_thread *worker_threads[WTH_MAX_THREADS];
 
+u32 wth_delayed_pending;
+u64 wth_delayed_fired;
+
+static int pool_grow_prio = -1;  /* prio of the pool to grow, -1 if none */
+static struct wth_delayed_job delayed_jobs[WTH_MAX_DELAYED_JOBS];
+static u64 delayed_next_deadline = (u64) -1;
+
 u32 wth_get_queue_size(struct worker_thread *wth)
 {
    return wth->rb.max_elems;
@@ -86,6 +128,55 @@ static long wth_cmp_func(const void *a, const void *b)
    return (*wa)->priority - (*wb)->priority;
 }
 
+u32 wth_get_queue_depth(struct worker_thread *t)
+{
+   struct generic_safe_ringbuf_stat s;
+   s.__raw = atomic_load_explicit(&t->rb.s.raw, mo_relaxed);
+
+   if (s.full)
+      return t->rb.max_elems;
+
+   return (s.write_pos + t->rb.max_elems - s.read_pos) % t->rb.max_elems;
+}
+
+static ALWAYS_INLINE u32 wth_depth_bucket(u32 depth)
+{
+   const u32 b = depth ? 32 - (u32)__builtin_clz(depth) : 0;
+   return MIN(b, (u32)WTH_DEPTH_BUCKETS - 1);
+}
+
+static ALWAYS_INLINE u32 wth_lat_bucket(u64 cycles)
+{
+   const u32 log2 = cycles ? 63 - (u32)__builtin_clzll(cycles) : 0;
+   return MIN(log2, (u32)WTH_LAT_BUCKETS - 1);
+}
+
+/* True if `t` is sleeping in the middle of a job (e.g. on a mutex) */
+static inline bool wth_is_blocked(struct worker_thread *t)
+{
+   return t->running_job && t->task->state == TASK_STATE_SLEEPING;
+}
+
+/*
+ * A job has been queued on the generic worker `t`, blocked in another job:
+ * wake up an idle peer, which will steal it (see wth_steal_job()).
+ */
+static void wth_wakeup_idle_peer(struct worker_thread *t)
+{
+   for (int i = 0; i < worker_threads_cnt; i++) {
+
+      struct worker_thread *p = worker_threads[i];
+
+      if (p == t || p->name || p->priority != t->priority)
+         continue;
+
+      if (p->waiting_for_jobs) {
+         wth_wakeup(p);
+         return;
+      }
+   }
+}
+
 NODISCARD bool
 wth_enqueue_on(struct worker_thread *t, void (*func)(void *), void *arg)
 {
@@ -95,7 +186,9 @@ wth_enqueue_on(struct worker_thread *t, void (*func)(void *), void *arg)
    struct wjob new_job = {
       .func = func,
       .arg = arg,
+      .enq_cycles = RDTSC(),
    };
+   u32 depth;
 
    disable_preemption();
 
@@ -118,24 +211,78 @@ wth_enqueue_on(struct worker_thread *t, void (*func)(void *), void *arg)
 
 #endif
 
+   depth = wth_get_queue_depth(t);
    success = safe_ringbuf_write_elem(&t->rb, &new_job, &was_empty);
 
-   if (success && was_empty && t->waiting_for_jobs) {
-      wth_wakeup(t);
+   if (success) {
+
+      t->stats.enqueued++;
+      t->stats.depth_hist[wth_depth_bucket(depth)]++;
+      t->stats.max_depth = MAX(t->stats.max_depth, depth + 1);
+
+      if (was_empty && t->waiting_for_jobs)
+         wth_wakeup(t);
+      else if (!t->name && wth_is_blocked(t))
+         wth_wakeup_idle_peer(t);
+
+   } else {
+
+      t->stats.dropped++;
    }
 
    enable_preemption();
    return success;
 }
 
+static int wth_count_pool_workers(int prio)
+{
+   int n = 0;
+
+   for (int i = 0; i < worker_threads_cnt; i++)
+      if (!worker_threads[i]->name && worker_threads[i]->priority == prio)
+         n++;
+
+   return n;
+}
+
+static void wth_request_pool_grow(int prio)
+{
+   if (pool_grow_prio < 0 || prio < pool_grow_prio)
+      pool_grow_prio = prio;
+}
+
+/* Must be called in task context, with preemption enabled */
+static void wth_pool_grow_if_requested(void)
+{
+   int prio;
+
+   if (LIKELY(pool_grow_prio < 0))
+      return;
+
+   disable_preemption();
+   {
+      prio = pool_grow_prio;
+      pool_grow_prio = -1;
+
+      if (prio >= 0 && wth_count_pool_workers(prio) < WTH_POOL_MAX_THREADS)
+         if (!wth_create_thread(NULL, prio, WTH_MAX_PRIO_QUEUE_SIZE))
+            printk("WARNING: wth: unable to grow the pool (prio %d)\n", prio);
+   }
+   enable_preemption();
+}
+
 NODISCARD bool
 wth_enqueue_anywhere(int lowest_prio, void (*func)(void *), void *arg)
 {
-   struct worker_thread *wth;
-
-   if (lowest_prio == WTH_PRIO_HIGHEST) /* shortcut: take the init worker */
-      return wth_enqueue_on(worker_threads[0], func, arg);
+   struct worker_thread *wth, *best = NULL;
+   u32 load, best_load = 0;
+   bool success;
 
+   /*
+    * Pick the least loaded generic worker, counting a job being run as load.
+    * On ties, prefer the lowest priority (= the last) one, not to disturb the
+    * higher-priority workers.
+    */
    for (int i = worker_threads_cnt-1; i >= 0; i--) {
 
       wth = worker_threads[i];
@@ -146,11 +293,112 @@ wth_enqueue_anywhere(int lowest_prio, void (*func)(void *), void *arg)
       if (wth->priority > lowest_prio)
          continue;
 
-      if (wth_enqueue_on(wth, func, arg))
-         return true; /* success */
+      load = wth_get_queue_depth(wth) + wth->running_job;
+
+      if (!best || load < best_load) {
+         best = wth;
+         best_load = load;
+      }
    }
 
-   return false;
+   if (!best)
+      return false;
+
+   success = wth_enqueue_on(best, func, arg);
+
+   if (!success || wth_is_blocked(best) || best_load >= best->rb.max_elems/2)
+   {
+      wth_request_pool_grow(best->priority);
+
+      if (!in_irq() && is_preemption_enabled() && are_interrupts_enabled())
+         wth_pool_grow_if_requested();
+   }
+
+   return success;
+}
+
+NODISCARD bool
+wth_enqueue_delayed(int lowest_prio,
+                    u32 ticks,
+                    void (*func)(void *),
+                    void *arg)
+{
+   struct wth_delayed_job *dj = NULL;
+   u64 deadline;
+   ulong var;
+
+   ASSERT(func != NULL);
+
+   if (!ticks)
+      return wth_enqueue_anywhere(lowest_prio, func, arg);
+
+   deadline = get_ticks() + ticks;
+   disable_interrupts(&var);
+   {
+      for (int i = 0; i < WTH_MAX_DELAYED_JOBS; i++) {
+         if (!delayed_jobs[i].func) {
+            dj = &delayed_jobs[i];
+            break;
+         }
+      }
+
+      if (dj) {
+
+         *dj = (struct wth_delayed_job) {
+            .deadline = deadline,
+            .func = func,
+            .arg = arg,
+            .lowest_prio = lowest_prio,
+         };
+
+         wth_delayed_pending++;
+         delayed_next_deadline = MIN(delayed_next_deadline, deadline);
+      }
+   }
+   enable_interrupts(&var);
+   return dj != NULL;
+}
+
+/*
+ * Called by the timer IRQ handler on every tick: moves the due delayed jobs
+ * to the pool. When the pool is full, they stay here until the next tick.
+ */
+void wth_run_delayed_jobs(u64 now)
+{
+   u64 next = (u64) -1;
+   ulong var;
+
+   disable_interrupts(&var);
+
+   if (LIKELY(now < delayed_next_deadline)) {
+      enable_interrupts(&var);
+      return;
+   }
+
+   for (int i = 0; i < WTH_MAX_DELAYED_JOBS; i++) {
+
+      struct wth_delayed_job *dj = &delayed_jobs[i];
+
+      if (!dj->func)
+         continue;
+
+      if (dj->deadline <= now) {
+
+         if (wth_enqueue_anywhere(dj->lowest_prio, dj->func, dj->arg)) {
+            dj->func = NULL;
+            wth_delayed_pending--;
+            wth_delayed_fired++;
+            continue;
+         }
+
+         dj->deadline = now + 1; /* retry on the next tick */
+      }
+
+      next = MIN(next, dj->deadline);
+   }
+
+   delayed_next_deadline = next;
+   enable_interrupts(&var);
 }
 
 struct worker_thread *
@@ -175,6 +423,20 @@ wth_find_worker(int lowest_prio)
    return worker_threads[0];
 }
 
+static void wth_run_job(struct worker_thread *t, struct wjob *job)
+{
+   const u64 lat = RDTSC() - job->enq_cycles;
+
+   t->stats.run++;
+   t->stats.lat_hist[wth_lat_bucket(lat)]++;
+   t->stats.max_lat_cycles = MAX(t->stats.max_lat_cycles, lat);
+
+   /* Run the job with preemption enabled */
+   t->running_job = true;
+   job->func(job->arg);
+   t->running_job = false;
+}
+
 bool wth_process_single_job(struct worker_thread *t)
 {
    bool success;
@@ -182,14 +444,50 @@ bool wth_process_single_job(struct worker_thread *t)
 
    success = safe_ringbuf_read_elem(&t->rb, &job_to_run);
 
-   if (success) {
-      /* Run the job with preemption enabled */
-      job_to_run.func(job_to_run.arg);
-   }
+   if (success)
+      wth_run_job(t, &job_to_run);
 
    return success;
 }
 
+/*
+ * Called by the idle generic worker `t`: runs a job taken from the queue of a
+ * generic worker having the same priority, but busy running another job.
+ */
+static bool wth_steal_job(struct worker_thread *t)
+{
+   struct worker_thread *v;
+   struct wjob job;
+
+   for (int i = 0; i < worker_threads_cnt; i++) {
+
+      v = worker_threads[i];
+
+      if (v == t || v->name || v->priority != t->priority)
+         continue;
+
+      if (!v->running_job)
+         continue;   /* it will run its jobs by itself */
+
+      /* Increment it before reading: see wth_wait_for_completion() */
+      atomic_fetch_add_explicit(&v->stolen_running, 1, mo_relaxed);
+
+      if (!safe_ringbuf_read_elem(&v->rb, &job)) {
+         atomic_fetch_sub_explicit(&v->stolen_running, 1, mo_relaxed);
+         continue;
+      }
+
+      t->stats.stolen++;
+      wth_run_job(t, &job);
+
+      atomic_fetch_sub_explicit(&v->stolen_running, 1, mo_relaxed);
+      kcond_signal_all(&v->completion);
+      return true;
+   }
+
+   return false;
+}
+
 void wth_run(void *arg)
 {
    struct worker_thread *t = arg;
@@ -207,6 +505,11 @@ void wth_run(void *arg)
 
          job_run = wth_process_single_job(t);
 
+         if (!t->name) {
+            wth_pool_grow_if_requested();
+            job_run = job_run || wth_steal_job(t);
+         }
+
       } while (job_run);
 
       disable_interrupts_forced();
@@ -285,13 +588,13 @@ wth_create_thread(const char *name, int priority, u16 queue_size)
    ASSERT(priority >= WTH_PRIO_HIGHEST && priority <= WTH_PRIO_LOWEST);
 
    /*
-    * Only the singleton init-time worker (the first to call this) may
-    * occupy WTH_PRIO_HIGHEST. Every later caller must pass a strictly
-    * lower priority (= numerically higher), so worker_threads[0] stays
-    * the init worker — the fast paths of wth_enqueue_anywhere() and
-    * wth_find_worker() rely on this.
+    * Only generic workers may occupy WTH_PRIO_HIGHEST: the init-time one
+    * (the first to call this) and the ones added to its pool. Every
+    * dedicated worker must pass a strictly lower priority (= numerically
+    * higher). Because the sort below is stable, worker_threads[0] stays
+    * the init worker — the fast path of wth_find_worker() relies on this.
     */
-   ASSERT(worker_threads_cnt == 0 || priority > WTH_PRIO_HIGHEST);
+   ASSERT(worker_threads_cnt == 0 || priority > WTH_PRIO_HIGHEST || !name);
 
    if (worker_threads_cnt >= ARRAY_SIZE(worker_threads))
       return NULL; /* too many worker threads */
@@ -338,8 +641,12 @@ wth_create_thread(const char *name, int priority, u16 queue_size)
 void
 wth_wait_for_completion(struct worker_thread *wth)
 {
-   while (!wth->waiting_for_jobs)
+   /* Jobs stolen from its queue by other workers must complete as well */
+   while (!wth->waiting_for_jobs ||
+          atomic_load_explicit(&wth->stolen_running, mo_relaxed))
+   {
       kcond_wait(&wth->completion, NULL, KRN_TIMER_HZ / 10);
+   }
 }
 
 static void
@@ -352,5 +659,10 @@ init_wth_create_worker_or_die(int prio, u16 queue_size)
 void init_worker_threads(void)
 {
    worker_threads_cnt = 0;
+   pool_grow_prio = -1;
+   wth_delayed_pending = 0;
+   wth_delayed_fired = 0;
+   delayed_next_deadline = (u64) -1;
+   bzero(delayed_jobs, sizeof(delayed_jobs));
    init_wth_create_worker_or_die(WTH_PRIO_HIGHEST, WTH_MAX_PRIO_QUEUE_SIZE);
 }
@@ -4,9 +4,34 @@
 #include <tilck/kernel/safe_ringbuf.h>
 #include <tilck/kernel/sync.h>
 
+#define WTH_LAT_BUCKETS                                     32
+#define WTH_DEPTH_BUCKETS                                    8
+
 struct wjob {
    void (*func)(void *);
    void *arg;
+   u64 enq_cycles;            /* RDTSC() at enqueue time */
+};
+
+/*
+ * Per-worker counters. They're updated without locks (also from IRQ context)
+ * and therefore are only approximate: good enough for statistics.
+ *
+ * depth_hist[i] counts the enqueues which found `i` jobs in the queue for
+ * i = 0 and [2^(i-1), 2^i) jobs for i > 0, while lat_hist[i] counts the jobs
+ * that waited [2^i, 2^(i+1)) cycles in the queue before running. In both, the
+ * last bucket counts everything above.
+ */
+struct wth_stats {
+
+   u64 enqueued;
+   u64 run;
+   u64 max_lat_cycles;
+   u32 dropped;               /* enqueues failed because the queue was full */
+   u32 stolen;                /* jobs taken from other workers' queues */
+   u32 max_depth;
+   u32 depth_hist[WTH_DEPTH_BUCKETS];
+   u32 lat_hist[WTH_LAT_BUCKETS];
 };
 
 struct worker_thread {
@@ -18,12 +43,18 @@ struct worker_thread {
    struct kcond completion;
    int priority;              /* 0 is the max priority */
    volatile bool waiting_for_jobs;
+   volatile bool running_job;
+   ATOMIC(int) stolen_running; /* jobs of ours being run by other workers */
+   struct wth_stats stats;
 };
 
 extern struct worker_thread *worker_threads[WTH_MAX_THREADS];
 extern int worker_threads_cnt;
+extern u32 wth_delayed_pending;
+extern u64 wth_delayed_fired;
 
 void wth_run(void *arg);
 void wth_wakeup(struct worker_thread *t);
 bool wth_process_single_job(struct worker_thread *t);
 int wth_create_thread_for(struct worker_thread *t);
+u32 wth_get_queue_depth(struct worker_thread *t);
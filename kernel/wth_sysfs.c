@@ -0,0 +1,160 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/mod_sysfs.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/worker_thread.h>
+#include <tilck/kernel/sched.h>
+
+#include "wth_int.h"
+
+/* ------------------------- /syst/wth/ files -------------------------- */
+
+#if MOD_sysfs
+
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+/*
+ * Upper bounds for the length of the lines in /syst/wth/stats: each worker
+ * has one line with its counters and two with its histograms.
+ */
+#define WTH_LINE_MAX                 (24 + 12 * 8)
+#define WTH_DEPTH_LINE_MAX           (24 + 11 * WTH_DEPTH_BUCKETS)
+#define WTH_LAT_LINE_MAX             (24 + 11 * WTH_LAT_BUCKETS)
+#define WTH_HEADER_MAX                                               512
+
+struct wth_dump_ctx {
+   char *buf;
+   size_t sz;
+   size_t used;
+};
+
+static void wth_dump(struct wth_dump_ctx *ctx, const char *fmt, ...)
+{
+   va_list args;
+
+   if (ctx->used >= ctx->sz)
+      return;
+
+   va_start(args, fmt);
+   ctx->used += (size_t)vsnprintk(ctx->buf + ctx->used,
+                                  ctx->sz - ctx->used,
+                                  fmt, args);
+   va_end(args);
+}
+
+static inline const char *wth_stats_name(struct worker_thread *t)
+{
+   return t->name ? t->name : "generic";
+}
+
+static offt
+wth_stats_get_buf_sz(struct sysobj *obj, void *data)
+{
+   /* Allow all the workers that might be created in the meanwhile */
+   const offt per_wth = WTH_LINE_MAX + WTH_DEPTH_LINE_MAX + WTH_LAT_LINE_MAX;
+   return WTH_HEADER_MAX + WTH_MAX_THREADS * per_wth;
+}
+
+static offt
+wth_stats_load(struct sysobj *obj, void *data,
+               void *buf, offt buf_sz, offt off)
+{
+   struct wth_dump_ctx ctx = {
+      .buf = buf,
+      .sz = (size_t)buf_sz,
+   };
+
+   ASSERT(off == 0);
+   disable_preemption();
+
+   wth_dump(&ctx,
+            "# delayed_pending: %u\n"
+            "# delayed_fired: %llu\n"
+            "# idx name prio qsize depth max_depth enqueued dropped "
+            "run stolen max_lat_cycles\n",
+            wth_delayed_pending, wth_delayed_fired);
+
+   for (int i = 0; i < worker_threads_cnt; i++) {
+
+      struct worker_thread *t = worker_threads[i];
+      struct wth_stats *s = &t->stats;
+
+      wth_dump(&ctx, "%d %s %d %u %u %u %llu %u %llu %u %llu\n",
+               i, wth_stats_name(t), t->priority,
+               wth_get_queue_size(t), wth_get_queue_depth(t), s->max_depth,
+               s->enqueued, s->dropped, s->run, s->stolen, s->max_lat_cycles);
+   }
+
+   wth_dump(&ctx,
+            "# queue depth at enqueue: idx name "
+            "[0] [1] [2,4) [4,8) ... [%u,inf)\n",
+            1u << (WTH_DEPTH_BUCKETS - 2));
+
+   for (int i = 0; i < worker_threads_cnt; i++) {
+
+      struct worker_thread *t = worker_threads[i];
+      wth_dump(&ctx, "%d %s", i, wth_stats_name(t));
+
+      for (int b = 0; b < WTH_DEPTH_BUCKETS; b++)
+         wth_dump(&ctx, " %u", t->stats.depth_hist[b]);
+
+      wth_dump(&ctx, "\n");
+   }
+
+   wth_dump(&ctx,
+            "# enqueue to run latency: idx name "
+            "[0,2) [2,4) [4,8) ... [2^%d,inf) cycles\n",
+            WTH_LAT_BUCKETS - 1);
+
+   for (int i = 0; i < worker_threads_cnt; i++) {
+
+      struct worker_thread *t = worker_threads[i];
+      wth_dump(&ctx, "%d %s", i, wth_stats_name(t));
+
+      for (int b = 0; b < WTH_LAT_BUCKETS; b++)
+         wth_dump(&ctx, " %u", t->stats.lat_hist[b]);
+
+      wth_dump(&ctx, "\n");
+   }
+
+   enable_preemption();
+   return (offt)MIN(ctx.used, ctx.sz);
+}
+
+static const struct sysobj_prop_type wth_stats_prop_type = {
+   .buf_type = SYSFS_BUF_BUFFERED,
+   .get_buf_sz = &wth_stats_get_buf_sz,
+   .load = &wth_stats_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(stats, &wth_stats_prop_type);
+
+DEF_STATIC_SYSOBJ_TYPE(wth_sysobj_type,
+                       &prop_stats,
+                       NULL);
+
+void register_wth_sysfs(void)
+{
+   struct sysobj *obj = sysfs_create_obj(&wth_sysobj_type, NULL, NULL);
+
+   if (!obj) {
+      printk("WARNING: /syst/wth not registered: out of memory\n");
+      return;
+   }
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "wth", obj) < 0) {
+      printk("WARNING: /syst/wth not registered\n");
+      sysfs_destroy_unregistered_obj(obj);
+   }
+}
+
+#else  /* !MOD_sysfs */
+
+void register_wth_sysfs(void) { /* no-op */ }
+
+#endif /* MOD_sysfs */
@@ -11,6 +11,7 @@
 #include <tilck/kernel/debug_utils.h>
 #include <tilck/kernel/cmdline.h>
 #include <tilck/kernel/uefi.h>
+#include <tilck/kernel/cpus.h>
 
 #include <tilck/mods/pci.h>
 #include <tilck/mods/acpi.h>
@@ -151,6 +152,53 @@ acpi_read_acpi_hw_flags(void)
    AcpiPutTable((struct acpi_table_header *)fadt);
 }
 
+/*
+ * Register all the CPUs listed in the MADT. Note: the ACPI spec requires the
+ * boot CPU to be the first entry.
+ */
+static void
+acpi_read_madt(void)
+{
+   ACPI_STATUS rc;
+   struct acpi_table_madt *madt;
+   ACPI_SUBTABLE_HEADER *sub;
+   ulong p, end;
+
+   rc = AcpiGetTable(ACPI_SIG_MADT, 1, (struct acpi_table_header **)&madt);
+
+   if (rc == AE_NOT_FOUND)
+      return;
+
+   if (ACPI_FAILURE(rc)) {
+      print_acpi_failure("AcpiGetTable", "MADT", rc);
+      return;
+   }
+
+   p = (ulong)madt + sizeof(*madt);
+   end = (ulong)madt + madt->Header.Length;
+
+   for (; p + sizeof(*sub) <= end; p += sub->Length) {
+
+      sub = (void *)p;
+
+      if (!sub->Length)
+         break; /* Corrupted table */
+
+      if (sub->Type == ACPI_MADT_TYPE_LOCAL_APIC) {
+
+         struct acpi_madt_local_apic *e = (void *)sub;
+         register_cpu(e->Id, !!(e->LapicFlags & ACPI_MADT_ENABLED));
+
+      } else if (sub->Type == ACPI_MADT_TYPE_LOCAL_X2APIC) {
+
+         struct acpi_madt_local_x2apic *e = (void *)sub;
+         register_cpu(e->LocalApicId, !!(e->LapicFlags & ACPI_MADT_ENABLED));
+      }
+   }
+
+   AcpiPutTable((struct acpi_table_header *)madt);
+}
+
 void
 acpi_reboot(void)
 {
@@ -280,6 +328,7 @@ acpi_mod_init_tables(void)
 
    acpi_init_status = ais_tables_initialized;
    acpi_read_acpi_hw_flags();
+   acpi_read_madt();
 }
 
 void
@@ -579,6 +628,7 @@ static struct module acpi_module = {
    .name = "acpi",
    .priority = MOD_acpi_prio,
    .init = &acpi_module_init,
+   .deps = MODULE_DEPS("sysfs", "pci"),
 };
 
 REGISTER_MODULE(&acpi_module);
@@ -0,0 +1,356 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * Minimal ATA PIO driver: it supports the two legacy IDE channels (primary
+ * and secondary, master and slave), exposed as /dev/hda .. /dev/hdd, LBA28
+ * and LBA48. It does not use IRQs: after each command, we just poll the
+ * status register. That's slow on real hardware, but it's simple and works
+ * well enough in QEMU, where each I/O instruction is handled synchronously.
+ *
+ * The driver is used only through the block device layer (see blkdev.h),
+ * which serializes the requests: no locking is needed here.
+ */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/modules.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/fs/blkdev.h>
+
+/* Registers, as offsets from the channel's I/O base */
+#define ATA_REG_DATA          0
+#define ATA_REG_ERROR         1
+#define ATA_REG_SECCOUNT      2
+#define ATA_REG_LBA0          3
+#define ATA_REG_LBA1          4
+#define ATA_REG_LBA2          5
+#define ATA_REG_DRIVE         6
+#define ATA_REG_STATUS        7
+#define ATA_REG_CMD           7
+
+/* Status register bits */
+#define ATA_SR_ERR         0x01
+#define ATA_SR_DRQ         0x08
+#define ATA_SR_DF          0x20
+#define ATA_SR_DRDY        0x40
+#define ATA_SR_BSY         0x80
+
+/* Commands */
+#define ATA_CMD_READ            0x20
+#define ATA_CMD_READ_EXT        0x24
+#define ATA_CMD_WRITE           0x30
+#define ATA_CMD_WRITE_EXT       0x34
+#define ATA_CMD_FLUSH           0xE7
+#define ATA_CMD_FLUSH_EXT       0xEA
+#define ATA_CMD_IDENTIFY        0xEC
+
+#define ATA_CTRL_NIEN           0x02     /* disable the IRQs */
+
+#define ATA_LBA28_MAX_SECTORS   (1u << 28)
+#define ATA_MAX_SECTORS_PER_CMD 128      /* keep the PIO bursts short */
+#define ATA_POLL_MAX_ITERS      10000000
+
+struct ata_drive {
+
+   struct block_dev bdev;
+   char name[4];
+   u16 io_base;
+   u16 ctrl_base;
+   bool slave;
+   bool lba48;
+};
+
+static const struct {
+   u16 io_base;
+   u16 ctrl_base;
+} ata_channels[2] = {
+   { 0x1F0, 0x3F6 },
+   { 0x170, 0x376 },
+};
+
+static inline u8 ata_status(struct ata_drive *d)
+{
+   return inb(d->io_base + ATA_REG_STATUS);
+}
+
+/* Reading the alt. status register 4 times gives the drive 400 ns */
+static inline void ata_delay_400ns(struct ata_drive *d)
+{
+   for (int i = 0; i < 4; i++)
+      inb(d->ctrl_base);
+}
+
+static int ata_wait_not_busy(struct ata_drive *d)
+{
+   for (u32 i = 0; i < ATA_POLL_MAX_ITERS; i++) {
+      if (!(ata_status(d) & ATA_SR_BSY))
+         return 0;
+   }
+
+   return -EIO;
+}
+
+static int ata_wait_drq(struct ata_drive *d)
+{
+   u8 status;
+
+   for (u32 i = 0; i < ATA_POLL_MAX_ITERS; i++) {
+
+      status = ata_status(d);
+
+      if (status & ATA_SR_BSY)
+         continue;
+
+      if (status & (ATA_SR_ERR | ATA_SR_DF))
+         return -EIO;
+
+      if (status & ATA_SR_DRQ)
+         return 0;
+   }
+
+   return -EIO;
+}
+
+static void
+ata_setup_cmd(struct ata_drive *d, u64 lba, u32 count, u8 cmd28, u8 cmd48)
+{
+   const u16 io = d->io_base;
+
+   if (d->lba48) {
+
+      outb(io + ATA_REG_DRIVE, 0x40 | (d->slave << 4));
+      ata_delay_400ns(d);
+
+      /* High bytes first, then the low ones */
+      outb(io + ATA_REG_SECCOUNT, (u8)(count >> 8));
+      outb(io + ATA_REG_LBA0, (u8)(lba >> 24));
+      outb(io + ATA_REG_LBA1, (u8)(lba >> 32));
+      outb(io + ATA_REG_LBA2, (u8)(lba >> 40));
+      outb(io + ATA_REG_SECCOUNT, (u8)count);
+      outb(io + ATA_REG_LBA0, (u8)lba);
+      outb(io + ATA_REG_LBA1, (u8)(lba >> 8));
+      outb(io + ATA_REG_LBA2, (u8)(lba >> 16));
+      outb(io + ATA_REG_CMD, cmd48);
+
+   } else {
+
+      outb(io + ATA_REG_DRIVE,
+           0xE0 | (d->slave << 4) | (u8)((lba >> 24) & 0x0F));
+      ata_delay_400ns(d);
+
+      outb(io + ATA_REG_SECCOUNT, (u8)count);
+      outb(io + ATA_REG_LBA0, (u8)lba);
+      outb(io + ATA_REG_LBA1, (u8)(lba >> 8));
+      outb(io + ATA_REG_LBA2, (u8)(lba >> 16));
+      outb(io + ATA_REG_CMD, cmd28);
+   }
+}
+
+static int
+ata_read(struct block_dev *bdev, u64 sector, u32 count, void *buf)
+{
+   struct ata_drive *d = bdev->driver_data;
+   u16 *p = buf;
+   u32 n;
+   int rc;
+
+   while (count > 0) {
+
+      n = MIN(count, (u32)ATA_MAX_SECTORS_PER_CMD);
+
+      if ((rc = ata_wait_not_busy(d)))
+         return rc;
+
+      ata_setup_cmd(d, sector, n, ATA_CMD_READ, ATA_CMD_READ_EXT);
+
+      for (u32 s = 0; s < n; s++) {
+
+         if ((rc = ata_wait_drq(d)))
+            return rc;
+
+         for (u32 i = 0; i < BLKDEV_SECTOR_SIZE / 2; i++)
+            *p++ = inw(d->io_base + ATA_REG_DATA);
+
+         ata_delay_400ns(d);
+      }
+
+      sector += n;
+      count -= n;
+   }
+
+   return 0;
+}
+
+static int
+ata_write(struct block_dev *bdev, u64 sector, u32 count, const void *buf)
+{
+   struct ata_drive *d = bdev->driver_data;
+   const u16 *p = buf;
+   u32 n;
+   int rc;
+
+   while (count > 0) {
+
+      n = MIN(count, (u32)ATA_MAX_SECTORS_PER_CMD);
+
+      if ((rc = ata_wait_not_busy(d)))
+         return rc;
+
+      ata_setup_cmd(d, sector, n, ATA_CMD_WRITE, ATA_CMD_WRITE_EXT);
+
+      for (u32 s = 0; s < n; s++) {
+
+         if ((rc = ata_wait_drq(d)))
+            return rc;
+
+         for (u32 i = 0; i < BLKDEV_SECTOR_SIZE / 2; i++)
+            outw(d->io_base + ATA_REG_DATA, *p++);
+
+         ata_delay_400ns(d);
+      }
+
+      sector += n;
+      count -= n;
+   }
+
+   /* Make sure the data reached the disk, before returning */
+   outb(d->io_base + ATA_REG_CMD,
+        d->lba48 ? ATA_CMD_FLUSH_EXT : ATA_CMD_FLUSH);
+   ata_delay_400ns(d);
+   return ata_wait_not_busy(d);
+}
+
+static const struct block_dev_ops ata_ops = {
+   .read = ata_read,
+   .write = ata_write,
+};
+
+static int ata_identify(struct ata_drive *d, u16 *id)
+{
+   const u16 io = d->io_base;
+   u8 status;
+
+   outb(d->ctrl_base, ATA_CTRL_NIEN);
+   outb(io + ATA_REG_DRIVE, 0xA0 | (d->slave << 4));
+   ata_delay_400ns(d);
+
+   outb(io + ATA_REG_SECCOUNT, 0);
+   outb(io + ATA_REG_LBA0, 0);
+   outb(io + ATA_REG_LBA1, 0);
+   outb(io + ATA_REG_LBA2, 0);
+   outb(io + ATA_REG_CMD, ATA_CMD_IDENTIFY);
+   ata_delay_400ns(d);
+
+   status = ata_status(d);
+
+   if (!status || status == 0xFF)
+      return -ENODEV;      /* no drive (or floating bus) */
+
+   if (ata_wait_not_busy(d))
+      return -ENODEV;
+
+   if (inb(io + ATA_REG_LBA1) || inb(io + ATA_REG_LBA2))
+      return -ENODEV;      /* not an ATA drive (e.g. ATAPI) */
+
+   if (ata_wait_drq(d))
+      return -ENODEV;
+
+   for (u32 i = 0; i < 256; i++)
+      id[i] = inw(io + ATA_REG_DATA);
+
+   return 0;
+}
+
+static void ata_probe_drive(u32 channel, bool slave, u16 *id)
+{
+   struct ata_drive *d;
+   u64 sectors;
+   bool lba48;
+   int rc;
+
+   struct ata_drive tmp = {
+      .io_base = ata_channels[channel].io_base,
+      .ctrl_base = ata_channels[channel].ctrl_base,
+      .slave = slave,
+   };
+
+   if (ata_identify(&tmp, id))
+      return;
+
+   if (!(id[49] & (1 << 9))) {
+      printk("ata: drive %u:%u does not support LBA, skip\n", channel, slave);
+      return;
+   }
+
+   lba48 = !!(id[83] & (1 << 10));
+
+   if (lba48) {
+      sectors = (u64)id[100]       |
+                (u64)id[101] << 16 |
+                (u64)id[102] << 32 |
+                (u64)id[103] << 48;
+   } else {
+      sectors = (u64)id[60] | (u64)id[61] << 16;
+   }
+
+   if (!sectors)
+      return;
+
+   if (!(d = kzalloc_obj(struct ata_drive))) {
+      printk("ata: out of memory\n");
+      return;
+   }
+
+   *d = tmp;
+   d->lba48 = lba48 && sectors > ATA_LBA28_MAX_SECTORS;
+   d->name[0] = 'h';
+   d->name[1] = 'd';
+   d->name[2] = (char)('a' + channel * 2 + slave);
+
+   d->bdev = (struct block_dev) {
+      .name = d->name,
+      .ops = &ata_ops,
+      .sectors = sectors,
+      .read_only = false,
+      .driver_data = d,
+   };
+
+   if ((rc = register_block_dev(&d->bdev))) {
+      printk("ata: failed to register /dev/%s: %d\n", d->name, rc);
+      kfree_obj(d, struct ata_drive);
+   }
+}
+
+static void init_ata(void)
+{
+   u16 *id;
+
+   if (!(id = kmalloc(512))) {
+      printk("ata: out of memory\n");
+      return;
+   }
+
+   for (u32 channel = 0; channel < ARRAY_SIZE(ata_channels); channel++) {
+
+      /* No controller at all: the bus is floating */
+      if (inb(ata_channels[channel].io_base + ATA_REG_STATUS) == 0xFF)
+         continue;
+
+      ata_probe_drive(channel, false, id);
+      ata_probe_drive(channel, true, id);
+   }
+
+   kfree2(id, 512);
+}
+
+static struct module ata_module = {
+   .name = "ata",
+   .priority = MOD_ata_prio,
+   .init = &init_ata,
+   .deps = MODULE_NO_DEPS,
+};
+
+REGISTER_MODULE(&ata_module);
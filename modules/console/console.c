@@ -863,11 +863,27 @@ tty_state_esc2_par1(u8 *c, u8 *color, struct term_action *a, void *ctx_arg)
    return tty_change_translation_table(ctx_arg, c, 1);
 }
 
+/*
+ * In the default state, tty_state_default() just writes table[c] for every
+ * byte `c` having table[c] >= 0, where `table` is the translation table of
+ * the current charset. Let the vterm write runs of such bytes by itself.
+ */
+static void tty_update_plain_trans(struct twfilter_ctx *ctx)
+{
+   struct console_data *const cd = ctx->cd;
+
+   vterm_set_plain_trans_table(
+      ctx->t->tstate,
+      ctx->non_default_state ? NULL : cd->c_sets_tables[cd->c_set]
+   );
+}
+
 static void tty_set_state(struct twfilter_ctx *ctx, term_filter new_state)
 {
    struct tty *const t = ctx->t;
    ctx->non_default_state = new_state != &tty_state_default;
    t->tintf->set_filter(t->tstate, new_state, ctx);
+   tty_update_plain_trans(ctx);
 }
 
 static int tty_pre_filter(struct twfilter_ctx *ctx, u8 *c)
@@ -70,6 +70,7 @@ tty_def_state_shift_out(u8 *c, u8 *color, struct term_action *a, void *ctx_arg)
 
    /* shift out: use alternate charset G1 */
    ctx->cd->c_set = 1;
+   tty_update_plain_trans(ctx);
 
    return TERM_FILTER_WRITE_BLANK;
 }
@@ -81,6 +82,7 @@ tty_def_state_shift_in(u8 *c, u8 *color, struct term_action *a, void *ctx_arg)
 
    /* shift in: return to the default charset G0 */
    ctx->cd->c_set = 0;
+   tty_update_plain_trans(ctx);
 
    return TERM_FILTER_WRITE_BLANK;
 }
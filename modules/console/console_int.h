@@ -43,6 +43,7 @@ struct console_data {
 
 static int tty_pre_filter(struct twfilter_ctx *ctx, u8 *c);
 static void tty_set_state(struct twfilter_ctx *ctx, term_filter new_state);
+static void tty_update_plain_trans(struct twfilter_ctx *ctx);
 static enum term_fret tty_state_default(u8*, u8*, struct term_action*, void*);
 static enum term_fret tty_state_esc1(u8*, u8*, struct term_action*, void*);
 static enum term_fret tty_state_esc2_par0(u8*, u8*, struct term_action*, void*);
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <tilck_gen_headers/mod_console.h>
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/printk.h>
 
@@ -45,6 +46,7 @@ static const struct actions_table_item actions_table[] = {
    [a_insert_blank_chars]   = ENTRY(ins_blank_chars, 1),
    [a_simple_del_chars]     = ENTRY(del_chars_in_line, 1),
    [a_simple_erase_chars]   = ENTRY(erase_chars_in_line, 1),
+   [a_set_sb_max_rows]      = ENTRY(set_sb_max_rows, 1),
 };
 
 #undef ENTRY
@@ -141,6 +143,14 @@ vterm_restart_output(term *t)
    term_execute_or_enqueue_action(t, &a);
 }
 
+static void
+vterm_set_sb_max_rows(term *t, u32 rows)
+{
+   struct term_action a;
+   term_make_action_set_sb_max_rows(&a, MIN(rows, (u32)TERM_SB_MAX_ROWS));
+   term_execute_or_enqueue_action(t, &a);
+}
+
 /* ---------------- term non-action interface funcs --------------------- */
 
 u16 vterm_get_curr_row(struct vterm *t)
@@ -153,12 +163,45 @@ u16 vterm_get_curr_col(struct vterm *t)
    return t->c;
 }
 
+/*
+ * Tells the vterm that, in the current state of its filter, every byte `c`
+ * with table[c] >= 0 is just written as the char table[c], with no side
+ * effects. That allows term_action_write() to skip the filter for runs of such
+ * bytes. NULL disables the fast path. Changing the filter resets the table.
+ */
+void vterm_set_plain_trans_table(struct vterm *t, const s16 *table)
+{
+   t->plain_trans = table;
+}
+
 static void
 vterm_set_filter(term *_t, term_filter func, void *ctx)
 {
    struct vterm *const t = _t;
    t->filter = func;
    t->filter_ctx = ctx;
+   t->plain_trans = NULL;
+}
+
+static void
+vterm_get_sb_info(term *_t, struct term_sb_info *out)
+{
+   struct vterm *const t = _t;
+
+   disable_preemption();
+   {
+      *out = (struct term_sb_info) {
+         .rows = t->sb.count,
+         .max_rows = t->sb.max_rows,
+         .mem = t->sb.chunks_count * TERM_SB_CHUNK_SIZE,
+         .data_size = t->sb.data_size,
+         .raw_size = t->sb.count * t->cols * 2,
+      };
+
+      if (t->sb.row_buf)
+         out->mem += t->cols * 2;
+   }
+   enable_preemption();
 }
 
 static bool
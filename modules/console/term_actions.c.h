@@ -122,6 +122,17 @@ term_action_write(struct vterm *const t, const char *buf, u32 len, u8 color)
          continue;
       }
 
+      if (t->plain_trans) {
+
+         /* Fast path: a run of chars the filter would just translate */
+         const u32 n = term_internal_write_plain_run(t, buf+i, len-i, color);
+
+         if (n) {
+            i += n - 1;       /* the loop increments `i` as well */
+            continue;
+         }
+      }
+
       /*
        * NOTE: We MUST store buf[i] in a local variable because the filter
        * function is absolutely allowed to modify its contents!!
@@ -182,6 +193,8 @@ static void term_action_reset(struct vterm *const t)
    t->vi->enable_cursor();
    term_int_move_cur(t, 0, 0);
    t->scroll = t->max_scroll = 0;
+   t->buf_top = 0;
+   term_sb_clear(t);
 
    for (u16 i = 0; i < t->rows; i++)
       ts_clear_row(t, i, DEFAULT_COLOR16);
@@ -405,7 +418,8 @@ DEFINE_TERM_ACTION_0(restart_output)
 static void
 term_action_use_alt_buffer(struct vterm *const t, bool use_alt_buffer)
 {
-   u16 *b = get_buf_row(t, 0);
+   const size_t row_sz = sizeof(u16) * t->cols;
+   u16 *const copy = t->screen_buf_copy;
 
    if (t->using_alt_buffer == use_alt_buffer)
       return;
@@ -423,13 +437,15 @@ term_action_use_alt_buffer(struct vterm *const t, bool use_alt_buffer)
       t->tabs_buf = t->alt_tabs_buf;
       t->saved_cur_row = t->r;
       t->saved_cur_col = t->c;
-      memcpy(t->screen_buf_copy, b, sizeof(u16) * t->rows * t->cols);
+      for (u16 row = 0; row < t->rows; row++)
+         memcpy(&copy[row * t->cols], get_buf_row(t, row), row_sz);
 
    } else {
 
       ASSERT(t->screen_buf_copy != NULL);
 
-      memcpy(b, t->screen_buf_copy, sizeof(u16) * t->rows * t->cols);
+      for (u16 row = 0; row < t->rows; row++)
+         memcpy(get_buf_row(t, row), &copy[row * t->cols], row_sz);
       t->r = t->saved_cur_row;
       t->c = t->saved_cur_col;
       t->tabs_buf = t->main_tabs_buf;
@@ -509,3 +525,14 @@ term_action_set_scroll_region(struct vterm *const t, u16 start, u16 end)
 }
 
 DEFINE_TERM_ACTION_2(set_scroll_region, u16, u16)
+
+static void
+term_action_set_sb_max_rows(struct vterm *const t, u32 rows)
+{
+   term_sb_set_max_rows(t, rows);
+
+   if (t->max_scroll - t->scroll > t->sb.count)
+      ts_set_scroll(t, t->max_scroll - t->sb.count);
+}
+
+DEFINE_TERM_ACTION_1(set_sb_max_rows, u32)
@@ -0,0 +1,355 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+
+#include <tilck_gen_headers/mod_console.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/utils.h>
+
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/list.h>
+#include <tilck/kernel/interrupts.h>
+#include <tilck/kernel/sched.h>
+
+#include "video_term_int.h"
+#include "vterm_struct.h"
+
+/*
+ * Video term scrollback
+ * -----------------------
+ *
+ * The rows scrolled off the screen are not kept as raw VGA entries: each row
+ * is encoded as a `struct term_sb_row`, where the trailing run of equal cells
+ * (typically blanks) is stored just once in `fill` and, when all the other
+ * cells have the same color, they're stored as plain chars. Therefore, a blank
+ * row takes 6 bytes and a short log line about one byte per char, instead of
+ * 2 * cols bytes.
+ *
+ * The rows are appended to a list of TERM_SB_CHUNK_SIZE chunks, allocated on
+ * demand. Each chunk keeps its rows' data growing from the beginning and their
+ * offsets growing from the end, which allows to access any row of the chunk
+ * in O(1). When the scrollback has more than `max_rows` rows, the oldest ones
+ * are dropped and the chunks containing only dropped rows are freed. Where we
+ * cannot allocate memory (IRQ context, panic) the oldest chunk is recycled.
+ *
+ * Rows are identified by their absolute index: the value of `max_scroll` at
+ * the moment the row went off the screen. The scrollback contains the rows
+ * [sb->end - sb->count, sb->end) and sb->end == t->max_scroll, always.
+ * The rows are decoded on demand, one at a time, when we're scrolling.
+ */
+
+struct term_sb_row {
+
+   u16 len;                   /* cells stored explicitly */
+   u16 fill;                  /* entry of the cells in [len, cols) */
+   u8 mono;                   /* 1: cells stored as chars, all with `color` */
+   u8 color;
+   u8 data[];
+};
+
+struct term_sb_chunk {
+
+   struct list_node node;
+   u32 first;                 /* absolute index of the chunk's first row */
+   u16 count;                 /* rows in the chunk */
+   u16 used;                  /* bytes used in data[], from the beginning */
+   u8 data[];                 /* rows, then (from the end) their u16 offsets */
+};
+
+#define SB_CHUNK_DATA_SIZE   (TERM_SB_CHUNK_SIZE - sizeof(struct term_sb_chunk))
+
+static ALWAYS_INLINE u16 *
+term_sb_chunk_offsets(struct term_sb_chunk *c)
+{
+   /* The offsets array grows backwards: the offset of row `i` is at [-1-i] */
+   return (u16 *)(c->data + SB_CHUNK_DATA_SIZE);
+}
+
+static ALWAYS_INLINE u32
+term_sb_chunk_free_space(struct term_sb_chunk *c)
+{
+   return SB_CHUNK_DATA_SIZE - c->used - c->count * sizeof(u16);
+}
+
+static ALWAYS_INLINE struct term_sb_row *
+term_sb_chunk_get_row(struct term_sb_chunk *c, u32 i)
+{
+   return (void *)(c->data + term_sb_chunk_offsets(c)[-1 - (int)i]);
+}
+
+/* Max size of an encoded row, including its offset in the chunk */
+static ALWAYS_INLINE u32 term_sb_max_row_size(struct vterm *t)
+{
+   return sizeof(struct term_sb_row) + 2 * t->cols + sizeof(u16);
+}
+
+static void
+term_sb_init(struct vterm *t, u32 max_rows)
+{
+   struct term_sb *sb = &t->sb;
+
+   *sb = (struct term_sb) { 0 };
+   list_init(&sb->chunks);
+
+   if (!max_rows || in_panic() || !is_kmalloc_initialized())
+      return;
+
+   if (term_sb_max_row_size(t) > SB_CHUNK_DATA_SIZE)
+      return; /* too many columns */
+
+   if (!(sb->row_buf = kalloc_array_obj(u16, t->cols)))
+      return;
+
+   sb->max_rows = MIN(max_rows, (u32)TERM_SB_MAX_ROWS);
+}
+
+static void
+term_sb_free_chunk(struct vterm *t, struct term_sb_chunk *c)
+{
+   list_remove(&c->node);
+   kfree2(c, TERM_SB_CHUNK_SIZE);
+   t->sb.chunks_count--;
+}
+
+/* Drops the oldest chunk's rows and returns the chunk, detached */
+static struct term_sb_chunk *
+term_sb_drop_oldest_chunk(struct vterm *t)
+{
+   struct term_sb *const sb = &t->sb;
+   struct term_sb_chunk *c;
+   u32 first_valid, valid;
+
+   c = list_first_obj(&sb->chunks, struct term_sb_chunk, node);
+   first_valid = MAX(sb->end - sb->count, c->first);
+   valid = c->first + c->count - first_valid;
+
+   sb->count -= valid;
+   sb->data_size -= c->used;
+   list_remove(&c->node);
+   return c;
+}
+
+/* Drops the oldest rows until we have at most `max_rows` rows */
+static void
+term_sb_trim(struct vterm *t)
+{
+   struct term_sb *const sb = &t->sb;
+   struct term_sb_chunk *c;
+
+   if (sb->count <= sb->max_rows)
+      return;
+
+   sb->count = sb->max_rows;
+
+   while (!list_is_empty(&sb->chunks)) {
+
+      c = list_first_obj(&sb->chunks, struct term_sb_chunk, node);
+
+      if (c->first + c->count > sb->end - sb->count)
+         break; /* the chunk still contains valid rows */
+
+      sb->data_size -= c->used;
+      term_sb_free_chunk(t, c);
+   }
+}
+
+static void
+term_sb_clear(struct vterm *t)
+{
+   struct term_sb *const sb = &t->sb;
+   struct term_sb_chunk *c, *tmp;
+
+   list_for_each(c, tmp, &sb->chunks, node)
+      term_sb_free_chunk(t, c);
+
+   sb->end = sb->count = sb->data_size = 0;
+}
+
+static void
+term_sb_destroy(struct vterm *t)
+{
+   term_sb_clear(t);
+
+   if (t->sb.row_buf) {
+      kfree_array_obj(t->sb.row_buf, u16, t->cols);
+      t->sb.row_buf = NULL;
+   }
+
+   t->sb.max_rows = 0;
+}
+
+static struct term_sb_chunk *
+term_sb_get_chunk_for_row(struct vterm *t, u32 size)
+{
+   struct term_sb *const sb = &t->sb;
+   struct term_sb_chunk *c = NULL;
+
+   if (!list_is_empty(&sb->chunks)) {
+
+      c = list_last_obj(&sb->chunks, struct term_sb_chunk, node);
+
+      if (term_sb_chunk_free_space(c) >= size)
+         return c;
+
+      c = NULL;
+   }
+
+   if (!in_irq() && !in_panic()) {
+      if ((c = kmalloc(TERM_SB_CHUNK_SIZE)))
+         sb->chunks_count++;
+   }
+
+   if (!c) {
+
+      if (list_is_empty(&sb->chunks))
+         return NULL;
+
+      /* No memory: recycle the oldest chunk */
+      c = term_sb_drop_oldest_chunk(t);
+   }
+
+   list_node_init(&c->node);
+   c->first = sb->end;
+   c->count = 0;
+   c->used = 0;
+   list_add_tail(&sb->chunks, &c->node);
+   return c;
+}
+
+/* Appends `row`, the screen's top row which is going to be scrolled off */
+static void
+term_sb_push_row(struct vterm *t, const u16 *row)
+{
+   struct term_sb *const sb = &t->sb;
+   const u16 cols = t->cols;
+   const u16 fill = row[cols - 1];
+   const u8 color = vgaentry_get_color(row[0]);
+   struct term_sb_chunk *c;
+   struct term_sb_row *r;
+   bool mono = true;
+   u16 len = cols;
+   u32 size;
+
+   if (!sb->max_rows) {
+      sb->end++;
+      return;
+   }
+
+   while (len > 0 && row[len - 1] == fill)
+      len--;
+
+   for (u16 i = 0; i < len; i++) {
+      if (vgaentry_get_color(row[i]) != color) {
+         mono = false;
+         break;
+      }
+   }
+
+   size = sizeof(struct term_sb_row) + (mono ? len : 2u * len);
+   size = pow2_round_up_at(size, sizeof(u16));
+
+   if (!(c = term_sb_get_chunk_for_row(t, size + sizeof(u16)))) {
+
+      /* No chunks at all: the row is lost */
+      sb->end++;
+      sb->count = 0;
+      return;
+   }
+
+   r = (void *)(c->data + c->used);
+   r->len = len;
+   r->fill = fill;
+   r->mono = mono;
+   r->color = color;
+
+   if (mono) {
+
+      for (u16 i = 0; i < len; i++)
+         r->data[i] = vgaentry_get_char(row[i]);
+
+   } else {
+
+      memcpy(r->data, row, 2u * len);
+   }
+
+   term_sb_chunk_offsets(c)[-1 - (int)c->count] = c->used;
+   c->used += size;
+   c->count++;
+
+   sb->data_size += size;
+   sb->end++;
+   sb->count++;
+   term_sb_trim(t);
+}
+
+/*
+ * Decodes the row with the absolute index `idx` in sb->row_buf and returns it.
+ * Rows not in the scrollback (anymore) are returned as blank.
+ */
+static u16 *
+term_sb_get_row(struct vterm *t, u32 idx)
+{
+   struct term_sb *const sb = &t->sb;
+   u16 *const out = sb->row_buf;
+   struct term_sb_chunk *c;
+   struct term_sb_row *r = NULL;
+
+   if (!out)
+      return NULL;
+
+   if (idx < sb->end && idx >= sb->end - sb->count) {
+
+      /* Usually, we're looking at the most recent rows: start from there */
+      c = list_last_obj(&sb->chunks, struct term_sb_chunk, node);
+
+      while (idx < c->first)
+         c = list_prev_obj(c, node);
+
+      r = term_sb_chunk_get_row(c, idx - c->first);
+   }
+
+   if (!r) {
+      memset16(out, make_vgaentry(' ', DEFAULT_COLOR16), t->cols);
+      return out;
+   }
+
+   if (r->mono) {
+
+      for (u16 i = 0; i < r->len; i++)
+         out[i] = make_vgaentry(r->data[i], r->color);
+
+   } else {
+
+      memcpy(out, r->data, 2u * r->len);
+   }
+
+   memset16(out + r->len, r->fill, t->cols - r->len);
+   return out;
+}
+
+static void
+term_sb_set_max_rows(struct vterm *t, u32 max_rows)
+{
+   struct term_sb *const sb = &t->sb;
+   max_rows = MIN(max_rows, (u32)TERM_SB_MAX_ROWS);
+
+   if (!max_rows) {
+      term_sb_destroy(t);
+      sb->end = t->max_scroll;
+      return;
+   }
+
+   if (!sb->row_buf) {
+
+      if (term_sb_max_row_size(t) > SB_CHUNK_DATA_SIZE)
+         return; /* too many columns */
+
+      if (!(sb->row_buf = kalloc_array_obj(u16, t->cols)))
+         return;
+   }
+
+   sb->max_rows = max_rows;
+   term_sb_trim(t);
+}
@@ -20,6 +20,7 @@
 #include "term_action_wrappers.c.h"
 #include "video_term_int.h"
 #include "vterm_struct.h"
+#include "term_scrollback.c.h"
 
 static struct vterm first_instance;
 static u16 failsafe_buffer[FAILSAFE_COLS * FAILSAFE_ROWS];
@@ -71,9 +72,21 @@ static void term_int_enable_cursor(struct vterm *t, bool val)
    }
 }
 
+/* Returns the data of the row `row` on the screen, considering the scroll */
+static u16 *ts_get_view_row(struct vterm *t, u16 row)
+{
+   const u32 abs_row = t->scroll + row;
+
+   if (abs_row >= t->max_scroll)
+      return get_buf_row(t, abs_row - t->max_scroll);
+
+   return term_sb_get_row(t, abs_row);
+}
+
 static void term_redraw2(struct vterm *t, u16 s, u16 e)
 {
    const bool fpu_allowed = !in_irq() && !in_panic();
+   u16 *data;
 
    if (!t->buffer)
       return;
@@ -81,8 +94,10 @@ static void term_redraw2(struct vterm *t, u16 s, u16 e)
    if (fpu_allowed)
       fpu_context_begin();
 
-   for (u16 row = s; row < e; row++)
-      t->vi->set_row(row, get_buf_row(t, row), fpu_allowed);
+   for (u16 row = s; row < e; row++) {
+      if ((data = ts_get_view_row(t, row)))
+         t->vi->set_row(row, data, fpu_allowed);
+   }
 
    if (fpu_allowed)
       fpu_context_end();
@@ -102,17 +117,14 @@ static void ts_set_scroll(struct vterm *t, u32 requested_scroll)
 {
    /*
     * 1. scroll cannot be > max_scroll
-    * 2. scroll cannot be < max_scroll - extra_buffer_rows, where
-    *    extra_buffer_rows = total_buffer_rows - VIDEO_ROWS.
-    *    In other words, if for example total_buffer_rows is 26, and max_scroll
-    *    is 1000, scroll cannot be less than 1000 + 25 - 26 = 999, which means
-    *    exactly 1 scroll row (extra_buffer_rows == 1).
+    * 2. scroll cannot be < max_scroll - sb.count, where sb.count is the number
+    *    of rows in the scrollback. For example, if max_scroll is 1000 and the
+    *    scrollback contains just 1 row, scroll cannot be less than 999.
+    *
+    * The scrollback rows are decoded one by one by term_redraw2().
     */
 
-   const u32 min_scroll =
-      t->max_scroll > t->extra_buffer_rows
-         ? t->max_scroll - t->extra_buffer_rows
-         : 0;
+   const u32 min_scroll = t->max_scroll - t->sb.count;
 
    requested_scroll = CLAMP(requested_scroll, min_scroll, t->max_scroll);
 
@@ -259,6 +271,12 @@ static void term_internal_incr_row(struct vterm *t)
       return;
    }
 
+   /*
+    * The screen's top row goes in the scrollback, while its slot in the ring
+    * becomes the new bottom row, cleared below.
+    */
+   term_sb_push_row(t, get_buf_row(t, 0));
+   t->buf_top = (u16)((t->buf_top + 1) % t->rows);
    t->max_scroll++;
 
    if (t->vi->scroll_one_line_up) {
@@ -381,6 +399,71 @@ static void term_internal_write_char2(struct vterm *t, char c, u8 color)
    }
 }
 
+static ALWAYS_INLINE bool is_plain_cell(s16 tv)
+{
+   return tv >= 0 && tv != '\n' && tv != '\r' && tv != '\t';
+}
+
+static void
+term_internal_flush_row_span(struct vterm *t, u16 row, u16 s, u16 e)
+{
+   const u16 *const buf_row = get_buf_row(t, row);
+
+   if (e - s >= t->cols / 2) {
+      term_redraw2(t, row, row + 1);
+      return;
+   }
+
+   for (u16 col = s; col < e; col++)
+      t->vi->set_char_at(row, col, buf_row[col]);
+}
+
+/*
+ * Fast path of term_action_write(): writes the longest run of bytes at the
+ * beginning of `buf` which the filter would just translate through the
+ * `plain_trans` table. The cells are written directly in the buffer and
+ * flushed to the video interface once per row: with set_row() when the span
+ * covers at least half of the row, with set_char_at() otherwise. Returns the
+ * number of bytes consumed (0 when buf[0] is not a plain char).
+ */
+static u32
+term_internal_write_plain_run(struct vterm *t,
+                              const char *buf,
+                              u32 len,
+                              u8 color)
+{
+   const s16 *const table = t->plain_trans;
+   u32 i = 0;
+
+   while (i < len && is_plain_cell(table[(u8)buf[i]])) {
+
+      u16 *buf_row;
+      u16 col;
+
+      if (t->c == t->cols) {
+         t->c = 0;
+         term_internal_incr_row(t);
+      }
+
+      buf_row = get_buf_row(t, t->r);
+
+      for (col = t->c; i < len && col < t->cols; i++, col++) {
+
+         const s16 tv = table[(u8)buf[i]];
+
+         if (!is_plain_cell(tv))
+            break;
+
+         buf_row[col] = make_vgaentry((u8)tv, color);
+      }
+
+      term_internal_flush_row_span(t, t->r, t->c, col);
+      t->c = col;
+   }
+
+   return i;
+}
+
 static int
 term_allocate_alt_buffers(struct vterm *t)
 {
@@ -477,10 +560,12 @@ dispose_term(term *_t)
    dispose_term_rb_data(&t->rb_data);
 
    if (t->buffer) {
-      kfree_array_obj(t->buffer, u16, t->total_buffer_rows * t->cols);
+      kfree_array_obj(t->buffer, u16, t->rows * t->cols);
       t->buffer = NULL;
    }
 
+   term_sb_destroy(t);
+
    if (t->main_tabs_buf) {
       kfree2(t->main_tabs_buf, t->cols * t->rows);
       t->main_tabs_buf = NULL;
@@ -511,11 +596,12 @@ vterm_get_params(term *_t, struct term_params *out)
 }
 
 /*
- * Calculate an optimal number of extra buffer rows to use for a term of size
- * `rows` x `cols`, in order to minimize the memory waste (happening when the
- * buffer size is not a power of 2).
+ * Calculate the default scrollback depth for a term of size `rows` x `cols`:
+ * the rows that would fit in a raw buffer of 32 KB (80 cols) to 256 KB. Since
+ * the scrollback is compressed and allocated on demand, that's also a rough
+ * upper bound of its memory usage.
  */
-static u32 term_calc_extra_buf_rows(u16 rows, u16 cols)
+static u32 term_calc_sb_rows(u16 rows, u16 cols)
 {
    u32 buf_size = 0;
 
@@ -575,17 +661,13 @@ init_vterm(term *_t,
                      sizeof(struct term_action),
                      t->actions_buf);
 
-   if (!in_panic() && intf) {
+   t->scroll = t->max_scroll = 0;
+   t->buf_top = 0;
 
-      t->extra_buffer_rows =
-         rows_buf >= 0
-            ? (u32)rows_buf
-            : term_calc_extra_buf_rows(rows, cols);
-
-      t->total_buffer_rows = t->rows + t->extra_buffer_rows;
+   if (!in_panic() && intf) {
 
       if (is_kmalloc_initialized())
-         t->buffer = kmalloc(2 * t->total_buffer_rows * t->cols);
+         t->buffer = kalloc_array_obj(u16, t->rows * t->cols);
    }
 
    if (t->buffer) {
@@ -599,7 +681,8 @@ init_vterm(term *_t,
       } else {
 
          if (t != &first_instance) {
-            kfree2(t->buffer, 2 * t->total_buffer_rows * t->cols);
+            kfree_array_obj(t->buffer, u16, t->rows * t->cols);
+            t->buffer = NULL;
             return -ENOMEM;
          }
 
@@ -616,14 +699,21 @@ init_vterm(term *_t,
       t->cols = (u16) MIN((u16)FAILSAFE_COLS, t->cols);
       t->rows = (u16) MIN((u16)FAILSAFE_ROWS, t->rows);
 
-      t->extra_buffer_rows = 0;
-      t->total_buffer_rows = t->rows;
       t->buffer = failsafe_buffer;
 
       if (!in_panic() && intf)
          printk("ERROR: unable to allocate the term buffer.\n");
    }
 
+   if (t->buffer != failsafe_buffer) {
+      term_sb_init(t,
+                   rows_buf >= 0
+                     ? (u32)rows_buf
+                     : term_calc_sb_rows(t->rows, t->cols));
+   } else {
+      term_sb_init(t, 0);
+   }
+
    for (u16 i = 0; i < t->rows; i++)
       ts_clear_row(t, i, DEFAULT_COLOR16);
 
@@ -631,8 +721,8 @@ init_vterm(term *_t,
    t->vi->enable_cursor();
    term_int_move_cur(t, 0, 0);
    t->initialized = true;
-   printk("video_term: buffer rows: %u (%u screens)\n",
-          t->total_buffer_rows, t->total_buffer_rows / t->rows);
+   printk("video_term: scrollback rows: %u (%u screens)\n",
+          t->sb.max_rows, t->sb.max_rows / t->rows);
    return 0;
 }
 
@@ -659,6 +749,8 @@ static const struct term_interface intf = {
    .pause_output = vterm_pause_output,
    .restart_output = vterm_restart_output,
    .set_filter = vterm_set_filter,
+   .get_sb_info = vterm_get_sb_info,
+   .set_sb_max_rows = vterm_set_sb_max_rows,
 
    .get_first_term = vterm_get_first_inst,
    .video_term_init = init_vterm,
@@ -33,6 +33,7 @@ enum term_action_type {
    a_insert_blank_chars,
    a_simple_del_chars,
    a_simple_erase_chars,
+   a_set_sb_max_rows,
 };
 
 /*
@@ -99,6 +100,7 @@ STATIC_ASSERT(sizeof(struct term_action) == (2 * sizeof(ulong)));
 
 u16 vterm_get_curr_row(struct vterm *t);
 u16 vterm_get_curr_col(struct vterm *t);
+void vterm_set_plain_trans_table(struct vterm *t, const s16 *table);
 
 static ALWAYS_INLINE void
 term_make_action_write(struct term_action *a,
@@ -320,6 +322,15 @@ term_make_action_simple_erase_chars(struct term_action *a, u16 num)
    };
 }
 
+static ALWAYS_INLINE void
+term_make_action_set_sb_max_rows(struct term_action *a, u32 rows)
+{
+   *a = (struct term_action) {
+      .type1 = a_set_sb_max_rows,
+      .arg = rows,
+   };
+}
+
 static void
 term_execute_or_enqueue_action(struct vterm *t, struct term_action *a);
 static void term_execute_action(struct vterm *t, struct term_action *a);
@@ -333,6 +344,11 @@ static void ts_buf_clear_row(struct vterm *t, u16 row, u8 color);
 static void ts_clear_row(struct vterm *t, u16 row, u8 color);
 static void term_int_scroll_up(struct vterm *t, u32 lines);
 static void term_internal_write_char2(struct vterm *t, char c, u8 color);
+static u32
+term_internal_write_plain_run(struct vterm *t,
+                              const char *buf,
+                              u32 len,
+                              u8 color);
 static void term_internal_write_backspace(struct vterm *t, u8 color);
 static inline void term_redraw(struct vterm *t);
 static void term_redraw2(struct vterm *t, u16 s, u16 e);
@@ -345,6 +361,9 @@ static ALWAYS_INLINE void ts_scroll_down(struct vterm *t, u32 lines);
 static ALWAYS_INLINE void ts_scroll_to_bottom(struct vterm *t);
 static ALWAYS_INLINE u8 get_curr_cell_color(struct vterm *t);
 static ALWAYS_INLINE u8 get_curr_cell_fg_color(struct vterm *t);
+static void ts_set_scroll(struct vterm *t, u32 requested_scroll);
+static void term_sb_clear(struct vterm *t);
+static void term_sb_set_max_rows(struct vterm *t, u32 max_rows);
 
 /* ------------ No-output video-interface ------------------ */
 
@@ -409,7 +428,7 @@ static const struct video_interface no_output_vi =
  *  301288    29388  250610   581286   8dea6   tilck
  */
 
-#define calc_buf_row(t, r) (((r) + (t)->scroll) % (t)->total_buffer_rows)
+#define calc_buf_row(t, r) (((r) + (t)->buf_top) % (t)->rows)
 #define get_buf_row(t, r) (&(t)->buffer[calc_buf_row((t), (r)) * (t)->cols])
 #define buf_set_entry(t, r, c, e) (get_buf_row((t), (r))[(c)] = (e))
 #define buf_get_entry(t, r, c) (get_buf_row((t), (r))[(c)])
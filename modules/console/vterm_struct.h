@@ -5,8 +5,24 @@
 #include <tilck/common/basic_defs.h>
 #include <tilck/kernel/term.h>
 #include <tilck/kernel/term_aux.h>
+#include <tilck/kernel/list.h>
 #include "video_term_int.h"
 
+/*
+ * Scrollback: the rows scrolled off the screen, compressed in a list of
+ * TERM_SB_CHUNK_SIZE chunks. See term_scrollback.c.h.
+ */
+struct term_sb {
+
+   struct list chunks;        /* struct term_sb_chunk, oldest first */
+   u16 *row_buf;              /* a decoded row, used when scrolling */
+   u32 end;                   /* abs. index of the row after the newest one */
+   u32 count;                 /* rows in the scrollback */
+   u32 max_rows;              /* max rows kept (depth), 0 = no scrollback */
+   u32 chunks_count;
+   u32 data_size;             /* sum of the sizes of the encoded rows */
+};
+
 struct vterm {
 
    bool initialized;
@@ -26,13 +42,15 @@ struct vterm {
    const struct video_interface *vi;
    const struct video_interface *saved_vi;
 
-   u16 *buffer;               /* the whole screen buffer */
+   u16 *buffer;               /* the screen rows, as a ring of `rows` rows */
    u16 *screen_buf_copy;      /* when != NULL, contains one screenshot */
    u32 scroll;                /* != max_scroll only while scrolling */
-   u32 max_scroll;            /* buffer rows used - rows. Its value is 0 until
-                                 the screen scrolls for the first time */
-   u32 total_buffer_rows;     /* >= term rows */
-   u32 extra_buffer_rows;     /* => total_buffer_rows - rows. Always >= 0 */
+   u32 max_scroll;            /* rows scrolled off the screen so far. Its
+                                 value is 0 until the screen scrolls for the
+                                 first time */
+   u16 buf_top;               /* index in `buffer` of the screen's row 0 */
+
+   struct term_sb sb;         /* the rows above the screen (scrollback) */
 
    u16 saved_cur_row;         /* keeps primary buffer's cursor's row */
    u16 saved_cur_col;         /* keeps primary buffer's cursor's col */
@@ -54,5 +72,6 @@ struct vterm {
 
    term_filter filter;
    void *filter_ctx;
+   const s16 *plain_trans;    /* see vterm_set_plain_trans_table() */
 };
 
@@ -28,6 +28,9 @@
 #include <tilck/kernel/tty.h>
 #include <tilck/kernel/worker_thread.h>
 #include <tilck/kernel/system_mmap.h>
+#include <tilck/kernel/page_alloc.h>
+#include <tilck/kernel/syscall_stats.h>
+#include <tilck/kernel/lockstat.h>
 #include <tilck/kernel/irq.h>
 #include <tilck/kernel/timer.h>
 #include <tilck/kernel/cmdline.h>         /* kopt_ttys */
@@ -72,9 +75,12 @@ STATIC_ASSERT(sizeof(struct dp_printk_event_data) ==
  */
 int dp_mini_debugger_tool(void);
 
+/* Defined in dp_stats.c */
+void dp_stats_init(void);
+
 /* ---------------------------- TASKS --------------------------------- */
 
-static void dp_fill_task_info(struct task *ti, struct dp_task_info *out)
+void dp_fill_task_info(struct task *ti, struct dp_task_info *out)
 {
    struct process *pi = ti->pi;
 
@@ -310,37 +316,43 @@ tilck_sys_dp_get_kmalloc_chunks(ulong u_buf, ulong max_count,
 
 /* ---------------------------- IRQ STATS ------------------------------ */
 
-static int
-tilck_sys_dp_get_irq_stats(ulong u_out, ulong _2, ulong _3, ulong _4)
+void dp_fill_irq_stats(struct dp_irq_stats *out)
 {
    extern u32 spur_irq_count;
    extern u32 unhandled_irq_count[256];
 
-   struct dp_irq_stats out = {0};
    u32 mask = 0;
 
-   if (user_out_of_range((void *)u_out, sizeof(out)))
-      return -EFAULT;
-
    if (KRN_TRACK_NESTED_INTERR) {
       extern u32 slow_timer_irq_handler_count;
-      out.slow_timer_count = slow_timer_irq_handler_count;
+      out->slow_timer_count = slow_timer_irq_handler_count;
    }
 
-   out.spur_irq_count    = spur_irq_count;
-   out.ticks_at_snapshot = get_ticks();
+   out->spur_irq_count    = spur_irq_count;
+   out->ticks_at_snapshot = get_ticks();
 
-   STATIC_ASSERT(ARRAY_SIZE(out.unhandled_count) ==
+   STATIC_ASSERT(ARRAY_SIZE(out->unhandled_count) ==
                  ARRAY_SIZE(unhandled_irq_count));
 
    for (u32 i = 0; i < ARRAY_SIZE(unhandled_irq_count); i++)
-      out.unhandled_count[i] = unhandled_irq_count[i];
+      out->unhandled_count[i] = unhandled_irq_count[i];
 
    for (int i = 0; i < 16; i++)
       if (!irq_is_masked(i))
          mask |= (1u << i);
 
-   out.unmasked_mask_lo16 = mask;
+   out->unmasked_mask_lo16 = mask;
+}
+
+static int
+tilck_sys_dp_get_irq_stats(ulong u_out, ulong _2, ulong _3, ulong _4)
+{
+   struct dp_irq_stats out = {0};
+
+   if (user_out_of_range((void *)u_out, sizeof(out)))
+      return -EFAULT;
+
+   dp_fill_irq_stats(&out);
 
    if (copy_to_user((void *)u_out, &out, sizeof(out)))
       return -EFAULT;
@@ -447,6 +459,203 @@ tilck_sys_dp_get_mem_global_stats(ulong u_out, ulong _2, ulong _3, ulong _4)
    return 0;
 }
 
+static int
+tilck_sys_dp_get_page_alloc_stats(ulong u_out, ulong _2, ulong _3, ulong _4)
+{
+   struct dp_page_alloc_stats out = {0};
+   struct page_alloc_stats st;
+
+   STATIC_ASSERT(PAGE_ALLOC_MAX_ORDER < DP_PAGE_ALLOC_MAX_ORDERS);
+
+   if (user_out_of_range((void *)u_out, sizeof(out)))
+      return -EFAULT;
+
+   page_alloc_get_stats(&st);
+
+   out.tot_pages = st.tot_pages;
+   out.free_pages = st.free_pages;
+   out.zero_cache_pages = st.zero_cache_pages;
+   out.fallback_allocs = st.fallback_allocs;
+   out.max_order = PAGE_ALLOC_MAX_ORDER;
+   out.largest_free_order = st.largest_free_order;
+
+   for (int i = 0; i <= PAGE_ALLOC_MAX_ORDER; i++)
+      out.free_blocks[i] = st.free_blocks[i];
+
+   if (copy_to_user((void *)u_out, &out, sizeof(out)))
+      return -EFAULT;
+
+   return 0;
+}
+
+/* ---------------------------- SYSCALLS ------------------------------ */
+
+static int
+tilck_sys_dp_get_syscall_stats(ulong u_buf, ulong max_count,
+                               ulong pid, ulong _4)
+{
+#if KRN_SYSCALL_STATS
+
+   STATIC_ASSERT(SYSCALL_STATS_BUCKETS == DP_SYSCALL_STATS_BUCKETS);
+
+   struct dp_syscall_stats *kbuf;
+   struct process *pi = NULL;
+   ulong count = 0;
+   int rc = 0;
+
+   if (max_count == 0)
+      return 0;
+
+   if (max_count > MAX_SYSCALLS)
+      max_count = MAX_SYSCALLS;
+
+   if (user_out_of_range((void *)u_buf,
+                         max_count * sizeof(struct dp_syscall_stats)))
+      return -EFAULT;
+
+   kbuf = kalloc_array_obj(struct dp_syscall_stats, max_count);
+
+   if (!kbuf)
+      return -ENOMEM;
+
+   disable_preemption();
+
+   if (pid) {
+
+      pi = get_process((int)pid);
+
+      if (!pi || !pi->sys_stats)
+         rc = -ESRCH;
+   }
+
+   for (u32 sn = 0; !rc && sn < MAX_SYSCALLS && count < max_count; sn++) {
+
+      struct dp_syscall_stats *e = &kbuf[count];
+
+      if (pi) {
+
+         if (!pi->sys_stats->count[sn])
+            continue;
+
+         *e = (struct dp_syscall_stats) {
+            .sys_n      = sn,
+            .count      = pi->sys_stats->count[sn],
+            .tot_cycles = pi->sys_stats->tot_cycles[sn],
+         };
+
+      } else {
+
+         const struct syscall_stats *s = &global_syscall_stats[sn];
+
+         if (!s->count)
+            continue;
+
+         *e = (struct dp_syscall_stats) {
+            .sys_n      = sn,
+            .count      = s->count,
+            .tot_cycles = s->tot_cycles,
+            .max_cycles = s->max_cycles,
+         };
+
+         memcpy(e->hist, s->hist, sizeof(e->hist));
+      }
+
+      count++;
+   }
+
+   enable_preemption();
+
+   if (!rc) {
+
+      if (copy_to_user((void *)u_buf,
+                       kbuf,
+                       count * sizeof(struct dp_syscall_stats)))
+      {
+         rc = -EFAULT;
+      }
+   }
+
+   kfree_array_obj(kbuf, struct dp_syscall_stats, max_count);
+   return rc ? rc : (int)count;
+
+#else
+   return -EOPNOTSUPP;
+#endif
+}
+
+/* ----------------------------- LOCKS -------------------------------- */
+
+static int
+tilck_sys_dp_get_lockstat(ulong u_buf, ulong max_count, ulong _3, ulong _4)
+{
+#if KRN_LOCKSTAT
+
+   struct lockstat_class *cls;
+   struct dp_lockstat_class *kbuf;
+   u32 count = 0;
+   int rc = 0;
+
+   if (max_count == 0)
+      return 0;
+
+   if (max_count > LOCKSTAT_MAX_CLASSES)
+      max_count = LOCKSTAT_MAX_CLASSES;
+
+   if (user_out_of_range((void *)u_buf,
+                         max_count * sizeof(struct dp_lockstat_class)))
+      return -EFAULT;
+
+   cls = kalloc_array_obj(struct lockstat_class, max_count);
+   kbuf = kalloc_array_obj(struct dp_lockstat_class, max_count);
+
+   if (!cls || !kbuf) {
+      rc = -ENOMEM;
+      goto out;
+   }
+
+   count = lockstat_get_classes(cls, (u32)max_count);
+
+   for (u32 i = 0; i < count; i++) {
+
+      const struct lockstat_class *c = &cls[i];
+      struct dp_lockstat_class *e = &kbuf[i];
+
+      *e = (struct dp_lockstat_class) {
+         .type      = c->type,
+         .locks     = c->locks,
+         .acquired  = c->acquired,
+         .contended = c->contended,
+         .wait_tot  = c->wait_tot,
+         .wait_max  = c->wait_max,
+         .holds     = c->holds,
+         .hold_tot  = c->hold_tot,
+         .hold_max  = c->hold_max,
+      };
+
+      lockstat_get_class_name(c, e->name, sizeof(e->name));
+   }
+
+   if (copy_to_user((void *)u_buf,
+                    kbuf,
+                    count * sizeof(struct dp_lockstat_class)))
+   {
+      rc = -EFAULT;
+   }
+
+out:
+   if (kbuf)
+      kfree_array_obj(kbuf, struct dp_lockstat_class, max_count);
+
+   if (cls)
+      kfree_array_obj(cls, struct lockstat_class, max_count);
+
+   return rc ? rc : (int)count;
+
+#else
+   return -EOPNOTSUPP;
+#endif
+}
+
 /* ---------------------------- MTRRs --------------------------------- */
 
 #ifdef arch_x86_family
@@ -620,6 +829,12 @@ static void dp_data_register(void)
                       tilck_sys_dp_get_mem_map);
    register_tilck_cmd(TILCK_CMD_DP_GET_MEM_GLOBAL_STATS,
                       tilck_sys_dp_get_mem_global_stats);
+   register_tilck_cmd(TILCK_CMD_DP_GET_PAGE_ALLOC_STATS,
+                      tilck_sys_dp_get_page_alloc_stats);
+   register_tilck_cmd(TILCK_CMD_DP_GET_SYSCALL_STATS,
+                      tilck_sys_dp_get_syscall_stats);
+   register_tilck_cmd(TILCK_CMD_DP_GET_LOCKSTAT,
+                      tilck_sys_dp_get_lockstat);
    register_tilck_cmd(TILCK_CMD_DP_GET_MTRRS,
                       tilck_sys_dp_get_mtrrs);
    register_tilck_cmd(TILCK_CMD_DP_GET_RUNTIME_INFO,
@@ -634,13 +849,15 @@ static void dp_data_register(void)
 /* ---------------------------- MODULE INIT --------------------------- */
 
 /*
- * Today the debugpanel module's job in two parts:
+ * Today the debugpanel module's job in three parts:
  *   1. The TILCK_CMD_DEBUGGER_TOOL slot — the panic-time mini
  *      debugger, invoked from the panic handler. Implementation in
  *      dp_debugger.c.
  *   2. The TILCK_CMD_DP_* data-collection sub-commands consumed by
  *      the userspace `dp` tool (the panels and ps mode). Handlers
  *      in this file; registration via dp_data_register().
+ *   3. The statistics page (/syst/dp/stats) that `dp` maps in its
+ *      address space, refreshed by a kthread. See dp_stats.c.
  *
  * Slots TILCK_CMD_DEBUG_PANEL / TILCK_CMD_TRACING_TOOL /
  * TILCK_CMD_PS_TOOL (6, 7, 8) used to be registered here too; the
@@ -653,6 +870,7 @@ debugpanel_module_init(void)
 {
    register_tilck_cmd(TILCK_CMD_DEBUGGER_TOOL, dp_mini_debugger_tool);
    dp_data_register();
+   dp_stats_init();
 }
 
 static struct module debugpanel_module = {
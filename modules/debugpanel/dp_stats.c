@@ -0,0 +1,222 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * The statistics page of the debugpanel: a few pages with per-task runtime,
+ * IRQ counters, heap usage and scheduler counters (struct dp_stats), which
+ * the userspace `dp` tool maps read-only from /syst/dp/stats. A kthread
+ * refreshes them every DP_STATS_REFRESH_MS, but only while somebody has the
+ * pages mapped: that's the case when the ref-count of the first pageframe is
+ * higher than it was right after the allocation. Readers synchronize with
+ * the kthread using the `seq` field, see dp_abi.h.
+ */
+
+#include <tilck_gen_headers/mod_sysfs.h>
+#include <tilck_gen_headers/config_kmalloc.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/dp_abi.h>
+
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/kmalloc_debug.h>
+#include <tilck/kernel/page_alloc.h>
+#include <tilck/kernel/paging.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/errno.h>
+
+#if MOD_sysfs
+
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+#define DP_STATS_ORDER                                 2
+
+STATIC_ASSERT((PAGE_SIZE << DP_STATS_ORDER) == DP_STATS_SIZE);
+
+/* Defined in dp_data.c */
+void dp_fill_task_info(struct task *ti, struct dp_task_info *out);
+void dp_fill_irq_stats(struct dp_irq_stats *out);
+
+static struct dp_stats *stats;
+static ulong stats_paddr;
+static u32 stats_base_ref_count;
+
+static int dp_stats_task_cb(void *obj, void *arg)
+{
+   struct task *ti = obj;
+   struct dp_stats_task *t;
+
+   if (ti->tid == KERNEL_TID_START)
+      return 0;       /* skip the main kernel task, as DP_GET_TASKS does */
+
+   if (stats->tasks_count < DP_STATS_MAX_TASKS) {
+
+      t = &stats->tasks[stats->tasks_count++];
+      dp_fill_task_info(ti, &t->info);
+      t->ticks = ti->ticks.total;
+      t->kernel_ticks = ti->ticks.total_kernel;
+   }
+
+   stats->tot_tasks++;
+   return 0;
+}
+
+static void dp_stats_update(void)
+{
+   struct debug_kmalloc_heap_info hi;
+   struct page_alloc_stats pst;
+   u64 kmalloc_used = 0, kmalloc_size = 0;
+
+   /* Collect first the counters that can't be read with preemption off */
+   page_alloc_get_stats(&pst);
+
+   disable_preemption();
+
+   /* Make `seq` odd, before touching anything else */
+   __atomic_store_n(&stats->seq, stats->seq + 1, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+
+   for (int i = 0; i < KMALLOC_HEAPS_COUNT; i++) {
+
+      if (!debug_kmalloc_get_heap_info(i, &hi))
+         break;
+
+      kmalloc_used += hi.mem_allocated;
+      kmalloc_size += hi.size;
+   }
+
+   stats->timer_hz = KRN_TIMER_HZ;
+   stats->updates++;
+   stats->ticks = get_ticks();
+   stats->idle_ticks = idle_ticks;
+   stats->runnable_count =
+      (u32)atomic_load_explicit(&runnable_tasks_count, mo_relaxed);
+
+   stats->tot_tasks = 0;
+   stats->tasks_count = 0;
+   iterate_over_tasks(dp_stats_task_cb, NULL);
+
+   dp_fill_irq_stats(&stats->irqs);
+
+   stats->kmalloc_used = kmalloc_used;
+   stats->kmalloc_heaps_size = kmalloc_size;
+   stats->page_alloc_tot_pages = pst.tot_pages;
+   stats->page_alloc_free_pages = pst.free_pages;
+
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   __atomic_store_n(&stats->seq, stats->seq + 1, __ATOMIC_RELAXED);
+
+   enable_preemption();
+}
+
+static bool dp_stats_is_mapped(void)
+{
+   return get_pageframe_ref_count(stats_paddr) > stats_base_ref_count;
+}
+
+static void dp_stats_thread(void *unused)
+{
+   while (true) {
+
+      if (dp_stats_is_mapped())
+         dp_stats_update();
+
+      kernel_sleep_ms(DP_STATS_REFRESH_MS);
+   }
+}
+
+static offt
+dp_stats_get_buf_sz(struct sysobj *obj, void *data)
+{
+   return DP_STATS_SIZE;
+}
+
+static offt
+dp_stats_load(struct sysobj *obj, void *data, void *buf, offt sz, offt off)
+{
+   size_t to_copy;
+
+   if (off < 0 || off > DP_STATS_SIZE)
+      return -EINVAL;
+
+   if (!off)
+      dp_stats_update();   /* read() gets always fresh data */
+
+   to_copy = MIN((size_t)sz, (size_t)(DP_STATS_SIZE - off));
+   memcpy(buf, (char *)stats + off, to_copy);
+   return (offt)to_copy;
+}
+
+static void *
+dp_stats_get_data_ptr(struct sysobj *obj, void *data)
+{
+   return stats;
+}
+
+static const struct sysobj_prop_type dp_stats_prop_type = {
+   .buf_type     = SYSFS_BUF_IMMUTABLE,
+   .get_buf_sz   = &dp_stats_get_buf_sz,
+   .load         = &dp_stats_load,
+   .get_data_ptr = &dp_stats_get_data_ptr,
+};
+
+DEF_STATIC_SYSOBJ_PROP(stats, &dp_stats_prop_type);
+
+DEF_STATIC_SYSOBJ_TYPE(dp_sysobj_type,
+                       &prop_stats,
+                       NULL);
+
+static void *dp_stats_alloc(void)
+{
+   void *va;
+
+   if ((va = alloc_pages(DP_STATS_ORDER)))
+      return va;
+
+   /* No page allocator pool: kmalloc returns blocks aligned at their size */
+   va = kmalloc(DP_STATS_SIZE);
+
+   if (va && !IS_PAGE_ALIGNED(va)) {
+      kfree2(va, DP_STATS_SIZE);
+      va = NULL;
+   }
+
+   return va;
+}
+
+void dp_stats_init(void)
+{
+   struct sysobj *obj;
+
+   if (!(stats = dp_stats_alloc())) {
+      printk("WARNING: dp: unable to allocate the stats page\n");
+      return;
+   }
+
+   bzero(stats, DP_STATS_SIZE);
+   stats_paddr = LIN_VA_TO_PA(stats);
+   stats_base_ref_count = get_pageframe_ref_count(stats_paddr);
+   dp_stats_update();
+
+   if (!(obj = sysfs_create_obj(&dp_sysobj_type, NULL, NULL))) {
+      printk("WARNING: dp: /syst/dp not registered: out of memory\n");
+      return;
+   }
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "dp", obj) < 0) {
+      printk("WARNING: dp: /syst/dp not registered\n");
+      sysfs_destroy_unregistered_obj(obj);
+      return;
+   }
+
+   if (kthread_create(&dp_stats_thread, 0, NULL) < 0)
+      printk("WARNING: dp: unable to create the stats thread\n");
+}
+
+#else
+
+void dp_stats_init(void) { /* no-op */ }
+
+#endif
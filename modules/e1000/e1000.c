@@ -856,6 +856,8 @@ static struct module e1000_module = {
    .name = "e1000",
    .priority = MOD_e1000_prio,
    .init = &init_e1000,
+   .deps = MODULE_DEPS("pci"),
+   .background = true,
 };
 
 REGISTER_MODULE(&e1000_module);
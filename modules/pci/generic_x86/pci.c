@@ -123,6 +123,8 @@ pci_ioport_config_read(struct pci_device_loc loc, u32 off, u32 width, u32 *val)
 {
    const u16 data_port = PCI_CONFIG_DATA + (off & 3);
    const u32 len = width >> 3;
+   ulong var;
+   int rc = 0;
 
    if (UNLIKELY(loc.seg != 0))
       return -EINVAL; /* Conventional PCI has no segment support */
@@ -133,6 +135,12 @@ pci_ioport_config_read(struct pci_device_loc loc, u32 off, u32 width, u32 *val)
    if (UNLIKELY(off + len > 256))
       return -EINVAL;
 
+   /*
+    * The address and the data ports are a pair: nobody else must touch them
+    * in between. Modules are initialized in parallel (see init_modules()).
+    */
+   disable_interrupts(&var);
+
    /* Write the address to the PCI config. space addr I/O port */
    outl(PCI_CONFIG_ADDRESS, pci_get_config_io_addr(loc, off));
 
@@ -148,10 +156,11 @@ pci_ioport_config_read(struct pci_device_loc loc, u32 off, u32 width, u32 *val)
          *val = inl(data_port);
          break;
       default:
-         return -EINVAL;
+         rc = -EINVAL;
    }
 
-   return 0;
+   enable_interrupts(&var);
+   return rc;
 }
 
 static int
@@ -159,6 +168,8 @@ pci_ioport_config_write(struct pci_device_loc loc, u32 off, u32 width, u32 val)
 {
    const u16 data_port = PCI_CONFIG_DATA + (off & 3);
    const u32 len = width >> 3;
+   ulong var;
+   int rc = 0;
 
    if (UNLIKELY(loc.seg != 0))
       return -EINVAL; /* Conventional PCI has no segment support */
@@ -169,6 +180,9 @@ pci_ioport_config_write(struct pci_device_loc loc, u32 off, u32 width, u32 val)
    if (UNLIKELY(off + len > 256))
       return -EINVAL;
 
+   /* See pci_ioport_config_read() */
+   disable_interrupts(&var);
+
    /* Write the address to the PCI config. space addr I/O port */
    outl(PCI_CONFIG_ADDRESS, pci_get_config_io_addr(loc, off));
 
@@ -184,10 +198,11 @@ pci_ioport_config_write(struct pci_device_loc loc, u32 off, u32 width, u32 val)
          outl(data_port, (u32)val);
          break;
       default:
-         return -EINVAL;
+         rc = -EINVAL;
    }
 
-   return 0;
+   enable_interrupts(&var);
+   return rc;
 }
 
 static struct pci_segment *
@@ -840,6 +855,7 @@ static struct module pci_module = {
    .name = "pci",
    .priority = MOD_pci_prio,
    .init = &init_pci,
+   .deps = MODULE_DEPS("sysfs"),
 };
 
 REGISTER_MODULE(&pci_module);
@@ -472,6 +472,8 @@ static struct module sb16_module = {
    .name = "sb16",
    .priority = MOD_sb16_prio,
    .init = &init_sb16,
+   .deps = MODULE_NO_DEPS,
+   .background = true,
 };
 
 REGISTER_MODULE(&sb16_module);
@@ -6,6 +6,7 @@
 
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/kmalloc_debug.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/list.h>
 #include <tilck/kernel/datetime.h>
@@ -16,6 +17,11 @@
 #include <tilck/kernel/modules.h>
 #include <tilck/kernel/sort.h>
 #include <tilck/kernel/cmdline.h>
+#include <tilck/kernel/syscall_stats.h>
+#include <tilck/kernel/boot_trace.h>
+#include <tilck/kernel/worker_thread.h>
+#include <tilck/kernel/lockstat.h>
+#include <tilck/kernel/tty.h>
 
 #include "sysfs_int.h"
 #include "dents.c.h"
@@ -443,22 +449,16 @@ sysfs_destroy_unregistered_obj(struct sysobj *obj)
    kfree_obj(obj, struct sysobj);
 }
 
-int
-sysfs_register_obj(struct mnt_fs *fs,
-                   struct sysobj *parent,
-                   const char *name,
-                   struct sysobj *obj)
+static int
+do_sysfs_register_obj(struct mnt_fs *fs,
+                      struct sysobj *parent,
+                      const char *name,
+                      struct sysobj *obj)
 {
+   struct sysfs_data *d = fs->device_data;
    struct sysfs_inode *iobj, *iparent;
-   struct sysfs_data *d;
    int rc;
 
-   if (!fs) {
-      ASSERT(sysfs != NULL);
-      fs = sysfs;
-   }
-
-   d = fs->device_data;
    ASSERT(obj != NULL);
 
    if (!parent) {
@@ -495,6 +495,33 @@ sysfs_register_obj(struct mnt_fs *fs,
    return sysfs_create_files_for_obj(fs, obj);
 }
 
+/*
+ * Kernel modules are initialized in parallel (see init_modules()) and many of
+ * them register objects here: serialize that with the exclusive lock.
+ */
+int
+sysfs_register_obj(struct mnt_fs *fs,
+                   struct sysobj *parent,
+                   const char *name,
+                   struct sysobj *obj)
+{
+   struct sysfs_data *d;
+   int rc;
+
+   if (!fs) {
+      ASSERT(sysfs != NULL);
+      fs = sysfs;
+   }
+
+   d = fs->device_data;
+   rwlock_wp_exlock(&d->rwlock);
+   {
+      rc = do_sysfs_register_obj(fs, parent, name, obj);
+   }
+   rwlock_wp_exunlock(&d->rwlock);
+   return rc;
+}
+
 struct symlink_tmp {
 
    char path[MAX_PATH];
@@ -609,17 +636,24 @@ sysfs_symlink_obj(struct mnt_fs *fs,
    if (*path == '/')
       *path = 0; /* Drop the trailing '/' */
 
+   rwlock_wp_exlock(&sd->rwlock);
+
    /* Create the symlink inode using `path` as target */
    link = sysfs_create_inode_symlink(sd, new_parent->inode, tmp->path);
 
-   if (!link)
-      goto oom;
+   if (link) {
 
-   /* Now finally create a dir entry for the symlink */
-   rc = sysfs_dir_add_entry(new_parent->inode, new_name, link, NULL);
+      /* Now finally create a dir entry for the symlink */
+      rc = sysfs_dir_add_entry(new_parent->inode, new_name, link, NULL);
 
-   if (rc < 0)
-      sysfs_destroy_inode(sd, link);
+      if (rc < 0)
+         sysfs_destroy_inode(sd, link);
+   }
+
+   rwlock_wp_exunlock(&sd->rwlock);
+
+   if (!link)
+      goto oom;
 
 out:
    /* Free our temporary object, since `link` now has a copy of tmp->path */
@@ -653,7 +687,7 @@ create_sysfs(void)
 
    d->next_inode = 1;
    d->wrt_time = (time_t)get_timestamp();
-   rwlock_wp_init(&d->rwlock, false);
+   rwlock_wp_init(&d->rwlock, 0);
    list_init(&d->dirty_handles);
    d->root = sysfs_create_inode_dir(d, NULL);
 
@@ -757,6 +791,12 @@ init_sysfs(void)
 
    sysfs_create_config_obj();
    register_kopts_sysfs();
+   register_syscall_stats_sysfs();
+   register_boot_trace_sysfs();
+   register_wth_sysfs();
+   register_lockstat_sysfs();
+   register_kmalloc_prof_sysfs();
+   register_tty_sysfs();
 }
 
 static struct module sysfs_module = {
@@ -47,6 +47,15 @@ static struct kcond tracing_cond;
 static struct ringbuf tracing_rb;
 static void *tracing_buf;
 
+/*
+ * Ring buffer counters, updated only with interrupts disabled, like the ring
+ * buffer itself. When the ring is full, new events are dropped (the reader
+ * must see the older ones first): `dropped` counts them.
+ */
+static u64 tracing_written_count;
+static u64 tracing_dropped_count;
+static u64 tracing_read_count;
+
 static u32 syms_count;
 static struct symbol_node *syms_buf;
 static struct symbol_node *syms_bintree;
@@ -271,6 +280,11 @@ enqueue_trace_event(struct trace_event *e)
    disable_interrupts(&var);
    {
       success = ringbuf_write_elem(&tracing_rb, e);
+
+      if (success)
+         tracing_written_count++;
+      else
+         tracing_dropped_count++;
    }
    enable_interrupts(&var);
 
@@ -477,19 +491,48 @@ trace_task_killed_int(int signum)
    enqueue_trace_event(&e);
 }
 
-bool read_trace_event_noblock(struct trace_event *e)
+/* Max events copied per interrupts-disabled section */
+#define TRACE_READ_BATCH                16
+
+/*
+ * Read up to `max` events. Used by the /syst/tracing/events file to return
+ * many events per read(): with one event per syscall, the reader cannot keep
+ * up with a busy traced task and the ring overruns. The events are copied in
+ * batches of TRACE_READ_BATCH, re-enabling the interrupts between them, so
+ * that a big read does not keep the interrupts disabled for long.
+ */
+static u32 read_trace_events_noblock(struct trace_event *buf, u32 max)
 {
-   bool success;
+   u32 n = 0, batch_end;
+   bool empty = false;
 
    /* We must NOT consume trace events from IRQ handlers, of course */
    ASSERT(!in_irq());
    ASSERT(are_interrupts_enabled());
-   disable_interrupts_forced();
-   {
-      success = ringbuf_read_elem(&tracing_rb, e);
+
+   while (n < max && !empty) {
+
+      batch_end = n + MIN(max - n, (u32)TRACE_READ_BATCH);
+
+      disable_interrupts_forced();
+      {
+         const u32 prev = n;
+
+         while (n < batch_end && ringbuf_read_elem(&tracing_rb, &buf[n]))
+            n++;
+
+         empty = n < batch_end;
+         tracing_read_count += n - prev;
+      }
+      enable_interrupts_forced();
    }
-   enable_interrupts_forced();
-   return success;
+
+   return n;
+}
+
+bool read_trace_event_noblock(struct trace_event *e)
+{
+   return read_trace_events_noblock(e, 1) == 1;
 }
 
 bool read_trace_event(struct trace_event *e, u32 timeout_ticks)
@@ -880,6 +923,24 @@ tracing_get_in_buffer_events_count(void)
    return rc;
 }
 
+void
+tracing_get_ring_stats(struct tracing_ring_stats *st)
+{
+   ulong var;
+
+   disable_interrupts(&var);
+   {
+      *st = (struct tracing_ring_stats) {
+         .in_buf = (u32)ringbuf_get_elems(&tracing_rb),
+         .capacity = (u32)tracing_rb.max_elems,
+         .written = tracing_written_count,
+         .dropped = tracing_dropped_count,
+         .read = tracing_read_count,
+      };
+   }
+   enable_interrupts(&var);
+}
+
 static void
 tracing_init_oom_panic(const char *buf_name)
 {
@@ -890,15 +951,24 @@ tracing_init_oom_panic(const char *buf_name)
 
 #if MOD_sysfs
 
+/*
+ * Each read() returns as many whole events as fit in the user buffer (at
+ * least one), without waiting for the buffer to fill up: reading one event
+ * at a time still works, but a reader using bigger buffers drains the ring
+ * with far fewer syscalls.
+ */
 static offt
 tracing_events_load(struct sysobj *obj, void *data,
                     void *buf, offt sz, offt off)
 {
-   if (sz < (offt)sizeof(struct trace_event))
+   const u32 max = (u32)(sz / (offt)sizeof(struct trace_event));
+   u32 n;
+
+   if (!max)
       return -EINVAL;
 
-   if (read_trace_event_noblock((struct trace_event *)buf))
-      return (offt)sizeof(struct trace_event);
+   if ((n = read_trace_events_noblock(buf, max)))
+      return (offt)(n * sizeof(struct trace_event));
 
    if (pending_signals())
       return -EINTR;
@@ -919,8 +989,8 @@ tracing_events_load(struct sysobj *obj, void *data,
    if (kcond_wait(&tracing_cond, NULL, KRN_TIMER_HZ / 10)) {
 
       /* Woken by an event — try the noblock read once more. */
-      if (read_trace_event_noblock((struct trace_event *)buf))
-         return (offt)sizeof(struct trace_event);
+      if ((n = read_trace_events_noblock(buf, max)))
+         return (offt)(n * sizeof(struct trace_event));
    }
 
    if (pending_signals())
@@ -936,6 +1006,35 @@ static const struct sysobj_prop_type tracing_events_prop_type = {
 
 DEF_STATIC_SYSOBJ_PROP(events, &tracing_events_prop_type);
 
+/* ----------------- /syst/tracing/stats text file ---------------------- */
+
+static offt
+tracing_stats_load(struct sysobj *obj, void *data,
+                   void *buf, offt sz, offt off)
+{
+   struct tracing_ring_stats st;
+   int rc;
+
+   tracing_get_ring_stats(&st);
+
+   rc = snprintk(buf, (size_t)sz,
+                 "in_buf %u\n"
+                 "capacity %u\n"
+                 "written %llu\n"
+                 "read %llu\n"
+                 "dropped %llu\n",
+                 st.in_buf, st.capacity, st.written, st.read, st.dropped);
+
+   return (offt)rc;
+}
+
+static const struct sysobj_prop_type tracing_stats_prop_type = {
+   .buf_type = SYSFS_BUF_ONESHOT,
+   .load     = &tracing_stats_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(stats, &tracing_stats_prop_type);
+
 /* ----------------- /syst/tracing/metadata immutable blob -------------- */
 
 /*
@@ -1167,6 +1266,7 @@ DEF_STATIC_SYSOBJ_PROP(metadata, &tracing_meta_prop_type);
 DEF_STATIC_SYSOBJ_TYPE(tracing_sysobj_type,
                        &prop_events,
                        &prop_metadata,
+                       &prop_stats,
                        NULL);
 
 static void
@@ -1274,6 +1374,7 @@ static struct module dp_module = {
    .name = "tracing",
    .priority = MOD_tracing_prio,
    .init = &init_tracing,
+   .deps = MODULE_DEPS("sysfs"),
 };
 
 REGISTER_MODULE(&dp_module);
@@ -107,13 +107,22 @@ tilck_sys_dp_task_set_traced(ulong tid, ulong enabled, ulong _3, ulong _4)
 static int
 tilck_sys_dp_trace_get_stats(ulong u_out, ulong _2, ulong _3, ulong _4)
 {
-   struct dp_trace_stats out = {
+   struct tracing_ring_stats rs;
+   struct dp_trace_stats out;
+
+   tracing_get_ring_stats(&rs);
+
+   out = (struct dp_trace_stats) {
       .force_exp_block    = tracing_is_force_exp_block_enabled() ? 1 : 0,
       .dump_big_bufs      = tracing_are_dump_big_bufs_on() ? 1 : 0,
       .enabled            = tracing_is_enabled() ? 1 : 0,
       .printk_lvl         = tracing_get_printk_lvl(),
       .sys_traced_count   = get_traced_syscalls_count(),
       .tasks_traced_count = get_traced_tasks_count(),
+      .in_buf_count       = rs.in_buf,
+      .buf_capacity       = rs.capacity,
+      .written_count      = rs.written,
+      .dropped_count      = rs.dropped,
    };
 
    if (user_out_of_range((void *)u_out, sizeof(out)))
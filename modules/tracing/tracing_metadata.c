@@ -460,6 +460,58 @@ static const struct syscall_info __tracing_metadata[] =
       },
    },
 
+#ifdef SYS_ugetrlimit
+   {
+      .sys_n = SYS_ugetrlimit,
+      .n_params = 2,
+      .exp_block = false,
+      .ret_type = &ptype_errno_or_val,
+      .params = {
+         SIMPLE_PARAM("resource", &ptype_int, sys_param_in),
+         SIMPLE_PARAM("rlim", &ptype_voidp, sys_param_out),
+      },
+   },
+#endif
+
+   {
+      .sys_n = SYS_getrlimit,
+      .n_params = 2,
+      .exp_block = false,
+      .ret_type = &ptype_errno_or_val,
+      .params = {
+         SIMPLE_PARAM("resource", &ptype_int, sys_param_in),
+         SIMPLE_PARAM("rlim", &ptype_voidp, sys_param_out),
+      },
+   },
+
+   {
+      .sys_n = SYS_setrlimit,
+      .n_params = 2,
+      .exp_block = false,
+      .ret_type = &ptype_errno_or_val,
+      .params = {
+         SIMPLE_PARAM("resource", &ptype_int, sys_param_in),
+         SIMPLE_PARAM("rlim", &ptype_voidp, sys_param_in),
+      },
+   },
+
+   {
+      .sys_n = SYS_prlimit64,
+      .n_params = 4,
+      .exp_block = false,
+      .ret_type = &ptype_errno_or_val,
+      .params = {
+         SIMPLE_PARAM("pid", &ptype_int, sys_param_in),
+         SIMPLE_PARAM("resource", &ptype_int, sys_param_in),
+         SIMPLE_PARAM("new_limit", &ptype_voidp, sys_param_in),
+         SIMPLE_PARAM("old_limit", &ptype_voidp, sys_param_out),
+      },
+   },
+
+#ifdef SYS_close_range
+   SYSCALL_TYPE_7(SYS_close_range, "first", "last", "flags"),
+#endif
+
    {
       .sys_n = TILCK_CMD_SYSCALL,
       .n_params = 1,
@@ -782,11 +834,10 @@ static const struct syscall_info __tracing_metadata[] =
    },
 
    /* ---------------- Layer 0c: memory-mgmt syscalls -------------------
-    * Tilck implements only munmap and madvise as real memory-mgmt
-    * calls — mprotect, mlock, mremap, msync, mincore etc. are all
-    * stubs returning -ENOSYS, so they have nothing useful to
-    * trace. brk and mmap_pgoff (the i386 mmap2 entry) were already
-    * covered. */
+    * Tilck implements munmap, mprotect, mremap and madvise as real
+    * memory-mgmt calls — mlock, msync, mincore etc. are all stubs
+    * returning -ENOSYS, so they have nothing useful to trace. brk
+    * and mmap_pgoff (the i386 mmap2 entry) were already covered. */
    {
       .sys_n = SYS_munmap,
       .n_params = 2,
@@ -798,6 +849,32 @@ static const struct syscall_info __tracing_metadata[] =
       },
    },
 
+   {
+      .sys_n = SYS_mprotect,
+      .n_params = 3,
+      .exp_block = false,
+      .ret_type = &ptype_errno_or_val,
+      .params = {
+         SIMPLE_PARAM("addr",   &ptype_voidp,     sys_param_in),
+         SIMPLE_PARAM("length", &ptype_int,       sys_param_in),
+         SIMPLE_PARAM("prot",   &ptype_mmap_prot, sys_param_in),
+      },
+   },
+
+   {
+      .sys_n = SYS_mremap,
+      .n_params = 5,
+      .exp_block = false,
+      .ret_type = &ptype_errno_or_ptr,
+      .params = {
+         SIMPLE_PARAM("old_addr", &ptype_voidp, sys_param_in),
+         SIMPLE_PARAM("old_len",  &ptype_int,   sys_param_in),
+         SIMPLE_PARAM("new_len",  &ptype_int,   sys_param_in),
+         SIMPLE_PARAM("flags",    &ptype_int,   sys_param_in),
+         SIMPLE_PARAM("new_addr", &ptype_voidp, sys_param_in),
+      },
+   },
+
    /* madvise: advice is an enum (MADV_NORMAL / MADV_DONTNEED /
     * MADV_FREE / ...). Layer 1 will swap ptype_int for
     * ptype_madvise_advice for symbolic rendering. */
@@ -60,6 +60,50 @@ tilck_option(KRN_KMALLOC_FIRST_HEAP_SIZE_KB
             "derived 'auto' value applies."
 )
 
+tilck_option(KRN_PAGE_ALLOC
+   TYPE     BOOL
+   CATEGORY "Kernel Memory"
+   DEFAULT  OFF
+   HELP     "Dedicated page-frame allocator for user pages"
+            "Reserve a pool of physical memory, managed by a buddy"
+            "allocator with per-order free lists, for the pageframes"
+            "mapped in user space (anonymous memory, brk, COW copies,"
+            "ELF segments). Keeps page-granular user memory out of the"
+            "kmalloc heaps. When the pool is exhausted, kmalloc is used"
+            "as a fallback. Off by default because the pool is reserved"
+            "at boot and taken away from kmalloc, even if never used."
+)
+
+tilck_option(KRN_PAGE_ALLOC_POOL_PERCENT
+   TYPE     UINT
+   CATEGORY "Kernel Memory"
+   DEFAULT  50
+   DEPENDS  KRN_PAGE_ALLOC
+   HELP     "Page allocator pool size (% of usable memory)"
+            "Percentage of the linearly-mapped usable memory reserved"
+            "at boot for the page-frame allocator. The rest is left to"
+            "kmalloc. Valid range: 1-90."
+)
+
+tilck_option(KRN_BCACHE_PAGES
+   TYPE     UINT
+   CATEGORY "Kernel Memory"
+   DEFAULT  256
+   HELP     "Max number of pages in the block device buffer cache"
+            "Pages are allocated on demand, up to this limit. After"
+            "that, the least recently used clean page gets recycled."
+)
+
+tilck_option(KRN_BCACHE_READAHEAD
+   TYPE     UINT
+   CATEGORY "Kernel Memory"
+   DEFAULT  16
+   HELP     "Block device read-ahead window (pages)"
+            "On sequential reads, the buffer cache's worker thread reads"
+            "in background up to this number of pages after the last"
+            "one read. Set to 0 to disable read-ahead."
+)
+
 tilck_option(KRN_BIG_IO_BUF
    TYPE     BOOL
    CATEGORY "Kernel Memory"
@@ -74,6 +118,17 @@ tilck_option(KRN_KMALLOC_HEAVY_STATS
    HELP     "Count allocations per distinct size (diagnostic)"
 )
 
+tilck_option(KRN_KMALLOC_PROFILER
+   TYPE     BOOL
+   CATEGORY "Kernel Memory"
+   DEFAULT  OFF
+   HELP     "Compile-in a sampling kmalloc profiler"
+            "Samples about one allocation every KMALLOC_PROF_SAMPLE_RATE"
+            "bytes and attributes the allocated and the live bytes to the"
+            "caller. Also keeps a size-class histogram per heap. Exported"
+            "under /syst/kmalloc_prof, also in pprof's heap format."
+)
+
 tilck_option(KRN_KMALLOC_FREE_MEM_POISONING
    TYPE     BOOL
    CATEGORY "Kernel Memory"
@@ -106,6 +161,17 @@ tilck_option(KRN_TERM_SCROLL_LINES
    HELP     "Lines to scroll on Shift+PgUp / Shift+PgDown"
 )
 
+tilck_option(KRN_TTY_INPUT_BS
+   TYPE     UINT
+   CATEGORY "Kernel Terminal"
+   DEFAULT  1024
+   HELP     "Size of the per-tty input buffer (bytes)"
+            "Limits both the input waiting to be read and, in canonical"
+            "mode, the length of a line. Must be between 64 and 32768."
+            "The input exceeding it is discarded (see input_overruns in"
+            "/syst/tty)."
+)
+
 tilck_option(KRN_PRINTK_ON_CURR_TTY
    TYPE     BOOL
    CATEGORY "Kernel Terminal"
@@ -113,6 +179,30 @@ tilck_option(KRN_PRINTK_ON_CURR_TTY
    HELP     "Always flush printk() on the current TTY"
 )
 
+tilck_option(KRN_TTY_ASYNC_OUTPUT
+   TYPE     BOOL
+   CATEGORY "Kernel Terminal"
+   DEFAULT  OFF
+   HELP     "Render the tty output in a worker thread"
+            "write() returns as soon as the data is in the per-tty output"
+            "ring, blocking only when the ring is full. A dedicated worker"
+            "thread renders the queued output, coalescing the writes done"
+            "before it runs. tcdrain() and TCSADRAIN wait for the output"
+            "to be rendered."
+)
+
+tilck_option(KRN_PRINTK_DEFERRED
+   TYPE     BOOL
+   CATEGORY "Kernel Terminal"
+   DEFAULT  OFF
+   HELP     "Flush printk() on the console from a worker thread"
+            "printk() just stores the message in the kmsg ring and returns:"
+            "the kmsg worker thread renders the stored messages on the"
+            "console. Before the worker thread starts, during panic and"
+            "where it cannot be woken up, the messages are still rendered"
+            "synchronously."
+)
+
 # KRN_FB_* options (fb_console banner / cursor / fonts / big-font
 # threshold / failsafe) live under Modules/fb now, declared in
 # modules/fb/options.cmake. They DEPEND on MOD_fb so mconf hides
@@ -144,6 +234,38 @@ tilck_option(KRN_TRACE_PRINTK_ON_BOOT
    HELP     "Enable trace_printk() from boot time"
 )
 
+tilck_option(KRN_SYSCALL_STATS
+   TYPE     BOOL
+   CATEGORY "Kernel Debug"
+   DEFAULT  ON
+   HELP     "Keep per-syscall latency stats"
+            "Counts every syscall and the cycles spent in it, globally"
+            "(with a log2 latency histogram) and per process. The stats"
+            "are exported under /syst/syscalls and shown by dp."
+)
+
+tilck_option(KRN_BOOT_TRACE
+   TYPE     BOOL
+   CATEGORY "Kernel Debug"
+   DEFAULT  ON
+   HELP     "Record a timeline of the boot phases"
+            "Reads the cycle counter before and after each init call in"
+            "kmain(), in the async init and in each module's init. The"
+            "timeline is exported as /syst/boot/timeline."
+)
+
+tilck_option(KRN_LOCKSTAT
+   TYPE     BOOL
+   CATEGORY "Kernel Debug"
+   DEFAULT  OFF
+   HELP     "Keep lock contention stats"
+            "For kmutex, rwlock_wp and kcond, grouped by lock class (the"
+            "call site of the init function): acquisitions, contentions,"
+            "wait and hold times in cycles. Costs two cycle counter reads"
+            "per lock/unlock and a pointer + a timestamp per lock. The"
+            "stats are exported as /syst/lockstat and shown by dp."
+)
+
 tilck_option(KRN_PAGE_FAULT_PRINTK
    TYPE     BOOL
    CATEGORY "Kernel Debug"
@@ -186,8 +308,20 @@ tilck_option(KRN_CLOCK_DRIFT_COMP
 tilck_option(KRN_MAX_HANDLES
    TYPE     UINT
    CATEGORY "Kernel Misc"
-   DEFAULT  16
-   HELP     "Max open handles per process (keep small)"
+   DEFAULT  4
+   HELP     "Initial size of the per-process fd table"
+            "Number of fd slots embedded in each process struct (keep it"
+            "small). The fd table grows on demand beyond that, up to"
+            "RLIMIT_NOFILE."
+)
+
+tilck_option(KRN_NOFILE_MAX
+   TYPE     UINT
+   CATEGORY "Kernel Misc"
+   DEFAULT  4096
+   HELP     "Max value for the RLIMIT_NOFILE hard limit"
+            "Upper bound for the number of fds a process can have open."
+            "The default soft limit is min(1024, KRN_NOFILE_MAX)."
 )
 
 tilck_option(KRN_RESCHED_ENABLE_PREEMPT
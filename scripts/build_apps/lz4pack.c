@@ -0,0 +1,343 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * Compresses a file in the LZ4 frame format, the one used for the compressed
+ * initrd. The frames are fully standard (`lz4 -d` can decompress them), but
+ * they always contain the content size, which Tilck's decoder requires in order
+ * to allocate the output buffer before the decompression.
+ *
+ * The compressor is a simple greedy one with a single-entry hash table: the
+ * compression ratio is a bit worse than `lz4 -1`, but that's irrelevant for
+ * the initrd, which is mostly made of zero-filled clusters and ELF binaries.
+ *
+ * After compressing, the output is decompressed with the same decoder used at
+ * boot time (common/lz4.c) and compared with the input.
+ */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/lz4.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+
+#define BLOCK_SIZE                        (64 * KB)
+#define BD_BLOCK_64K                           0x40
+#define FLG_VERSION_01                         0x40
+#define FLG_CONTENT_SIZE                       0x08
+#define FLG_CONTENT_CHECKSUM                   0x04
+
+#define HASH_LOG                                 16
+#define MIN_MATCH                                 4
+#define MAX_OFFSET                            65535
+#define LAST_LITERALS                             5
+#define MF_LIMIT                                 12
+
+static u8 *hash_in;
+static u32 hash_table[1 << HASH_LOG];        /* position + 1 or 0 */
+
+#define XXH_PRIME1                        2654435761u
+#define XXH_PRIME2                        2246822519u
+#define XXH_PRIME3                        3266489917u
+#define XXH_PRIME4                         668265263u
+#define XXH_PRIME5                         374761393u
+
+static inline u32 rotl32(u32 x, int r)
+{
+   return (x << r) | (x >> (32 - r));
+}
+
+static inline u32 rd32(const u8 *p)
+{
+   u32 v;
+   memcpy(&v, p, 4);
+   return v;
+}
+
+static inline void wr32(u8 *p, u32 v)
+{
+   memcpy(p, &v, 4);
+}
+
+static inline u32 xxh32_round(u32 acc, u32 val)
+{
+   acc += val * XXH_PRIME2;
+   acc = rotl32(acc, 13);
+   return acc * XXH_PRIME1;
+}
+
+static u32 xxh32(const u8 *p, size_t len)
+{
+   const u8 *const end = p + len;
+   u32 h;
+
+   if (len >= 16) {
+
+      u32 v1 = XXH_PRIME1 + XXH_PRIME2;
+      u32 v2 = XXH_PRIME2;
+      u32 v3 = 0;
+      u32 v4 = -XXH_PRIME1;
+
+      for (; p + 16 <= end; p += 16) {
+         v1 = xxh32_round(v1, rd32(p));
+         v2 = xxh32_round(v2, rd32(p + 4));
+         v3 = xxh32_round(v3, rd32(p + 8));
+         v4 = xxh32_round(v4, rd32(p + 12));
+      }
+
+      h = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+
+   } else {
+
+      h = XXH_PRIME5;
+   }
+
+   h += (u32)len;
+
+   for (; p + 4 <= end; p += 4)
+      h = rotl32(h + rd32(p) * XXH_PRIME3, 17) * XXH_PRIME4;
+
+   for (; p < end; p++)
+      h = rotl32(h + *p * XXH_PRIME5, 11) * XXH_PRIME1;
+
+   h ^= h >> 15;
+   h *= XXH_PRIME2;
+   h ^= h >> 13;
+   h *= XXH_PRIME3;
+   h ^= h >> 16;
+   return h;
+}
+
+static inline u32 hash_pos(u32 pos)
+{
+   return (rd32(hash_in + pos) * XXH_PRIME1) >> (32 - HASH_LOG);
+}
+
+static u8 *emit_len(u8 *op, u32 len)
+{
+   for (; len >= 255; len -= 255)
+      *op++ = 255;
+
+   *op++ = (u8)len;
+   return op;
+}
+
+static u8 *
+emit_sequence(u8 *op, const u8 *lit, u32 lit_len, u32 offset, u32 match_len)
+{
+   u8 *token = op++;
+   u32 ml = match_len ? match_len - MIN_MATCH : 0;
+
+   *token = (u8)((MIN(lit_len, 15u) << 4) | MIN(ml, 15u));
+
+   if (lit_len >= 15)
+      op = emit_len(op, lit_len - 15);
+
+   memcpy(op, lit, lit_len);
+   op += lit_len;
+
+   if (!match_len)
+      return op;     /* last sequence: literals only */
+
+   *op++ = (u8)offset;
+   *op++ = (u8)(offset >> 8);
+
+   if (ml >= 15)
+      op = emit_len(op, ml - 15);
+
+   return op;
+}
+
+/*
+ * Compresses in[start, end) in `out`. Matches can refer to the previous
+ * blocks as well (linked blocks). Returns the compressed size.
+ */
+static u32 compress_block(u8 *in, u32 start, u32 end, u8 *out)
+{
+   u8 *op = out;
+   u32 anchor = start;
+   u32 ip = start;
+
+   if (end - start >= MF_LIMIT + 1) {
+
+      const u32 mflimit = end - MF_LIMIT;
+      const u32 matchlimit = end - LAST_LITERALS;
+
+      while (ip < mflimit) {
+
+         const u32 h = hash_pos(ip);
+         const u32 ref = hash_table[h];
+         u32 len;
+
+         hash_table[h] = ip + 1;
+
+         if (!ref || ip - (ref - 1) > MAX_OFFSET ||
+             rd32(in + ref - 1) != rd32(in + ip))
+         {
+            ip++;
+            continue;
+         }
+
+         for (len = MIN_MATCH; ip + len < matchlimit; len++)
+            if (in[ref - 1 + len] != in[ip + len])
+               break;
+
+         op = emit_sequence(op, in + anchor, ip - anchor, ip - (ref-1), len);
+         ip += len;
+         anchor = ip;
+      }
+   }
+
+   op = emit_sequence(op, in + anchor, end - anchor, 0, 0);
+   return (u32)(op - out);
+}
+
+static u8 *read_file(const char *path, size_t *size_ref)
+{
+   FILE *fh;
+   u8 *buf;
+   long size;
+
+   if (!(fh = fopen(path, "rb"))) {
+      fprintf(stderr, "ERROR: cannot open '%s': %s\n", path, strerror(errno));
+      return NULL;
+   }
+
+   fseek(fh, 0, SEEK_END);
+   size = ftell(fh);
+   fseek(fh, 0, SEEK_SET);
+
+   if (size < 0 || !(buf = malloc((size_t)size + 1))) {
+      fprintf(stderr, "ERROR: cannot read '%s'\n", path);
+      fclose(fh);
+      return NULL;
+   }
+
+   if (fread(buf, 1, (size_t)size, fh) != (size_t)size) {
+      fprintf(stderr, "ERROR: cannot read '%s'\n", path);
+      fclose(fh);
+      free(buf);
+      return NULL;
+   }
+
+   fclose(fh);
+   *size_ref = (size_t)size;
+   return buf;
+}
+
+static size_t compress_frame(u8 *in, size_t in_size, u8 *out)
+{
+   u8 *op = out;
+   u64 content_size = in_size;
+
+   wr32(op, LZ4F_MAGIC);
+   op[4] = FLG_VERSION_01 | FLG_CONTENT_SIZE | FLG_CONTENT_CHECKSUM;
+   op[5] = BD_BLOCK_64K;
+   memcpy(op + 6, &content_size, 8);
+   op[14] = (u8)(xxh32(op + 4, 10) >> 8);
+   op += 15;
+
+   hash_in = in;
+
+   for (size_t off = 0; off < in_size; off += BLOCK_SIZE) {
+
+      const u32 end = (u32)MIN(off + BLOCK_SIZE, in_size);
+      const u32 raw_sz = end - (u32)off;
+      u32 csz = compress_block(in, (u32)off, end, op + 4);
+
+      if (csz >= raw_sz) {
+
+         /*
+          * Incompressible: store the block as it is. Note: compress_block()
+          * wrote at most raw_sz + raw_sz/255 + 16 bytes, which is fine as long
+          * as the output buffer has enough slack (see main()).
+          */
+         memcpy(op + 4, in + off, raw_sz);
+         wr32(op, raw_sz | 0x80000000);
+         op += 4 + raw_sz;
+
+      } else {
+
+         wr32(op, csz);
+         op += 4 + csz;
+      }
+   }
+
+   wr32(op, 0);                        /* EndMark */
+   wr32(op + 4, xxh32(in, in_size));   /* Content checksum */
+   op += 8;
+
+   return (size_t)(op - out);
+}
+
+static bool verify(u8 *in, size_t in_size, u8 *frame, size_t frame_size)
+{
+   u8 *tmp = malloc(in_size + 1);
+   long rc;
+   bool ok;
+
+   if (!tmp)
+      return false;
+
+   rc = lz4f_decompress(frame, (u32)frame_size, tmp, (u32)in_size);
+   ok = rc == (long)in_size && !memcmp(tmp, in, in_size);
+   free(tmp);
+   return ok;
+}
+
+int main(int argc, char **argv)
+{
+   size_t in_size, out_size, out_cap;
+   u8 *in, *out;
+   FILE *fh;
+
+   if (argc != 3) {
+      fprintf(stderr, "Syntax: %s <input file> <output file>\n", argv[0]);
+      return 1;
+   }
+
+   if (!(in = read_file(argv[1], &in_size)))
+      return 1;
+
+   if (in_size >= 0xffffffff) {
+      fprintf(stderr, "ERROR: input file too big\n");
+      return 1;
+   }
+
+   out_cap = LZ4F_MAX_HEADER_SIZE + 8 + in_size + in_size / 255 +
+             (in_size / BLOCK_SIZE + 1) * (LZ4F_MAX_BLOCK_OVERHEAD + 16);
+
+   if (!(out = malloc(out_cap))) {
+      fprintf(stderr, "ERROR: out of memory\n");
+      return 1;
+   }
+
+   out_size = compress_frame(in, in_size, out);
+
+   if (!verify(in, in_size, out, out_size)) {
+      fprintf(stderr, "ERROR: verification failed\n");
+      return 1;
+   }
+
+   if (!(fh = fopen(argv[2], "wb"))) {
+      fprintf(stderr, "ERROR: cannot open '%s': %s\n",
+              argv[2], strerror(errno));
+      return 1;
+   }
+
+   if (fwrite(out, 1, out_size, fh) != out_size) {
+      fprintf(stderr, "ERROR: cannot write '%s'\n", argv[2]);
+      fclose(fh);
+      return 1;
+   }
+
+   fclose(fh);
+   printf("lz4pack: %zu -> %zu bytes (%.1f%%)\n",
+          in_size, out_size, in_size ? 100.0 * out_size / in_size : 0.0);
+
+   free(out);
+   free(in);
+   return 0;
+}
@@ -0,0 +1,134 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/self_tests.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+
+#define BULK_TEST_PAGES                                  16
+#define BULK_TEST_SIZE              (BULK_TEST_PAGES * PAGE_SIZE)
+#define BULK_TEST_GUARD                                0xaa
+
+static const size_t bulk_test_sizes[] = {
+   PAGE_SIZE,
+   PAGE_SIZE + 17,
+   3 * PAGE_SIZE + 32,
+   BULK_TEST_SIZE - 64,
+};
+
+/* 0 = aligned, 1 = unaligned (fallback), 32 = aligned for the SIMD funcs */
+static const size_t bulk_test_offs[] = { 0, 1, 32 };
+
+static void
+bulk_check_guards(const struct bulk_mem_impl *impl, u8 *dst, size_t off,
+                  size_t sz)
+{
+   if (off && dst[off - 1] != BULK_TEST_GUARD)
+      panic("bulk_mem[%s]: wrote before dest (sz: %zu)", impl->name, sz);
+
+   if (dst[off + sz] != BULK_TEST_GUARD)
+      panic("bulk_mem[%s]: wrote after dest (sz: %zu)", impl->name, sz);
+}
+
+static void
+bulk_check_impl(const struct bulk_mem_impl *impl, u8 *src, u8 *dst)
+{
+   for (u32 i = 0; i < ARRAY_SIZE(bulk_test_sizes); i++) {
+      for (u32 j = 0; j < ARRAY_SIZE(bulk_test_offs); j++) {
+
+         const size_t sz = bulk_test_sizes[i];
+         const size_t off = bulk_test_offs[j];
+
+         memset(dst, BULK_TEST_GUARD, BULK_TEST_SIZE);
+         impl->cpy(dst + off, src + off, sz);
+
+         if (memcmp(dst + off, src + off, sz))
+            panic("bulk_mem[%s]: wrong copy (sz: %zu, off: %zu)",
+                  impl->name, sz, off);
+
+         bulk_check_guards(impl, dst, off, sz);
+         memset(dst, BULK_TEST_GUARD, BULK_TEST_SIZE);
+         impl->zero(dst + off, sz);
+
+         for (size_t k = 0; k < sz; k++) {
+            if (dst[off + k])
+               panic("bulk_mem[%s]: wrong bzero (sz: %zu, off: %zu)",
+                     impl->name, sz, off);
+         }
+
+         bulk_check_guards(impl, dst, off, sz);
+      }
+   }
+}
+
+static void
+bulk_perf_impl(const struct bulk_mem_impl *impl, u8 *src, u8 *dst)
+{
+   const int iters = 256;
+   u64 start, cpy_cycles, zero_cycles;
+
+   start = RDTSC();
+
+   for (int i = 0; i < iters; i++)
+      for (u32 p = 0; p < BULK_TEST_PAGES; p++)
+         impl->cpy(dst + p * PAGE_SIZE, src + p * PAGE_SIZE, PAGE_SIZE);
+
+   cpy_cycles = (RDTSC() - start) / (iters * BULK_TEST_PAGES);
+   start = RDTSC();
+
+   for (int i = 0; i < iters; i++)
+      for (u32 p = 0; p < BULK_TEST_PAGES; p++)
+         impl->zero(dst + p * PAGE_SIZE, PAGE_SIZE);
+
+   zero_cycles = (RDTSC() - start) / (iters * BULK_TEST_PAGES);
+
+   printk(NO_PREFIX "%-10s cycles per page: memcpy: %6" PRIu64
+          ", bzero: %6" PRIu64 "\n", impl->name, cpy_cycles, zero_cycles);
+}
+
+void selftest_bulk_mem(void)
+{
+   u8 *src = kmalloc(BULK_TEST_SIZE);
+   u8 *dst = kmalloc(BULK_TEST_SIZE);
+
+   if (!src || !dst)
+      panic("No enough memory for the bulk_mem test buffers");
+
+   for (u32 i = 0; i < BULK_TEST_SIZE; i++)
+      src[i] = (u8)(i * 7 + 3);
+
+   printk("bulk memcpy/bzero in use: %s\n", get_bulk_mem_impl_name());
+
+   for (u32 i = 0; i < bulk_mem_impls_count; i++) {
+
+      const struct bulk_mem_impl *impl = &bulk_mem_impls[i];
+
+      if (se_is_stop_requested())
+         break;
+
+      if (!impl->is_supported()) {
+         printk(NO_PREFIX "%-10s not supported\n", impl->name);
+         continue;
+      }
+
+      bulk_check_impl(impl, src, dst);
+      bulk_perf_impl(impl, src, dst);
+   }
+
+   kfree2(dst, BULK_TEST_SIZE);
+   kfree2(src, BULK_TEST_SIZE);
+
+   if (se_is_stop_requested())
+      se_interrupted_end();
+   else
+      se_regular_end();
+}
+
+REGISTER_SELF_TEST(bulk_mem, se_short, &selftest_bulk_mem)
+
+#endif
@@ -428,3 +428,111 @@ end:
 }
 
 REGISTER_SELF_TEST(kmutex_ord, se_med, &selftest_kmutex_ord)
+
+/* -------------------------------------------------- */
+/*             Priority inheritance test              */
+/* -------------------------------------------------- */
+
+/*
+ * Classic priority inversion: a fair task (L) holds a PI mutex needed by a RT
+ * task (H), while a RT task with a lower priority (M) is spinning. Without
+ * priority inheritance, M would starve L and, therefore, block H for its whole
+ * run. With it, L runs at H's priority until it unlocks the mutex: H waits
+ * only for L's critical section.
+ */
+
+#define PI_L_WORK_TICKS                       (KRN_TIMER_HZ / 20 + 1)
+#define PI_M_SPIN_TICKS                       (KRN_TIMER_HZ / 2)
+
+static struct kmutex pi_mutex;
+static volatile bool pi_l_locked;
+static volatile bool pi_l_boosted;
+static volatile u64 pi_h_wait_ticks;
+
+static u64 pi_get_curr_task_ticks(void)
+{
+   return *(volatile u64 *)&get_curr_task()->ticks.total;
+}
+
+static void kmutex_pi_low(void *unused)
+{
+   u64 start;
+
+   kmutex_lock(&pi_mutex);
+   {
+      pi_l_locked = true;
+      start = pi_get_curr_task_ticks();
+
+      /* Burn CPU time while holding the lock */
+      while (pi_get_curr_task_ticks() - start < PI_L_WORK_TICKS) {
+         if (get_curr_task()->pi_prio)
+            pi_l_boosted = true;
+      }
+   }
+   kmutex_unlock(&pi_mutex);
+
+   /* The boost must end with the unlock */
+   VERIFY(get_curr_task()->pi_prio == 0);
+}
+
+static void kmutex_pi_med(void *unused)
+{
+   const u64 end = get_ticks() + PI_M_SPIN_TICKS;
+   while (get_ticks() < end) { }
+}
+
+static void kmutex_pi_high(void *unused)
+{
+   const u64 start = get_ticks();
+
+   kmutex_lock(&pi_mutex);
+   {
+      pi_h_wait_ticks = get_ticks() - start;
+   }
+   kmutex_unlock(&pi_mutex);
+}
+
+static int kmutex_pi_create_rt_thread(kthread_func_ptr func, int rt_prio)
+{
+   int tid = kthread_create2(func, "kmutex_pi_rt", 0, NULL);
+   VERIFY(tid > 0);
+   sched_set_task_attr(get_task(tid), SCHED_FIFO, 0, rt_prio);
+   return tid;
+}
+
+void selftest_kmutex_pi()
+{
+   int local_tids[3];
+
+   pi_l_locked = false;
+   pi_l_boosted = false;
+   pi_h_wait_ticks = 0;
+   kmutex_init(&pi_mutex, KMUTEX_FL_PI);
+
+   local_tids[0] = kthread_create(kmutex_pi_low, 0, NULL);
+   VERIFY(local_tids[0] > 0);
+
+   while (!pi_l_locked)
+      kernel_yield();
+
+   disable_preemption();
+   {
+      local_tids[1] = kmutex_pi_create_rt_thread(kmutex_pi_med, 10);
+      local_tids[2] = kmutex_pi_create_rt_thread(kmutex_pi_high, 20);
+   }
+   enable_preemption();
+
+   kthread_join_all(local_tids, ARRAY_SIZE(local_tids), true);
+   kmutex_destroy(&pi_mutex);
+
+   printk("[se_kmutex] PI: high prio task waited %" PRIu64 " ticks "
+          "(low prio critical section: %d ticks, med prio spin: %d ticks)\n",
+          pi_h_wait_ticks, PI_L_WORK_TICKS, PI_M_SPIN_TICKS);
+
+   /* The inversion must have been bounded by L's work, not by M's spin */
+   VERIFY(pi_l_boosted);
+   VERIFY(pi_h_wait_ticks < PI_M_SPIN_TICKS / 2);
+   se_regular_end();
+}
+
+REGISTER_SELF_TEST(kmutex_pi, se_short, &selftest_kmutex_pi)
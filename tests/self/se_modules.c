@@ -0,0 +1,180 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/self_tests.h>
+#include <tilck/kernel/test/modules.h>
+
+/*
+ * Fake modules initialized with do_init_modules(), like the real ones. Each
+ * init func sleeps, so that independent modules can overlap, and checks that
+ * all of its dependencies have already completed their init.
+ */
+
+#define SE_MOD_SLEEP_MS                                  50
+
+enum { SE_A, SE_B, SE_C, SE_D, SE_E, SE_F, SE_G, SE_MODS_COUNT };
+
+/* The expected deps of each fake module, as bitmasks of SE_* values */
+static const u32 se_mods_deps[SE_MODS_COUNT] = {
+   [SE_A] = 0,
+   [SE_B] = 0,
+   [SE_C] = (1 << SE_A),
+   [SE_D] = (1 << SE_A) | (1 << SE_B),
+   [SE_E] = (1 << SE_C) | (1 << SE_D),
+   [SE_F] = (1 << SE_F) - 1,        /* deps == NULL: all the fg ones before */
+   [SE_G] = (1 << SE_B),
+};
+
+static u32 se_mods_done;
+static u32 se_mods_running;
+static u32 se_mods_max_running;
+static struct module se_mods[SE_MODS_COUNT];
+
+static void se_mod_init(int i)
+{
+   disable_preemption();
+   {
+      if ((se_mods_done & se_mods_deps[i]) != se_mods_deps[i])
+         panic("[se_modules] %s started before its deps completed (0x%x)",
+               se_mods[i].name, se_mods_done);
+
+      se_mods_running++;
+      se_mods_max_running = MAX(se_mods_max_running, se_mods_running);
+   }
+   enable_preemption();
+
+   kernel_sleep_ms(SE_MOD_SLEEP_MS);
+
+   disable_preemption();
+   {
+      se_mods_running--;
+      se_mods_done |= (1u << i);
+   }
+   enable_preemption();
+}
+
+static void se_mod_init_a(void) { se_mod_init(SE_A); }
+static void se_mod_init_b(void) { se_mod_init(SE_B); }
+static void se_mod_init_c(void) { se_mod_init(SE_C); }
+static void se_mod_init_d(void) { se_mod_init(SE_D); }
+static void se_mod_init_e(void) { se_mod_init(SE_E); }
+static void se_mod_init_f(void) { se_mod_init(SE_F); }
+static void se_mod_init_g(void) { se_mod_init(SE_G); }
+
+static struct module se_mods[SE_MODS_COUNT] = {
+
+   [SE_A] = {
+      .name = "se_a",
+      .priority = 10,
+      .init = &se_mod_init_a,
+      .deps = MODULE_NO_DEPS,
+   },
+
+   [SE_B] = {
+      .name = "se_b",
+      .priority = 20,
+      .init = &se_mod_init_b,
+      .deps = MODULE_NO_DEPS,
+   },
+
+   [SE_C] = {
+      .name = "se_c",
+      .priority = 30,
+      .init = &se_mod_init_c,
+      .deps = MODULE_DEPS("se_a"),
+   },
+
+   [SE_D] = {
+      .name = "se_d",
+      .priority = 40,
+      .init = &se_mod_init_d,
+      .deps = MODULE_DEPS("se_a", "se_b"),
+   },
+
+   [SE_E] = {
+      .name = "se_e",
+      .priority = 50,
+      .init = &se_mod_init_e,
+      .deps = MODULE_DEPS("se_c", "se_d", "se_not_compiled_in"),
+   },
+
+   [SE_F] = {
+      .name = "se_f",
+      .priority = 60,
+      .init = &se_mod_init_f,
+      .deps = NULL,
+   },
+
+   /* Lower priority than se_f, but se_f doesn't wait for it */
+   [SE_G] = {
+      .name = "se_g",
+      .priority = 15,
+      .init = &se_mod_init_g,
+      .deps = MODULE_DEPS("se_b"),
+      .background = true,
+   },
+};
+
+void selftest_modules(void)
+{
+   struct module *mods[SE_MODS_COUNT];
+   int tids[MOD_INIT_THREADS - 1];
+   struct mod_init_ctx ctx;
+   u32 elapsed_ms;
+   int threads;
+   u64 start;
+
+   bzero(&ctx, sizeof(ctx));
+   kmutex_init(&ctx.mutex, 0);
+   kcond_init(&ctx.cond);
+
+   for (int i = 0; i < SE_MODS_COUNT; i++)
+      mods[i] = &se_mods[i];
+
+   ctx.mods = mods;
+   ctx.count = SE_MODS_COUNT;
+   se_mods_done = 0;
+   se_mods_running = 0;
+   se_mods_max_running = 0;
+
+   start = get_ticks();
+   threads = do_init_modules(&ctx, tids);
+
+   /* All the non-background modules must be done, when it returns */
+   VERIFY((se_mods_done | (1 << SE_G)) == (1u << SE_MODS_COUNT) - 1);
+
+   kthread_join_all(tids, (size_t)threads, true);
+   elapsed_ms = (u32)((get_ticks() - start) * 1000 / KRN_TIMER_HZ);
+
+   printk("[se_modules] %u modules initialized in %u ms by %d threads, "
+          "max %u at the same time\n",
+          SE_MODS_COUNT, elapsed_ms, threads + 1, se_mods_max_running);
+
+   VERIFY(se_mods_done == (1u << SE_MODS_COUNT) - 1);
+
+   /*
+    * se_a and se_b (and then se_c, se_d and se_g) don't depend on each other:
+    * they must have been initialized at the same time. Serially, the modules
+    * would take at least SE_MODS_COUNT * SE_MOD_SLEEP_MS.
+    */
+   if (threads > 0) {
+
+      if (se_mods_max_running < 2)
+         panic("[se_modules] independent modules didn't run in parallel");
+
+      if (elapsed_ms >= SE_MODS_COUNT * SE_MOD_SLEEP_MS)
+         panic("[se_modules] the init took %u ms: no parallelism",
+               elapsed_ms);
+   }
+
+   kcond_destroy(&ctx.cond);
+   kmutex_destroy(&ctx.mutex);
+   se_regular_end();
+}
+
+REGISTER_SELF_TEST(modules, se_short, &selftest_modules)
@@ -229,7 +229,7 @@ void selftest_rwlock_wp()
    int retry;
 
    readers_running = writers_running = 0;
-   rwlock_wp_init(&test_rwlwp, false);
+   rwlock_wp_init(&test_rwlwp, 0);
 
    printk("-------- sub-test: join readers and then writers -----------\n");
 
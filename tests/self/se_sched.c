@@ -0,0 +1,136 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/utils.h>
+
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/debug_utils.h>
+#include <tilck/kernel/self_tests.h>
+
+static volatile bool spin_stop;
+
+struct se_sched_rt_ctx {
+   int fair_tid;
+   u64 fair_ticks_before;
+   u64 fair_ticks_after;
+};
+
+static void se_sched_spin(void *unused)
+{
+   while (!spin_stop) { }
+}
+
+static u64 se_sched_get_total_ticks(int tid, u32 *weight)
+{
+   struct task *ti;
+   u64 total;
+
+   disable_preemption();
+   {
+      ti = get_task(tid);
+      VERIFY(ti != NULL);
+      total = ti->ticks.total;
+
+      if (weight)
+         *weight = sched_get_task_weight(ti);
+   }
+   enable_preemption();
+   return total;
+}
+
+static int
+se_sched_create_spin_thread(int policy, int nice, int rt_prio)
+{
+   int tid;
+
+   disable_preemption();
+   {
+      tid = kthread_create(se_sched_spin, 0, NULL);
+      VERIFY(tid > 0);
+      sched_set_task_attr(get_task(tid), policy, nice, rt_prio);
+   }
+   enable_preemption();
+   return tid;
+}
+
+void selftest_sched_fair(void)
+{
+   static const int nice_vals[] = { 0, 5 };
+   int tids[ARRAY_SIZE(nice_vals)];
+   u64 ticks[ARRAY_SIZE(nice_vals)];
+   u32 w[ARRAY_SIZE(nice_vals)];
+
+   spin_stop = false;
+
+   for (u32 i = 0; i < ARRAY_SIZE(nice_vals); i++)
+      tids[i] = se_sched_create_spin_thread(SCHED_NORMAL, nice_vals[i], 0);
+
+   kernel_sleep(2 * KRN_TIMER_HZ);
+
+   for (u32 i = 0; i < ARRAY_SIZE(nice_vals); i++)
+      ticks[i] = se_sched_get_total_ticks(tids[i], &w[i]);
+
+   spin_stop = true;
+   kthread_join_all(tids, ARRAY_SIZE(tids), true);
+
+   printk("[se_sched] ticks: nice 0 -> %" PRIu64 ", nice 5 -> %" PRIu64
+          " (weights: %u, %u)\n", ticks[0], ticks[1], w[0], w[1]);
+
+   /*
+    * The CPU time has to be split according to the weights: allow an error
+    * of ~1/3 because the scheduler's granularity is the timeslice.
+    */
+   VERIFY(ticks[1] > 0);
+   VERIFY(ticks[0] * w[1] * 3 >= ticks[1] * w[0] * 2);
+   VERIFY(ticks[0] * w[1] * 3 <= ticks[1] * w[0] * 4);
+   se_regular_end();
+}
+
+REGISTER_SELF_TEST(sched_fair, se_short, &selftest_sched_fair)
+
+static void se_sched_rt_thread(void *arg)
+{
+   struct se_sched_rt_ctx *ctx = arg;
+   const u64 end = get_ticks() + KRN_TIMER_HZ / 4;
+
+   ctx->fair_ticks_before = se_sched_get_total_ticks(ctx->fair_tid, NULL);
+
+   while (get_ticks() < end) { }
+
+   ctx->fair_ticks_after = se_sched_get_total_ticks(ctx->fair_tid, NULL);
+}
+
+void selftest_sched_rt(void)
+{
+   struct se_sched_rt_ctx ctx = {0};
+   int rt_tid;
+
+   spin_stop = false;
+   ctx.fair_tid = se_sched_create_spin_thread(SCHED_NORMAL, 0, 0);
+   kernel_sleep(KRN_TIMER_HZ / 10);
+
+   disable_preemption();
+   {
+      rt_tid = kthread_create(se_sched_rt_thread, 0, &ctx);
+      VERIFY(rt_tid > 0);
+      sched_set_task_attr(get_task(rt_tid), SCHED_FIFO, 0, 10);
+   }
+   enable_preemption();
+
+   kthread_join(rt_tid, true);
+
+   spin_stop = true;
+   kthread_join(ctx.fair_tid, true);
+
+   printk("[se_sched] fair task ticks while a RT task was spinning: %" PRIu64
+          "\n", ctx.fair_ticks_after - ctx.fair_ticks_before);
+
+   /* The fair task must not have run at all while the RT one was runnable */
+   VERIFY(ctx.fair_ticks_before > 0);
+   VERIFY(ctx.fair_ticks_after == ctx.fair_ticks_before);
+   se_regular_end();
+}
+
+REGISTER_SELF_TEST(sched_rt, se_short, &selftest_sched_rt)
@@ -8,11 +8,13 @@
 #include <tilck/kernel/worker_thread.h>
 #include <tilck/kernel/sync.h>
 #include <tilck/kernel/sched.h>
+#include <tilck/kernel/timer.h>
 #include <tilck/kernel/debug_utils.h>
 #include <tilck/kernel/self_tests.h>
 
 static ATOMIC(u32) g_counter;
 static u64 g_cycles_begin;
+static u64 g_delayed_job_ticks;
 
 struct se_wth_ctx {
    struct worker_thread *wth;
@@ -253,3 +255,99 @@ void selftest_wth_perf(void)
 }
 
 REGISTER_SELF_TEST(wth_perf, se_short, &selftest_wth_perf)
+
+static void test_wth_delayed_func(void *arg)
+{
+   g_delayed_job_ticks = get_ticks();
+   g_counter++;
+}
+
+static struct worker_thread *g_pool_workers[WTH_MAX_THREADS];
+static u32 g_pool_workers_cnt;
+
+/* Like test_wth_func2(), but it also records which worker ran it */
+static void test_wth_pool_func(void *arg)
+{
+   struct worker_thread *wth = get_curr_task()->worker_thread;
+   u32 i;
+
+   disable_preemption();
+   {
+      for (i = 0; i < g_pool_workers_cnt; i++)
+         if (g_pool_workers[i] == wth)
+            break;
+
+      if (i == g_pool_workers_cnt && i < ARRAY_SIZE(g_pool_workers))
+         g_pool_workers[g_pool_workers_cnt++] = wth;
+   }
+   enable_preemption();
+
+   g_counter++;
+   kernel_sleep_ms(50);
+}
+
+static void se_wth_wait_counter(u32 val)
+{
+   for (int i = 0; g_counter < val; i++) {
+
+      if (i == 3 * KRN_TIMER_HZ)
+         panic("[se_wth] counter (%u) != %u after 3s", g_counter, val);
+
+      kernel_sleep(1);
+   }
+}
+
+void selftest_wth_pool(void)
+{
+   const u32 delay = KRN_TIMER_HZ / 10;
+   const u32 n = 2 * WTH_POOL_MAX_THREADS;
+   u32 elapsed_ms;
+   u64 start;
+
+   printk("[se_wth] enqueue a job delayed by %u ticks\n", delay);
+   g_counter = 0;
+   start = get_ticks();
+
+   if (!wth_enqueue_delayed(WTH_PRIO_LOWEST, delay, &test_wth_delayed_func, 0))
+      panic("[se_wth] wth_enqueue_delayed() failed");
+
+   kernel_sleep(delay / 2);
+   VERIFY(g_counter == 0);
+
+   se_wth_wait_counter(1);
+   printk("[se_wth] the job ran after %u ticks\n",
+          (u32)(g_delayed_job_ticks - start));
+   VERIFY(g_delayed_job_ticks - start >= delay);
+
+   printk("[se_wth] enqueue %u sleeping jobs anywhere\n", n);
+   g_counter = 0;
+   g_pool_workers_cnt = 0;
+   start = get_ticks();
+
+   for (u32 i = 0; i < n; i++) {
+      while (!wth_enqueue_anywhere(WTH_PRIO_LOWEST, &test_wth_pool_func, NULL))
+         kernel_yield();
+   }
+
+   se_wth_wait_counter(n);
+   elapsed_ms = (u32)((get_ticks() - start) * 1000 / KRN_TIMER_HZ);
+
+   printk("[se_wth] all the jobs completed in %u ms by %u workers\n",
+          elapsed_ms, g_pool_workers_cnt);
+
+   /*
+    * The jobs block, so the pool must have grown (or jobs must have been
+    * stolen by the idle workers). 50 ms each: with a single worker, they'd
+    * take at least n * 50 ms.
+    */
+   if (g_pool_workers_cnt < 2)
+      panic("[se_wth] all the %u jobs ran on the same worker", n);
+
+   if (elapsed_ms >= n * 50)
+      panic("[se_wth] the jobs took %u ms: they did not run in parallel",
+            elapsed_ms);
+
+   se_regular_end();
+}
+
+REGISTER_SELF_TEST(wth_pool, se_short, &selftest_wth_pool)
@@ -29,6 +29,9 @@ CMD_ENTRY(fpu,          TT_SHORT,  true)
 CMD_ENTRY(brk,          TT_SHORT,  true)
 CMD_ENTRY(mmap,         TT_MED,    true)
 CMD_ENTRY(mmap2,        TT_SHORT,  true)
+CMD_ENTRY(mprotect,     TT_SHORT,  true)
+CMD_ENTRY(mmap_fixed,   TT_SHORT,  true)
+CMD_ENTRY(mremap,       TT_SHORT,  true)
 CMD_ENTRY(kcow,         TT_SHORT,  true)
 CMD_ENTRY(wpid1,        TT_SHORT,  true)
 CMD_ENTRY(wpid2,        TT_SHORT,  true)
@@ -45,6 +48,7 @@ CMD_ENTRY(sigabrt,      TT_SHORT,  true)
 CMD_ENTRY(sig_ignore,   TT_SHORT,  true)
 CMD_ENTRY(bigargv,      TT_SHORT,  true)
 CMD_ENTRY(cloexec,      TT_SHORT,  true)
+CMD_ENTRY(fdtable,      TT_SHORT,  true)
 CMD_ENTRY(fs1,          TT_SHORT,  true)
 CMD_ENTRY(fs2,          TT_SHORT,  true)
 CMD_ENTRY(fs3,          TT_SHORT,  true)
@@ -54,6 +58,8 @@ CMD_ENTRY(fs6,          TT_SHORT,  true)
 CMD_ENTRY(fs7,          TT_SHORT,  true)
 CMD_ENTRY(fs_perf1,     TT_SHORT,  true)
 CMD_ENTRY(fs_perf2,     TT_SHORT,  true)
+CMD_ENTRY(fs_perf3,     TT_SHORT,  true)
+CMD_ENTRY(fs_perf4,     TT_SHORT,  true)
 CMD_ENTRY(fmmap1,       TT_SHORT,  true)
 CMD_ENTRY(fmmap2,       TT_SHORT,  true)
 CMD_ENTRY(fmmap3,       TT_SHORT,  true)
@@ -81,6 +87,7 @@ CMD_ENTRY(execve0,      TT_SHORT,  true)
 CMD_ENTRY(vfork0,       TT_SHORT,  true)
 CMD_ENTRY(extra,        TT_MED,    true)
 CMD_ENTRY(fatmm1,       TT_SHORT,  true)
+CMD_ENTRY(fatrw1,       TT_SHORT,  true)
 CMD_ENTRY(sigmask,      TT_SHORT,  true)
 CMD_ENTRY(sig1,         TT_SHORT,  true)
 CMD_ENTRY(sig2,         TT_SHORT,  true)
@@ -102,6 +109,11 @@ CMD_ENTRY(sigsegv5,     TT_SHORT,  true)
 CMD_ENTRY(getuids,      TT_SHORT,  true)
 CMD_ENTRY(getrusage,    TT_SHORT,  true)
 CMD_ENTRY(exit_cb,      TT_SHORT,  true)
+CMD_ENTRY(boottime,     TT_SHORT,  MOD_sysfs)
 CMD_ENTRY(dev_null,     TT_SHORT,  MOD_null)
 CMD_ENTRY(dev_zero,     TT_SHORT,  MOD_null)
 CMD_ENTRY(dev_full,     TT_SHORT,  MOD_null)
+CMD_ENTRY(dev_kmsg,     TT_SHORT,  true)
+CMD_ENTRY(dp_stats,     TT_SHORT,  MOD_debugpanel && MOD_sysfs)
+CMD_ENTRY(blkdev1,      TT_SHORT,  MOD_ata)
+CMD_ENTRY(tty_out1,     TT_SHORT,  true)
@@ -0,0 +1,140 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <linux/fs.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+/*
+ * The test runner attaches a copy-on-write snapshot of the fatpart image as
+ * the second IDE disk (see tests/runners/single_test_run): we can freely write
+ * on it. Reading more than the buffer cache (1 MB, by default) from the disk
+ * makes the pages we wrote get evicted, so that the read-back really comes
+ * from the disk.
+ */
+#define BLKDEV_TEST_DEV                  "/dev/hdb"
+#define BLKDEV_TEST_MNT             "/tmp/blkdev1_mnt"
+#define BLKDEV_EVICT_SIZE          (4 * 1024 * 1024)
+
+static int blkdev_cmp_files(const char *p1, const char *p2)
+{
+   static char buf1[4096], buf2[4096];
+   int fd1, fd2, rc1, rc2;
+   int res = -1;
+
+   fd1 = open(p1, O_RDONLY);
+   fd2 = open(p2, O_RDONLY);
+
+   if (fd1 < 0 || fd2 < 0)
+      goto out;
+
+   do {
+
+      rc1 = read(fd1, buf1, sizeof(buf1));
+      rc2 = read(fd2, buf2, sizeof(buf2));
+
+      if (rc1 != rc2 || rc1 < 0 || memcmp(buf1, buf2, rc1))
+         goto out;
+
+   } while (rc1 > 0);
+
+   res = 0;
+
+out:
+   if (fd1 >= 0)
+      close(fd1);
+
+   if (fd2 >= 0)
+      close(fd2);
+
+   return res;
+}
+
+int cmd_blkdev1(int argc, char **argv)
+{
+   static char buf[4096];
+   char orig[512], data[512];
+   unsigned long long size, off, evict;
+   int fd, rc, ssz;
+
+   if (!running_on_tilck()) {
+      not_on_tilck_message();
+      return 0;
+   }
+
+   fd = open(BLKDEV_TEST_DEV, O_RDWR);
+
+   if (fd < 0 && errno == ENOENT) {
+      printf(PFX "[SKIP] because there's no %s\n", BLKDEV_TEST_DEV);
+      return 0;
+   }
+
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   rc = ioctl(fd, BLKGETSIZE64, &size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   rc = ioctl(fd, BLKSSZGET, &ssz);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(ssz == sizeof(orig));
+   DEVSHELL_CMD_ASSERT(size >= 2 * sizeof(buf));
+   printf("- %s: %llu bytes\n", BLKDEV_TEST_DEV, size);
+
+   printf("- Write a pattern on the last sector\n");
+   off = size - sizeof(orig);
+   rc = pread(fd, orig, sizeof(orig), off);
+   DEVSHELL_CMD_ASSERT(rc == sizeof(orig));
+
+   for (size_t i = 0; i < sizeof(data); i++)
+      data[i] = (char)(orig[i] ^ (i * 13 + 5));
+
+   rc = pwrite(fd, data, sizeof(data), off);
+   DEVSHELL_CMD_ASSERT(rc == sizeof(data));
+   rc = fsync(fd);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("- Evict it from the buffer cache\n");
+   evict = size - sizeof(buf);
+
+   if (evict > BLKDEV_EVICT_SIZE)
+      evict = BLKDEV_EVICT_SIZE;
+
+   for (unsigned long long o = 0; o < evict; o += sizeof(buf)) {
+      rc = pread(fd, buf, sizeof(buf), o);
+      DEVSHELL_CMD_ASSERT(rc == sizeof(buf));
+   }
+
+   printf("- Read it back and restore it\n");
+   memset(buf, 0, sizeof(orig));
+   rc = pread(fd, buf, sizeof(orig), off);
+   DEVSHELL_CMD_ASSERT(rc == sizeof(orig));
+   DEVSHELL_CMD_ASSERT(!memcmp(buf, data, sizeof(data)));
+
+   rc = pwrite(fd, orig, sizeof(orig), off);
+   DEVSHELL_CMD_ASSERT(rc == sizeof(orig));
+   rc = ioctl(fd, BLKFLSBUF, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   close(fd);
+
+   printf("- Mount it in read-only mode and compare a file with the initrd\n");
+   rc = mkdir(BLKDEV_TEST_MNT, 0755);
+   DEVSHELL_CMD_ASSERT(rc == 0 || errno == EEXIST);
+
+   rc = mount(BLKDEV_TEST_DEV, BLKDEV_TEST_MNT, "vfat", MS_RDONLY, NULL);
+
+   /* There's no umount(): a previous run might have mounted it already */
+   DEVSHELL_CMD_ASSERT(rc == 0 || errno == EBUSY);
+
+   rc = blkdev_cmp_files(DEVSHELL_PATH, BLKDEV_TEST_MNT "/usr/bin/devshell");
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
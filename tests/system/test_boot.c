@@ -0,0 +1,137 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+#define TIMELINE_FILE               "/syst/boot/timeline"
+#define MAX_EVENTS                                    128
+
+struct boot_event {
+   u64 start_us;
+   u64 dur_us;
+   u64 cycles;
+   char kind[8];
+   char name[48];
+};
+
+static struct boot_event events[MAX_EVENTS];
+
+static int cmp_by_dur_desc(const void *a, const void *b)
+{
+   const struct boot_event *ea = a;
+   const struct boot_event *eb = b;
+
+   if (ea->cycles != eb->cycles)
+      return ea->cycles < eb->cycles ? 1 : -1;
+
+   return 0;
+}
+
+static int read_timeline(FILE *fh, u64 *cycles_per_ms)
+{
+   char line[128];
+   int n = 0;
+
+   while (fgets(line, sizeof(line), fh) && n < MAX_EVENTS) {
+
+      struct boot_event *e = &events[n];
+
+      if (line[0] == '#') {
+         sscanf(line, "# cycles_per_ms: %" SCNu64, cycles_per_ms);
+         continue;
+      }
+
+      if (sscanf(line, "%" SCNu64 " %" SCNu64 " %" SCNu64 " %7s %47s",
+                 &e->start_us, &e->dur_us, &e->cycles,
+                 e->kind, e->name) == 5)
+      {
+         n++;
+      }
+   }
+
+   return n;
+}
+
+/*
+ * Prints the boot phases recorded by the kernel (KRN_BOOT_TRACE), sorted by
+ * duration. As a system test, it also checks that the timeline makes sense.
+ */
+int cmd_boottime(int argc, char **argv)
+{
+   u64 cycles_per_ms = 0, end_us = 0, tot_cycles = 0;
+   u64 kind_us[3] = {0};
+   const char *kinds[3] = {"init", "async", "module"};
+   u64 last_init_start = 0;
+   FILE *fh;
+   int n;
+
+   if (!(fh = fopen(TIMELINE_FILE, "r"))) {
+
+      if (!running_on_tilck()) {
+         not_on_tilck_message();
+         return 0;
+      }
+
+      printf(PFX "No %s (KRN_BOOT_TRACE disabled?): skip\n", TIMELINE_FILE);
+      return 0;
+   }
+
+   n = read_timeline(fh, &cycles_per_ms);
+   fclose(fh);
+
+   DEVSHELL_CMD_ASSERT(n > 0);
+
+   for (int i = 0; i < n; i++) {
+
+      struct boot_event *e = &events[i];
+
+      if (!strcmp(e->kind, "mark"))
+         continue;
+
+      /* The synchronous init phases run one after the other, in order */
+      if (!strcmp(e->kind, "init")) {
+         DEVSHELL_CMD_ASSERT(e->start_us >= last_init_start);
+         last_init_start = e->start_us;
+      }
+
+      end_us = MAX(end_us, e->start_us + e->dur_us);
+      tot_cycles += e->cycles;
+
+      for (int k = 0; k < 3; k++)
+         if (!strcmp(e->kind, kinds[k]))
+            kind_us[k] += e->dur_us;
+   }
+
+   if (!cycles_per_ms) {
+      printf(PFX "Cycle counter not calibrated: durations in cycles only\n");
+   }
+
+   qsort(events, (size_t)n, sizeof(events[0]), cmp_by_dur_desc);
+
+   printf("\n%10s %10s %6s  %-7s %s\n",
+          "dur (us)", "start (us)", "%", "kind", "name");
+
+   for (int i = 0; i < n; i++) {
+
+      struct boot_event *e = &events[i];
+
+      printf("%10" PRIu64 " %10" PRIu64 " %5.1f%%  %-7s %s\n",
+             e->dur_us, e->start_us,
+             tot_cycles ? 100.0 * e->cycles / tot_cycles : 0.0,
+             e->kind, e->name);
+   }
+
+   printf("\n");
+
+   for (int k = 0; k < 3; k++)
+      printf("Total %-7s %10" PRIu64 " us\n", kinds[k], kind_us[k]);
+
+   printf("Boot, up to the end of the last phase: %" PRIu64 " us\n\n", end_us);
+   return 0;
+}
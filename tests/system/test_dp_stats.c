@@ -0,0 +1,86 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include <tilck/common/dp_abi.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+static struct dp_stats snap;
+
+/*
+ * Maps the debugpanel's statistics page and checks that the kernel refreshes
+ * it while it's mapped, with consistent (seqlock-protected) snapshots.
+ */
+int cmd_dp_stats(int argc, char **argv)
+{
+   const volatile struct dp_stats *s;
+   bool found = false;
+   u64 updates;
+   void *p;
+   u32 seq;
+   int fd, rc;
+
+   if ((fd = open(DP_STATS_PATH, O_RDONLY)) < 0) {
+
+      if (!running_on_tilck()) {
+         not_on_tilck_message();
+         return 0;
+      }
+
+      printf(PFX "No %s: skip\n", DP_STATS_PATH);
+      return 0;
+   }
+
+   /* read() works as well, and returns always fresh data */
+   rc = read(fd, &snap, sizeof(snap));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(snap));
+   DEVSHELL_CMD_ASSERT(!(snap.seq & 1));
+   DEVSHELL_CMD_ASSERT(snap.updates > 0);
+
+   p = mmap(NULL, DP_STATS_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+   DEVSHELL_CMD_ASSERT(p != MAP_FAILED);
+   close(fd);
+
+   s = p;
+   updates = s->updates;
+
+   /* The kernel refreshes the page only while it's mapped: wait for it */
+   for (int i = 0; i < 20 && s->updates == updates; i++)
+      usleep(100 * 1000);
+
+   DEVSHELL_CMD_ASSERT(s->updates > updates);
+
+   do {
+      seq = dp_stats_read_begin(s);
+      memcpy(&snap, (const void *)s, sizeof(snap));
+   } while (dp_stats_read_retry(s, seq));
+
+   DEVSHELL_CMD_ASSERT(!(seq & 1));
+   DEVSHELL_CMD_ASSERT(snap.timer_hz > 0);
+   DEVSHELL_CMD_ASSERT(snap.tasks_count > 0);
+   DEVSHELL_CMD_ASSERT(snap.tasks_count <= snap.tot_tasks);
+   DEVSHELL_CMD_ASSERT(snap.kmalloc_used > 0);
+
+   for (u32 i = 0; i < snap.tasks_count; i++) {
+      if (snap.tasks[i].info.tid == getpid()) {
+         found = true;
+         DEVSHELL_CMD_ASSERT(snap.tasks[i].ticks >= snap.tasks[i].kernel_ticks);
+      }
+   }
+
+   DEVSHELL_CMD_ASSERT(found || snap.tasks_count < snap.tot_tasks);
+
+   printf(PFX "updates: %llu, tasks: %u, kmalloc used: %llu KB\n",
+          (unsigned long long)snap.updates, snap.tot_tasks,
+          (unsigned long long)snap.kmalloc_used / KB);
+
+   rc = munmap(p, DP_STATS_SIZE);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
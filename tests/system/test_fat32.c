@@ -55,6 +55,13 @@ int cmd_fatmm1(int argc, char **argv)
                 mmap_off);
 
    if (vaddr == (void *)-1) {
+
+      if (errno == ENODEV) {
+         printf(PFX "[SKIP] because the initrd is mounted in r/w mode\n");
+         close(fd);
+         return 0;
+      }
+
       fprintf(stderr, "ERROR: mmap failed: %s\n", strerror(errno));
       goto err_end;
    }
@@ -101,3 +108,163 @@ err_end:
    close(fd);
    return 1;
 }
+
+static void fatrw_fill(char *buf, size_t len, unsigned seed)
+{
+   for (size_t i = 0; i < len; i++)
+      buf[i] = (char)(i * 7 + seed);
+}
+
+static int fatrw_count_entries(const char *dir_path, const char *prefix)
+{
+   struct dirent *de;
+   DIR *d;
+   int count = 0;
+
+   if (!(d = opendir(dir_path)))
+      return -1;
+
+   while ((de = readdir(d))) {
+      if (!strncmp(de->d_name, prefix, strlen(prefix)))
+         count++;
+   }
+
+   closedir(d);
+   return count;
+}
+
+/*
+ * Write test for FAT, running on the initrd. It requires Tilck to be booted
+ * with the -initrd_rw (-irw) option or built with KERNEL_INITRD_RW=1, like in
+ * the gcc_opt_features CI configuration.
+ */
+int cmd_fatrw1(int argc, char **argv)
+{
+   static char wbuf[20000], rbuf[20000], mbuf[1000];
+   const char *dir = "/initrd/tmp_fatrw1";
+   const char *file = "/initrd/tmp_fatrw1/a_long_file_name.data";
+   const char *hole_file = "/initrd/tmp_fatrw1/file_with_hole";
+   char path[128];
+   struct stat st;
+   int fd, rc, cnt;
+
+   if (!getenv("TILCK")) {
+      printf(PFX "[SKIP] because we're not running on Tilck\n");
+      return 0;
+   }
+
+   rc = mkdir(dir, 0755);
+
+   if (rc < 0 && errno == EROFS) {
+      printf(PFX "[SKIP] because the initrd is read-only (boot with -irw)\n");
+      return 0;
+   }
+
+   DEVSHELL_CMD_ASSERT(rc == 0 || errno == EEXIST);
+
+   printf("- Write a file spanning over multiple clusters\n");
+   fatrw_fill(wbuf, sizeof(wbuf), 3);
+   fd = open(file, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   rc = write(fd, wbuf, 1000);
+   DEVSHELL_CMD_ASSERT(rc == 1000);
+   rc = write(fd, wbuf + 1000, sizeof(wbuf) - 1000);
+   DEVSHELL_CMD_ASSERT(rc == sizeof(wbuf) - 1000);
+   close(fd);
+
+   rc = stat(file, &st);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(st.st_size == sizeof(wbuf));
+
+   printf("- Read it back\n");
+   fd = open(file, O_RDONLY);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+   rc = read(fd, rbuf, sizeof(rbuf));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(rbuf));
+   DEVSHELL_CMD_ASSERT(!memcmp(rbuf, wbuf, sizeof(wbuf)));
+
+   printf("- Overwrite its middle and append to it\n");
+   fatrw_fill(mbuf, sizeof(mbuf), 11);
+   rc = open(file, O_WRONLY);
+   DEVSHELL_CMD_ASSERT(rc > 0);
+   DEVSHELL_CMD_ASSERT(pwrite(rc, mbuf, sizeof(mbuf), 4000) == sizeof(mbuf));
+   close(rc);
+   memcpy(wbuf + 4000, mbuf, sizeof(mbuf));
+
+   rc = open(file, O_WRONLY | O_APPEND);
+   DEVSHELL_CMD_ASSERT(rc > 0);
+   DEVSHELL_CMD_ASSERT(write(rc, wbuf, 100) == 100);
+   close(rc);
+
+   rc = stat(file, &st);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(st.st_size == sizeof(wbuf) + 100);
+
+   rc = lseek(fd, 3000, SEEK_SET);
+   DEVSHELL_CMD_ASSERT(rc == 3000);
+   rc = read(fd, rbuf, sizeof(rbuf));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(wbuf) - 3000 + 100);
+   DEVSHELL_CMD_ASSERT(!memcmp(rbuf, wbuf + 3000, sizeof(wbuf) - 3000));
+   DEVSHELL_CMD_ASSERT(!memcmp(rbuf + sizeof(wbuf) - 3000, wbuf, 100));
+   close(fd);
+
+   printf("- Truncate it\n");
+   rc = truncate(file, 4000);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   rc = stat(file, &st);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(st.st_size == 4000);
+
+   fd = open(file, O_RDWR);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+   rc = ftruncate(fd, 6000);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   rc = read(fd, rbuf, sizeof(rbuf));
+   DEVSHELL_CMD_ASSERT(rc == 6000);
+   DEVSHELL_CMD_ASSERT(!memcmp(rbuf, wbuf, 4000));
+
+   for (int i = 4000; i < 6000; i++)
+      DEVSHELL_CMD_ASSERT(rbuf[i] == 0);
+
+   rc = fsync(fd);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   close(fd);
+
+   printf("- Write past the end of a new file\n");
+   fd = open(hole_file, O_CREAT | O_TRUNC | O_RDWR, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+   rc = lseek(fd, 10000, SEEK_SET);
+   DEVSHELL_CMD_ASSERT(rc == 10000);
+   rc = write(fd, "end", 3);
+   DEVSHELL_CMD_ASSERT(rc == 3);
+   rc = lseek(fd, 0, SEEK_SET);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   rc = read(fd, rbuf, sizeof(rbuf));
+   DEVSHELL_CMD_ASSERT(rc == 10003);
+   DEVSHELL_CMD_ASSERT(!memcmp(rbuf + 10000, "end", 3));
+
+   for (int i = 0; i < 10000; i++)
+      DEVSHELL_CMD_ASSERT(rbuf[i] == 0);
+
+   close(fd);
+
+   printf("- Create many files with long names\n");
+
+   for (int i = 0; i < 40; i++) {
+      sprintf(path, "%s/this is a quite long name %02d.txt", dir, i);
+      fd = open(path, O_CREAT | O_WRONLY, 0644);
+      DEVSHELL_CMD_ASSERT(fd > 0);
+      close(fd);
+   }
+
+   cnt = fatrw_count_entries(dir, "this is a quite long name");
+   DEVSHELL_CMD_ASSERT(cnt == 40);
+
+   rc = open(path, O_CREAT | O_EXCL | O_WRONLY, 0644);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EEXIST);
+
+   sync();
+   printf("DONE\n");
+   return 0;
+}
@@ -151,6 +151,33 @@ int cmd_fs2(int argc, char **argv)
    return 0;
 }
 
+/*
+ * Reads the whole directory `path` and stores in `order` the numbers of its
+ * "test_<n>" entries, in the order getdents() returns them. Returns how many
+ * entries it found.
+ */
+static int fs3_read_dir_order(const char *path, int *order, int max)
+{
+   struct dirent *de;
+   int cnt = 0;
+   DIR *d;
+
+   d = opendir(path);
+   DEVSHELL_CMD_ASSERT(d != NULL);
+
+   while ((de = readdir(d))) {
+
+      if (strncmp(de->d_name, "test_", 5))
+         continue;
+
+      DEVSHELL_CMD_ASSERT(cnt < max);
+      order[cnt++] = atoi(de->d_name + 5); /* skip "test_" */
+   }
+
+   closedir(d);
+   return cnt;
+}
+
 /*
  * Test a corner case for RAMFS: remove the next dentry while reading the
  * contents of a directory with getdents64().
@@ -159,7 +186,8 @@ int cmd_fs3(int argc, char **argv)
 {
    struct linux_dirent64 *de;
    char dentsbuf[192];
-   int fd, rc, off = 0;
+   int order[20];
+   int fd, rc, off = 0, cnt, pos, removed;
    DIR *d;
 
    if (!running_on_tilck()) {
@@ -173,6 +201,14 @@ int cmd_fs3(int argc, char **argv)
    for (int i = 0; i < 20; i++)
       create_test_file("/tmp/r", i);
 
+   /*
+    * Tilck's RAMFS returns the entries in the order of their hash, not in the
+    * creation one. That order doesn't change while we don't add entries, so
+    * read it first: that's how we know which entry comes next.
+    */
+   cnt = fs3_read_dir_order("/tmp/r", order, ARRAY_SIZE(order));
+   DEVSHELL_CMD_ASSERT(cnt == 20);
+
    d = opendir("/tmp/r");
    DEVSHELL_CMD_ASSERT(d != NULL);
 
@@ -190,17 +226,20 @@ int cmd_fs3(int argc, char **argv)
    int last_n = atoi(de->d_name + 5); /* skip "test_" */
    printf("last entry: '%s' (%d)\n", de->d_name, last_n);
 
-   /*
-    * The next elem, at least on Tilck's ramfs, will be "test_${last_n+1}"
-    * because the getdents64 keep the creation order. Remove that elem.
-    */
+   for (pos = 0; pos < cnt; pos++)
+      if (order[pos] == last_n)
+         break;
+
+   /* The buffer is too small to contain all the entries */
+   DEVSHELL_CMD_ASSERT(pos + 2 < cnt);
 
-   printf("Remove the next entry: test_%03d\n", last_n + 1);
-   remove_test_file_expecting_success("/tmp/r", last_n + 1);
+   removed = order[pos + 1];
+   printf("Remove the next entry: test_%03d\n", removed);
+   remove_test_file_expecting_success("/tmp/r", removed);
 
    /*
     * Now, if this special case has been handled correctly, we should continue
-    * from last_n + 2.
+    * from the entry after the removed one.
     */
 
    rc = getdents64(fd, (void *)dentsbuf, sizeof(dentsbuf));
@@ -208,25 +247,17 @@ int cmd_fs3(int argc, char **argv)
 
    printf("getdents64: %d\n", rc);
 
-   if (getenv("TILCK")) {
-
-      /*
-       * Tilck's RAMFS keep the creation order: that's why we can reason about
-       * which dentry will the next one. In general, that's not possible.
-       */
-
-      de = (void *) dentsbuf;
-      printf("Next entry: '%s'\n", de->d_name);
-      DEVSHELL_CMD_ASSERT(atoi(de->d_name + 5) == last_n + 2);
-      printf("The next dentry was last_n + 2 as expected\n");
-   }
+   de = (void *) dentsbuf;
+   printf("Next entry: '%s'\n", de->d_name);
+   DEVSHELL_CMD_ASSERT(atoi(de->d_name + 5) == order[pos + 2]);
+   printf("The next dentry was test_%03d as expected\n", order[pos + 2]);
 
    rc = closedir(d);
    DEVSHELL_CMD_ASSERT(rc == 0);
 
    for (int i = 0; i < 20; i++) {
 
-      if (i != last_n+1) {
+      if (i != removed) {
 
          remove_test_file_expecting_success("/tmp/r", i);
 
@@ -14,6 +14,7 @@
 #include <sys/syscall.h>
 #include <sys/mman.h>
 #include <sys/time.h>
+#include <dirent.h>
 
 #include "devshell.h"
 #include "sysenter.h"
@@ -109,3 +110,215 @@ int cmd_fs_perf2(int argc, char **argv)
    DEVSHELL_CMD_ASSERT(rc == 0);
    return 0;
 }
+
+static u64 count_dir_entries(DIR *d)
+{
+   u64 n = 0;
+
+   while (readdir(d))
+      n++;
+
+   return n;
+}
+
+/*
+ * Reads up to `max` entries (all of them, if max < 0) from `d`, counting in
+ * seen[k] how many times "test_<k>" has been returned. Returns the number of
+ * entries read, including "." and "..".
+ */
+static int read_test_entries(DIR *d, unsigned char *seen, int n_seen, int max)
+{
+   struct dirent *de;
+   int cnt = 0, k;
+
+   for (; max < 0 || cnt < max; cnt++) {
+
+      if (!(de = readdir(d)))
+         break;
+
+      if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."))
+         continue;
+
+      DEVSHELL_CMD_ASSERT(!strncmp(de->d_name, "test_", 5));
+      k = atoi(de->d_name + 5);
+      DEVSHELL_CMD_ASSERT(k >= 0 && k < n_seen);
+
+      if (seen[k]++) {
+         fprintf(stderr, "Entry '%s' returned twice\n", de->d_name);
+         DEVSHELL_CMD_ASSERT(false);
+      }
+   }
+
+   return cnt;
+}
+
+/* Checks that each of the entries in [0, n) has been returned exactly once */
+static void check_no_missing_entries(unsigned char *seen, int n)
+{
+   for (int k = 0; k < n; k++) {
+      if (seen[k] != 1) {
+         fprintf(stderr, "Entry 'test_%03d' not returned\n", k);
+         DEVSHELL_CMD_ASSERT(false);
+      }
+   }
+}
+
+#define FS_PERF3_ENTRIES                                   5000
+
+/*
+ * Large directory: creat(), stat() (lookup) and unlink() cost must not depend
+ * on the number of entries. Also, entries added while reading the directory
+ * must not make readdir() skip any entry or return the same entry twice.
+ */
+int cmd_fs_perf3(int argc, char **argv)
+{
+   const int n = FS_PERF3_ENTRIES;
+   static unsigned char seen[FS_PERF3_ENTRIES + 100];
+   char path[256];
+   struct stat statbuf;
+   u64 start, end, elapsed, cnt;
+   const char *dest_dir = argc > 0 ? argv[0] : "/tmp/big";
+   DIR *d;
+   int rc;
+
+   printf("Using '%s' as test dir\n", dest_dir);
+
+   rc = mkdir(dest_dir, 0755);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   for (int k = 0; k < n; k += n / 5) {
+
+      start = RDTSC();
+
+      for (int i = k; i < k + n / 5; i++)
+         create_test_file(dest_dir, i);
+
+      end = RDTSC();
+      elapsed = (end - start) / (n / 5);
+      printf("Entries: %5d, avg. creat() cost: %6" PRIu64 " cycles\n",
+             k, elapsed);
+   }
+
+   start = RDTSC();
+
+   for (int i = 0; i < n; i++) {
+      sprintf(path, "%s/test_%03d", dest_dir, i);
+      rc = stat(path, &statbuf);
+      DEVSHELL_CMD_ASSERT(rc == 0);
+   }
+
+   end = RDTSC();
+   elapsed = (end - start) / n;
+   printf("Entries: %5d, avg. stat() cost:  %6" PRIu64 " cycles\n", n, elapsed);
+
+   d = opendir(dest_dir);
+   DEVSHELL_CMD_ASSERT(d != NULL);
+
+   start = RDTSC();
+   cnt = count_dir_entries(d);
+   end = RDTSC();
+   printf("Avg. readdir() cost: %6" PRIu64 " cycles\n", (end - start) / cnt);
+   DEVSHELL_CMD_ASSERT(cnt == (u64)n + 2);
+
+   rewinddir(d);
+   memset(seen, 0, sizeof(seen));
+   rc = read_test_entries(d, seen, n, -1);
+   DEVSHELL_CMD_ASSERT(rc == n + 2);
+   check_no_missing_entries(seen, n);
+
+   /* Read half of the dir, add entries and then read the rest of it */
+   rewinddir(d);
+   memset(seen, 0, sizeof(seen));
+   rc = read_test_entries(d, seen, n, n / 2);
+   DEVSHELL_CMD_ASSERT(rc == n / 2);
+
+   for (int i = n; i < n + 100; i++)
+      create_test_file(dest_dir, i);
+
+   cnt = (u64)n / 2 + (u64)read_test_entries(d, seen, n + 100, -1);
+   printf("Entries read with 100 inserts in the middle: %" PRIu64 "\n", cnt);
+   DEVSHELL_CMD_ASSERT(cnt >= (u64)n + 2 && cnt <= (u64)n + 102);
+
+   /* The new entries might be returned or not, but the old ones must be */
+   check_no_missing_entries(seen, n);
+
+   rc = closedir(d);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   start = RDTSC();
+
+   for (int i = 0; i < n + 100; i++)
+      remove_test_file_expecting_success(dest_dir, i);
+
+   end = RDTSC();
+   elapsed = (end - start) / (n + 100);
+   printf("Avg. unlink() cost: %6" PRIu64 " cycles\n", elapsed);
+
+   rc = rmdir(dest_dir);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
+
+static u32 read_file_with_buf(const char *path, size_t buf_sz, u64 *cycles)
+{
+   static char buf[64 * KB];
+   u32 sum = 0;
+   u64 start;
+   ssize_t rc;
+   int fd;
+
+   fd = open(path, O_RDONLY);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   start = RDTSC();
+
+   while ((rc = read(fd, buf, buf_sz)) > 0) {
+      for (ssize_t i = 0; i < rc; i++)
+         sum = sum * 31 + (u8)buf[i];
+   }
+
+   *cycles = RDTSC() - start;
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   close(fd);
+   return sum;
+}
+
+/*
+ * Sequential reads of a big file from the FAT initrd, with different buffer
+ * sizes: the data read must be the same and the cost per KB should decrease
+ * with bigger buffers, thanks to the read-ahead of the cluster chain.
+ */
+int cmd_fs_perf4(int argc, char **argv)
+{
+   static const size_t buf_sizes[] = { 512, 4 * KB, 16 * KB, 64 * KB };
+   const char *path = argc > 0 ? argv[0] : DEVSHELL_PATH;
+   struct stat statbuf;
+   u32 sum, ref_sum = 0;
+   u64 cycles;
+   int rc;
+
+   rc = stat(path, &statbuf);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   if (statbuf.st_size < KB) {
+      printf(PFX "[SKIP] because '%s' is too small\n", path);
+      return 0;
+   }
+
+   printf("Reading '%s' (%ld KB)\n", path, (long)statbuf.st_size / KB);
+
+   for (int i = 0; i < ARRAY_SIZE(buf_sizes); i++) {
+
+      sum = read_file_with_buf(path, buf_sizes[i], &cycles);
+
+      if (!i)
+         ref_sum = sum;
+
+      printf("buf: %5zu bytes, avg. cost per KB: %6" PRIu64 " cycles\n",
+             buf_sizes[i], cycles / (u64)(statbuf.st_size / KB));
+
+      DEVSHELL_CMD_ASSERT(sum == ref_sum);
+   }
+
+   return 0;
+}
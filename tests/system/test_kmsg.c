@@ -0,0 +1,60 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include "devshell.h"
+
+void cmd_dev_kmsg(int argc, char **argv)
+{
+   struct pollfd pfd;
+   char buf[1024];
+   off_t first, next;
+   int rc, fd;
+
+   fd = open("/dev/kmsg", O_RDONLY | O_NONBLOCK);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   /* The boot messages are there: we start from the oldest one */
+   rc = read(fd, buf, sizeof(buf) - 1);
+   DEVSHELL_CMD_ASSERT(rc > 0);
+   DEVSHELL_CMD_ASSERT(buf[rc - 1] == '\n');
+   buf[rc] = 0;
+   DEVSHELL_CMD_ASSERT(strchr(buf, ';') != NULL);
+   printf("First record: %s", buf);
+
+   /* A buffer too small for the record */
+   first = lseek(fd, 0, SEEK_SET);
+   DEVSHELL_CMD_ASSERT(first >= 0);
+   rc = read(fd, buf, 4);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   /* Seek by sequence number */
+   rc = read(fd, buf, sizeof(buf) - 1);
+   DEVSHELL_CMD_ASSERT(rc > 0);
+   DEVSHELL_CMD_ASSERT(lseek(fd, 0, SEEK_CUR) == first + 1);
+
+   /* At the end, there's nothing to read (unless the kernel logs more) */
+   next = lseek(fd, 0, SEEK_END);
+   DEVSHELL_CMD_ASSERT(next > first);
+
+   pfd = (struct pollfd) { .fd = fd, .events = POLLIN };
+   rc = poll(&pfd, 1, 0);
+   DEVSHELL_CMD_ASSERT(rc >= 0);
+
+   if (rc == 0) {
+      rc = read(fd, buf, sizeof(buf));
+      DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+   }
+
+   /* Going one record back makes the file readable again */
+   DEVSHELL_CMD_ASSERT(lseek(fd, -1, SEEK_END) >= next - 1);
+   rc = poll(&pfd, 1, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1 && (pfd.revents & POLLIN));
+
+   close(fd);
+}
@@ -14,10 +14,19 @@
 #include <sys/syscall.h>
 #include <sys/mman.h>
 #include <sys/time.h>
+#include <sys/resource.h>
 
 #include "devshell.h"
 #include "sysenter.h"
 
+#ifndef SYS_close_range
+   #define SYS_close_range          436
+#endif
+
+#ifndef CLOSE_RANGE_CLOEXEC
+   #define CLOSE_RANGE_CLOEXEC      (1U << 2)
+#endif
+
 bool running_on_tilck(void)
 {
    return getenv("TILCK") != NULL;
@@ -278,6 +287,71 @@ int cmd_cloexec(int argc, char **argv)
    return WEXITSTATUS(wstatus);
 }
 
+/* Test the growable fd table, close_range() and RLIMIT_NOFILE */
+int cmd_fdtable(int argc, char **argv)
+{
+   const int limit = 200;
+   struct rlimit saved, rl;
+   int rc, fd, last_fd = -1;
+   int pid, wstatus;
+
+   rc = getrlimit(RLIMIT_NOFILE, &saved);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(saved.rlim_cur <= saved.rlim_max);
+   DEVSHELL_CMD_ASSERT(saved.rlim_max >= (rlim_t)limit);
+
+   /* The soft limit cannot be above the hard one */
+   rl = (struct rlimit) { saved.rlim_max, saved.rlim_max - 1 };
+   rc = setrlimit(RLIMIT_NOFILE, &rl);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   rl = (struct rlimit) { limit, saved.rlim_max };
+   rc = setrlimit(RLIMIT_NOFILE, &rl);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   /* Fill the fd table, well beyond its initial size */
+   while ((fd = dup(0)) >= 0) {
+      DEVSHELL_CMD_ASSERT(fd > last_fd);
+      last_fd = fd;
+   }
+
+   DEVSHELL_CMD_ASSERT(errno == EMFILE);
+   DEVSHELL_CMD_ASSERT(last_fd == limit - 1);
+
+   rc = dup2(0, limit);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EBADF);
+
+   /* The fork()-ed child must get all the fds */
+   pid = fork();
+   DEVSHELL_CMD_ASSERT(pid >= 0);
+
+   if (!pid)
+      exit(fcntl(last_fd, F_GETFD) < 0 ? 1 : 0);
+
+   rc = waitpid(pid, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == pid);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+
+   rc = syscall(SYS_close_range, 10, 100, CLOSE_RANGE_CLOEXEC);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(fcntl(50, F_GETFD) & FD_CLOEXEC);
+   DEVSHELL_CMD_ASSERT(!(fcntl(101, F_GETFD) & FD_CLOEXEC));
+
+   rc = syscall(SYS_close_range, 3, ~0U, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = fcntl(last_fd, F_GETFD);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EBADF);
+
+   fd = dup(0);
+   DEVSHELL_CMD_ASSERT(fd == 3);
+   close(fd);
+
+   rc = setrlimit(RLIMIT_NOFILE, &saved);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
+
 /* Test scripts testing EXTRA components running on Tilck */
 
 static const char *extra_test_scripts[] = {
@@ -19,6 +19,14 @@
 #include "sysenter.h"
 #include "test_common.h"
 
+#ifndef MAP_FIXED_NOREPLACE
+   #define MAP_FIXED_NOREPLACE      0x100000
+#endif
+
+#ifndef MREMAP_MAYMOVE
+   #define MREMAP_MAYMOVE           1
+#endif
+
 int cmd_brk(int argc, char **argv)
 {
    const size_t alloc_size = 1024 * 1024;
@@ -391,3 +399,192 @@ int cmd_fork_oom(int argc, char **argv)
    free(buf);
    return rc;
 }
+
+static void mm_write_child(void *ptr)
+{
+   *(volatile char *)ptr = 'x';
+}
+
+static void mm_read_child(void *ptr)
+{
+   printf(STR_CHILD "Read at %p: %#x\n", ptr, *(volatile char *)ptr);
+}
+
+static void *
+mremap_pages(void *old_addr, size_t old_len, size_t new_len, int flags)
+{
+   return (void *)syscall(SYS_mremap, old_addr, old_len, new_len, flags, NULL);
+}
+
+int cmd_mprotect(int argc, char **argv)
+{
+   const size_t page_size = getpagesize();
+   char *buf;
+   int rc;
+
+   buf = mmap(NULL,
+              4 * page_size,
+              PROT_READ | PROT_WRITE,
+              MAP_ANONYMOUS | MAP_PRIVATE,
+              -1,
+              0);
+
+   DEVSHELL_CMD_ASSERT(buf != (void *)-1);
+
+   for (size_t i = 0; i < 4; i++)
+      buf[i * page_size] = (char)('a' + i);
+
+   printf("Make the 2nd page read-only\n");
+   rc = mprotect(buf + page_size, page_size, PROT_READ);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(buf[page_size] == 'b');
+
+   if (test_sig(mm_read_child, buf + page_size, 0, 0, 0))
+      return 1;
+
+   if (test_sig(mm_write_child, buf + page_size, SIGSEGV, 0, 0))
+      return 1;
+
+   printf("Make the 3rd page inaccessible (PROT_NONE)\n");
+   rc = mprotect(buf + 2 * page_size, page_size, PROT_NONE);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   if (test_sig(mm_read_child, buf + 2 * page_size, SIGSEGV, 0, 0))
+      return 1;
+
+   printf("Check that the other pages are still writable\n");
+   if (test_sig(mm_write_child, buf, 0, 0, 0))
+      return 1;
+
+   if (test_sig(mm_write_child, buf + 3 * page_size, 0, 0, 0))
+      return 1;
+
+   printf("Restore PROT_READ | PROT_WRITE on the whole buffer\n");
+   rc = mprotect(buf, 4 * page_size, PROT_READ | PROT_WRITE);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   for (size_t i = 0; i < 4; i++) {
+      DEVSHELL_CMD_ASSERT(buf[i * page_size] == (char)('a' + i));
+      buf[i * page_size] = 'z';
+   }
+
+   rc = munmap(buf + 3 * page_size, page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("Check that mprotect() on unmapped memory fails with ENOMEM\n");
+   rc = mprotect(buf, 4 * page_size, PROT_READ);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == ENOMEM);
+
+   rc = munmap(buf, 3 * page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
+
+int cmd_mmap_fixed(int argc, char **argv)
+{
+   const size_t page_size = getpagesize();
+   char *buf, *res;
+   int rc;
+
+   buf = mmap(NULL,
+              4 * page_size,
+              PROT_READ | PROT_WRITE,
+              MAP_ANONYMOUS | MAP_PRIVATE,
+              -1,
+              0);
+
+   DEVSHELL_CMD_ASSERT(buf != (void *)-1);
+   memset(buf, 'a', 4 * page_size);
+
+   printf("Replace the 2nd page with MAP_FIXED\n");
+   res = mmap(buf + page_size,
+              page_size,
+              PROT_READ | PROT_WRITE,
+              MAP_ANONYMOUS | MAP_PRIVATE | MAP_FIXED,
+              -1,
+              0);
+
+   DEVSHELL_CMD_ASSERT(res == buf + page_size);
+   DEVSHELL_CMD_ASSERT(buf[0] == 'a');
+   DEVSHELL_CMD_ASSERT(buf[page_size] == 0);
+   DEVSHELL_CMD_ASSERT(buf[2 * page_size] == 'a');
+
+   printf("Check that MAP_FIXED_NOREPLACE does not replace anything\n");
+   res = mmap(buf + page_size,
+              page_size,
+              PROT_READ | PROT_WRITE,
+              MAP_ANONYMOUS | MAP_PRIVATE | MAP_FIXED_NOREPLACE,
+              -1,
+              0);
+
+   DEVSHELL_CMD_ASSERT(res == (void *)-1 && errno == EEXIST);
+
+   printf("Un-map the 3 mappings with a single munmap() call\n");
+   rc = munmap(buf, 4 * page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   res = mmap(buf + page_size,
+              page_size,
+              PROT_READ | PROT_WRITE,
+              MAP_ANONYMOUS | MAP_PRIVATE | MAP_FIXED_NOREPLACE,
+              -1,
+              0);
+
+   DEVSHELL_CMD_ASSERT(res == buf + page_size);
+   DEVSHELL_CMD_ASSERT(res[0] == 0);
+
+   rc = munmap(res, page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
+
+int cmd_mremap(int argc, char **argv)
+{
+   const size_t page_size = getpagesize();
+   char *buf, *res, *other;
+   int rc;
+
+   buf = mmap(NULL,
+              3 * page_size,
+              PROT_READ | PROT_WRITE,
+              MAP_ANONYMOUS | MAP_PRIVATE,
+              -1,
+              0);
+
+   DEVSHELL_CMD_ASSERT(buf != (void *)-1);
+   buf[0] = 'a';
+   buf[page_size] = 'b';
+   buf[2 * page_size] = 'c';
+
+   /* The 3rd page blocks the in-place growth of the first two */
+   other = buf + 2 * page_size;
+
+   printf("Check that growing in place fails without MREMAP_MAYMOVE\n");
+   res = mremap_pages(buf, 2 * page_size, 4 * page_size, 0);
+   DEVSHELL_CMD_ASSERT(res == (void *)-1 && errno == ENOMEM);
+
+   printf("Grow the mapping by moving it\n");
+   res = mremap_pages(buf, 2 * page_size, 4 * page_size, MREMAP_MAYMOVE);
+   DEVSHELL_CMD_ASSERT(res != (void *)-1);
+   DEVSHELL_CMD_ASSERT(res != buf);
+   DEVSHELL_CMD_ASSERT(res[0] == 'a');
+   DEVSHELL_CMD_ASSERT(res[page_size] == 'b');
+   DEVSHELL_CMD_ASSERT(res[3 * page_size] == 0);
+   DEVSHELL_CMD_ASSERT(other[0] == 'c');
+   res[3 * page_size] = 'd';
+
+   printf("Shrink the mapping in place\n");
+   buf = mremap_pages(res, 4 * page_size, page_size, 0);
+   DEVSHELL_CMD_ASSERT(buf == res);
+   DEVSHELL_CMD_ASSERT(buf[0] == 'a');
+
+   if (test_sig(mm_read_child, res + page_size, SIGSEGV, 0, 0))
+      return 1;
+
+   rc = munmap(buf, page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = munmap(other, page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
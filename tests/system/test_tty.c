@@ -0,0 +1,83 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+/*
+ * More than the tty's output ringbuf (TTY_OUTPUT_BS, 4 KB by default): with
+ * KRN_TTY_ASYNC_OUTPUT, a blocking write() of this size has to wait for the
+ * flush job to make some space, while a non-blocking one might return a short
+ * count or fail with EAGAIN.
+ */
+#define TTY_OUT_LINES                      80
+#define TTY_OUT_LINE_LEN                   78
+
+static char tty_out_buf[TTY_OUT_LINES * TTY_OUT_LINE_LEN];
+
+static void tty_out_fill_buf(void)
+{
+   char *p = tty_out_buf;
+
+   for (int i = 0; i < TTY_OUT_LINES; i++, p += TTY_OUT_LINE_LEN) {
+      memset(p, '-', TTY_OUT_LINE_LEN - 1);
+      memcpy(p, "tty_out1 ", 9);
+      p[TTY_OUT_LINE_LEN - 1] = '\n';
+   }
+}
+
+int cmd_tty_out1(int argc, char **argv)
+{
+   struct termios c_term;
+   int rc, fl;
+
+   if (!isatty(1)) {
+      printf(PFX "[SKIP] because stdout is not a tty\n");
+      return 0;
+   }
+
+   tty_out_fill_buf();
+   fflush(stdout);
+
+   printf("- Blocking write() larger than the output buffer\n");
+   fflush(stdout);
+   rc = write(1, tty_out_buf, sizeof(tty_out_buf));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(tty_out_buf));
+
+   printf("- tcdrain() (TCSBRK)\n");
+   fflush(stdout);
+   rc = tcdrain(1);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("- tcsetattr(TCSADRAIN) (TCSETSW)\n");
+   fflush(stdout);
+   rc = tcgetattr(1, &c_term);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   rc = tcsetattr(1, TCSADRAIN, &c_term);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("- Non-blocking write() larger than the output buffer\n");
+   fflush(stdout);
+   fl = fcntl(1, F_GETFL);
+   DEVSHELL_CMD_ASSERT(fl >= 0);
+   rc = fcntl(1, F_SETFL, fl | O_NONBLOCK);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = write(1, tty_out_buf, sizeof(tty_out_buf));
+
+   /* The O_NONBLOCK flag is shared with devshell: restore it first */
+   DEVSHELL_CMD_ASSERT(fcntl(1, F_SETFL, fl) == 0);
+   DEVSHELL_CMD_ASSERT(rc > 0 || errno == EAGAIN);
+   DEVSHELL_CMD_ASSERT(rc <= (int)sizeof(tty_out_buf));
+
+   rc = tcdrain(1);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   printf("\n");
+   return 0;
+}
@@ -21,6 +21,7 @@ extern "C" {
    #include <tilck/kernel/test/tty_test.h>
    #include <tilck/kernel/ringbuf.h>
    #include <tilck/kernel/sched.h>
+   #include <tilck/kernel/kb.h>
    #include <tilck/common/color_defs.h>
 
    /*
@@ -30,6 +31,32 @@ extern "C" {
     * the test binary via libkernel_test_patched.a.
     */
    void tty_input_init(struct tty *t);
+   void tty_inbuf_on_mode_change(struct tty *t, tcflag_t old_lflag);
+
+#if KRN_TTY_ASYNC_OUTPUT
+   #include <tilck/kernel/fs/devfs.h>
+   #include <tilck/kernel/worker_thread.h>
+   #include <tilck/kernel/timer.h>
+   #include "kernel/wth_int.h" // private header
+
+   /* Same as above, from kernel/tty/tty_output.c */
+   void init_tty_output(void);
+   int tty_output_drain(struct tty *t);
+   void tty_output_echo(struct tty *t, const char *buf, size_t size);
+   ssize_t tty_output_write(struct tty *t,
+                            struct devfs_handle *h,
+                            const char *buf,
+                            size_t size);
+#endif
+
+#if defined(__i386__) || defined(__x86_64)
+   #include <tilck/common/arch/generic_x86/x86_utils.h>
+#elif defined(__riscv)
+   #include <tilck/common/arch/riscv/riscv_utils.h>
+#else
+   /* TODO: actually implement an equivalent of RDTSC for AARCH64 */
+   static inline ulong RDTSC(void) { return 0; }
+#endif
 }
 
 using namespace std;
@@ -255,11 +282,16 @@ public:
       console_write(buf, (size_t)n);
    }
 
+   /* Drains the readable input, followed by the line being edited, if any */
    size_t drain_tty_input(char *out, size_t maxlen) {
       size_t count = 0;
       u8 b;
       while (count < maxlen && ringbuf_read_elem1(&t->input_ringbuf, &b))
          out[count++] = (char)b;
+      for (u16 i = 0; count < maxlen && i < t->edit_len; i++)
+         out[count++] = t->edit_buf[i];
+      t->input_lines_count = 0;
+      t->edit_len = 0;
       return count;
    }
 
@@ -1611,3 +1643,443 @@ TEST_F(console_test, sm_interm_bytes_overflow_recovers)
       +--------------------+
    )");
 }
+
+TEST_F(console_test, plain_run_scrolls)
+{
+   /* One single run of plain chars, longer than the whole screen */
+   std::string s;
+
+   for (int i = 0; i < 5 * TEST_TERM_COLS + 3; i++)
+      s += (char)('a' + (i / TEST_TERM_COLS));
+
+   console_write(s.c_str(), s.size());
+   check_screen_vs_expected(R"(
+      +--------------------+
+      |bbbbbbbbbbbbbbbbbbbb|
+      |cccccccccccccccccccc|
+      |dddddddddddddddddddd|
+      |eeeeeeeeeeeeeeeeeeee|
+      |fff$                |
+      +--------------------+
+   )");
+}
+
+TEST_F(console_test, plain_run_stops_at_sequences)
+{
+   /* Color and charset changes in the middle of a single write */
+   console_write("ab\033[31mcd\033[0m\016q\017ef\r\nxy");
+
+   ASSERT_EQ(vgaentry_get_char(test_video_framebuffer[0][0]), 'a');
+   ASSERT_EQ(vgaentry_get_char(test_video_framebuffer[0][2]), 'c');
+   ASSERT_NE(vgaentry_get_char(test_video_framebuffer[0][4]), 'q');
+   ASSERT_EQ(vgaentry_get_char(test_video_framebuffer[0][5]), 'e');
+   ASSERT_EQ(vgaentry_get_char(test_video_framebuffer[1][1]), 'y');
+
+   check_color_at(0, 1, DEFAULT_COLOR16);
+   check_color_at(0, 2, make_color(COLOR_RED, DEFAULT_BG_COLOR));
+   check_color_at(0, 3, make_color(COLOR_RED, DEFAULT_BG_COLOR));
+   check_color_at(0, 5, DEFAULT_COLOR16);
+   ASSERT_EQ(cursor_row, 1);
+   ASSERT_EQ(cursor_col, 2);
+}
+
+static std::string screen_row_text(int row)
+{
+   std::string s;
+
+   for (int j = 0; j < TEST_TERM_COLS; j++)
+      s += (char)vgaentry_get_char(test_video_framebuffer[row][j]);
+
+   while (!s.empty() && s.back() == ' ')
+      s.pop_back();
+
+   return s;
+}
+
+static void write_numbered_lines(console_test *ct, int from, int to)
+{
+   char buf[32];
+   int n;
+
+   for (int i = from; i < to; i++) {
+      n = snprintf(buf, sizeof(buf), "%sline %d", i > from ? "\r\n" : "", i);
+      ct->console_write(buf, (size_t)n);
+   }
+}
+
+TEST_F(console_test, scrollback_scroll_up_and_down)
+{
+   write_numbered_lines(this, 0, 10);
+
+   ASSERT_EQ(screen_row_text(0), "line 5");
+   ASSERT_EQ(screen_row_text(4), "line 9");
+
+   t->tintf->scroll_up(t->tstate, 3);
+   ASSERT_FALSE(cursor_enabled);
+
+   for (int i = 0; i < TEST_TERM_ROWS; i++)
+      ASSERT_EQ(screen_row_text(i), "line " + std::to_string(2 + i));
+
+   /* Can't scroll beyond the oldest row */
+   t->tintf->scroll_up(t->tstate, 100);
+   ASSERT_EQ(screen_row_text(0), "line 0");
+   ASSERT_EQ(screen_row_text(4), "line 4");
+
+   t->tintf->scroll_down(t->tstate, 100);
+   ASSERT_TRUE(cursor_enabled);
+   ASSERT_EQ(screen_row_text(0), "line 5");
+   ASSERT_EQ(screen_row_text(4), "line 9");
+}
+
+TEST_F(console_test, scrollback_keeps_colors)
+{
+   console_write("a\033[31mred\033[0mb\r\nplain");
+   write_numbered_lines(this, 0, TEST_TERM_ROWS);
+
+   t->tintf->scroll_up(t->tstate, 100);
+   ASSERT_EQ(screen_row_text(0), "aredb");
+   check_color_at(0, 0, DEFAULT_COLOR16);
+   check_color_at(0, 1, make_color(COLOR_RED, DEFAULT_BG_COLOR));
+   check_color_at(0, 3, make_color(COLOR_RED, DEFAULT_BG_COLOR));
+   check_color_at(0, 4, DEFAULT_COLOR16);
+   check_color_at(0, 10, DEFAULT_COLOR16);
+   ASSERT_EQ(screen_row_text(1), "plainline 0");
+}
+
+TEST_F(console_test, scrollback_max_rows)
+{
+   struct term_sb_info info;
+
+   t->tintf->set_sb_max_rows(t->tstate, 2);
+   write_numbered_lines(this, 0, 10);
+
+   t->tintf->get_sb_info(t->tstate, &info);
+   ASSERT_EQ(info.max_rows, 2u);
+   ASSERT_EQ(info.rows, 2u);
+
+   t->tintf->scroll_up(t->tstate, 100);
+   ASSERT_EQ(screen_row_text(0), "line 3");
+   ASSERT_EQ(screen_row_text(4), "line 7");
+   t->tintf->scroll_down(t->tstate, 100);
+
+   /* Disable the scrollback */
+   t->tintf->set_sb_max_rows(t->tstate, 0);
+   write_numbered_lines(this, 10, 20);
+
+   t->tintf->get_sb_info(t->tstate, &info);
+   ASSERT_EQ(info.rows, 0u);
+   ASSERT_EQ(info.mem, 0u);
+
+   t->tintf->scroll_up(t->tstate, 100);
+   ASSERT_EQ(screen_row_text(4), "line 19");
+}
+
+TEST_F(console_test, scrollback_is_compressed)
+{
+   struct term_sb_info info;
+
+   /* Enough rows to need several chunks */
+   write_numbered_lines(this, 0, 2000);
+   t->tintf->get_sb_info(t->tstate, &info);
+
+   ASSERT_EQ(info.rows, MIN(info.max_rows, 2000u - TEST_TERM_ROWS));
+   ASSERT_LT(info.data_size, info.raw_size / 2);
+   ASSERT_LE(info.data_size, info.mem);
+
+   t->tintf->scroll_up(t->tstate, 100);
+   ASSERT_EQ(screen_row_text(0), "line 1895");
+}
+
+class console_test_canon_input : public console_test_reply_path {
+public:
+   void send_input(const char *s) {
+      for (; *s; s++)
+         tty_send_keyevent(t, make_key_event(0, *s, true), false);
+   }
+
+   std::string edit_line() {
+      return std::string(t->edit_buf, t->edit_len);
+   }
+
+   u16 line_len(u16 i) {
+      return t->input_lines[(t->input_lines_first + i) % TTY_INPUT_MAX_LINES];
+   }
+};
+
+TEST_F(console_test_canon_input, lines_are_committed_as_spans)
+{
+   char buf[32] = {0};
+
+   send_input("ab");
+   ASSERT_EQ(t->input_lines_count, 0);
+   ASSERT_EQ(ringbuf_get_elems(&t->input_ringbuf), 0u);
+   ASSERT_EQ(edit_line(), "ab");
+
+   send_input("\ncde\n");
+   ASSERT_EQ(t->input_lines_count, 2);
+   ASSERT_EQ(line_len(0), 3);
+   ASSERT_EQ(line_len(1), 4);
+   ASSERT_EQ(edit_line(), "");
+
+   ASSERT_EQ(drain_tty_input(buf, sizeof(buf) - 1), 7u);
+   ASSERT_STREQ(buf, "ab\ncde\n");
+}
+
+TEST_F(console_test_canon_input, erase_werase_and_kill)
+{
+   send_input("abc\x7f");                 /* VERASE */
+   ASSERT_EQ(edit_line(), "ab");
+
+   send_input("\x15");                    /* VKILL */
+   ASSERT_EQ(edit_line(), "");
+
+   send_input("\x7f");                    /* nothing to erase */
+   ASSERT_EQ(edit_line(), "");
+
+   send_input("foo bar  \x17");           /* VWERASE */
+   ASSERT_EQ(edit_line(), "foo ");
+
+   send_input("\n");
+   ASSERT_EQ(t->input_lines_count, 1);
+   ASSERT_EQ(line_len(0), 5);
+
+   /* Committed lines cannot be edited anymore */
+   send_input("\x7f\x15");
+   ASSERT_EQ(t->input_lines_count, 1);
+   ASSERT_EQ(line_len(0), 5);
+}
+
+TEST_F(console_test_canon_input, eof_is_not_kept)
+{
+   char buf[32] = {0};
+
+   send_input("ab\x04");                  /* VEOF: ends the line */
+   send_input("\x04");                    /* VEOF on empty line: EOF */
+
+   ASSERT_EQ(t->input_lines_count, 2);
+   ASSERT_EQ(line_len(0), 2);
+   ASSERT_EQ(line_len(1), 0);
+
+   ASSERT_EQ(drain_tty_input(buf, sizeof(buf) - 1), 2u);
+   ASSERT_STREQ(buf, "ab");
+}
+
+TEST_F(console_test_canon_input, overruns_are_counted)
+{
+   std::string line(TTY_INPUT_BS + 10, 'x');
+
+   /* In canonical mode, a line has at most TTY_INPUT_BS - 1 chars + delim */
+   send_input(line.c_str());
+   ASSERT_EQ(t->edit_len, TTY_INPUT_BS - 1);
+   ASSERT_EQ(t->input_overruns, 11u);
+
+   send_input("\n");
+   ASSERT_EQ(t->input_lines_count, 1);
+   ASSERT_EQ(line_len(0), TTY_INPUT_BS);
+
+   /* The buffer is full: this line is discarded, as we cannot block */
+   send_input("abc\n");
+   ASSERT_EQ(t->input_lines_count, 1);
+   ASSERT_EQ(t->input_overruns, 15u);
+}
+
+TEST_F(console_test_canon_input, mode_change_keeps_pending_input)
+{
+   char buf[32] = {0};
+   tcflag_t old_lflag = t->c_term.c_lflag;
+
+   send_input("one\ntwo");
+
+   /* Switching to raw mode, the line being edited becomes readable */
+   t->c_term.c_lflag &= ~(tcflag_t)ICANON;
+   tty_inbuf_on_mode_change(t, old_lflag);
+
+   ASSERT_EQ(t->input_lines_count, 0);
+   ASSERT_EQ(t->edit_len, 0);
+   ASSERT_EQ(ringbuf_get_elems(&t->input_ringbuf), 7u);
+
+   /* Back to canonical mode: the unread input has to be terminated again */
+   t->c_term.c_lflag = old_lflag;
+   tty_inbuf_on_mode_change(t, old_lflag & ~(tcflag_t)ICANON);
+
+   ASSERT_EQ(t->input_lines_count, 0);
+   ASSERT_EQ(edit_line(), "one\ntwo");
+
+   send_input("\n");
+   ASSERT_EQ(drain_tty_input(buf, sizeof(buf) - 1), 8u);
+   ASSERT_STREQ(buf, "one\ntwo\n");
+}
+
+#if KRN_TTY_ASYNC_OUTPUT
+
+/*
+ * With KRN_TTY_ASYNC_OUTPUT, write() only fills the tty's output ringbuf. In
+ * the unit tests the worker threads don't run: the tests fire the delayed
+ * jobs and run the queued ones by hand, like the timer and the workers would.
+ */
+class console_test_async_output : public console_test {
+public:
+
+   void SetUp() override {
+      console_test::SetUp();
+      init_worker_threads();
+      init_tty_output();
+      ASSERT_NE(tty_out_wth, nullptr);
+   }
+
+   void TearDown() override {
+      tty_out_wth = nullptr;     /* back to the synchronous output */
+      console_test::TearDown();
+   }
+
+   ssize_t async_write(const char *s, size_t n, int fl_flags = 0) {
+      struct devfs_handle h = {};
+      h.fl_flags = fl_flags;
+      return tty_output_write(t, &h, s, n);
+   }
+
+   ssize_t async_write(const char *s) {
+      return async_write(s, strlen(s));
+   }
+
+   bool run_queued_jobs() {
+
+      bool any = false;
+
+      for (int i = 0; i < worker_threads_cnt; i++)
+         while (wth_process_single_job(worker_threads[i]))
+            any = true;
+
+      return any;
+   }
+
+   void run_delayed_flush() {
+      wth_run_delayed_jobs(get_ticks() + KRN_TIMER_HZ);
+      while (run_queued_jobs()) { }
+   }
+};
+
+TEST_F(console_test_async_output, writes_are_rendered_later_together)
+{
+   ASSERT_EQ(async_write("ab"), 2);
+   ASSERT_EQ(async_write("cd"), 2);
+
+   /* Nothing rendered yet: just one delayed flush for both the writes */
+   ASSERT_FALSE(run_queued_jobs());
+   ASSERT_EQ(wth_delayed_pending, 1u);
+   ASSERT_TRUE(t->out_flush_delayed);
+   ASSERT_FALSE(t->out_job_queued);
+
+   check_screen_vs_expected(R"(
+      +--------------------+
+      |$                   |
+      |                    |
+      |                    |
+      |                    |
+      |                    |
+      +--------------------+
+   )");
+
+   run_delayed_flush();
+
+   ASSERT_FALSE(t->out_flush_delayed);
+   ASSERT_FALSE(t->out_job_queued);
+   ASSERT_TRUE(ringbuf_is_empty(&t->out_ringbuf));
+   ASSERT_EQ(tty_output_drain(t), 0);
+
+   check_screen_vs_expected(R"(
+      +--------------------+
+      |abcd$               |
+      |                    |
+      |                    |
+      |                    |
+      |                    |
+      +--------------------+
+   )");
+}
+
+TEST_F(console_test_async_output, echo_keeps_the_order)
+{
+   ASSERT_EQ(async_write("abc"), 3);
+   tty_output_echo(t, "X", 1);
+   ASSERT_EQ(async_write("d"), 1);
+
+   run_delayed_flush();
+
+   check_screen_vs_expected(R"(
+      +--------------------+
+      |abcXd$              |
+      |                    |
+      |                    |
+      |                    |
+      |                    |
+      +--------------------+
+   )");
+}
+
+TEST_F(console_test_async_output, half_full_ringbuf_is_flushed_now)
+{
+   std::string s(TTY_OUTPUT_BS / 2, 'x');
+
+   ASSERT_EQ(async_write(s.c_str(), s.size()), (ssize_t)s.size());
+
+   /* The flush job gets queued without waiting for the timer */
+   ASSERT_TRUE(t->out_job_queued);
+   ASSERT_TRUE(run_queued_jobs());
+   ASSERT_FALSE(t->out_job_queued);
+   ASSERT_TRUE(ringbuf_is_empty(&t->out_ringbuf));
+}
+
+TEST_F(console_test_async_output, nonblock_write_on_full_ringbuf)
+{
+   std::string s(2 * TTY_OUTPUT_BS, 'x');
+
+   /* Short count: just what fits in the ringbuf */
+   ASSERT_EQ(async_write(s.c_str(), s.size(), O_NONBLOCK), TTY_OUTPUT_BS);
+   ASSERT_EQ(async_write("y", 1, O_NONBLOCK), -EAGAIN);
+
+   /* Once the flush job has run, there's space again */
+   ASSERT_TRUE(run_queued_jobs());
+   ASSERT_EQ(async_write("y", 1, O_NONBLOCK), 1);
+
+   run_delayed_flush();
+   ASSERT_TRUE(ringbuf_is_empty(&t->out_ringbuf));
+   ASSERT_EQ(screen_row_text(TEST_TERM_ROWS - 1).back(), 'y');
+}
+
+#endif
+
+static void
+benchmark_console_write(struct tty *t, const std::string &text, int iters)
+{
+   u64 start = RDTSC();
+
+   for (int i = 0; i < iters; i++)
+      t->tintf->write(t->tstate, text.c_str(), text.size(), t->curr_color);
+
+   u64 tot = RDTSC() - start;
+   printf("[ INFO     ] Avg. cycles per byte: %lu\n",
+          (unsigned long)(tot / ((u64)iters * text.size())));
+}
+
+/* Plain text: mostly handled by the vterm's fast path */
+TEST_F(console_test, DISABLED_benchmark_plain_text)
+{
+   std::string s;
+
+   for (int i = 0; i < 64; i++)
+      s += "The quick brown fox jumps over the lazy dog. 0123456789\r\n";
+
+   benchmark_console_write(t, s, 1000);
+}
+
+/* The same text, with a color change every word: mostly filtered per byte */
+TEST_F(console_test, DISABLED_benchmark_colored_text)
+{
+   std::string s;
+
+   for (int i = 0; i < 64; i++)
+      s += "\033[31mThe \033[32mquick \033[33mbrown \033[34mfox \033[0m\r\n";
+
+   benchmark_console_write(t, s, 1000);
+}
@@ -0,0 +1,113 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+
+#include <memory>
+
+#include <gtest/gtest.h>
+#include "kernel_init_funcs.h"
+
+extern "C" {
+   #include <tilck/kernel/process.h>
+   #include <tilck/kernel/kmalloc.h>
+   #include <tilck/kernel/errno.h>
+}
+
+using namespace std;
+using namespace testing;
+
+class fd_table_test : public Test {
+
+public:
+
+   void SetUp() override {
+
+      init_kmalloc_for_tests();
+
+      pi = make_unique<process>();
+      init_fd_table(pi.get());
+      init_default_rlimits(pi.get());
+      kmutex_lock(&pi->fslock);
+   }
+
+   void TearDown() override {
+      kmutex_unlock(&pi->fslock);
+      free_fd_table(pi.get());
+      pi->rlimits = NULL;      /* points to a test's local array, if set */
+   }
+
+   /* Takes the lowest free fd and marks it as used */
+   int take_fd() {
+
+      int fd = get_free_handle_num_ge(pi.get(), 0);
+
+      if (fd >= 0)
+         set_fs_handle(pi.get(), fd, &dummy_handle);
+
+      return fd;
+   }
+
+   unique_ptr<process> pi;
+   fs_handle_base dummy_handle = {};
+};
+
+TEST_F(fd_table_test, lowest_free_fd)
+{
+   for (int i = 0; i < KRN_MAX_HANDLES; i++)
+      ASSERT_EQ(take_fd(), i);
+
+   ASSERT_EQ(pi->handles_cap, (u32)KRN_MAX_HANDLES);
+   ASSERT_EQ(get_fd_table_end(pi.get()), (u32)KRN_MAX_HANDLES);
+
+   set_fs_handle(pi.get(), 1, NULL);
+   set_fs_handle(pi.get(), 2, NULL);
+
+   ASSERT_EQ(get_free_handle_num_ge(pi.get(), 0), 1);
+   ASSERT_EQ(get_free_handle_num_ge(pi.get(), 2), 2);
+   ASSERT_EQ(get_free_handle_num_ge(pi.get(), 3), KRN_MAX_HANDLES);
+
+   set_fs_handle(pi.get(), KRN_MAX_HANDLES - 1, NULL);
+   ASSERT_EQ(get_fd_table_end(pi.get()), (u32)KRN_MAX_HANDLES - 1);
+}
+
+TEST_F(fd_table_test, growth)
+{
+   const int count = 5 * KRN_MAX_HANDLES + 1;
+
+   for (int i = 0; i < count; i++)
+      ASSERT_EQ(take_fd(), i);
+
+   ASSERT_GE(pi->handles_cap, (u32)count);
+   ASSERT_TRUE(pi->handles != pi->handles_inline);
+   ASSERT_EQ(get_fd_table_end(pi.get()), (u32)count);
+
+   /* The content of the old table must have been preserved */
+   for (int i = 0; i < count; i++)
+      ASSERT_EQ(pi->handles[i], (fs_handle)&dummy_handle);
+
+   set_fs_handle(pi.get(), 3, NULL);
+   ASSERT_EQ(take_fd(), 3);
+
+   /* Asking for a high fd grows the table as well */
+   ASSERT_EQ(get_free_handle_num_ge(pi.get(), 500), 500);
+   ASSERT_GE(pi->handles_cap, 501u);
+   ASSERT_EQ(get_fd_table_end(pi.get()), (u32)count);
+}
+
+TEST_F(fd_table_test, nofile_limit)
+{
+   struct k_rlimit64 lims[RLIM_NLIMITS] = {};
+
+   lims[RLIMIT_NOFILE].rlim_cur = 40;
+   lims[RLIMIT_NOFILE].rlim_max = KRN_NOFILE_MAX;
+   pi->rlimits = lims;
+
+   for (int i = 0; i < 40; i++)
+      ASSERT_EQ(take_fd(), i);
+
+   ASSERT_EQ(take_fd(), -EMFILE);
+   ASSERT_EQ(get_free_handle_num_ge(pi.get(), 45), -EMFILE);
+
+   set_fs_handle(pi.get(), 20, NULL);
+   ASSERT_EQ(take_fd(), 20);
+}
@@ -21,11 +21,13 @@ public:
 TEST(fork_dup_all_handles, trigger_inside_path)
 {
    vfs_mock mock;
-   process pi = {};
+   process pi = {}, parent = {};
    fs_handle_base handles[3] = {}, dup_handles[2] = {};
-   pi.handles[0] = &handles[0];
-   pi.handles[1] = &handles[1];
-   pi.handles[2] = &handles[2];
+   init_fd_table(&pi);
+   init_fd_table(&parent);
+   set_fs_handle(&parent, 0, &handles[0]);
+   set_fs_handle(&parent, 1, &handles[1]);
+   set_fs_handle(&parent, 2, &handles[2]);
 
    EXPECT_CALL(mock, vfs_dup(&handles[0], _))
       .WillOnce(
@@ -46,5 +48,6 @@ TEST(fork_dup_all_handles, trigger_inside_path)
 
    EXPECT_CALL(mock, vfs_close(&dup_handles[0]));
    EXPECT_CALL(mock, vfs_close(&dup_handles[1]));
-   ASSERT_EQ(fork_dup_all_handles(&pi), -ENOMEM);
+   ASSERT_EQ(fork_dup_all_handles(&pi, &parent), -ENOMEM);
+   ASSERT_EQ(get_fd_table_end(&pi), 0u);
 }
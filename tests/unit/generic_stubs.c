@@ -40,14 +40,19 @@ void arch_specific_new_proc_setup() { NOT_REACHED(); }
 void arch_specific_free_proc() { NOT_REACHED(); }
 void fpu_context_begin() { }
 void fpu_context_end() { }
+void bulk_memcpy(void *d, const void *s, size_t n) { memcpy(d, s, n); }
+void bulk_bzero(void *d, size_t n) { memset(d, 0, n); }
 void map_zero_pages() { NOT_REACHED(); }
 void dump_var_mtrrs() { }
 void set_page_rw() { }
+void set_page_prot() { }
+void swap_page_mappings() { NOT_REACHED(); }
 void poweroff() { NOT_REACHED(); }
 int get_irq_num(void *ctx) { return -1; }
 int get_int_num(void *ctx) { return -1; }
 void retain_pageframes_mapped_at() { }
 void release_pageframes_mapped_at() { }
+u32 get_pageframe_ref_count() { return 0; }
 bool irq_is_masked() { NOT_REACHED(); return false; }
 void dump_stacktrace() { NOT_REACHED(); }
 bool allocate_fpu_regs() { NOT_REACHED(); return false; }
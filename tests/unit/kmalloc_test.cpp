@@ -891,3 +891,73 @@ TEST_F(kmalloc_test, partial_free)
 
    kmalloc_destroy_heap(&h);
 }
+
+TEST_F(kmalloc_test, kmalloc_at)
+{
+   void *ptr, *ptr2;
+   size_t s;
+
+   struct kmalloc_heap h;
+   kmalloc_create_heap(&h,
+                       MB,                           /* vaddr */
+                       KMALLOC_MIN_HEAP_SIZE,        /* heap size */
+                       KMALLOC_MIN_HEAP_SIZE / 16,   /* min block size */
+                       KMALLOC_MIN_HEAP_SIZE / 8,    /* alloc block size */
+                       false,                        /* linear mapping */
+                       NULL,                         /* metadata_nodes */
+                       fake_alloc_and_map_func,
+                       fake_free_and_map_func);
+
+   const size_t mbs = h.min_block_size;
+
+   /* Not aligned at the min block size */
+   ptr = per_heap_kmalloc_at(&h, (void *)(h.vaddr + mbs / 2), mbs, mbs);
+   EXPECT_EQ(ptr, nullptr);
+
+   /* Out of the heap */
+   ptr = per_heap_kmalloc_at(&h, (void *)(h.vaddr + 12 * mbs), 8 * mbs, mbs);
+   EXPECT_EQ(ptr, nullptr);
+
+   ptr = per_heap_kmalloc_at(&h, (void *)(h.vaddr + 4 * mbs), 7 * mbs, mbs);
+   EXPECT_EQ(ptr, (void *)(h.vaddr + 4 * mbs));
+   EXPECT_EQ(h.mem_allocated, 7 * mbs);
+
+   dump_heap_subtree(&h, 0, 5);
+
+   /* Overlaps with the previous allocation */
+   ptr2 = per_heap_kmalloc_at(&h, (void *)(h.vaddr + 10 * mbs), 2 * mbs, mbs);
+   EXPECT_EQ(ptr2, nullptr);
+   EXPECT_EQ(h.mem_allocated, 7 * mbs);
+
+   /* The regular allocator must see the holes around it */
+   s = 4 * mbs;
+   ptr2 = per_heap_kmalloc(&h, &s, KMALLOC_FL_MULTI_STEP | mbs);
+   EXPECT_EQ(ptr2, (void *)h.vaddr);
+
+   ptr2 = per_heap_kmalloc_at(&h, (void *)(h.vaddr + 11 * mbs), 5 * mbs, mbs);
+   EXPECT_EQ(ptr2, (void *)(h.vaddr + 11 * mbs));
+   EXPECT_EQ(h.mem_allocated, h.size);
+
+   /* Free a range crossing the two kmalloc_at() allocations */
+   s = 4 * mbs;
+   per_heap_kfree(&h,
+                  (void *)(h.vaddr + 9 * mbs),
+                  &s,
+                  KFREE_FL_ALLOW_SPLIT | KFREE_FL_MULTI_STEP);
+
+   EXPECT_EQ(s, 4 * mbs);
+   EXPECT_EQ(h.mem_allocated, h.size - 4 * mbs);
+
+   ptr2 = per_heap_kmalloc_at(&h, (void *)(h.vaddr + 9 * mbs), 4 * mbs, mbs);
+   EXPECT_EQ(ptr2, (void *)(h.vaddr + 9 * mbs));
+   EXPECT_EQ(h.mem_allocated, h.size);
+
+   s = h.size;
+   per_heap_kfree(&h,
+                  (void *)h.vaddr,
+                  &s,
+                  KFREE_FL_ALLOW_SPLIT | KFREE_FL_MULTI_STEP);
+
+   EXPECT_EQ(h.mem_allocated, 0U);
+   kmalloc_destroy_heap(&h);
+}
@@ -0,0 +1,81 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <cstring>
+#include <string>
+#include <gtest/gtest.h>
+
+extern "C" {
+   #include <tilck/kernel/kmsg.h>
+   #include <tilck/kernel/errno.h>
+}
+
+using namespace std;
+
+static void store_str(const string &s, u8 flags = 0)
+{
+   kmsg_store(KMSG_LEVEL_INFO, flags, s.c_str(), (u32)s.length());
+}
+
+static string rec_text(const struct kmsg_record &r)
+{
+   return string(r.text, r.len);
+}
+
+TEST(kmsg, store_and_read)
+{
+   struct kmsg_record r;
+   const u32 seq = kmsg_get_next_seq();
+
+   store_str("hello\n");
+   store_str("world", KMSG_FL_CONT);
+
+   ASSERT_EQ(kmsg_get_next_seq(), seq + 2);
+
+   ASSERT_EQ(kmsg_read(seq, &r), 0);
+   EXPECT_EQ(r.seq, seq);
+   EXPECT_EQ(r.level, KMSG_LEVEL_INFO);
+   EXPECT_EQ(r.flags, 0);
+   EXPECT_EQ(rec_text(r), "hello\n");
+
+   ASSERT_EQ(kmsg_read(seq + 1, &r), 0);
+   EXPECT_EQ(r.seq, seq + 1);
+   EXPECT_EQ(r.flags, KMSG_FL_CONT);
+   EXPECT_EQ(rec_text(r), "world");
+
+   /* Not stored yet */
+   EXPECT_EQ(kmsg_read(seq + 2, &r), -EAGAIN);
+}
+
+TEST(kmsg, long_text_is_truncated)
+{
+   struct kmsg_record r;
+   const u32 seq = kmsg_get_next_seq();
+   const string s(KMSG_TEXT_MAX + 10, 'x');
+
+   store_str(s);
+
+   ASSERT_EQ(kmsg_read(seq, &r), 0);
+   EXPECT_EQ(r.len, KMSG_TEXT_MAX);
+   EXPECT_EQ(rec_text(r), s.substr(0, KMSG_TEXT_MAX));
+}
+
+TEST(kmsg, overwritten_records)
+{
+   struct kmsg_record r;
+   const u32 seq = kmsg_get_next_seq();
+
+   for (u32 i = 0; i < KMSG_RECORDS + 3; i++)
+      store_str(to_string(i));
+
+   EXPECT_EQ(kmsg_get_first_seq(), seq + 3);
+
+   /* The first 3 records have been overwritten */
+   for (u32 i = 0; i < 3; i++)
+      EXPECT_EQ(kmsg_read(seq + i, &r), -EPIPE);
+
+   for (u32 i = 3; i < KMSG_RECORDS + 3; i++) {
+      ASSERT_EQ(kmsg_read(seq + i, &r), 0);
+      EXPECT_EQ(r.seq, seq + i);
+      EXPECT_EQ(rec_text(r), to_string(i));
+   }
+}
@@ -0,0 +1,153 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+extern "C" {
+   #include <tilck/common/basic_defs.h>
+   #include <tilck/common/lz4.h>
+}
+
+using namespace std;
+
+/*
+ * Generated with: lz4 -9 -BX --content-size, on the text returned by
+ * get_sample_text(). It has block and content checksums.
+ */
+static const u8 sample_frame[] = {
+   0x04, 0x22, 0x4d, 0x18, 0x7c, 0x40, 0x94, 0x02, 0x00, 0x00, 0x00, 0x00,
+   0x00, 0x00, 0x6e, 0x76, 0x00, 0x00, 0x00, 0xf1, 0x1a, 0x54, 0x69, 0x6c,
+   0x63, 0x6b, 0x20, 0x30, 0x30, 0x30, 0x3a, 0x20, 0x74, 0x68, 0x65, 0x20,
+   0x71, 0x75, 0x69, 0x63, 0x6b, 0x20, 0x62, 0x72, 0x6f, 0x77, 0x6e, 0x20,
+   0x66, 0x6f, 0x78, 0x20, 0x6a, 0x75, 0x6d, 0x70, 0x73, 0x20, 0x6f, 0x76,
+   0x65, 0x72, 0x1f, 0x00, 0x94, 0x6c, 0x61, 0x7a, 0x79, 0x20, 0x64, 0x6f,
+   0x67, 0x0a, 0x37, 0x00, 0x1f, 0x31, 0x37, 0x00, 0x23, 0x1f, 0x32, 0x37,
+   0x00, 0x23, 0x1f, 0x33, 0x37, 0x00, 0x23, 0x1f, 0x34, 0x37, 0x00, 0x23,
+   0x1f, 0x35, 0x37, 0x00, 0x23, 0x1f, 0x36, 0x37, 0x00, 0x23, 0x1f, 0x37,
+   0x37, 0x00, 0x23, 0x1f, 0x38, 0x37, 0x00, 0x23, 0x1f, 0x39, 0x37, 0x00,
+   0x22, 0x1f, 0x31, 0x26, 0x02, 0x23, 0x1f, 0x31, 0x26, 0x02, 0x17, 0x50,
+   0x20, 0x64, 0x6f, 0x67, 0x0a, 0x49, 0x2c, 0xc4, 0xee, 0x00, 0x00, 0x00,
+   0x00, 0x8e, 0x57, 0xbd, 0x63
+};
+
+/*
+ * Hand-made frame with linked blocks: an uncompressed block followed by
+ * a compressed one which has an overlapping match referring to the first.
+ */
+static const u8 linked_frame[] = {
+   0x04, 0x22, 0x4d, 0x18,                            /* magic */
+   0x48, 0x40,                                        /* FLG, BD */
+   0x19, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,    /* content size: 25 */
+   0x00,                                              /* HC (not checked) */
+   0x08, 0x00, 0x00, 0x80,                            /* uncompressed, 8 */
+   'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h',
+   0x09, 0x00, 0x00, 0x00,                            /* compressed, 9 */
+   0x08, 0x08, 0x00,                                  /* match: off 8, len 12 */
+   0x50, 'i', 'j', 'k', 'l', 'm',                     /* last literals */
+   0x00, 0x00, 0x00, 0x00,                            /* EndMark */
+};
+
+static string get_sample_text()
+{
+   string s;
+   char buf[64];
+
+   for (int i = 0; i < 12; i++) {
+      sprintf(buf, "Tilck %03d: the quick brown fox "
+                   "jumps over the lazy dog\n", i);
+      s += buf;
+   }
+
+   return s;
+}
+
+TEST(lz4, read_header)
+{
+   struct lz4f_info info;
+
+   ASSERT_TRUE(lz4f_is_frame(sample_frame));
+   ASSERT_EQ(lz4f_read_header(sample_frame, 4, &info), 1);
+   ASSERT_EQ(lz4f_read_header(sample_frame, sizeof(sample_frame), &info), 0);
+   ASSERT_EQ(info.content_size, get_sample_text().size());
+   ASSERT_EQ(info.block_max_size, 64u * KB);
+   ASSERT_EQ(info.header_size, 15u);
+   ASSERT_TRUE(info.block_checksum);
+   ASSERT_TRUE(info.content_checksum);
+}
+
+TEST(lz4, decompress)
+{
+   const string expected = get_sample_text();
+   vector<char> out(expected.size());
+   long rc;
+
+   rc = lz4f_decompress(sample_frame, sizeof(sample_frame),
+                        out.data(), (u32)out.size());
+
+   ASSERT_EQ(rc, (long)expected.size());
+   ASSERT_EQ(string(out.data(), out.size()), expected);
+}
+
+TEST(lz4, linked_blocks)
+{
+   char out[25];
+   long rc;
+
+   rc = lz4f_decompress(linked_frame, sizeof(linked_frame), out, sizeof(out));
+   ASSERT_EQ(rc, 25);
+   ASSERT_EQ(string(out, sizeof(out)), "abcdefghabcdefghabcdijklm");
+}
+
+TEST(lz4, streaming)
+{
+   const string expected = get_sample_text();
+   vector<char> out(expected.size());
+   vector<u8> in;
+   struct lz4f_stream s;
+   u32 consumed;
+   int rc = 0;
+
+   /* Feed the frame one byte at a time, keeping the unconsumed bytes */
+   lz4f_stream_init(&s, out.data(), (u32)out.size());
+
+   for (size_t i = 0; i < sizeof(sample_frame) && !rc; i++) {
+
+      in.push_back(sample_frame[i]);
+      rc = lz4f_stream_decode(&s, in.data(), (u32)in.size(), &consumed);
+      ASSERT_GE(rc, 0);
+      in.erase(in.begin(), in.begin() + consumed);
+   }
+
+   ASSERT_EQ(rc, 1);
+   ASSERT_TRUE(in.empty());
+   ASSERT_EQ(s.out_pos, expected.size());
+   ASSERT_EQ(string(out.data(), out.size()), expected);
+}
+
+TEST(lz4, corrupted)
+{
+   const string expected = get_sample_text();
+   vector<char> out(expected.size());
+   u8 buf[sizeof(linked_frame)];
+
+   /* Truncated frame */
+   ASSERT_EQ(lz4f_decompress(sample_frame, sizeof(sample_frame) - 6,
+                             out.data(), (u32)out.size()), -1);
+
+   /* Output buffer too small */
+   ASSERT_EQ(lz4f_decompress(sample_frame, sizeof(sample_frame),
+                             out.data(), (u32)out.size() - 1), -1);
+
+   /* Match offset pointing before the beginning of the output */
+   memcpy(buf, linked_frame, sizeof(buf));
+   buf[32] = 0x10;
+   ASSERT_EQ(lz4f_decompress(buf, sizeof(buf), out.data(), 25), -1);
+
+   /* Unsupported version */
+   memcpy(buf, linked_frame, sizeof(buf));
+   buf[4] = 0x88;
+   ASSERT_EQ(lz4f_decompress(buf, sizeof(buf), out.data(), 25), -1);
+}
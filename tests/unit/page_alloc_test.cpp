@@ -0,0 +1,211 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include <gtest/gtest.h>
+#include "fake_funcs_utils.h"
+#include "kernel_init_funcs.h"
+
+extern "C" {
+   #include <tilck/kernel/kmalloc.h>
+   #include <tilck/kernel/paging.h>
+   #include <tilck/kernel/page_alloc.h>
+   #include <tilck/kernel/system_mmap.h>
+   #include <tilck/kernel/system_mmap_int.h>
+}
+
+using namespace std;
+using namespace testing;
+
+#define TEST_POOL_START                 (192 * MB)
+#define TEST_POOL_SIZE                   (64 * MB)
+#define TEST_POOL_PAGES    ((size_t)TEST_POOL_SIZE >> PAGE_SHIFT)
+
+class page_alloc_test : public Test {
+
+public:
+
+   void SetUp() override {
+
+      /* Make sure the fake physical memory exists */
+      init_kmalloc_for_tests();
+
+      memcpy(saved_mem_regions, mem_regions, sizeof(mem_regions));
+      saved_mem_regions_count = mem_regions_count;
+
+      mem_regions_count = 2;
+      mem_regions[0] = (struct mem_region) {
+         .addr = 0,
+         .len = TEST_POOL_START,
+         .type = MULTIBOOT_MEMORY_AVAILABLE,
+         .extra = 0,
+      };
+      mem_regions[1] = (struct mem_region) {
+         .addr = TEST_POOL_START,
+         .len = TEST_POOL_SIZE,
+         .type = MULTIBOOT_MEMORY_AVAILABLE,
+         .extra = MEM_REG_EXTRA_PAGE_ALLOC,
+      };
+
+      /* Re-init kmalloc, this time without the pool's region */
+      init_kmalloc_for_tests();
+      init_page_alloc();
+   }
+
+   void TearDown() override {
+      memcpy(mem_regions, saved_mem_regions, sizeof(mem_regions));
+      mem_regions_count = saved_mem_regions_count;
+      init_page_alloc();
+   }
+
+private:
+   struct mem_region saved_mem_regions[MAX_MEM_REGIONS];
+   int saved_mem_regions_count;
+};
+
+static void check_pool_is_whole(void)
+{
+   struct page_alloc_stats st;
+   page_alloc_get_stats(&st);
+
+   ASSERT_EQ(st.tot_pages, TEST_POOL_PAGES);
+   ASSERT_EQ(st.free_pages, TEST_POOL_PAGES);
+   ASSERT_EQ(st.largest_free_order, PAGE_ALLOC_MAX_ORDER);
+   ASSERT_EQ(st.free_blocks[PAGE_ALLOC_MAX_ORDER],
+             TEST_POOL_PAGES >> PAGE_ALLOC_MAX_ORDER);
+
+   for (int i = 0; i < PAGE_ALLOC_MAX_ORDER; i++)
+      ASSERT_EQ(st.free_blocks[i], 0u);
+}
+
+TEST_F(page_alloc_test, init)
+{
+   if (!KRN_PAGE_ALLOC)
+      return;
+
+   check_pool_is_whole();
+}
+
+TEST_F(page_alloc_test, alloc_and_free_pages)
+{
+   const size_t count = 1000;
+   vector<void *> pages;
+
+   if (!KRN_PAGE_ALLOC)
+      return;
+
+   for (size_t i = 0; i < count; i++) {
+
+      void *va = alloc_pageframe(0);
+      ASSERT_TRUE(va != NULL);
+      ASSERT_TRUE(IS_PAGE_ALIGNED(va));
+      ASSERT_TRUE(is_page_alloc_frame(LIN_VA_TO_PA(va)));
+      pages.push_back(va);
+   }
+
+   sort(pages.begin(), pages.end());
+   ASSERT_TRUE(adjacent_find(pages.begin(), pages.end()) == pages.end());
+
+   struct page_alloc_stats st;
+   page_alloc_get_stats(&st);
+   ASSERT_EQ(st.free_pages, TEST_POOL_PAGES - count);
+
+   /* Free the pages in a "random" order, to exercise the coalescing */
+   for (size_t i = 0; i < count; i += 2)
+      free_pageframe(pages[i]);
+
+   for (size_t i = 1; i < count; i += 2)
+      free_pageframe(pages[i]);
+
+   check_pool_is_whole();
+}
+
+TEST_F(page_alloc_test, high_order_blocks)
+{
+   void *b1, *b2, *b3;
+
+   if (!KRN_PAGE_ALLOC)
+      return;
+
+   b1 = alloc_pages(3);
+   b2 = alloc_pages(0);
+   b3 = alloc_pages(PAGE_ALLOC_MAX_ORDER);
+
+   ASSERT_TRUE(b1 != NULL);
+   ASSERT_TRUE(b2 != NULL);
+   ASSERT_TRUE(b3 != NULL);
+
+   /* Blocks are naturally aligned in physical memory */
+   ASSERT_EQ(LIN_VA_TO_PA(b1) & ((PAGE_SIZE << 3) - 1), 0u);
+   ASSERT_EQ(LIN_VA_TO_PA(b3) & ((PAGE_SIZE << PAGE_ALLOC_MAX_ORDER) - 1), 0u);
+
+   free_pages(b2, 0);
+   free_pages(b3, PAGE_ALLOC_MAX_ORDER);
+   free_pages(b1, 3);
+
+   check_pool_is_whole();
+}
+
+TEST_F(page_alloc_test, kmalloc_fallback)
+{
+   const size_t max_blocks = TEST_POOL_PAGES >> PAGE_ALLOC_MAX_ORDER;
+   vector<void *> blocks;
+   struct page_alloc_stats st;
+   void *va;
+
+   if (!KRN_PAGE_ALLOC)
+      return;
+
+   for (size_t i = 0; i < max_blocks; i++) {
+      blocks.push_back(alloc_pages(PAGE_ALLOC_MAX_ORDER));
+      ASSERT_TRUE(blocks.back() != NULL);
+   }
+
+   ASSERT_TRUE(alloc_pages(0) == NULL);
+
+   /* The pool is exhausted: kmalloc must be used */
+   va = alloc_pageframe(0);
+   ASSERT_TRUE(va != NULL);
+   ASSERT_FALSE(is_page_alloc_frame(LIN_VA_TO_PA(va)));
+
+   page_alloc_get_stats(&st);
+   ASSERT_EQ(st.free_pages, 0u);
+   ASSERT_EQ(st.largest_free_order, -1);
+   ASSERT_EQ(st.fallback_allocs, 1u);
+
+   free_pageframe(va);
+
+   for (void *b : blocks)
+      free_pages(b, PAGE_ALLOC_MAX_ORDER);
+
+   check_pool_is_whole();
+}
+
+TEST_F(page_alloc_test, zeroed_pages)
+{
+   void *va;
+
+   if (!KRN_PAGE_ALLOC)
+      return;
+
+   va = alloc_pageframe(0);
+   ASSERT_TRUE(va != NULL);
+   memset(va, 0xaa, PAGE_SIZE);
+   free_pageframe(va);
+
+   va = alloc_pageframe(PAGE_ALLOC_FL_ZERO);
+   ASSERT_TRUE(va != NULL);
+
+   for (size_t i = 0; i < PAGE_SIZE; i++)
+      ASSERT_EQ(((u8 *)va)[i], 0);
+
+   free_pageframe(va);
+   check_pool_is_whole();
+}
@@ -19,6 +19,7 @@ extern "C" {
 
    #include <tilck/kernel/kmalloc.h>
    #include <tilck/kernel/worker_thread.h>
+   #include <tilck/kernel/timer.h>
    #include "kernel/wth_int.h" // private header
 }
 
@@ -193,3 +194,51 @@ TEST_F(worker_thread_test, chaos)
       }
    }
 }
+
+static int delayed_func_calls;
+
+static void delayed_func(void *p1)
+{
+   ASSERT_EQ(p1, TO_PTR(1234));
+   delayed_func_calls++;
+}
+
+TEST_F(worker_thread_test, delayed)
+{
+   struct worker_thread *wth = wth_find_worker(WTH_PRIO_HIGHEST);
+   const u64 now = get_ticks();
+   bool res = false;
+
+   delayed_func_calls = 0;
+   ASSERT_TRUE(wth_enqueue_delayed(WTH_PRIO_HIGHEST, 5,
+                                   &delayed_func, TO_PTR(1234)));
+
+   // Not due yet: nothing gets queued
+   wth_run_delayed_jobs(now + 4);
+   ASSERT_NO_FATAL_FAILURE({ res = wth_process_single_job(wth); });
+   ASSERT_FALSE(res);
+
+   // Due: the job gets moved to the worker's queue, exactly once
+   wth_run_delayed_jobs(now + 5);
+   wth_run_delayed_jobs(now + 6);
+   ASSERT_NO_FATAL_FAILURE({ res = wth_process_single_job(wth); });
+   ASSERT_TRUE(res);
+   ASSERT_NO_FATAL_FAILURE({ res = wth_process_single_job(wth); });
+   ASSERT_FALSE(res);
+   ASSERT_EQ(delayed_func_calls, 1);
+}
+
+TEST_F(worker_thread_test, delayed_table_full)
+{
+   for (int i = 0; i < WTH_MAX_DELAYED_JOBS; i++) {
+      ASSERT_TRUE(wth_enqueue_delayed(WTH_PRIO_HIGHEST, 1000,
+                                      &delayed_func, TO_PTR(1234)));
+   }
+
+   ASSERT_FALSE(wth_enqueue_delayed(WTH_PRIO_HIGHEST, 1000,
+                                    &delayed_func, TO_PTR(1234)));
+
+   // With no delay, the job is enqueued right away
+   ASSERT_TRUE(wth_enqueue_delayed(WTH_PRIO_HIGHEST, 0,
+                                   &delayed_func, TO_PTR(1234)));
+}
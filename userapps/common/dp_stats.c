@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "dp_stats.h"
+
+static const volatile struct dp_stats *stats_page;
+static bool map_failed;
+
+static bool dp_stats_map(void)
+{
+   void *p;
+   char c;
+   int fd;
+
+   if (stats_page)
+      return true;
+
+   if (map_failed)
+      return false;
+
+   map_failed = true;
+
+   if ((fd = open(DP_STATS_PATH, O_RDONLY)) < 0)
+      return false;
+
+   p = mmap(NULL, DP_STATS_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+
+   if (p == MAP_FAILED) {
+      close(fd);
+      return false;
+   }
+
+   /*
+    * The kernel refreshes the page only while it's mapped: until its thread
+    * wakes up, the data might be old. A read() makes it refresh it now. If
+    * the read() fails, we'll just get older data in the first snapshot.
+    */
+   if (read(fd, &c, 1) < 0) {
+      /* Ignore the error, see above */
+   }
+
+   close(fd);
+
+   stats_page = p;
+   map_failed = false;
+   return true;
+}
+
+bool dp_stats_snapshot(struct dp_stats *out)
+{
+   u32 seq;
+
+   if (!dp_stats_map())
+      return false;
+
+   do {
+
+      seq = dp_stats_read_begin(stats_page);
+      memcpy(out, (const void *)stats_page, sizeof(*out));
+
+   } while (dp_stats_read_retry(stats_page, seq));
+
+   return true;
+}
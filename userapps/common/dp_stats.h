@@ -0,0 +1,19 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * Userspace side of the kernel's statistics page (DP_STATS_PATH, see
+ * <tilck/common/dp_abi.h>). The page is mapped once, on the first call;
+ * after that, taking a snapshot costs no syscalls at all.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <tilck/common/dp_abi.h>
+
+/*
+ * Copy a consistent snapshot of the statistics page in `out`. Returns false
+ * if the page is not available (e.g. the kernel was built without sysfs), in
+ * which case the callers fall back to the TILCK_CMD_DP_* sub-commands.
+ */
+bool dp_stats_snapshot(struct dp_stats *out);
@@ -16,6 +16,7 @@
 #include "term.h"
 #include "tui_layout.h"
 #include "task_dump.h"
+#include "dp_stats.h"
 
 struct dp_task_info dp_tasks_buf[MAX_DP_TASKS];
 int dp_tasks_count;
@@ -38,6 +39,20 @@ int dp_tasks_refresh(void)
    return 0;
 }
 
+int dp_tasks_refresh_passive(void)
+{
+   static struct dp_stats snap;
+
+   if (!dp_stats_snapshot(&snap) || snap.tasks_count != snap.tot_tasks)
+      return dp_tasks_refresh();   /* no stats page or truncated task list */
+
+   for (u32 i = 0; i < snap.tasks_count; i++)
+      dp_tasks_buf[i] = snap.tasks[i].info;
+
+   dp_tasks_count = (int)snap.tasks_count;
+   return 0;
+}
+
 void state_to_str(char *out, unsigned char state, bool stopped, bool traced)
 {
    char *p = out;
@@ -52,6 +52,14 @@ enum task_dump_str_t {
  */
 int dp_tasks_refresh(void);
 
+/*
+ * Like dp_tasks_refresh(), but it reads the task table from the statistics
+ * page (see dp_stats.h) when possible: no syscalls, but the data might be a
+ * few hundred milliseconds old. Good for the periodic or user-requested
+ * refreshes, not after acting on a task.
+ */
+int dp_tasks_refresh_passive(void);
+
 /* Format the state byte (+ stopped/traced flags) as 1-3 chars. */
 void state_to_str(char *out, unsigned char state, bool stopped, bool traced);
 
@@ -14,6 +14,7 @@
  * (only the call site is the C runtime instead of REGISTER_MODULE).
  */
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -105,8 +106,14 @@ static void dp_exit(void)
    tui_term_restore();
 }
 
+/*
+ * Max label length for the tabs other than the selected one, used only when
+ * the full labels don't fit in the header row.
+ */
+#define DP_SHORT_LABEL_LEN       3
+
 static void
-dp_write_header(int i, const char *s, bool selected)
+dp_write_header(int i, const char *s, bool selected, int max_len)
 {
    if (selected) {
 
@@ -117,24 +124,41 @@ dp_write_header(int i, const char *s, bool selected)
 
    } else {
 
-      term_write("%d[%s]" RESET_ATTRS " ", i, s);
+      term_write("%d[%.*s]" RESET_ATTRS " ", i, max_len, s);
    }
 }
 
+/* Length of the header row, with the full labels: "N[label] " per tab */
+static int dp_get_header_len(void)
+{
+   struct dp_screen *p;
+   int len = 0;
+
+   for (p = dp_screens_head; p; p = p->next)
+      len += snprintf(NULL, 0, "%d[%s] ", p->index + 1, p->label);
+
+   return len;
+}
+
 static void paint_chrome(void)
 {
    struct dp_screen *p;
+   int max_len;
 
    term_clear();
    term_move_cursor(tui_start_row + 1, tui_start_col + 2);
 
+   max_len = dp_get_header_len() > DP_W - 2 ? DP_SHORT_LABEL_LEN : INT_MAX;
+
    for (p = dp_screens_head; p; p = p->next)
-      dp_write_header(p->index + 1, p->label, p == dp_ctx);
+      dp_write_header(p->index + 1, p->label, p == dp_ctx, max_len);
 
    /*
     * No "q[Quit]" tab in the header: adding the Runtime screen pushed
     * the tabs row past the panel's inner width on 80-col terminals.
-    * 'q' still quits — the keypress handler matches the bare char.
+    * 'q' still quits — the keypress handler matches the bare char. For
+    * the same reason, when the full labels don't fit anyway, only the
+    * selected tab shows its full label.
     */
 
    term_draw_rect_raw(tui_start_row, tui_start_col, DP_H, DP_W);
@@ -21,6 +21,7 @@
 #include "tui_layout.h"
 #include "dp_int.h"
 #include "dp_panel.h"
+#include "dp_stats.h"
 
 static struct dp_irq_stats stats;
 static int got_stats;
@@ -72,9 +73,25 @@ static void dp_irqs_on_enter(void)
    got_stats = (dp_cmd_get_irqs(&stats) == 0);
 }
 
+/*
+ * Take the counters from the kernel's statistics page, when available: that
+ * costs no syscalls, so we can afford to do it every time the panel is drawn.
+ */
+static void dp_irqs_refresh_from_stats_page(void)
+{
+   static struct dp_stats snap;
+
+   if (dp_stats_snapshot(&snap)) {
+      stats = snap.irqs;
+      timer_hz = snap.timer_hz;
+      got_stats = 1;
+   }
+}
+
 static void dp_show_irqs(void)
 {
    row = tui_screen_start_row;
+   dp_irqs_refresh_from_stats_page();
 
    dp_writeln("Kernel IRQ-related counters");
 
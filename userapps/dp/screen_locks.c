@@ -0,0 +1,282 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * Locks panel: the lock classes sorted by the total time spent waiting on
+ * them, according to the kernel lock contention stats (KRN_LOCKSTAT).
+ * Driven by TILCK_CMD_DP_GET_LOCKSTAT; the same data is available as text
+ * in /syst/lockstat/classes.
+ *
+ * A lock class is the call site of the lock's init function (or the name of
+ * a static lock). Times are in CPU cycles (TSC on x86). The avg wait is per
+ * contended acquisition, the avg hold per measured hold.
+ *
+ * Sortable columns: 'w' total wait, 'c' contended, 'a' acquired,
+ * 'h' total hold. 'r' reloads the stats.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <tilck/common/syscalls.h>
+#include <tilck/common/dp_abi.h>
+
+#include "term.h"
+#include "tui_layout.h"
+#include "dp_int.h"
+#include "dp_panel.h"
+
+#define MAX_LOCK_ROWS     256
+
+static struct dp_lockstat_class stats[MAX_LOCK_ROWS];
+static int stats_count;
+static int got_data;
+static int load_errno;
+static char order_by = 'w';
+static int row;
+
+static long
+dp_cmd_get_lockstat(struct dp_lockstat_class *buf, unsigned long max)
+{
+   return syscall(TILCK_CMD_SYSCALL,
+                  TILCK_CMD_DP_GET_LOCKSTAT,
+                  (long)buf, (long)max, 0L, 0L);
+}
+
+static const char *type_name(unsigned type)
+{
+   switch (type) {
+      case 0: return "mutex";
+      case 1: return "rwlock";
+      case 2: return "cond";
+   }
+
+   return "?";
+}
+
+static unsigned long long
+avg(unsigned long long tot, unsigned long long count)
+{
+   return count ? tot / count : 0;
+}
+
+static int cmp_u64_desc(unsigned long long x, unsigned long long y)
+{
+   if (x > y) return -1;
+   if (x < y) return  1;
+   return 0;
+}
+
+static int cmp_wait(const void *a, const void *b)
+{
+   const struct dp_lockstat_class *x = a;
+   const struct dp_lockstat_class *y = b;
+   return cmp_u64_desc(x->wait_tot, y->wait_tot);
+}
+
+static int cmp_contended(const void *a, const void *b)
+{
+   const struct dp_lockstat_class *x = a;
+   const struct dp_lockstat_class *y = b;
+   return cmp_u64_desc(x->contended, y->contended);
+}
+
+static int cmp_acquired(const void *a, const void *b)
+{
+   const struct dp_lockstat_class *x = a;
+   const struct dp_lockstat_class *y = b;
+   return cmp_u64_desc(x->acquired, y->acquired);
+}
+
+static int cmp_hold(const void *a, const void *b)
+{
+   const struct dp_lockstat_class *x = a;
+   const struct dp_lockstat_class *y = b;
+   return cmp_u64_desc(x->hold_tot, y->hold_tot);
+}
+
+static void resort(void)
+{
+   int (*cmp)(const void *, const void *) = cmp_wait;
+
+   switch (order_by) {
+      case 'c': cmp = cmp_contended; break;
+      case 'a': cmp = cmp_acquired;  break;
+      case 'h': cmp = cmp_hold;      break;
+      case 'w':
+      default:  cmp = cmp_wait;      break;
+   }
+
+   qsort(stats, (size_t)stats_count, sizeof(stats[0]), cmp);
+}
+
+static void load_stats(void)
+{
+   long rc = dp_cmd_get_lockstat(stats, MAX_LOCK_ROWS);
+
+   if (rc < 0) {
+      got_data = 0;
+      load_errno = errno;
+      stats_count = 0;
+      return;
+   }
+
+   got_data = 1;
+   stats_count = (int)rc;
+   resort();
+}
+
+static void dp_locks_on_enter(void)
+{
+   load_stats();
+}
+
+static enum dp_kb_handler_action
+dp_locks_keypress(struct key_event ke)
+{
+   if (!ke.print_char)
+      return dp_kb_handler_nak;
+
+   switch (ke.print_char) {
+
+      case 'r':
+         load_stats();
+         ui_need_update = true;
+         return dp_kb_handler_ok_and_continue;
+
+      case 'w':
+      case 'c':
+      case 'a':
+      case 'h':
+         order_by = ke.print_char;
+         resort();
+         ui_need_update = true;
+         return dp_kb_handler_ok_and_continue;
+   }
+
+   return dp_kb_handler_nak;
+}
+
+/* Formats a number in 5 chars, unless it's >= 10^13 */
+static const char *fmt_num(char *buf, size_t sz, unsigned long long val)
+{
+   if (val < 10000ULL)
+      snprintf(buf, sz, "%llu", val);
+   else if (val < 10000ULL * 1000)
+      snprintf(buf, sz, "%lluK", val / 1000);
+   else if (val < 10000ULL * 1000 * 1000)
+      snprintf(buf, sz, "%lluM", val / 1000 / 1000);
+   else
+      snprintf(buf, sz, "%lluG", val / 1000 / 1000 / 1000);
+
+   return buf;
+}
+
+static void dp_show_locks(void)
+{
+   unsigned long long tot_acq = 0, tot_cont = 0;
+   char b1[16], b2[16], b3[16], b4[16], b5[16], b6[16], b7[16];
+
+   row = tui_screen_start_row;
+
+   if (!got_data) {
+
+      if (load_errno == EOPNOTSUPP || load_errno == ENOTSUP) {
+
+         dp_writeln(
+            "Not available: recompile with KRN_LOCKSTAT=1");
+
+      } else {
+
+         dp_writeln(E_COLOR_BR_RED
+                    "TILCK_CMD_DP_GET_LOCKSTAT failed (errno=%d)"
+                    RESET_ATTRS, load_errno);
+      }
+
+      return;
+   }
+
+   for (int i = 0; i < stats_count; i++) {
+      tot_acq += stats[i].acquired;
+      tot_cont += stats[i].contended;
+   }
+
+   dp_writeln("Lock classes:    %5d", stats_count);
+   dp_writeln("Acquisitions:    %5s", fmt_num(b1, sizeof(b1), tot_acq));
+   dp_writeln("Contended:       %5s", fmt_num(b1, sizeof(b1), tot_cont));
+
+   dp_writeln(
+      "Order by: "
+      E_COLOR_BR_WHITE "w" RESET_ATTRS "ait time, "
+      E_COLOR_BR_WHITE "c" RESET_ATTRS "ontended, "
+      E_COLOR_BR_WHITE "a" RESET_ATTRS "cquired, "
+      E_COLOR_BR_WHITE "h" RESET_ATTRS "old time. "
+      E_COLOR_BR_WHITE "r" RESET_ATTRS "eload");
+
+   dp_writeln(" ");
+
+   dp_writeln(
+                 "       Lock class   "
+      TERM_VLINE " Type "
+      TERM_VLINE "%s" "  Acq "    RESET_ATTRS
+      TERM_VLINE "%s" " Cont "    RESET_ATTRS
+      TERM_VLINE "%s" " Wait "    RESET_ATTRS
+      TERM_VLINE " AvgW "
+      TERM_VLINE " MaxW "
+      TERM_VLINE "%s" " AvgH "    RESET_ATTRS
+      TERM_VLINE " MaxH ",
+      order_by == 'a' ? E_COLOR_BR_WHITE REVERSE_VIDEO : "",
+      order_by == 'c' ? E_COLOR_BR_WHITE REVERSE_VIDEO : "",
+      order_by == 'w' ? E_COLOR_BR_WHITE REVERSE_VIDEO : "",
+      order_by == 'h' ? E_COLOR_BR_WHITE REVERSE_VIDEO : "");
+
+   dp_writeln(
+      GFX_ON
+      "qqqqqqqqqqqqqqqqqqqqnqqqqqqnqqqqqqnqqqqqqnqqqqqqnqqqqqqnqqqqqqn"
+      "qqqqqqnqqqqqq"
+      GFX_OFF
+   );
+
+   for (int i = 0; i < stats_count; i++) {
+
+      const struct dp_lockstat_class *s = &stats[i];
+
+      dp_writeln(" %-19.19s"
+                 TERM_VLINE "%-6s"
+                 TERM_VLINE "%6s"
+                 TERM_VLINE "%6s"
+                 TERM_VLINE "%6s"
+                 TERM_VLINE "%6s"
+                 TERM_VLINE "%6s"
+                 TERM_VLINE "%6s"
+                 TERM_VLINE "%6s",
+                 s->name,
+                 type_name(s->type),
+                 fmt_num(b1, sizeof(b1), s->acquired),
+                 fmt_num(b2, sizeof(b2), s->contended),
+                 fmt_num(b3, sizeof(b3), s->wait_tot),
+                 fmt_num(b4, sizeof(b4), avg(s->wait_tot, s->contended)),
+                 fmt_num(b5, sizeof(b5), s->wait_max),
+                 fmt_num(b6, sizeof(b6), avg(s->hold_tot, s->holds)),
+                 fmt_num(b7, sizeof(b7), s->hold_max));
+   }
+
+   dp_writeln(" ");
+}
+
+static struct dp_screen dp_locks_screen = {
+   .index = 8,
+   .label = "Locks",
+   .draw_func = dp_show_locks,
+   .on_dp_enter = dp_locks_on_enter,
+   .on_keypress_func = dp_locks_keypress,
+};
+
+__attribute__((constructor))
+static void dp_locks_register(void)
+{
+   dp_register_screen(&dp_locks_screen);
+}
@@ -1,10 +1,10 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
 /*
- * MemMap panel: global memory stats + physical memory map regions +
- * (on x86) variable MTRRs. Driven by three TILCK_CMD_DP_GET_*
- * sub-commands and the same multi-section layout the in-kernel
- * modules/debugpanel/dp_sys_mmap.c had.
+ * MemMap panel: global memory stats + page-frame allocator stats +
+ * physical memory map regions + (on x86) variable MTRRs. Driven by four
+ * TILCK_CMD_DP_GET_* sub-commands and the same multi-section layout the
+ * in-kernel modules/debugpanel/dp_sys_mmap.c had.
  */
 
 #include <stdio.h>
@@ -22,6 +22,7 @@
 
 #define KB_  1024UL
 #define MB_  (1024UL * 1024UL)
+#define PAGE_KB  4ULL
 
 #define MAX_MEM_REGIONS  64
 #define MAX_MTRRS        32
@@ -32,6 +33,9 @@ static int region_count;
 static struct dp_mem_global_stats gstats;
 static int got_gstats;
 
+static struct dp_page_alloc_stats pastats;
+static int got_pastats;
+
 static struct dp_mtrr_entry mtrrs[MAX_MTRRS];
 static struct dp_mtrr_info mtrr_info;
 static int mtrr_count;
@@ -49,6 +53,7 @@ static int row;
 #define MEM_REG_EXTRA_LOWMEM      (1u << 2)
 #define MEM_REG_EXTRA_FRAMEBUFFER (1u << 3)
 #define MEM_REG_EXTRA_DMA         (1u << 4)
+#define MEM_REG_EXTRA_PAGE_ALLOC  (1u << 5)
 
 /* Mirrors kernel/mm/system_mmap.c::mem_region_extra_to_str. Strings
  * are 4 chars to keep MemMap rows column-aligned with the kernel's
@@ -63,6 +68,7 @@ extra_to_str(unsigned extra)
       case MEM_REG_EXTRA_LOWMEM:       return "LMRS";
       case MEM_REG_EXTRA_FRAMEBUFFER:  return "FBUF";
       case MEM_REG_EXTRA_DMA:          return "DMA ";
+      case MEM_REG_EXTRA_PAGE_ALLOC:   return "PGAL";
    }
    return "MIXD";
 }
@@ -86,6 +92,13 @@ static long dp_cmd_get_gstats(struct dp_mem_global_stats *out)
                   (long)out, 0L, 0L, 0L);
 }
 
+static long dp_cmd_get_pastats(struct dp_page_alloc_stats *out)
+{
+   return syscall(TILCK_CMD_SYSCALL,
+                  TILCK_CMD_DP_GET_PAGE_ALLOC_STATS,
+                  (long)out, 0L, 0L, 0L);
+}
+
 static long dp_cmd_get_mtrrs(struct dp_mtrr_entry *buf, unsigned long max,
                              struct dp_mtrr_info *info)
 {
@@ -100,6 +113,7 @@ static void dp_mmap_on_enter(void)
    region_count = (rc < 0) ? 0 : (int)rc;
 
    got_gstats = (dp_cmd_get_gstats(&gstats) == 0);
+   got_pastats = (dp_cmd_get_pastats(&pastats) == 0);
 
    memset(&mtrr_info, 0, sizeof(mtrr_info));
    long mrc = dp_cmd_get_mtrrs(mtrrs, MAX_MTRRS, &mtrr_info);
@@ -128,13 +142,78 @@ static void dump_global_stats(void)
    dp_writeln("Used by kernel text + data:  %8llu KB",
               (unsigned long long)gstats.kernel_used / KB_);
 
-   const unsigned long long tot =
+   unsigned long long tot =
       gstats.kmalloc_used + gstats.ramdisk_used + gstats.kernel_used;
 
+   if (got_pastats && pastats.tot_pages) {
+
+      const unsigned long long pa_used =
+         pastats.tot_pages - pastats.free_pages - pastats.zero_cache_pages;
+
+      dp_writeln("Used by page allocator:      %8llu KB",
+                 pa_used * PAGE_KB);
+
+      tot += pa_used * PAGE_KB * KB_;
+   }
+
    dp_writeln("Tot used:                    %8llu KB", tot / KB_);
    dp_writeln(" ");
 }
 
+static void dump_page_alloc_stats(void)
+{
+   char buf[128] = "";
+   int n = 0;
+
+   if (!got_pastats || !pastats.tot_pages)
+      return;
+
+   const unsigned long long free_tot =
+      pastats.free_pages + pastats.zero_cache_pages;
+
+   const unsigned long long largest =
+      pastats.largest_free_order >= 0
+         ? 1ull << pastats.largest_free_order
+         : 0;
+
+   /*
+    * Fragmentation index: how much of the free memory is NOT in the largest
+    * free block. 0% means all the free memory is in a single block.
+    */
+   const unsigned frag =
+      pastats.free_pages
+         ? (unsigned)(100 - largest * 100 / pastats.free_pages)
+         : 0;
+
+   dp_writeln("Page allocator pool:         %8llu KB",
+              (unsigned long long)pastats.tot_pages * PAGE_KB);
+
+   dp_writeln("Free (zero cache):           %8llu KB (%llu KB)",
+              free_tot * PAGE_KB,
+              (unsigned long long)pastats.zero_cache_pages * PAGE_KB);
+
+   dp_writeln("kmalloc fallbacks:           %8llu",
+              (unsigned long long)pastats.fallback_allocs);
+
+   dp_writeln("Largest free block:          %8llu KB [ frag: %u%% ]",
+              largest * PAGE_KB, frag);
+
+   for (unsigned i = 0; i <= pastats.max_order; i++) {
+
+      if (i >= DP_PAGE_ALLOC_MAX_ORDERS)
+         break;
+
+      n += snprintf(buf + n, sizeof(buf) - (size_t)n, " %llu",
+                    (unsigned long long)pastats.free_blocks[i]);
+
+      if (n >= (int)sizeof(buf))
+         break;
+   }
+
+   dp_writeln("Free blocks per order:      %s", buf);
+   dp_writeln(" ");
+}
+
 static void dump_regions(void)
 {
    dp_writeln("           START                 END        (T, Extr)");
@@ -190,6 +269,7 @@ static void dp_show_mmap(void)
    row = tui_screen_start_row;
 
    dump_global_stats();
+   dump_page_alloc_stats();
    dump_regions();
    dump_mtrrs();
    dp_writeln(" ");
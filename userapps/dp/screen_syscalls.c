@@ -0,0 +1,343 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * Syscalls panel: the syscalls sorted by the total time spent in them,
+ * according to the always-on kernel syscall stats (KRN_SYSCALL_STATS).
+ * Driven by TILCK_CMD_DP_GET_SYSCALL_STATS; the same data is available
+ * as text under /syst/syscalls/.
+ *
+ * Times are in CPU cycles (TSC on x86). The p50/p99 columns are upper
+ * bounds derived from the kernel's log2 latency histograms, so they're
+ * accurate only up to a factor of 2.
+ *
+ * Sortable columns: 't' total time, 'c' calls, 'a' avg, 'm' max.
+ * 'r' reloads the stats.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <tilck/common/syscalls.h>
+#include <tilck/common/dp_abi.h>
+
+#include "term.h"
+#include "tui_layout.h"
+#include "dp_int.h"
+#include "dp_panel.h"
+
+#define MAX_SYSCALL_ROWS     512
+
+static struct dp_syscall_stats stats[MAX_SYSCALL_ROWS];
+static char *sys_names[MAX_SYSCALL_ROWS];
+static int stats_count;
+static int got_data;
+static int load_errno;
+static char order_by = 't';
+static int row;
+
+static long
+dp_cmd_get_syscall_stats(struct dp_syscall_stats *buf, unsigned long max)
+{
+   return syscall(TILCK_CMD_SYSCALL,
+                  TILCK_CMD_DP_GET_SYSCALL_STATS,
+                  (long)buf, (long)max, 0L, 0L);
+}
+
+/*
+ * The names come from the tracing module (TILCK_CMD_DP_TRACE_GET_SYS_NAME),
+ * which is optional: without it, we show just the syscall numbers.
+ */
+static const char *get_sys_name(unsigned sys_n)
+{
+   static char fallback[32];
+   char buf[64];
+   const char *src = buf;
+   long rc;
+
+   if (sys_n >= MAX_SYSCALL_ROWS)
+      goto use_fallback;
+
+   if (sys_names[sys_n])
+      return sys_names[sys_n];
+
+   rc = syscall(TILCK_CMD_SYSCALL,
+                TILCK_CMD_DP_TRACE_GET_SYS_NAME,
+                (long)sys_n, (long)buf, (long)sizeof(buf), 0L);
+
+   if (rc < 0)
+      goto use_fallback;
+
+   if (!strncmp(src, "sys_", 4))
+      src += 4;
+
+   sys_names[sys_n] = strdup(src);
+
+   if (sys_names[sys_n])
+      return sys_names[sys_n];
+
+use_fallback:
+   snprintf(fallback, sizeof(fallback), "syscall_%u", sys_n);
+   return fallback;
+}
+
+static unsigned long long avg_cycles(const struct dp_syscall_stats *s)
+{
+   return s->count ? s->tot_cycles / s->count : 0;
+}
+
+static int cmp_tot(const void *a, const void *b)
+{
+   const struct dp_syscall_stats *x = a;
+   const struct dp_syscall_stats *y = b;
+
+   if (x->tot_cycles > y->tot_cycles) return -1;
+   if (x->tot_cycles < y->tot_cycles) return  1;
+   return 0;
+}
+
+static int cmp_count(const void *a, const void *b)
+{
+   const struct dp_syscall_stats *x = a;
+   const struct dp_syscall_stats *y = b;
+
+   if (x->count > y->count) return -1;
+   if (x->count < y->count) return  1;
+   return 0;
+}
+
+static int cmp_avg(const void *a, const void *b)
+{
+   const unsigned long long x = avg_cycles(a);
+   const unsigned long long y = avg_cycles(b);
+
+   if (x > y) return -1;
+   if (x < y) return  1;
+   return 0;
+}
+
+static int cmp_max(const void *a, const void *b)
+{
+   const struct dp_syscall_stats *x = a;
+   const struct dp_syscall_stats *y = b;
+
+   if (x->max_cycles > y->max_cycles) return -1;
+   if (x->max_cycles < y->max_cycles) return  1;
+   return 0;
+}
+
+static void resort(void)
+{
+   int (*cmp)(const void *, const void *) = cmp_tot;
+
+   switch (order_by) {
+      case 'c': cmp = cmp_count; break;
+      case 'a': cmp = cmp_avg;   break;
+      case 'm': cmp = cmp_max;   break;
+      case 't':
+      default:  cmp = cmp_tot;   break;
+   }
+
+   qsort(stats, (size_t)stats_count, sizeof(stats[0]), cmp);
+}
+
+static void load_stats(void)
+{
+   long rc = dp_cmd_get_syscall_stats(stats, MAX_SYSCALL_ROWS);
+
+   if (rc < 0) {
+      got_data = 0;
+      load_errno = errno;
+      stats_count = 0;
+      return;
+   }
+
+   got_data = 1;
+   stats_count = (int)rc;
+   resort();
+}
+
+static void dp_syscalls_on_enter(void)
+{
+   load_stats();
+}
+
+static enum dp_kb_handler_action
+dp_syscalls_keypress(struct key_event ke)
+{
+   if (!ke.print_char)
+      return dp_kb_handler_nak;
+
+   switch (ke.print_char) {
+
+      case 'r':
+         load_stats();
+         ui_need_update = true;
+         return dp_kb_handler_ok_and_continue;
+
+      case 't':
+      case 'c':
+      case 'a':
+      case 'm':
+         order_by = ke.print_char;
+         resort();
+         ui_need_update = true;
+         return dp_kb_handler_ok_and_continue;
+   }
+
+   return dp_kb_handler_nak;
+}
+
+/* Formats a number of cycles in 5 chars, unless it's >= 10^13 */
+static const char *fmt_cycles(char *buf, size_t sz, unsigned long long val)
+{
+   if (val < 10000ULL)
+      snprintf(buf, sz, "%llu", val);
+   else if (val < 10000ULL * 1000)
+      snprintf(buf, sz, "%lluK", val / 1000);
+   else if (val < 10000ULL * 1000 * 1000)
+      snprintf(buf, sz, "%lluM", val / 1000 / 1000);
+   else
+      snprintf(buf, sz, "%lluG", val / 1000 / 1000 / 1000);
+
+   return buf;
+}
+
+/*
+ * Returns an upper bound for the given percentile, using the histogram:
+ * bucket `i` contains the calls which took [2^i, 2^(i+1)) cycles.
+ */
+static const char *
+fmt_percentile(char *buf, size_t sz, const struct dp_syscall_stats *s, int p)
+{
+   const unsigned long long target = (s->count * (unsigned)p + 99) / 100;
+   unsigned long long sum = 0;
+   int i;
+
+   for (i = 0; i < DP_SYSCALL_STATS_BUCKETS - 1; i++) {
+
+      sum += s->hist[i];
+
+      if (sum >= target)
+         break;
+   }
+
+   if (i == DP_SYSCALL_STATS_BUCKETS - 1) {
+      buf[0] = '>';
+      fmt_cycles(buf + 1, sz - 1, 1ULL << i);
+      return buf;
+   }
+
+   return fmt_cycles(buf, sz, 1ULL << (i + 1));
+}
+
+static void dp_show_syscalls(void)
+{
+   unsigned long long tot_calls = 0, tot_cycles = 0;
+   char b1[16], b2[16], b3[16], b4[16], b5[16];
+
+   row = tui_screen_start_row;
+
+   if (!got_data) {
+
+      if (load_errno == EOPNOTSUPP || load_errno == ENOTSUP) {
+
+         dp_writeln(
+            "Not available: recompile with KRN_SYSCALL_STATS=1");
+
+      } else {
+
+         dp_writeln(E_COLOR_BR_RED
+                    "TILCK_CMD_DP_GET_SYSCALL_STATS failed (errno=%d)"
+                    RESET_ATTRS, load_errno);
+      }
+
+      return;
+   }
+
+   for (int i = 0; i < stats_count; i++) {
+      tot_calls += stats[i].count;
+      tot_cycles += stats[i].tot_cycles;
+   }
+
+   dp_writeln("Syscalls used:   %5d", stats_count);
+   dp_writeln("Total calls:     %5llu", tot_calls);
+   dp_writeln("Total cycles:    %5s",
+              fmt_cycles(b1, sizeof(b1), tot_cycles));
+
+   dp_writeln(
+      "Order by: "
+      E_COLOR_BR_WHITE "t" RESET_ATTRS "otal time, "
+      E_COLOR_BR_WHITE "c" RESET_ATTRS "alls, "
+      E_COLOR_BR_WHITE "a" RESET_ATTRS "vg, "
+      E_COLOR_BR_WHITE "m" RESET_ATTRS "ax. "
+      E_COLOR_BR_WHITE "r" RESET_ATTRS "eload");
+
+   dp_writeln(" ");
+
+   dp_writeln(
+                 "    Syscall      "
+      TERM_VLINE "%s" "  Calls  "  RESET_ATTRS
+      TERM_VLINE "%s" " Cycles "   RESET_ATTRS
+      TERM_VLINE " Time%% "
+      TERM_VLINE "%s" "  Avg  "    RESET_ATTRS
+      TERM_VLINE "%s" "  Max  "    RESET_ATTRS
+      TERM_VLINE "  p50  "
+      TERM_VLINE "  p99  ",
+      order_by == 'c' ? E_COLOR_BR_WHITE REVERSE_VIDEO : "",
+      order_by == 't' ? E_COLOR_BR_WHITE REVERSE_VIDEO : "",
+      order_by == 'a' ? E_COLOR_BR_WHITE REVERSE_VIDEO : "",
+      order_by == 'm' ? E_COLOR_BR_WHITE REVERSE_VIDEO : "");
+
+   dp_writeln(
+      GFX_ON
+      "qqqqqqqqqqqqqqqqqnqqqqqqqqqnqqqqqqqqnqqqqqqqnqqqqqqqnqqqqqqqn"
+      "qqqqqqqnqqqqqqq"
+      GFX_OFF
+   );
+
+   for (int i = 0; i < stats_count; i++) {
+
+      const struct dp_syscall_stats *s = &stats[i];
+      const unsigned long long pct1k =
+         tot_cycles ? s->tot_cycles * 1000 / tot_cycles : 0;
+
+      dp_writeln(" %3u %-11.11s "
+                 TERM_VLINE " %7llu "
+                 TERM_VLINE " %6s "
+                 TERM_VLINE " %3llu.%llu "
+                 TERM_VLINE " %5s "
+                 TERM_VLINE " %5s "
+                 TERM_VLINE " %5s "
+                 TERM_VLINE " %5s ",
+                 s->sys_n,
+                 get_sys_name(s->sys_n),
+                 (unsigned long long)s->count,
+                 fmt_cycles(b1, sizeof(b1), s->tot_cycles),
+                 pct1k / 10,
+                 pct1k % 10,
+                 fmt_cycles(b2, sizeof(b2), avg_cycles(s)),
+                 fmt_cycles(b3, sizeof(b3), s->max_cycles),
+                 fmt_percentile(b4, sizeof(b4), s, 50),
+                 fmt_percentile(b5, sizeof(b5), s, 99));
+   }
+
+   dp_writeln(" ");
+}
+
+static struct dp_screen dp_syscalls_screen = {
+   .index = 7,
+   .label = "Syscalls",
+   .draw_func = dp_show_syscalls,
+   .on_dp_enter = dp_syscalls_on_enter,
+   .on_keypress_func = dp_syscalls_keypress,
+};
+
+__attribute__((constructor))
+static void dp_syscalls_register(void)
+{
+   dp_register_screen(&dp_syscalls_screen);
+}
@@ -278,7 +278,7 @@ static void dp_tasks_enter(void)
    sel_index = 0;
    sel_tid = -1;
    mode = tm_default;
-   dp_tasks_refresh();
+   dp_tasks_refresh_passive();
 }
 
 /*
@@ -407,7 +407,7 @@ sel_keypress(struct key_event ke)
          return dp_kb_handler_ok_and_continue;
 
       case 'r':
-         dp_tasks_refresh();
+         dp_tasks_refresh_passive();
          ui_need_update = true;
          return dp_kb_handler_ok_and_continue;
 
@@ -475,7 +475,7 @@ static enum dp_kb_handler_action
 default_keypress(struct key_event ke)
 {
    if (ke.print_char == 'r') {
-      dp_tasks_refresh();
+      dp_tasks_refresh_passive();
       ui_need_update = true;
       return dp_kb_handler_ok_and_continue;
    }
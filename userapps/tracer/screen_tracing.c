@@ -49,6 +49,9 @@
 #define EVENTS_PATH       "/syst/tracing/events"
 #define RENDER_BUF_SZ     1024
 #define MAX_SYSCALLS      512
+#define EVENTS_BATCH      32       /* max events per read() */
+
+static struct dp_trace_event events_buf[EVENTS_BATCH];
 
 /* ----------------------- TILCK_CMD wrappers -------------------------- */
 
@@ -199,15 +202,21 @@ static void show_banner(void)
       TERM_VLINE " #Sys traced: " E_COLOR_BR_BLUE "%d" RESET_ATTRS " "
       TERM_VLINE " #Tasks traced: " E_COLOR_BR_BLUE "%d" RESET_ATTRS " "
       TERM_VLINE "\r\n"
-      TERM_VLINE " Printk lvl: " E_COLOR_BR_BLUE "%d" RESET_ATTRS
-      "\r\n",
+      TERM_VLINE " Printk lvl: " E_COLOR_BR_BLUE "%d" RESET_ATTRS " "
+      TERM_VLINE " Buf: " E_COLOR_BR_BLUE "%u/%u" RESET_ATTRS " "
+      TERM_VLINE " Dropped: %s%llu" RESET_ATTRS " "
+      TERM_VLINE "\r\n",
       st.force_exp_block ? E_COLOR_GREEN "ON" RESET_ATTRS
                          : E_COLOR_RED "OFF" RESET_ATTRS,
       st.dump_big_bufs   ? E_COLOR_GREEN "ON" RESET_ATTRS
                          : E_COLOR_RED "OFF" RESET_ATTRS,
       st.sys_traced_count,
       st.tasks_traced_count,
-      st.printk_lvl);
+      st.printk_lvl,
+      st.in_buf_count,
+      st.buf_capacity,
+      st.dropped_count ? E_COLOR_BR_RED : E_COLOR_BR_BLUE,
+      (unsigned long long)st.dropped_count);
 
    term_write(TERM_VLINE " Trace expr: " E_COLOR_YELLOW "%s" RESET_ATTRS,
                 filter_buf);
@@ -442,7 +451,9 @@ static void edit_traced_pids(void)
 
 /*
  * Drive the live tracing loop: read events from /syst/tracing/events
- * and render each one via the kernel renderer. Stops on:
+ * and render each one via the kernel renderer. Each read() returns up
+ * to EVENTS_BATCH events: reading them one by one, a busy traced task
+ * easily overruns the kernel's ring buffer. Stops on:
  *
  *   - Ctrl+C — exit the tracer entirely. Returns false. The TTY is
  *     in raw mode (ISIG cleared) so this arrives as byte 0x03 on
@@ -458,7 +469,6 @@ static void edit_traced_pids(void)
 static bool
 trace_live_loop(int events_fd)
 {
-   struct dp_trace_event ev;
    struct dp_render_ctx ctx = {0};
    char rbuf[RENDER_BUF_SZ];
    char c;
@@ -483,14 +493,18 @@ trace_live_loop(int events_fd)
       if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
          break;
 
-      n = read(events_fd, &ev, sizeof(ev));
+      n = read(events_fd, events_buf, sizeof(events_buf));
+
+      if (n >= (ssize_t)sizeof(events_buf[0])) {
 
-      if (n == (ssize_t)sizeof(ev)) {
+         for (size_t i = 0; i < (size_t)n / sizeof(events_buf[0]); i++) {
 
-         long rc = tr_render_event(&ev, rbuf, sizeof(rbuf), &ctx);
+            long rc = tr_render_event(&events_buf[i],
+                                      rbuf, sizeof(rbuf), &ctx);
 
-         if (rc > 0)
-            term_write_n(rbuf, (int)rc);
+            if (rc > 0)
+               term_write_n(rbuf, (int)rc);
+         }
 
          continue;
       }
@@ -552,22 +566,25 @@ static int dump_remaining_events(int events_fd)
 
    /* Drain. The events fd's kernel-side read is non-blocking-friendly
     * (returns -EAGAIN when empty), so loop until we hit that or EOF. */
-   struct dp_trace_event ev;
    struct dp_render_ctx ctx = {0};
    char rbuf[RENDER_BUF_SZ];
 
    while (1) {
 
-      ssize_t n = read(events_fd, &ev, sizeof(ev));
+      ssize_t n = read(events_fd, events_buf, sizeof(events_buf));
 
-      if (n == (ssize_t)sizeof(ev)) {
+      if (n >= (ssize_t)sizeof(events_buf[0])) {
 
          if (c == 'n' || c == 'N') {
 
-            long rc = tr_render_event(&ev, rbuf, sizeof(rbuf), &ctx);
+            for (size_t i = 0; i < (size_t)n / sizeof(events_buf[0]); i++) {
 
-            if (rc > 0)
-               term_write_n(rbuf, (int)rc);
+               long rc = tr_render_event(&events_buf[i],
+                                         rbuf, sizeof(rbuf), &ctx);
+
+               if (rc > 0)
+                  term_write_n(rbuf, (int)rc);
+            }
          }
 
          continue;
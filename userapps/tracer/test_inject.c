@@ -63,6 +63,7 @@
 #define EVENTS_PATH       "/syst/tracing/events"
 #define RENDER_BUF_SZ     1024
 #define STRESS_NEVENTS    10000
+#define STRESS_BATCH      32
 
 /* Pretend tid used by injected events. Distinct from any real task
  * so the renderer's by-tid scratch state stays uncontaminated when
@@ -88,6 +89,14 @@ cmd_inject_event(const struct dp_trace_event *ev)
                   (long)ev, 0L, 0L, 0L);
 }
 
+static long
+cmd_get_stats(struct dp_trace_stats *out)
+{
+   return syscall(TILCK_CMD_SYSCALL,
+                  TILCK_CMD_DP_TRACE_GET_STATS,
+                  (long)out, 0L, 0L, 0L);
+}
+
 /* ------------------------------ harness ------------------------------ */
 
 static int events_fd = -1;
@@ -966,6 +975,15 @@ tr_run_stress_test(void)
 
    drain_ring();
 
+   struct dp_trace_stats st_before = {0}, st_after = {0};
+
+   if (cmd_get_stats(&st_before) < 0) {
+      fprintf(stderr, "cmd_get_stats failed (errno=%d)\n", errno);
+      cmd_set_test_mode(0);
+      close(events_fd);
+      return 1;
+   }
+
    for (int i = 0; i < STRESS_NEVENTS; i++) {
 
       struct dp_trace_event ev;
@@ -981,21 +999,37 @@ tr_run_stress_test(void)
       }
    }
 
-   /* Drain and validate. */
+   /*
+    * Drain and validate. Read many events per read(), like the live
+    * tracer does: the kernel must return only whole events, in order.
+    */
+   static struct dp_trace_event batch[STRESS_BATCH];
    int n_read = 0;
    int n_bad = 0;
+   int n_partial = 0;
    int last_counter = -1;
+   int batch_n = 0;
+   int batch_i = 0;
    bool monotone = true;
    char render_buf[RENDER_BUF_SZ];
 
    while (1) {
 
-      struct dp_trace_event back;
-      ssize_t n = read(events_fd, &back, sizeof(back));
+      if (batch_i == batch_n) {
 
-      if (n != (ssize_t)sizeof(back))
-         break;
+         ssize_t n = read(events_fd, batch, sizeof(batch));
 
+         if (n < (ssize_t)sizeof(batch[0]))
+            break;
+
+         if (n % (ssize_t)sizeof(batch[0]))
+            n_partial++;
+
+         batch_n = (int)(n / (ssize_t)sizeof(batch[0]));
+         batch_i = 0;
+      }
+
+      struct dp_trace_event back = batch[batch_i++];
       n_read++;
 
       if (back.type != dp_te_sys_enter ||
@@ -1024,12 +1058,37 @@ tr_run_stress_test(void)
       tr_render_event(&back, render_buf, sizeof(render_buf), &rctx);
    }
 
+   if (cmd_get_stats(&st_after) < 0) {
+      fprintf(stderr, "cmd_get_stats failed (errno=%d)\n", errno);
+      cmd_set_test_mode(0);
+      close(events_fd);
+      return 1;
+   }
+
    cmd_set_test_mode(0);
    close(events_fd);
    events_fd = -1;
 
-   printf("  drained %d events (%d bad, monotone=%s)\n",
-          n_read, n_bad, monotone ? "yes" : "no");
+   const unsigned long long dropped =
+      st_after.dropped_count - st_before.dropped_count;
+
+   printf("  drained %d events (%d bad, monotone=%s), dropped: %llu\n",
+          n_read, n_bad, monotone ? "yes" : "no", dropped);
+
+   if (n_partial > 0) {
+      printf("  [FAIL] %d reads returned partial events\n", n_partial);
+      return 1;
+   }
+
+   /*
+    * Every injected event must have been either read or counted as
+    * dropped. Stray events (e.g. trace_printk) can only make the sum
+    * bigger.
+    */
+   if ((unsigned long long)n_read + dropped < STRESS_NEVENTS) {
+      printf("  [FAIL] events lost without being counted as dropped\n");
+      return 1;
+   }
 
    if (n_read == 0) {
       printf("  [FAIL] no events drained\n");